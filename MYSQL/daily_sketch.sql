@@ -0,0 +1,12 @@
+create table daily_sketch
+(
+    day     date             not null comment '日期（本地时间）',
+    node    int              not null comment '节点编号',
+    channel tinyint unsigned not null comment '通道：0空气温度 1空气湿度 2氧气含量 3土壤温度 4土壤湿度 5光照强度',
+    sketch  blob             not null comment '当天该节点该通道的分位数草图（t-digest序列化）',
+    primary key (day, node, channel)
+)
+    comment '每日分位数草图（入库时维护，用于每日分布箱线图，不必扫描原始数据）';
+
+create index idx_channel_day
+    on daily_sketch (channel, day);
@@ -4,6 +4,8 @@ QT       += core gui sql network serialport printsupport
 INCLUDEPATH += $$PWD
 HEADERS += $$PWD/qcustomplot.h
 SOURCES += $$PWD/qcustomplot.cpp
+# 曲线数据按键/值两个数组存放（QCPDataContainer<QCPGraphData>的结构数组版本）
+DEFINES += QCUSTOMPLOT_USE_SOA_GRAPHDATA
 
 # 添加Qxlsx支持
 include($$PWD/QXlsx/QXlsx.pri)
@@ -13,26 +15,63 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 CONFIG += c++17
 
+# LOG_TRACE只在调试构建中编译进来，发布构建中整条语句不存在
+CONFIG(debug, debug|release): DEFINES += SENSOR_LOG_ENABLE_TRACE
+
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    config.cpp \
     debugging.cpp \
     databaseworker.cpp \
+    excelexport.cpp \
+    frameparser.cpp \
+    historychart.cpp \
+    latencytrace.cpp \
+    logger.cpp \
+    logringmodel.cpp \
     main.cpp \
+    metrics.cpp \
+    metricsserver.cpp \
     msgworker.cpp \
     mysql.cpp \
+    nodeheatmap.cpp \
+    packetcapture.cpp \
     mytcpserver.cpp \
+    sequencetracker.cpp \
+    serialworker.cpp \
+    udpworker.cpp \
     widget.cpp
 
 HEADERS += \
+    boundedqueue.h \
+    config.h \
+    dailysketch.h \
     databaseworker.h \
     debugging.h \
+    excelexport.h \
+    frameparser.h \
+    historychart.h \
+    historytile.h \
+    latencytrace.h \
+    logger.h \
+    logringmodel.h \
+    metrics.h \
+    metricsserver.h \
     msgworker.h \
     mysql.h \
+    mpscring.h \
+    nodeheatmap.h \
+    packetcapture.h \
     mytcpserver.h \
+    quantilesketch.h \
+    queuestats.h \
     sensordata.h \
+    sequencetracker.h \
+    serialworker.h \
+    udpworker.h \
     widget.h
 
 FORMS += \
@@ -0,0 +1,219 @@
+﻿#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <QString>
+#include <QVector>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QTemporaryFile>
+#include <QDataStream>
+#include <QDir>
+#include <QByteArray>
+#include "logger.h"
+#include "queuestats.h"
+
+// 队列满时的处理策略
+enum class OverflowPolicy {
+    DropOldest,  // 丢弃最旧的元素（界面快照：只关心最新数据）
+    DropNewest,  // 丢弃新到的元素
+    Block,       // 阻塞生产者直到有空位（向上游施加背压）
+    SpillToDisk  // 溢出部分写入磁盘文件，消费者追上后再读回（存储：运行期间不丢数据）
+};
+
+// BoundedQueue - 有界多生产者/单消费者队列
+// 生产者线程调用push()，消费者按自己的节奏（定时器，每帧或每批）调用popBatch()一次取走多个元素，
+// 代替逐条的跨线程排队信号，使各级之间积压的数据量有上限。
+// SpillToDisk策略要求T支持QDataStream的<<和>>。溢出文件是本进程独占的临时文件，队列析构时删除，
+// 不能跨重启保留数据：进程崩溃或被杀时尚未读回的溢出数据随之丢失。
+template <typename T>
+class BoundedQueue
+{
+public:
+    BoundedQueue(const QString &name, int capacity, OverflowPolicy policy)
+        : m_name(name), m_capacity(qMax(1, capacity)), m_policy(policy)
+    {
+        m_ring.resize(m_capacity);
+    }
+
+    ~BoundedQueue()
+    {
+        if (m_spillFile.isOpen()) {
+            m_spillFile.close();
+            m_spillFile.remove();
+        }
+    }
+
+    // 入队；元素被丢弃或队列已关闭时返回false
+    bool push(const T &item)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_closed) {
+            m_stats.dropped++;
+            return false;
+        }
+
+        if (m_size == m_capacity || (m_policy == OverflowPolicy::SpillToDisk && m_spillCount > 0)) {
+            switch (m_policy) {
+            case OverflowPolicy::DropOldest:
+                m_head = (m_head + 1) % m_capacity;
+                m_size--;
+                m_stats.dropped++;
+                break;
+            case OverflowPolicy::DropNewest:
+                m_stats.dropped++;
+                return false;
+            case OverflowPolicy::Block:
+                while (m_size == m_capacity && !m_closed) {
+                    m_notFull.wait(&m_mutex);
+                }
+                if (m_closed) {
+                    m_stats.dropped++;
+                    return false;
+                }
+                break;
+            case OverflowPolicy::SpillToDisk:
+                // 一旦开始溢出，后续元素也写入文件，保证先进先出
+                if (spill(item)) {
+                    m_stats.pushed++;
+                    return true;
+                }
+                m_stats.dropped++;
+                return false;
+            }
+        }
+
+        m_ring[(m_head + m_size) % m_capacity] = item;
+        m_size++;
+        m_stats.pushed++;
+        if (m_size > m_stats.highWater) {
+            m_stats.highWater = m_size;
+        }
+        return true;
+    }
+
+    // 一次取走最多maxItems个元素追加到out，返回取走的个数
+    int popBatch(QVector<T> &out, int maxItems)
+    {
+        QMutexLocker locker(&m_mutex);
+        int n = qMin(maxItems, m_size);
+        out.reserve(out.size() + n);
+        for (int i = 0; i < n; ++i) {
+            out.append(m_ring[m_head]);
+            m_ring[m_head] = T();// 释放元素持有的资源（如QString）
+            m_head = (m_head + 1) % m_capacity;
+        }
+        m_size -= n;
+        m_stats.popped += n;
+
+        if (m_spillCount > 0 && m_size < m_capacity / 2) {
+            unspill();
+        }
+        if (n > 0 && m_policy == OverflowPolicy::Block) {
+            m_notFull.wakeAll();
+        }
+        return n;
+    }
+
+    // 关闭队列：唤醒所有阻塞的生产者，之后的push都会失败
+    void close()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_closed = true;
+        m_notFull.wakeAll();
+    }
+
+    // 积压总数（内存+磁盘）
+    qint64 size() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_size + m_spillCount;
+    }
+
+    QueueStats stats() const
+    {
+        QMutexLocker locker(&m_mutex);
+        QueueStats s = m_stats;
+        s.name = m_name;
+        s.depth = m_size;
+        s.capacity = m_capacity;
+        s.spilled = m_spillCount;
+        return s;
+    }
+
+private:
+    QString m_name;
+    int m_capacity;
+    OverflowPolicy m_policy;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_notFull;
+    QVector<T> m_ring;   // 环形缓冲区
+    int m_head = 0;      // 队头位置
+    int m_size = 0;      // 元素个数
+    bool m_closed = false;
+    QueueStats m_stats;
+
+    // 磁盘溢出：顺序追加写，顺序读回，读完后截断
+    // 文件名带随机后缀，同一台机器上的多个实例（或同名队列）不会互相截断对方的文件
+    QTemporaryFile m_spillFile;
+    qint64 m_spillReadPos = 0;
+    qint64 m_spillWritePos = 0; // 最后一条完整写入的记录的末尾
+    qint64 m_spillCount = 0;
+
+    bool spill(const T &item)
+    {
+        if (!m_spillFile.isOpen()) {
+            m_spillFile.setFileTemplate(QDir::temp().filePath(QString("SerialAndTCP_%1_XXXXXX.spill").arg(m_name)));
+            if (!m_spillFile.open()) {
+                LOG_WARNING("queue", "无法创建溢出文件", {"queue", m_name}, {"error", m_spillFile.errorString()});
+                return false;
+            }
+            m_spillReadPos = 0;
+            m_spillWritePos = 0;
+        }
+        // 先序列化到内存，整条记录一次写入并核对字节数；
+        // 磁盘满等原因只写入一部分时截断回上一条完整记录的末尾，文件中不留半条记录，读回时不会错位
+        QByteArray record;
+        {
+            QDataStream out(&record, QIODevice::WriteOnly);
+            out << item;
+        }
+        if (!m_spillFile.seek(m_spillWritePos) || m_spillFile.write(record) != record.size() || !m_spillFile.flush()) {
+            LOG_WARNING("queue", "写入溢出文件失败，丢弃", {"queue", m_name}, {"error", m_spillFile.errorString()});
+            m_spillFile.resize(m_spillWritePos);
+            return false;
+        }
+        m_spillWritePos += record.size();
+        m_spillCount++;
+        return true;
+    }
+
+    void unspill()
+    {
+        m_spillFile.seek(m_spillReadPos);
+        QDataStream in(&m_spillFile);
+        while (m_spillCount > 0 && m_size < m_capacity) {
+            T item;
+            in >> item;
+            if (in.status() != QDataStream::Ok) {
+                LOG_WARNING("queue", "溢出文件读取失败，丢弃", {"queue", m_name}, {"count", m_spillCount});
+                m_stats.dropped += static_cast<quint64>(m_spillCount);
+                m_spillCount = 0;
+                break;
+            }
+            m_ring[(m_head + m_size) % m_capacity] = item;
+            m_size++;
+            m_spillCount--;
+        }
+        m_spillReadPos = m_spillFile.pos();
+        if (m_spillCount == 0) {
+            // 溢出数据已全部读回，截断文件
+            m_spillFile.resize(0);
+            m_spillReadPos = 0;
+            m_spillWritePos = 0;
+        }
+    }
+};
+
+#endif // BOUNDEDQUEUE_H
@@ -0,0 +1,163 @@
+﻿// config.cpp - 配置文件的载入、校验与热加载
+
+#include "config.h"
+#include "logger.h"
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QSettings>
+#include <QtMath>
+
+static const int kReloadDelayMs = 300; // 文件改动后等待写完再重新载入
+
+static const char *const kAlarmKeys[AppConfig::kAlarmChannels] = {"atemp", "ahumi", "oxygen", "stemp", "shumi2", "light"};
+
+static const AppConfig kDefaultConfig;
+std::atomic<const AppConfig *> Config::s_current{&kDefaultConfig};
+
+AppConfig::AppConfig()
+{
+    for (double &threshold : alarmThresholds) {
+        threshold = qQNaN();
+    }
+}
+
+// 读取整数，缺省或超出范围时用默认值
+static int readInt(const QSettings &settings, const char *key, int fallback, int min, int max)
+{
+    if (!settings.contains(key)) {
+        return fallback;
+    }
+    bool ok = false;
+    const int value = settings.value(key).toInt(&ok);
+    if (!ok || value < min || value > max) {
+        LOG_WARNING("config", "配置值无效，使用默认值", {"key", key}, {"value", settings.value(key).toString()},
+                    {"default", fallback});
+        return fallback;
+    }
+    return value;
+}
+
+static QString readString(const QSettings &settings, const char *key, const QString &fallback)
+{
+    return settings.contains(key) ? settings.value(key).toString() : fallback;
+}
+
+static bool sameConfig(const AppConfig &a, const AppConfig &b)
+{
+    for (int i = 0; i < AppConfig::kAlarmChannels; ++i) {
+        const double x = a.alarmThresholds[i];
+        const double y = b.alarmThresholds[i];
+        if (qIsNaN(x) != qIsNaN(y) || (!qIsNaN(x) && x != y)) {
+            return false;
+        }
+    }
+    return a.port == b.port && a.dbHost == b.dbHost && a.dbPort == b.dbPort && a.dbName == b.dbName
+           && a.dbUser == b.dbUser && a.dbPassword == b.dbPassword && a.storeBatchSize == b.storeBatchSize
+           && a.storeMaxBatchesPerTick == b.storeMaxBatchesPerTick && a.storeDrainIntervalMs == b.storeDrainIntervalMs
+           && a.storeQueueCapacity == b.storeQueueCapacity && a.retryBufferRows == b.retryBufferRows
+           && a.maxDataPoints == b.maxDataPoints && a.fps == b.fps && a.uiQueueCapacity == b.uiQueueCapacity
+           && a.rawQueueCapacity == b.rawQueueCapacity && a.shutdownDeadlineMs == b.shutdownDeadlineMs
+           && a.metricsPort == b.metricsPort && a.metricsBind == b.metricsBind && a.logLevel == b.logLevel;
+}
+
+Config &Config::instance()
+{
+    static Config config;
+    return config;
+}
+
+Config::Config()
+{
+    m_reloadTimer.setSingleShot(true);
+    m_reloadTimer.setInterval(kReloadDelayMs);
+    connect(&m_reloadTimer, &QTimer::timeout, this, &Config::reload);
+}
+
+void Config::load(const QString &fileName)
+{
+    m_fileName = QFileInfo(fileName).absoluteFilePath();
+    if (!m_watcher) {
+        m_watcher = new QFileSystemWatcher(this);
+        connect(m_watcher, &QFileSystemWatcher::fileChanged, &m_reloadTimer, qOverload<>(&QTimer::start));
+        connect(m_watcher, &QFileSystemWatcher::directoryChanged, &m_reloadTimer, qOverload<>(&QTimer::start));
+    }
+    // 同时监视所在目录，文件被替换或之后才创建时也能收到通知
+    m_watcher->addPath(QFileInfo(m_fileName).absolutePath());
+    if (!QFileInfo::exists(m_fileName)) {
+        LOG_INFO("config", "配置文件不存在，使用默认配置", {"file", m_fileName});
+    }
+    reload();
+}
+
+void Config::watchFile()
+{
+    if (QFileInfo::exists(m_fileName) && !m_watcher->files().contains(m_fileName)) {
+        m_watcher->addPath(m_fileName);
+    }
+}
+
+//解析配置文件，整份替换当前快照
+void Config::reload()
+{
+    watchFile();
+    // 文件暂时不存在（正在被替换）或被删除时保持当前配置
+    if (!QFileInfo::exists(m_fileName)) {
+        return;
+    }
+    QSettings settings(m_fileName, QSettings::IniFormat);
+    if (settings.status() != QSettings::NoError) {
+        LOG_WARNING("config", "配置文件格式错误，保持当前配置", {"file", m_fileName});
+        return;
+    }
+
+    // 从默认值开始解析：删掉的键恢复默认值
+    AppConfig *next = new AppConfig;
+    next->port = quint16(readInt(settings, "network/port", next->port, 1, 65535));
+
+    next->dbHost = readString(settings, "database/host", next->dbHost);
+    next->dbPort = readInt(settings, "database/port", next->dbPort, 1, 65535);
+    next->dbName = readString(settings, "database/name", next->dbName);
+    next->dbUser = readString(settings, "database/user", next->dbUser);
+    next->dbPassword = readString(settings, "database/password", next->dbPassword);
+
+    next->storeBatchSize = readInt(settings, "store/batch_size", next->storeBatchSize, 1, 100000);
+    next->storeMaxBatchesPerTick = readInt(settings, "store/max_batches_per_tick", next->storeMaxBatchesPerTick, 1, 1000);
+    next->storeDrainIntervalMs = readInt(settings, "store/drain_interval_ms", next->storeDrainIntervalMs, 10, 60000);
+    next->storeQueueCapacity = readInt(settings, "store/queue_capacity", next->storeQueueCapacity, 1, 10000000);
+    next->retryBufferRows = readInt(settings, "store/retry_buffer_rows", next->retryBufferRows, 0, 10000000);
+
+    next->maxDataPoints = readInt(settings, "ui/max_data_points", next->maxDataPoints, 2, 1000000);
+    next->fps = readInt(settings, "ui/fps", next->fps, 1, 120);
+    next->uiQueueCapacity = readInt(settings, "ui/queue_capacity", next->uiQueueCapacity, 1, 1000000);
+    next->rawQueueCapacity = readInt(settings, "ui/raw_queue_capacity", next->rawQueueCapacity, 1, 1000000);
+
+    for (int i = 0; i < AppConfig::kAlarmChannels; ++i) {
+        const QString key = QString("alarm/") + kAlarmKeys[i];
+        if (!settings.contains(key)) {
+            continue;
+        }
+        bool ok = false;
+        const double threshold = settings.value(key).toDouble(&ok);
+        if (ok) {
+            next->alarmThresholds[i] = threshold;
+        } else {
+            LOG_WARNING("config", "报警阈值无效，忽略", {"key", key}, {"value", settings.value(key).toString()});
+        }
+    }
+
+    next->shutdownDeadlineMs = readInt(settings, "shutdown/deadline_ms", next->shutdownDeadlineMs, 0, 600000);
+
+    next->metricsPort = quint16(readInt(settings, "metrics/port", next->metricsPort, 0, 65535));
+    next->metricsBind = readString(settings, "metrics/bind", next->metricsBind);
+    next->logLevel = readString(settings, "log/level", next->logLevel);
+
+    const AppConfig *previous = &current();
+    if (sameConfig(*previous, *next)) {
+        delete next;
+        return;
+    }
+    m_snapshots.append(next);
+    s_current.store(next, std::memory_order_release);
+    LOG_INFO("config", "已载入配置", {"file", m_fileName}, {"version", int(m_snapshots.size())});
+    emit changed(previous, next);
+}
@@ -0,0 +1,93 @@
+﻿#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <QObject>
+#include <QList>
+#include <QString>
+#include <QTimer>
+#include <atomic>
+
+class QFileSystemWatcher;
+
+// AppConfig - 一份完整的运行配置（只读快照），各字段的默认值即未配置时的取值
+// 对应配置文件（INI）中的 [分组] 键，见README“配置文件”
+struct AppConfig {
+    // [network]
+    quint16 port = 1210;               // TCP监听端口，UDP使用同一端口号
+
+    // [database]
+    QString dbHost = "localhost";
+    int dbPort = 3306;
+    QString dbName = "test";
+    QString dbUser = "root";
+    QString dbPassword = "123456";
+
+    // [store]
+    int storeBatchSize = 500;          // 每个事务最多写入的条数
+    int storeMaxBatchesPerTick = 8;    // 每次定时器触发最多写入的批数
+    int storeDrainIntervalMs = 200;    // 批量写入间隔
+    int storeQueueCapacity = 10000;    // 待入库队列容量（启动时生效）
+    int retryBufferRows = 20000;       // 断线期间重试缓冲的条数上限
+
+    // [ui]
+    int maxDataPoints = 300;           // 实时曲线保留的点数
+    int fps = 30;                      // 界面每秒取出队列、刷新曲线的次数上限
+    int uiQueueCapacity = 1024;        // 界面快照队列容量（启动时生效）
+    int rawQueueCapacity = 2048;       // 调试窗口原始数据队列容量（启动时生效）
+
+    // [alarm] 报警阈值，顺序同SensorData：空气温度、空气湿度、氧气、土壤温度、土壤湿度、光照
+    // 配置了的通道启用报警并填入阈值；未配置（NaN）的通道保持界面上的设置
+    static const int kAlarmChannels = 6;
+    double alarmThresholds[kAlarmChannels];
+
+    // [shutdown]
+    int shutdownDeadlineMs = 5000;     // 退出时读完连接中的数据并写完待入库数据的期限
+
+    // [metrics] / [log]（命令行指定时以命令行为准）
+    quint16 metricsPort = 9464;
+    QString metricsBind = "127.0.0.1"; // 指标服务监听的地址，默认只允许本机抓取；0.0.0.0为全部网卡
+    QString logLevel = "info";
+
+    AppConfig();
+};
+
+// Config - 配置文件的载入与热加载
+// 启动时载入，之后用QFileSystemWatcher监视，文件改动后重新解析成一份新快照，再一次性替换当前快照（RCU方式）：
+// 热路径（接收线程、数据库线程、界面每帧）用current()无锁读取，读到的要么是旧快照要么是新快照，不会读到一半。
+// 旧快照不释放（配置很少改动，每份只有几百字节），读者不需要登记或加锁，引用在程序结束前一直有效。
+// 替换后发出changed(previous, current)，需要额外动作的模块（重新监听端口、重连数据库、调整定时器）据此处理。
+class Config : public QObject
+{
+    Q_OBJECT
+public:
+    static Config &instance();
+
+    // 当前快照，任意线程无锁读取
+    static const AppConfig &current() { return *s_current.load(std::memory_order_acquire); }
+
+    // 载入配置文件并开始监视；文件不存在时使用默认值，出现后自动载入
+    void load(const QString &fileName);
+    QString fileName() const { return m_fileName; }
+
+signals:
+    // 配置已替换（在界面线程发出，previous/current在程序结束前一直有效）
+    void changed(const AppConfig *previous, const AppConfig *current);
+
+private:
+    Config();
+    Q_DISABLE_COPY(Config)
+
+    // 重新解析配置文件，内容有变化时替换当前快照
+    void reload();
+    // 编辑器常以“写新文件再改名”的方式保存，被替换的文件会从监视列表中消失，需重新加入
+    void watchFile();
+
+    static std::atomic<const AppConfig *> s_current;
+
+    QString m_fileName;
+    QFileSystemWatcher *m_watcher = nullptr;
+    QTimer m_reloadTimer;                 // 合并短时间内的多次改动通知
+    QList<const AppConfig *> m_snapshots; // 全部快照（不释放）
+};
+
+#endif // CONFIG_H
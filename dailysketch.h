@@ -0,0 +1,36 @@
+﻿#ifndef DAILYSKETCH_H
+#define DAILYSKETCH_H
+
+#include <QDate>
+#include <QHash>
+#include <QMetaType>
+#include <QVector>
+
+// DailySketchKey - 每日分位数草图的编号（本地日期 × 节点），每个编号下六个通道各一个草图
+struct DailySketchKey {
+    qint64 day = 0; // QDate::toJulianDay()
+    int node = 0;
+
+    bool operator==(const DailySketchKey &other) const { return day == other.day && node == other.node; }
+    bool operator!=(const DailySketchKey &other) const { return !(*this == other); }
+};
+
+inline size_t qHash(const DailySketchKey &key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.day, key.node);
+}
+
+// DailyDistribution - 某通道一天的分布（全部节点合并后的草图求出的分位数），用于箱线图
+struct DailyDistribution {
+    QDate day;
+    double minimum = 0;
+    double lowerQuartile = 0;
+    double median = 0;
+    double upperQuartile = 0;
+    double maximum = 0;
+    double count = 0; // 当天读数条数
+};
+
+Q_DECLARE_METATYPE(DailyDistribution)
+
+#endif // DAILYSKETCH_H
@@ -7,14 +7,30 @@
 #include <QMutexLocker>
 #include <QSqlQuery>
 #include <QDateTime>
-#include <QDebug>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QDataStream>
+#include <QMap>
+#include <QRandomGenerator>
+#include "metrics.h"
+#include "latencytrace.h"
+#include "logger.h"
 
-DatabaseWorker::DatabaseWorker(QObject *parent) : QObject(parent)
+// 批量写入的间隔、批大小、重试缓冲上限和连接参数见Config（[store]、[database]），可热加载
+static const int kSketchFlushIntervalMs = 60000; // 每日草图写回数据库的间隔
+static const int kSketchChannels = 6;          // 空气温度、空气湿度、氧气、土壤温度、土壤湿度、光照
+static const int kReconnectInitialMs = 1000;   // 连接失败后第一次重试的等待时间
+static const int kReconnectMaxMs = 60000;      // 重试等待时间上限
+static const int kHealthCheckIntervalMs = 5000; // 连接后ping的间隔
+static const int kConnectTimeoutSec = 3;        // 连接超时（MYSQL_OPT_CONNECT_TIMEOUT）
+static const char *const kInsertGreenhouseSql =
+    "INSERT INTO greenhouse_data (collect_time, air_temp, air_humidity, oxygen_content, soil_temp, soil_humidity, light_intensity) VALUES (?, ?, ?, ?, ?, ?, ?);";
+
+DatabaseWorker::DatabaseWorker(OverflowPolicy storePolicy, int storeCapacity, QObject *parent)
+    : QObject(parent)
+    , m_storeQueue(new BoundedQueue<SensorData>("store", storeCapacity, storePolicy))
 {
-    qDebug() << "[DatabaseWorker] 构造函数被调用";
-    
-    // 初始化数据库连接对象
-    db = QSqlDatabase::addDatabase("QMYSQL");
+    // 数据库连接在数据库线程中建立（connectToMysql），这里不加载驱动，构造不阻塞界面线程
     
     // 初始化属性映射表
     attributeMap["空气温度"] = "air_temp";
@@ -23,12 +39,14 @@ DatabaseWorker::DatabaseWorker(QObject *parent) : QObject(parent)
     attributeMap["土壤温度"] = "soil_temp";
     attributeMap["土壤含水量"] = "soil_humidity";
     attributeMap["光照强度"] = "light_intensity";
-    
-    qDebug() << "[DatabaseWorker] 属性映射表初始化完成";
+
+    LOG_DEBUG("db", "数据库工作对象已创建", {"storeCapacity", storeCapacity});
 }
 
 DatabaseWorker::~DatabaseWorker()
 {
+    // 唤醒可能阻塞在队列上的接收线程
+    m_storeQueue->close();
     // 确保在对象销毁前断开数据库连接
     disconnectFromDatabase();
 }
@@ -43,6 +61,7 @@ bool DatabaseWorker::connectToMysql()
     if (QSqlDatabase::contains("mysqlConnection")) {
         db = QSqlDatabase::database("mysqlConnection");
         if (db.isOpen()) {
+            setConnectionState(ConnectionState::Connected);
             emit connectionStatusChanged(true, "数据库连接已存在且可用");
             return true;
         }
@@ -52,82 +71,563 @@ bool DatabaseWorker::connectToMysql()
     
     // 创建并配置新连接
     db = QSqlDatabase::addDatabase("QMYSQL", "mysqlConnection");
-    db.setHostName("localhost");
-    db.setPort(3306);
-    db.setDatabaseName("test");
-    db.setUserName("root");
-    db.setPassword("123456");
+    const AppConfig &config = Config::current();
+    db.setHostName(config.dbHost);
+    db.setPort(config.dbPort);
+    db.setDatabaseName(config.dbName);
+    db.setUserName(config.dbUser);
+    db.setPassword(config.dbPassword);
+    // 数据库不可达时几秒内失败，之后按退避重试，不长时间占住数据库线程
+    db.setConnectOptions(QString("MYSQL_OPT_CONNECT_TIMEOUT=%1").arg(kConnectTimeoutSec));
     
     // 尝试打开连接
     if (!db.open()) {
         QString error = db.lastError().text();
-        db = QSqlDatabase();
-        if (QSqlDatabase::contains("mysqlConnection")) {
-            QSqlDatabase::removeDatabase("mysqlConnection");
-        }
+        closeConnection();
         emit connectionStatusChanged(false, "连接失败: " + error);
         return false;
     }
     
+    // 插入语句在每次（重新）连接后预处理一次，之后每批只绑定参数
+    m_insertQuery = QSqlQuery(db);
+    if (!prepareGreenhouseInsert(m_insertQuery)) {
+        QString error = m_insertQuery.lastError().text();
+        closeConnection();
+        emit connectionStatusChanged(false, "预处理插入语句失败: " + error);
+        return false;
+    }
+    
+    setConnectionState(ConnectionState::Connected);
     emit connectionStatusChanged(true, "数据库连接成功");
     return true;
 }
 
+// 启动批量写入定时器（在数据库线程中执行，定时器归属本线程）
+void DatabaseWorker::startStoreDrain()
+{
+    if (m_drainTimer) {
+        return;
+    }
+    m_drainTimer = new QTimer(this);
+    connect(m_drainTimer, &QTimer::timeout, this, &DatabaseWorker::drainStoreQueue);
+    m_drainTimer->start(Config::current().storeDrainIntervalMs);
+
+    m_sketchFlushTimer = new QTimer(this);
+    connect(m_sketchFlushTimer, &QTimer::timeout, this, &DatabaseWorker::onSketchFlushTimeout);
+    m_sketchFlushTimer->start(kSketchFlushIntervalMs);
+}
+
+// 从待入库队列取出数据批量写入
+void DatabaseWorker::drainStoreQueue()
+{
+    static MetricGauge *const retryRows =
+        Metrics::instance().gauge("sensor_db_retry_buffer_rows", "断线期间重试缓冲中等待写入的条数");
+
+    const AppConfig &config = Config::current();
+    QVector<SensorData> batch;
+    if (!isConnected()) {
+        // 断线期间继续取出待入库队列，放进重试缓冲，缓冲满后才留在队列中
+        while (m_retryRows + config.storeBatchSize <= config.retryBufferRows
+               && m_storeQueue->popBatch(batch, config.storeBatchSize) > 0) {
+            bufferForRetry(batch, false);
+            batch.clear();
+        }
+        retryRows->set(m_retryRows);
+        return;
+    }
+
+    // 每次最多写入若干批，剩余的留到下一次，避免长时间占住数据库线程而耽误查询
+    // 先写重试缓冲中的数据，保持写入顺序
+    for (int i = 0; i < config.storeMaxBatchesPerTick && isConnected(); ++i) {
+        if (!m_retryBatches.isEmpty()) {
+            batch = m_retryBatches.takeFirst();
+            m_retryRows -= batch.size();
+        } else if (m_storeQueue->popBatch(batch, config.storeBatchSize) == 0) {
+            break;
+        }
+        storeGreenhouseBatch(batch);
+        batch.clear();
+    }
+    retryRows->set(m_retryRows);
+}
+
+//退出前写完剩余数据
+DatabaseWorker::FlushResult DatabaseWorker::flushForShutdown(int timeoutMs)
+{
+    QElapsedTimer clock;
+    clock.start();
+    FlushResult result;
+
+    // 此后写入中断线不再安排重连，剩余数据直接计为未写入
+    m_shuttingDown = true;
+    if (m_drainTimer) {
+        m_drainTimer->stop();
+    }
+    if (m_reconnectTimer) {
+        m_reconnectTimer->stop();
+    }
+    if (m_healthTimer) {
+        m_healthTimer->stop();
+    }
+    m_storeQueue->close();
+
+    // 正在等待重连：不再退避，立即再试一次；剩余时间不够一次连接超时就不试，避免超出期限
+    if (!isConnected() && m_state != ConnectionState::Disconnected && timeoutMs >= kConnectTimeoutSec * 1000
+        && (m_retryRows > 0 || m_storeQueue->size() > 0)) {
+        connectToMysql();
+    }
+
+    const AppConfig &config = Config::current();
+    QVector<SensorData> batch;
+    while (isConnected() && clock.elapsed() < timeoutMs) {
+        if (!m_retryBatches.isEmpty()) {
+            batch = m_retryBatches.takeFirst();
+            m_retryRows -= batch.size();
+        } else if (m_storeQueue->popBatch(batch, config.storeBatchSize) == 0) {
+            break;
+        }
+        const StoreResult stored = storeGreenhouseBatch(batch);
+        result.flushed += stored.stored;
+        result.unwritten += stored.dropped; // 连接正常但写不进去，已丢弃
+        batch.clear(); // 断线时未写入的部分已放回重试缓冲，计入下面的剩余条数
+    }
+    result.unwritten += m_retryRows + m_storeQueue->size();
+    return result;
+}
+
+//放入重试缓冲
+void DatabaseWorker::bufferForRetry(const QVector<SensorData> &batch, bool front)
+{
+    if (front) {
+        m_retryBatches.prepend(batch);
+    } else {
+        m_retryBatches.append(batch);
+    }
+    m_retryRows += batch.size();
+}
+
 //插入数据
-void DatabaseWorker::storeGreenhouseData(double airTemp, double airHumidity, double oxygenContent, double soilTemp, double soilHumidity, double lightIntensity)
+DatabaseWorker::StoreResult DatabaseWorker::storeGreenhouseBatch(const QVector<SensorData> &batch)
 {
-    qDebug() << "[DatabaseWorker] 开始存储温室环境数据";
-    
+    static MetricCounter *const batchFailures =
+        Metrics::instance().counter("sensor_db_batch_failures_total", "写入或提交失败的批数");
+    static MetricCounter *const batchRetries =
+        Metrics::instance().counter("sensor_db_batch_retries_total", "连接正常但写入失败后整批重试的次数");
+    static MetricCounter *const rowsDropped =
+        Metrics::instance().counter("sensor_db_rows_dropped_total", "连接正常但写入失败而丢弃的条数");
+
     QMutexLocker locker(&mutex);
+    StoreResult result;
     if (!db.isOpen()) {
-        qDebug() << "[DatabaseWorker] 数据库连接未打开，无法存储数据";
-        // 可以考虑添加一个存储结果信号，与查询结果信号保持一致的错误处理风格
-        return;
+        bufferForRetry(batch, true);
+        return result;
     }
 
-    QSqlQuery query(db);
+    if (commitRowsLocked(batch)) {
+        result.stored = batch.size();
+        return result;
+    }
+    batchFailures->inc();
+    if (!pingLocked()) {
+        // 连接已断开：这一批放回重试缓冲，重连后再写
+        bufferForRetry(batch, true);
+        connectionLost("写入时连接断开");
+        return result;
+    }
+
+    // 连接正常：死锁、锁等待超时等暂时性错误已回滚整个事务，整批重试一次
+    batchRetries->inc();
+    if (commitRowsLocked(batch)) {
+        result.stored = batch.size();
+        return result;
+    }
+
+    // 仍然失败，多半是个别行写不进去：二分找出这些行丢弃，其余照常写入
+    splitAndStoreLocked(batch, 0, batch.size(), result);
+    if (result.dropped > 0) {
+        rowsDropped->inc(quint64(result.dropped));
+        LOG_ERROR("db", "写入失败，丢弃无法写入的数据", {"rows", result.dropped}, {"stored", result.stored},
+                  {"batch", int(batch.size())});
+    }
+    return result;
+}
+
+//写入并提交一批数据
+bool DatabaseWorker::commitRowsLocked(const QVector<SensorData> &rows)
+{
+    static MetricHistogram *const batchLatency =
+        Metrics::instance().histogram("sensor_db_batch_seconds", "一批数据写入并提交的耗时", 1e-6);
+    static MetricCounter *const rowsStored = Metrics::instance().counter("sensor_db_rows_stored_total", "已提交入库的条数");
+
+    const qint64 writeStart = LatencyTrace::now();
+    if (!insertGreenhouseRows(db, m_insertQuery, rows)) {
+        return false;
+    }
+    const qint64 committedAt = LatencyTrace::now();
+    batchLatency->record(committedAt - writeStart);
+    LatencyTrace::recordCommitted(rows, writeStart, committedAt);
+    rowsStored->inc(quint64(rows.size()));
+    // 只累加已经提交的数据，草图与表中的数据一致
+    addToDailySketches(rows);
+    return true;
+}
+
+//二分写入：两半依次各自提交，写不进去的一半继续二分，直到单条
+bool DatabaseWorker::splitAndStoreLocked(const QVector<SensorData> &batch, int from, int count, StoreResult &result)
+{
+    if (count == 1) {
+        result.dropped++;
+        return true;
+    }
+    const int half = count / 2;
+    const int parts[2][2] = {{from, half}, {from + half, count - half}};
+    for (const auto &part : parts) {
+        if (commitRowsLocked(batch.mid(part[0], part[1]))) {
+            result.stored += part[1];
+            continue;
+        }
+        if (!pingLocked()) {
+            // 连接断开：从这一半起尚未写入的数据按原顺序放回重试缓冲
+            bufferForRetry(batch.mid(part[0]), true);
+            connectionLost("写入时连接断开");
+            return false;
+        }
+        if (!splitAndStoreLocked(batch, part[0], part[1], result)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//预处理插入语句
+bool DatabaseWorker::prepareGreenhouseInsert(QSqlQuery &insert)
+{
     // 使用参数化查询插入数据到已创建的表中
-    QString insertQuery = "INSERT INTO greenhouse_data (collect_time, air_temp, air_humidity, oxygen_content, soil_temp, soil_humidity, light_intensity) VALUES (?, ?, ?, ?, ?, ?, ?);";
-    query.prepare(insertQuery);
-    
-    // 添加当前时间（转换为字符串格式以避免时区问题）
-    query.addBindValue(QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss"));
-    // 添加环境参数
-    query.addBindValue(airTemp);
-    query.addBindValue(airHumidity);
-    query.addBindValue(oxygenContent);
-    query.addBindValue(soilTemp);
-    query.addBindValue(soilHumidity);
-    query.addBindValue(lightIntensity);
-
-    if (query.exec()) {
-        qDebug() << "[DatabaseWorker] 数据存储成功";
-    } else {
-        qDebug() << "[DatabaseWorker] 数据存储失败: " << query.lastError().text();
+    return insert.prepare(kInsertGreenhouseSql);
+}
+
+//在一个事务中插入一批数据（每次预处理插入语句）
+bool DatabaseWorker::insertGreenhouseRows(QSqlDatabase &database, const QVector<SensorData> &batch)
+{
+    QSqlQuery query(database);
+    prepareGreenhouseInsert(query);
+    return insertGreenhouseRows(database, query, batch);
+}
+
+//在一个事务中插入一批数据（不加锁，调用方保证database只在本线程使用）
+bool DatabaseWorker::insertGreenhouseRows(QSqlDatabase &database, QSqlQuery &query, const QVector<SensorData> &batch)
+{
+    // 一批数据放在一个事务里提交，避免每条数据一次提交
+    database.transaction();
+
+    for (const SensorData &data : batch) {
+        // 采集时间取接收时刻（转换为字符串格式以避免时区问题），而不是入库时刻
+        query.bindValue(0, QDateTime::fromMSecsSinceEpoch(data.time).toString("yyyy-MM-dd HH:mm:ss"));
+        // 添加环境参数
+        query.bindValue(1, data.atemp);
+        query.bindValue(2, data.ahumi);
+        query.bindValue(3, data.oxygen);
+        query.bindValue(4, data.stemp);
+        query.bindValue(5, data.shumi2);
+        query.bindValue(6, data.light);
+
+        if (!query.exec()) {
+            LOG_ERROR("db", "数据存储失败", {"error", query.lastError().text()});
+            database.rollback();
+            return false;
+        }
+    }
+
+    if (!database.commit()) {
+        LOG_ERROR("db", "提交失败", {"error", database.lastError().text()});
+        database.rollback();
+        return false;
+    }
+    return true;
+}
+
+//把一批数据累加到每日草图
+void DatabaseWorker::addToDailySketches(const QVector<SensorData> &batch)
+{
+    // 本批中载入失败的键，不再逐条重复查询
+    QSet<DailySketchKey> failed;
+    for (const SensorData &data : batch) {
+        if (data.time < m_sketchDayStart || data.time >= m_sketchDayEnd) {
+            // 与collect_time一致按本地日期划分
+            const QDate date = QDateTime::fromMSecsSinceEpoch(data.time).date();
+            m_sketchDay = date.toJulianDay();
+            m_sketchDayStart = date.startOfDay().toMSecsSinceEpoch();
+            m_sketchDayEnd = date.addDays(1).startOfDay().toMSecsSinceEpoch();
+        }
+        DailySketchKey key;
+        key.day = m_sketchDay;
+        key.node = data.node;
+        if (failed.contains(key)) {
+            continue;
+        }
+        QVector<QuantileSketch> *sketches = sketchesFor(key);
+        if (!sketches) {
+            failed.insert(key);
+            continue;
+        }
+        (*sketches)[0].add(data.atemp);
+        (*sketches)[1].add(data.ahumi);
+        (*sketches)[2].add(data.oxygen);
+        (*sketches)[3].add(data.stemp);
+        (*sketches)[4].add(data.shumi2);
+        (*sketches)[5].add(data.light);
+        m_dirtySketches.insert(key);
+    }
+}
+
+//取(日期, 节点)的草图
+QVector<QuantileSketch> *DatabaseWorker::sketchesFor(const DailySketchKey &key)
+{
+    auto found = m_sketches.find(key);
+    if (found != m_sketches.end()) {
+        return &found.value();
+    }
+
+    // 程序重启或迟到的读数：先合并数据库中已有的草图，写回时不会覆盖掉之前的数据
+    // 载入不成功时不缓存也不累加，这几条读数不计入当天分布，但库中已有的分布不会被覆盖
+    QVector<QuantileSketch> sketches(kSketchChannels);
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT channel, sketch FROM daily_sketch WHERE day = ? AND node = ?");
+    query.addBindValue(QDate::fromJulianDay(key.day));
+    query.addBindValue(key.node);
+    if (!query.exec()) {
+        LOG_ERROR("db", "载入每日草图失败", {"day", key.day}, {"node", key.node}, {"error", query.lastError().text()});
+        return nullptr;
+    }
+    while (query.next()) {
+        const int channel = query.value(0).toInt();
+        if (channel < 0 || channel >= kSketchChannels) {
+            continue;
+        }
+        QDataStream in(query.value(1).toByteArray());
+        QuantileSketch stored;
+        in >> stored;
+        if (in.status() != QDataStream::Ok) {
+            LOG_ERROR("db", "每日草图数据损坏，不写回该日", {"day", key.day}, {"node", key.node}, {"channel", channel});
+            return nullptr;
+        }
+        sketches[channel].merge(stored);
     }
+    return &m_sketches.insert(key, sketches).value();
+}
+
+//把改动过的草图写回数据库
+bool DatabaseWorker::flushDailySketches()
+{
+    if (!m_dirtySketches.isEmpty()) {
+        if (!db.isOpen()) {
+            return false;
+        }
+        db.transaction();
+        QSqlQuery query(db);
+        query.prepare("REPLACE INTO daily_sketch (day, node, channel, sketch) VALUES (?, ?, ?, ?)");
+        for (const DailySketchKey &key : std::as_const(m_dirtySketches)) {
+            const QVector<QuantileSketch> &sketches = m_sketches[key];
+            for (int channel = 0; channel < kSketchChannels; ++channel) {
+                if (sketches.at(channel).isEmpty()) {
+                    continue;
+                }
+                QByteArray blob;
+                QDataStream out(&blob, QIODevice::WriteOnly);
+                out << sketches.at(channel);
+                query.bindValue(0, QDate::fromJulianDay(key.day));
+                query.bindValue(1, key.node);
+                query.bindValue(2, channel);
+                query.bindValue(3, blob);
+                if (!query.exec()) {
+                    LOG_ERROR("db", "每日草图写入失败", {"day", key.day}, {"node", key.node}, {"channel", channel},
+                              {"error", query.lastError().text()});
+                    db.rollback();
+                    return false;
+                }
+            }
+        }
+        if (!db.commit()) {
+            LOG_ERROR("db", "每日草图提交失败", {"error", db.lastError().text()});
+            db.rollback();
+            return false;
+        }
+        m_dirtySketches.clear();
+    }
+
+    // 昨天以前的草图已写回，不再常驻内存（迟到的读数会重新从数据库载入）
+    const qint64 yesterday = QDate::currentDate().toJulianDay() - 1;
+    for (auto it = m_sketches.begin(); it != m_sketches.end();) {
+        if (it.key().day < yesterday) {
+            it = m_sketches.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return true;
+}
+
+void DatabaseWorker::onSketchFlushTimeout()
+{
+    QMutexLocker locker(&mutex);
+    flushDailySketches();
 }
 
 void DatabaseWorker::connectToDatabase()
 {
-    connectToMysql();
+    static MetricCounter *const reconnects =
+        Metrics::instance().counter("sensor_db_reconnects_total", "断线后重新连接成功的次数");
+
+    if (m_reconnectTimer) {
+        m_reconnectTimer->stop();
+    }
+    if (m_shuttingDown) {
+        return; // 退出时只由flushForShutdown连接
+    }
+    setConnectionState(ConnectionState::Connecting);
+    if (!connectToMysql()) {
+        scheduleReconnect();
+        return;
+    }
+    if (m_everConnected) {
+        reconnects->inc();
+        LOG_INFO("db", "数据库已重新连接", {"attempts", m_reconnectAttempts}, {"retryRows", m_retryRows});
+    }
+    m_everConnected = true;
+    m_reconnectAttempts = 0;
+
+    // 连接后定时检查，MySQL重启等断线在几秒内发现
+    if (!m_healthTimer) {
+        m_healthTimer = new QTimer(this);
+        connect(m_healthTimer, &QTimer::timeout, this, &DatabaseWorker::onHealthCheck);
+        m_healthTimer->start(kHealthCheckIntervalMs);
+    }
+}
+
+//配置改动：调整写入间隔；连接参数变化时用新参数重新连接
+void DatabaseWorker::applyConfig(const AppConfig *previous, const AppConfig *current)
+{
+    if (m_drainTimer && previous->storeDrainIntervalMs != current->storeDrainIntervalMs) {
+        m_drainTimer->setInterval(current->storeDrainIntervalMs);
+    }
+    const bool databaseChanged = previous->dbHost != current->dbHost || previous->dbPort != current->dbPort
+                                 || previous->dbName != current->dbName || previous->dbUser != current->dbUser
+                                 || previous->dbPassword != current->dbPassword;
+    if (!databaseChanged || m_state == ConnectionState::Disconnected) {
+        return; // 参数未变，或尚未开始连接/已主动断开
+    }
+    LOG_INFO("db", "数据库连接参数已修改，重新连接", {"host", current->dbHost}, {"database", current->dbName});
+    {
+        QMutexLocker locker(&mutex);
+        if (db.isOpen()) {
+            flushDailySketches();
+        }
+        closeConnection();
+    }
+    m_reconnectAttempts = 0;
+    connectToDatabase();
 }
 
-//关闭数据库连接
-void DatabaseWorker::disconnectFromDatabase()
+//连接失败：等待时间从1秒起每次翻倍，最长60秒；实际等待在其一半到全部之间随机，避免多个实例同时重连
+void DatabaseWorker::scheduleReconnect()
+{
+    if (m_shuttingDown) {
+        return;
+    }
+    if (!m_reconnectTimer) {
+        m_reconnectTimer = new QTimer(this);
+        m_reconnectTimer->setSingleShot(true);
+        connect(m_reconnectTimer, &QTimer::timeout, this, &DatabaseWorker::connectToDatabase);
+    }
+    const int backoff = qMin(kReconnectMaxMs, kReconnectInitialMs << qMin(m_reconnectAttempts, 6));
+    const int delay = backoff / 2 + int(QRandomGenerator::global()->bounded(backoff / 2 + 1));
+    m_reconnectAttempts++;
+    LOG_WARNING("db", "数据库连接失败，稍后重试", {"attempt", m_reconnectAttempts}, {"retryMs", delay});
+    m_reconnectTimer->start(delay);
+}
+
+//更新连接状态
+void DatabaseWorker::setConnectionState(ConnectionState state)
+{
+    static MetricGauge *const stateGauge =
+        Metrics::instance().gauge("sensor_db_connection_state", "数据库连接状态：0未连接，1连接中/等待重试，2已连接");
+    stateGauge->set(qint64(state));
+    m_state = state;
+    m_connected.store(state == ConnectionState::Connected, std::memory_order_relaxed);
+}
+
+//执行SELECT 1检查连接
+bool DatabaseWorker::pingLocked()
+{
+    static MetricCounter *const pingFailures =
+        Metrics::instance().counter("sensor_db_ping_failures_total", "连接检查（SELECT 1）失败的次数");
+    if (db.isOpen()) {
+        QSqlQuery query(db);
+        if (query.exec("SELECT 1")) {
+            return true;
+        }
+    }
+    pingFailures->inc();
+    return false;
+}
+
+//定时检查连接
+void DatabaseWorker::onHealthCheck()
 {
     QMutexLocker locker(&mutex);
-    
-    // 清理数据库连接
+    if (!isConnected()) {
+        return;
+    }
+    if (!pingLocked()) {
+        connectionLost("连接检查失败");
+    }
+}
+
+//连接失效：关闭后按退避重连，期间的数据进入重试缓冲
+void DatabaseWorker::connectionLost(const QString &reason)
+{
+    LOG_WARNING("db", "数据库连接断开", {"reason", reason});
+    closeConnection();
+    setConnectionState(ConnectionState::Connecting);
+    emit connectionStatusChanged(false, "数据库连接断开，正在重连");
+    scheduleReconnect();
+}
+
+//释放插入语句和连接（语句需在移除连接之前释放）
+void DatabaseWorker::closeConnection()
+{
+    m_insertQuery = QSqlQuery();
     db = QSqlDatabase();
-    
     if (QSqlDatabase::contains("mysqlConnection")) {
-        // 安全关闭连接
-        {   
-            QSqlDatabase localDb = QSqlDatabase::database("mysqlConnection");
+        {
+            QSqlDatabase localDb = QSqlDatabase::database("mysqlConnection", false);
             if (localDb.isOpen()) localDb.close();
         }
-        
         QSqlDatabase::removeDatabase("mysqlConnection");
+    }
+}
+
+//关闭数据库连接
+void DatabaseWorker::disconnectFromDatabase()
+{
+    QMutexLocker locker(&mutex);
+    
+    // 主动断开后不再自动重连
+    if (m_reconnectTimer) {
+        m_reconnectTimer->stop();
+    }
+    setConnectionState(ConnectionState::Disconnected);
+    
+    // 断开前写回尚未保存的每日草图
+    if (db.isOpen()) {
+        flushDailySketches();
+    }
+    
+    // 清理数据库连接
+    const bool wasOpen = QSqlDatabase::contains("mysqlConnection");
+    closeConnection();
+    if (wasOpen) {
         emit connectionStatusChanged(false, "数据库已断开连接");
     }
 }
@@ -136,7 +636,7 @@ void DatabaseWorker::disconnectFromDatabase()
 bool DatabaseWorker::checkConnection()
 {
     if (!db.isOpen()) {
-        qDebug() << "[DatabaseWorker] 数据库连接未打开";
+        LOG_WARNING("db", "数据库连接未打开，无法查询");
         emit queryResultsReady(false, QList<QVariantList>(), "数据库连接未打开");
         return false;
     }
@@ -157,15 +657,15 @@ QList<QVariantList> DatabaseWorker::processQueryResults(QSqlQuery &query, const
         rowCount++;
     }
     
-    qDebug() << "[DatabaseWorker]" << queryType << "查询到" << rowCount << "条数据";
+    LOG_DEBUG("db", "查询完成", {"type", queryType}, {"rows", rowCount});
     return results;
 }
 
 //查询数据
 void DatabaseWorker::queryAllGreenhouseData()
 {
-    qDebug() << "[DatabaseWorker] 开始查询数据";
-    
+    LOG_DEBUG("db", "开始查询全部数据");
+
     QMutexLocker locker(&mutex);
     if (!checkConnection()) {
         return;
@@ -175,7 +675,7 @@ void DatabaseWorker::queryAllGreenhouseData()
     QString selectQuery = "SELECT entry_id, collect_time, air_temp, air_humidity, oxygen_content, soil_temp, soil_humidity, light_intensity FROM greenhouse_data ORDER BY collect_time DESC";
     
     if (!query.exec(selectQuery)) {
-        qDebug() << "[DatabaseWorker] 查询失败: " << query.lastError().text();
+        LOG_ERROR("db", "查询失败", {"error", query.lastError().text()});
         emit queryResultsReady(false, QList<QVariantList>(), "查询失败: " + query.lastError().text());
         return;
     }
@@ -188,10 +688,9 @@ void DatabaseWorker::queryAllGreenhouseData()
 // 按时间范围查询温室环境数据
 void DatabaseWorker::queryGreenhouseDataByTimeRange(const QDateTime &startTime, const QDateTime &endTime)
 {
-    qDebug() << "[DatabaseWorker] 开始按时间范围查询数据";
-    qDebug() << "[DatabaseWorker] 时间范围: " << startTime.toString("yyyy-MM-dd HH:mm:ss") 
-             << " - " << endTime.toString("yyyy-MM-dd HH:mm:ss");
-    
+    LOG_DEBUG("db", "开始按时间范围查询", {"from", startTime.toString("yyyy-MM-dd HH:mm:ss")},
+              {"to", endTime.toString("yyyy-MM-dd HH:mm:ss")});
+
     QMutexLocker locker(&mutex);
     if (!checkConnection()) {
         return;
@@ -210,7 +709,7 @@ void DatabaseWorker::queryGreenhouseDataByTimeRange(const QDateTime &startTime,
     query.addBindValue(endTime);
     
     if (!query.exec()) {
-        qDebug() << "[DatabaseWorker] 时间范围查询失败: " << query.lastError().text();
+        LOG_ERROR("db", "时间范围查询失败", {"error", query.lastError().text()});
         emit queryResultsReady(false, QList<QVariantList>(), "查询失败: " + query.lastError().text());
         return;
     }
@@ -223,15 +722,13 @@ void DatabaseWorker::queryGreenhouseDataByTimeRange(const QDateTime &startTime,
 // 按属性值范围查询温室环境数据
 void DatabaseWorker::queryGreenhouseDataByValueRange(const QString &attributeName, double minValue, double maxValue)
 {
-    qDebug() << "[DatabaseWorker] 开始按属性值范围查询数据";
-    qDebug() << "[DatabaseWorker] 属性名: " << attributeName 
-             << "，值范围: " << minValue << " - " << maxValue;
+    LOG_DEBUG("db", "开始按属性值范围查询", {"attribute", attributeName}, {"min", minValue}, {"max", maxValue});
     
     // 使用成员变量attributeMap映射中文属性名到数据库字段名
     
     // 检查属性名是否有效
     if (!attributeMap.contains(attributeName)) {
-        qDebug() << "[DatabaseWorker] 无效的属性名: " << attributeName;
+        LOG_WARNING("db", "无效的属性名", {"attribute", attributeName});
         emit queryResultsReady(false, QList<QVariantList>(), "无效的属性名: " + attributeName);
         return;
     }
@@ -256,7 +753,7 @@ void DatabaseWorker::queryGreenhouseDataByValueRange(const QString &attributeNam
     query.addBindValue(maxValue);
     
     if (!query.exec()) {
-        qDebug() << "[DatabaseWorker] 属性值范围查询失败: " << query.lastError().text();
+        LOG_ERROR("db", "属性值范围查询失败", {"attribute", attributeName}, {"error", query.lastError().text()});
         emit queryResultsReady(false, QList<QVariantList>(), "查询失败: " + query.lastError().text());
         return;
     }
@@ -265,3 +762,117 @@ void DatabaseWorker::queryGreenhouseDataByValueRange(const QString &attributeNam
     QList<QVariantList> results = processQueryResults(query, "属性值范围");
     emit queryResultsReady(true, results, QString("查询成功，共 %1 条数据").arg(results.size()));
 }
+
+// 查询历史曲线的一个瓦片
+void DatabaseWorker::queryHistoryTile(const HistoryTileKey &key)
+{
+    HistoryTile tile;
+    tile.key = key;
+    tile.fetchedAt = QDateTime::currentMSecsSinceEpoch();
+
+    QMutexLocker locker(&mutex);
+    if (!db.isOpen()) {
+        // 不走checkConnection，避免在数据库窗口里弹出查询失败
+        emit historyTileReady(tile);
+        return;
+    }
+
+    // 在数据库中按桶分组求平均，每个瓦片最多返回HistoryTileKey::kBuckets行
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    QString selectQuery = "SELECT FLOOR(UNIX_TIMESTAMP(collect_time) / ?) AS bucket, "
+                         "AVG(air_temp), AVG(air_humidity), AVG(oxygen_content), AVG(soil_temp), AVG(soil_humidity), AVG(light_intensity) "
+                         "FROM greenhouse_data "
+                         "WHERE collect_time >= ? AND collect_time < ? "
+                         "GROUP BY bucket ORDER BY bucket";
+    query.prepare(selectQuery);
+    query.addBindValue(key.bucketSeconds());
+    // 与写入时一致，使用本地时间字符串
+    query.addBindValue(QDateTime::fromSecsSinceEpoch(key.startSeconds()).toString("yyyy-MM-dd HH:mm:ss"));
+    query.addBindValue(QDateTime::fromSecsSinceEpoch(key.endSeconds()).toString("yyyy-MM-dd HH:mm:ss"));
+
+    if (!query.exec()) {
+        LOG_ERROR("db", "历史瓦片查询失败", {"level", key.level}, {"index", key.index}, {"error", query.lastError().text()});
+        emit historyTileReady(tile);
+        return;
+    }
+
+    const qint64 bucketMs = key.bucketSeconds() * 1000;
+    while (query.next()) {
+        SensorData row;
+        row.time = query.value(0).toLongLong() * bucketMs + bucketMs / 2;
+        row.atemp = query.value(1).toDouble();
+        row.ahumi = query.value(2).toDouble();
+        row.oxygen = query.value(3).toDouble();
+        row.stemp = query.value(4).toDouble();
+        row.shumi2 = query.value(5).toDouble();
+        row.light = query.value(6).toDouble();
+        tile.rows.append(row);
+    }
+    tile.ok = true;
+    emit historyTileReady(tile);
+}
+
+// 查询某通道每天的分布
+void DatabaseWorker::queryDailyDistribution(int channel, const QDate &from, const QDate &to)
+{
+    QVector<DailyDistribution> days;
+    if (channel < 0 || channel >= kSketchChannels) {
+        emit dailyDistributionReady(false, channel, days, "无效的通道");
+        return;
+    }
+
+    QMutexLocker locker(&mutex);
+    if (!db.isOpen()) {
+        emit dailyDistributionReady(false, channel, days, "数据库连接未打开");
+        return;
+    }
+    // 先写回内存中的草图，今天的分布也包含最新写入的数据
+    flushDailySketches();
+
+    // 每天每个节点一个草图，90天只需读取90×节点数个几KB的草图，不必扫描原始数据
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT day, sketch, node FROM daily_sketch WHERE channel = ? AND day BETWEEN ? AND ?");
+    query.addBindValue(channel);
+    query.addBindValue(from);
+    query.addBindValue(to);
+    if (!query.exec()) {
+        LOG_ERROR("db", "每日分布查询失败", {"channel", channel}, {"error", query.lastError().text()});
+        emit dailyDistributionReady(false, channel, days, "查询失败: " + query.lastError().text());
+        return;
+    }
+
+    // 同一天各节点的草图合并为全部节点的分布
+    QMap<QDate, QuantileSketch> merged;
+    while (query.next()) {
+        QDataStream in(query.value(1).toByteArray());
+        QuantileSketch sketch;
+        in >> sketch;
+        if (in.status() != QDataStream::Ok) {
+            // 损坏的草图只跳过这一行，其余节点和日期照常显示
+            LOG_WARNING("db", "每日草图数据损坏，跳过", {"day", query.value(0).toDate()}, {"node", query.value(2).toInt()},
+                        {"channel", channel});
+            continue;
+        }
+        merged[query.value(0).toDate()].merge(sketch);
+    }
+
+    for (auto it = merged.constBegin(); it != merged.constEnd(); ++it) {
+        const QuantileSketch &sketch = it.value();
+        if (sketch.isEmpty()) {
+            continue;
+        }
+        DailyDistribution day;
+        day.day = it.key();
+        day.minimum = sketch.min();
+        day.lowerQuartile = sketch.quantile(0.25);
+        day.median = sketch.quantile(0.5);
+        day.upperQuartile = sketch.quantile(0.75);
+        day.maximum = sketch.max();
+        day.count = sketch.count();
+        days.append(day);
+    }
+    LOG_DEBUG("db", "每日分布查询完成", {"channel", channel}, {"days", int(days.size())});
+    emit dailyDistributionReady(true, channel, days, QString("查询成功，共 %1 天").arg(days.size()));
+}
@@ -1,11 +1,24 @@
-
+﻿
 
 #ifndef DATABASEWORKER_H
 #define DATABASEWORKER_H
 
 #include <QObject>   // Qt核心对象类
 #include <QSqlDatabase> // Qt数据库连接类
+#include <QSqlQuery>
 #include <QMutex>      // 线程同步互斥锁
+#include <QSharedPointer>
+#include <QVector>
+#include <QSet>
+#include <atomic>
+#include "sensordata.h"
+#include "boundedqueue.h" // 有界队列，存储待入库的数据
+#include "historytile.h"  // 历史曲线的数据瓦片
+#include "dailysketch.h"  // 每日分位数草图
+#include "quantilesketch.h"
+#include "config.h"       // 配置快照（热加载）
+
+class QTimer;
 
 class DatabaseWorker : public QObject
 {
@@ -13,20 +26,57 @@ class DatabaseWorker : public QObject
 
 public:
 
-    explicit DatabaseWorker(QObject *parent = nullptr);
+    // storePolicy/storeCapacity: 待入库队列满时的处理策略和容量
+    explicit DatabaseWorker(OverflowPolicy storePolicy = OverflowPolicy::SpillToDisk, int storeCapacity = 10000, QObject *parent = nullptr);
     
 
     ~DatabaseWorker();
 
+    // 连接状态，数值即sensor_db_connection_state指标的值
+    enum class ConnectionState {
+        Disconnected = 0, // 未连接（主动断开）
+        Connecting = 1,   // 正在连接或等待重试
+        Connected = 2
+    };
+
+    // 是否已连接到数据库（任意线程可读）
+    bool isConnected() const { return m_connected.load(std::memory_order_relaxed); }
+
+    // 待入库队列，接收线程直接push，本对象在数据库线程中定时批量取出入库
+    QSharedPointer<BoundedQueue<SensorData>> storeQueue() const { return m_storeQueue; }
+
+    // 退出前写入的结果
+    struct FlushResult {
+        qint64 flushed = 0;   // 写入并提交的条数
+        qint64 unwritten = 0; // 期限内未能写入、随程序退出丢弃的条数
+    };
+
+    // 程序退出时在数据库线程中调用（各接收线程已结束）：停止定时写入并关闭待入库队列，
+    // 在timeoutMs内把重试缓冲和队列中（含溢出到磁盘）的数据按顺序写完，最后一批提交后返回。
+    // 调用后不再自动重连。期限只在两批之间检查：已开始的一批（以及调用前正在执行的查询）会执行完，
+    // 数据库无响应时可能超出期限，最长约为驱动的读写超时
+    FlushResult flushForShutdown(int timeoutMs);
+
+    // 在一个事务中把一批数据插入greenhouse_data表（预处理语句逐行绑定，失败时回滚）
+    // 不依赖具体驱动，基准测试用它在SQLite上测量写入吞吐
+    static bool insertGreenhouseRows(QSqlDatabase &database, const QVector<SensorData> &batch);
+    // 同上，使用已在database上预处理好的插入语句（见prepareGreenhouseInsert），连接期间只预处理一次
+    static bool insertGreenhouseRows(QSqlDatabase &database, QSqlQuery &insert, const QVector<SensorData> &batch);
+    static bool prepareGreenhouseInsert(QSqlQuery &insert);
+
 public slots:
     // 连接到数据库 - 供外部调用的公共槽函数，触发数据库连接操作
+    // 连接失败或之后断线时按指数退避自动重试（1秒起，每次翻倍，最长60秒，带随机抖动），不阻塞调用方
     void connectToDatabase();
     
     // 断开数据库连接 - 安全地关闭数据库连接并释放相关资源
     void disconnectFromDatabase();
     
-    // 存储温室环境数据到数据库
-    void storeGreenhouseData(double airTemp, double airHumidity, double oxygenContent, double soilTemp, double soilHumidity, double lightIntensity);
+    // 配置热加载：写入间隔立即生效，连接参数变化时重新连接（批大小等每次写入时读取当前配置）
+    void applyConfig(const AppConfig *previous, const AppConfig *current);
+    
+    // 启动待入库队列的定时批量写入，需在数据库线程启动后调用
+    void startStoreDrain();
     
     // 查询所有温室环境数据
     void queryAllGreenhouseData();
@@ -36,6 +86,12 @@ public slots:
     
     // 按属性值范围查询温室环境数据
     void queryGreenhouseDataByValueRange(const QString &attributeName, double minValue, double maxValue);
+    
+    // 查询历史曲线的一个瓦片（按桶宽聚合），结果通过historyTileReady返回
+    void queryHistoryTile(const HistoryTileKey &key);
+    
+    // 查询某通道[from, to]每天的分布（由每日草图合并得到），结果通过dailyDistributionReady返回
+    void queryDailyDistribution(int channel, const QDate &from, const QDate &to);
 
 signals:
     // 连接状态变化信号 - 当数据库连接状态改变时发出
@@ -48,6 +104,12 @@ signals:
     // results: 查询结果数据，每个QVariantList代表一行数据
     // message: 状态描述消息
     void queryResultsReady(bool success, const QList<QVariantList> &results, const QString &message);
+    
+    // 历史瓦片查询完成信号 - 失败时tile.ok为false
+    void historyTileReady(const HistoryTile &tile);
+    
+    // 每日分布查询完成信号 - days按日期升序，只包含有数据的日期
+    void dailyDistributionReady(bool success, int channel, const QVector<DailyDistribution> &days, const QString &message);
 
 private:
     // db - 数据库连接对象，用于管理与MySQL数据库的连接
@@ -63,10 +125,99 @@ private:
     // 返回值: 连接是否成功
     bool connectToMysql();
     
+    // 连接期间预处理好的插入语句，重连后重新预处理
+    QSqlQuery m_insertQuery;
+
+    // 连接失败后的重试定时器和已连续失败的次数
+    QTimer *m_reconnectTimer = nullptr;
+    int m_reconnectAttempts = 0;
+    // 连接后定时ping，发现断线后转入重连
+    QTimer *m_healthTimer = nullptr;
+    // 是否连接成功过（之后的连接计为重连）
+    bool m_everConnected = false;
+    ConnectionState m_state = ConnectionState::Disconnected; // 只在数据库线程中读写
+    bool m_shuttingDown = false; // flushForShutdown之后为true，不再安排重连（只在数据库线程中读写）
+    std::atomic<bool> m_connected{false};
+
+    // scheduleReconnect - 按带抖动的指数退避安排下一次连接
+    void scheduleReconnect();
+
+    // setConnectionState - 更新连接状态和指标
+    void setConnectionState(ConnectionState state);
+
+    // pingLocked - 执行SELECT 1检查连接是否可用（调用方持有mutex）
+    bool pingLocked();
+
+    // onHealthCheck - 定时检查连接，断线时转入重连
+    void onHealthCheck();
+
+    // connectionLost - 关闭失效的连接并开始重连（调用方持有mutex）
+    void connectionLost(const QString &reason);
+
+    // closeConnection - 释放插入语句和连接（调用方持有mutex）
+    void closeConnection();
+
+    // 断线期间的重试缓冲：写入失败的批次和断线时从待入库队列取出的数据，重连后先写入
+    // 最多约retryBufferRows条（配置[store] retry_buffer_rows），超过后数据留在待入库队列（默认溢出到磁盘），接收线程不会等待
+    QList<QVector<SensorData>> m_retryBatches;
+    int m_retryRows = 0;
+
     // checkConnection - 检查数据库连接状态的辅助方法
     // 返回值: 连接是否有效
     bool checkConnection();
     
+    // m_storeQueue - 待入库队列；m_drainTimer - 批量写入定时器
+    QSharedPointer<BoundedQueue<SensorData>> m_storeQueue;
+    QTimer *m_drainTimer = nullptr;
+
+    // drainStoreQueue - 从待入库队列取出一批数据，在一个事务中写入
+    void drainStoreQueue();
+
+    // 一批数据的写入结果；既未写入也未丢弃的部分已放回重试缓冲
+    struct StoreResult {
+        int stored = 0;  // 已提交的条数
+        int dropped = 0; // 连接正常但写不进去而丢弃的条数
+    };
+
+    // storeGreenhouseBatch - 批量存储温室环境数据
+    // 连接断开导致失败时，未写入的数据放回重试缓冲并开始重连；
+    // 连接正常时先整批重试一次（死锁、锁等待超时等暂时性错误），仍失败再二分找出写不进去的行丢弃
+    StoreResult storeGreenhouseBatch(const QVector<SensorData> &batch);
+
+    // commitRowsLocked - 在一个事务中写入并提交，成功后记录指标并累加每日草图（调用方持有mutex）
+    bool commitRowsLocked(const QVector<SensorData> &rows);
+
+    // splitAndStoreLocked - 把batch中[from, from+count)分成两半分别写入，单条写不进去时丢弃（调用方持有mutex）
+    // 返回值: 连接是否仍然正常；断开时从from起未写入的数据已放回重试缓冲
+    bool splitAndStoreLocked(const QVector<SensorData> &batch, int from, int count, StoreResult &result);
+
+    // bufferForRetry - 把一批数据放入重试缓冲（front为true时放在最前面，保持写入顺序）
+    void bufferForRetry(const QVector<SensorData> &batch, bool front);
+
+    // 每日分位数草图：每个(日期, 节点)六个通道，写入成功后累加，定时写回daily_sketch表
+    // m_dirtySketches - 尚未写回的编号；m_sketchFlushTimer - 定时写回
+    QHash<DailySketchKey, QVector<QuantileSketch>> m_sketches;
+    QSet<DailySketchKey> m_dirtySketches;
+    QTimer *m_sketchFlushTimer = nullptr;
+    // 最近一次换算的本地日期及其起止时刻（毫秒），同一天的读数不必逐条换算日期
+    qint64 m_sketchDay = 0;
+    qint64 m_sketchDayStart = 0;
+    qint64 m_sketchDayEnd = 0;
+
+    // addToDailySketches - 把已提交的一批数据累加到每日草图（调用方持有mutex）
+    void addToDailySketches(const QVector<SensorData> &batch);
+
+    // sketchesFor - 取(日期, 节点)的草图，第一次用到时先载入数据库中已有的草图（调用方持有mutex）
+    // 载入失败（查询出错或草图损坏）时返回nullptr，不缓存，下次写入时重新载入，避免写回时覆盖库中已有的分布
+    QVector<QuantileSketch> *sketchesFor(const DailySketchKey &key);
+
+    // flushDailySketches - 把改动过的草图写回数据库，并释放昨天以前的草图（调用方持有mutex）
+    // 返回值: 是否写入成功
+    bool flushDailySketches();
+
+    // onSketchFlushTimeout - 定时写回草图（加锁后调用flushDailySketches）
+    void onSketchFlushTimeout();
+
     // processQueryResults - 处理查询结果的辅助方法
     // query: 已执行的查询对象
     // queryType: 查询类型描述，用于日志
@@ -1,22 +1,79 @@
 ﻿#include "debugging.h"
 #include "ui_debugging.h"
+#include "logringmodel.h"
+#include "frameparser.h"
+#include <QTimer>
+#include <QScrollBar>
 
 debugging::debugging(QWidget *parent) :
     QWidget(parent),
     ui(new Ui::debugging)
 {
     ui->setupUi(this);
+
+    // 接收区使用定长环形模型+列表视图，只绘制可见行，长时间运行不会越来越卡
+    model = new LogRingModel(5000, this);
+    ui->textreceive->setModel(model);
+
+    // 数据先攒在pending里，每帧（约30fps）批量追加一次
+    flushTimer = new QTimer(this);
+    flushTimer->setSingleShot(true);
+    flushTimer->setInterval(33);
+    connect(flushTimer, &QTimer::timeout, this, &debugging::flushPending);
 }
 
 debugging::~debugging()
 {
+    FrameParser::setRawDataEnabled(false);
     delete ui;
 }
 
+void debugging::showEvent(QShowEvent *event)
+{
+    FrameParser::setRawDataEnabled(true);
+    QWidget::showEvent(event);
+}
+
+void debugging::hideEvent(QHideEvent *event)
+{
+    // 窗口不可见时接收线程不再生成原始数据
+    FrameParser::setRawDataEnabled(false);
+    QWidget::hideEvent(event);
+}
+
 void debugging::showdata(QString data)
 {
-    // 假设ui中有一个QTextBrowser名为textBrowser或类似控件用于显示数据
-    ui->textreceive->append(data);
+    pending.append(data);
+    if (!flushTimer->isActive()) {
+        flushTimer->start();
+    }
+}
+
+void debugging::showlines(const QVector<QString> &lines)
+{
+    pending += lines;
+    if (!flushTimer->isActive()) {
+        flushTimer->start();
+    }
+}
+
+void debugging::flushPending()
+{
+    if (pending.isEmpty()) {
+        return;
+    }
+
+    // 只有原本就在底部时才自动滚动，便于向上翻看历史
+    QScrollBar *bar = ui->textreceive->verticalScrollBar();
+    bool atBottom = bar->value() == bar->maximum();
+
+    model->appendLines(pending);
+    pending.clear();
+
+    if (atBottom && !model->isPaused()) {
+        ui->textreceive->scrollToBottom();
+    }
+    ui->countlabel->setText(QString("%1 行").arg(model->totalCount()));
 }
 
 void debugging::on_sendbtn_clicked()
@@ -28,7 +85,9 @@ void debugging::on_sendbtn_clicked()
 
 void debugging::on_updeleteall_clicked()
 {
-    ui->textreceive->clear();
+    pending.clear();
+    model->clear();
+    ui->countlabel->clear();
 }
 
 void debugging::on_downdeleteall_clicked()
@@ -36,9 +95,26 @@ void debugging::on_downdeleteall_clicked()
     ui->textsend->clear();
 }
 
+// 与数据库窗口的退出按钮一致，只隐藏窗口（窗口由主窗口持有和释放）
 void debugging::on_exitbutton_clicked()
 {
-    this->deleteLater();
+    this->hide();
 }
 
+void debugging::on_pausecb_toggled(bool checked)
+{
+    model->setPaused(checked);
+    if (!checked) {
+        ui->textreceive->scrollToBottom();
+    }
+}
 
+void debugging::on_nodefilter_editingFinished()
+{
+    // 空表示显示全部节点
+    QString text = ui->nodefilter->text().trimmed();
+    bool ok = false;
+    int node = text.toInt(&ok);
+    model->setNodeFilter(text.isEmpty() || !ok ? -1 : node);
+    ui->textreceive->scrollToBottom();
+}
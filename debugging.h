@@ -2,6 +2,10 @@
 #define DEBUGGING_H
 
 #include <QWidget>
+#include <QVector>
+
+class QTimer;
+class LogRingModel;
 
 namespace Ui {
 class debugging;
@@ -15,17 +19,29 @@ public:
     explicit debugging(QWidget *parent = nullptr);
     ~debugging();
 
+protected:
+    void showEvent(QShowEvent *event) override;//窗口显示时打开原始数据发送
+    void hideEvent(QHideEvent *event) override;//窗口关闭/隐藏时关闭原始数据发送
+
 private:
     Ui::debugging *ui;
+    LogRingModel *model;//定长环形日志模型
+    QVector<QString> pending;//本帧待追加的行
+    QTimer *flushTimer;//每帧把pending批量追加到模型
+
+    void flushPending();//批量追加到模型并滚动到底部
 
 signals:
     void senddata(QByteArray data);    //发送数据的信号
 public slots:
     void showdata(QString data); //接收数据并显示到界面中
+    void showlines(const QVector<QString> &lines); //批量接收数据
     void on_sendbtn_clicked();//点击按钮发送数据给下位机
     void on_updeleteall_clicked();//上清屏
     void on_downdeleteall_clicked(); //下清屏
     void on_exitbutton_clicked();//退出按钮
+    void on_pausecb_toggled(bool checked);//暂停显示
+    void on_nodefilter_editingFinished();//按节点过滤
 };
 
 #endif // DEBUGGING_H
@@ -0,0 +1,150 @@
+﻿// excelexport.cpp - 查询结果导出为Excel文件（主界面导出按钮和基准测试共用）
+
+#include "excelexport.h"
+#include <QDateTime>
+#include <QSize>
+// 引入QXlsx库
+#include "QXlsx/header/xlsxdocument.h"
+#include "QXlsx/header/xlsxformat.h"
+#include "QXlsx/header/xlsxchart.h"
+#include "QXlsx/header/xlsxcellrange.h"
+using namespace QXlsx;
+
+bool ExcelExporter::writeGreenhouseWorkbook(const QList<QVariantList> &results, const QString &fileName)
+{
+    // 创建一个新的Excel文档对象
+    Document xlsx;
+    
+    // 创建表头格式对象
+    Format headerFormat;
+    headerFormat.setFontBold(true); // 设置表头字体为粗体
+    headerFormat.setHorizontalAlignment(Format::AlignHCenter); // 设置表头水平居中对齐
+    headerFormat.setVerticalAlignment(Format::AlignVCenter); // 设置表头垂直居中对齐
+    headerFormat.setBorderStyle(Format::BorderThin); // 设置表头边框为细边框
+    
+    // 创建数据单元格格式对象
+    Format dataFormat;
+    dataFormat.setBorderStyle(Format::BorderThin); // 设置数据单元格边框为细边框
+    
+    // 首先添加空气参数工作表
+    xlsx.addSheet("空气参数");
+    xlsx.selectSheet("空气参数");
+    
+    // 写入表头
+    xlsx.write("A1", "时间", headerFormat);
+    xlsx.write("B1", "空气温度(°C)", headerFormat);
+    xlsx.write("C1", "空气湿度(%)", headerFormat);
+    xlsx.write("D1", "氧气浓度(%)", headerFormat);
+    
+    int airDataRowCount = 0; // 计数器，用于记录实际写入的空气参数数据行数
+    
+    // 遍历查询结果，写入空气参数数据
+    for (int i = 0; i < results.size(); ++i) {
+        const QVariantList &row = results.at(i);
+        if (row.size() >= 5) { // 确保有足够的数据列
+            int excelRow = i + 2; // Excel行号从2开始
+            
+            // 从数据库结果中提取数据
+            QString timeString = row.at(1).toDateTime().toString("yyyy-MM-dd HH:mm:ss"); // 时间
+            double airTemp = row.at(2).toDouble(); // 空气温度
+            double airHumidity = row.at(3).toDouble(); // 空气湿度
+            double oxygenContent = row.at(4).toDouble(); // 氧气浓度
+            
+            // 写入Excel
+            xlsx.write(excelRow, 1, timeString, dataFormat);
+            xlsx.write(excelRow, 2, airTemp, dataFormat);
+            xlsx.write(excelRow, 3, airHumidity, dataFormat);
+            xlsx.write(excelRow, 4, oxygenContent, dataFormat);
+            
+            airDataRowCount++;
+        }
+    }
+    
+    // 如果有数据，创建空气参数图表
+    if (airDataRowCount > 0) {
+        int chartRow = airDataRowCount + 3; // 图表位置在数据下方3行
+        Chart *airChart = xlsx.insertChart(chartRow, 1, QSize(800, 400)); // 插入图表
+        
+        airChart->setChartType(Chart::CT_LineChart); // 设置为折线图
+        airChart->setChartTitle("空气参数变化趋势"); // 设置图表标题
+        
+        // 添加温度数据系列（使用时间作为X轴）
+        CellRange tempRange("A2:B" + QString::number(airDataRowCount + 1));
+        airChart->addSeries(tempRange, nullptr, false, true);
+        
+        // 添加湿度数据系列
+        CellRange humidityRange("A2:A" + QString::number(airDataRowCount + 1) + ",C2:C" + QString::number(airDataRowCount + 1));
+        airChart->addSeries(humidityRange, nullptr, false, true);
+        
+        // 添加氧气浓度数据系列
+        CellRange oxygenRange("A2:A" + QString::number(airDataRowCount + 1) + ",D2:D" + QString::number(airDataRowCount + 1));
+        airChart->addSeries(oxygenRange, nullptr, false, true);
+        
+        // 设置图表属性
+        airChart->setChartLegend(Chart::Top, false); // 图例在顶部
+        airChart->setAxisTitle(Chart::Bottom, "时间"); // X轴标题
+        airChart->setAxisTitle(Chart::Left, "数值"); // Y轴标题
+    }
+    
+    // 接下来添加土壤参数工作表
+    xlsx.addSheet("土壤参数");
+    xlsx.selectSheet("土壤参数");
+    
+    // 写入表头
+    xlsx.write("A1", "时间", headerFormat);
+    xlsx.write("B1", "土壤温度(°C)", headerFormat);
+    xlsx.write("C1", "土壤湿度(%)", headerFormat);
+    xlsx.write("D1", "光照强度(%)", headerFormat);
+    
+    int soilDataRowCount = 0; // 计数器，用于记录实际写入的土壤参数数据行数
+    
+    // 遍历查询结果，写入土壤参数数据
+    for (int i = 0; i < results.size(); ++i) {
+        const QVariantList &row = results.at(i);
+        if (row.size() >= 8) { // 确保有足够的数据列
+            int excelRow = i + 2; // Excel行号从2开始
+            
+            // 从数据库结果中提取数据
+            QString timeString = row.at(1).toDateTime().toString("yyyy-MM-dd HH:mm:ss"); // 时间
+            double soilTemp = row.at(5).toDouble(); // 土壤温度
+            double soilHumidity = row.at(6).toDouble(); // 土壤湿度
+            double lightIntensity = row.at(7).toDouble(); // 光照强度
+            
+            // 写入Excel
+            xlsx.write(excelRow, 1, timeString, dataFormat);
+            xlsx.write(excelRow, 2, soilTemp, dataFormat);
+            xlsx.write(excelRow, 3, soilHumidity, dataFormat);
+            xlsx.write(excelRow, 4, lightIntensity, dataFormat);
+            
+            soilDataRowCount++;
+        }
+    }
+    
+    // 如果有数据，创建土壤参数图表
+    if (soilDataRowCount > 0) {
+        int chartRow = soilDataRowCount + 3; // 图表位置在数据下方3行
+        Chart *soilChart = xlsx.insertChart(chartRow, 1, QSize(800, 400)); // 插入图表
+        
+        soilChart->setChartType(Chart::CT_LineChart); // 设置为折线图
+        soilChart->setChartTitle("土壤参数变化趋势"); // 设置图表标题
+        
+        // 添加土壤温度数据系列
+        CellRange soilTempRange("A2:B" + QString::number(soilDataRowCount + 1));
+        soilChart->addSeries(soilTempRange, nullptr, false, true);
+        
+        // 添加土壤湿度数据系列
+        CellRange soilHumidityRange("A2:A" + QString::number(soilDataRowCount + 1) + ",C2:C" + QString::number(soilDataRowCount + 1));
+        soilChart->addSeries(soilHumidityRange, nullptr, false, true);
+        
+        // 添加光照强度数据系列
+        CellRange lightRange("A2:A" + QString::number(soilDataRowCount + 1) + ",D2:D" + QString::number(soilDataRowCount + 1));
+        soilChart->addSeries(lightRange, nullptr, false, true);
+        
+        // 设置图表属性
+        soilChart->setChartLegend(Chart::Top, false); // 图例在顶部
+        soilChart->setAxisTitle(Chart::Bottom, "时间"); // X轴标题
+        soilChart->setAxisTitle(Chart::Left, "数值"); // Y轴标题
+    }
+    
+    return xlsx.saveAs(fileName);
+}
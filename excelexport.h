@@ -0,0 +1,19 @@
+﻿#ifndef EXCELEXPORT_H
+#define EXCELEXPORT_H
+
+#include <QList>
+#include <QString>
+#include <QVariantList>
+
+// ExcelExporter - 把数据库查询结果导出为xlsx工作簿
+// 结果行的格式与DatabaseWorker::queryResultsReady相同：
+// entry_id, collect_time, air_temp, air_humidity, oxygen_content, soil_temp, soil_humidity, light_intensity
+class ExcelExporter
+{
+public:
+    // 生成“空气参数”“土壤参数”两个工作表（数据表格 + 折线图）并保存到fileName
+    // 返回值: 是否保存成功
+    static bool writeGreenhouseWorkbook(const QList<QVariantList> &results, const QString &fileName);
+};
+
+#endif // EXCELEXPORT_H
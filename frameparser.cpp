@@ -0,0 +1,204 @@
+﻿#include "frameparser.h"
+#include "logger.h"
+#include "metrics.h"
+
+#include <QStringList>
+#include <QDateTime>
+#include <QMap>
+#include <climits>
+#include <cmath>
+
+static const QByteArray kFramePrefix("{Params[");//帧头
+static const QByteArray kFrameSuffix("]}");//帧尾
+
+// 发送时间戳（ts，墙上时钟微秒）允许的范围：比本机时钟早超过一天或晚超过一分钟的视为无效，
+// 避免时钟错误或伪造的ts把端到端延迟直方图的桶拉到离谱的值
+static const qint64 kMaxSentAgeUs = 24LL * 3600 * 1000 * 1000;
+static const qint64 kMaxSentAheadUs = 60LL * 1000 * 1000;
+
+std::atomic<bool> FrameParser::s_rawDataEnabled(false);
+
+// 报文中的整数字段（node、seq、ts）先以double解析：必须是有限的整数且在[minimum, maximum]内才能转换，
+// 否则转换是未定义行为
+static bool integralInRange(double value, double minimum, double maximum)
+{
+    return std::isfinite(value) && value == std::trunc(value) && value >= minimum && value <= maximum;
+}
+
+// 整数字段无效（非整数、超出范围、NaN/inf）时不赋值并计数；只在出错时走到这里，按字段名查注册表即可
+static void countInvalidField(const char *field, double value)
+{
+    Metrics::instance()
+        .counter("sensor_parse_invalid_fields_total", "报文中无效而被忽略的整数字段数", QString("field=\"%1\"").arg(field))
+        ->inc();
+    LOG_WARNING("parser", "整数字段无效，忽略", {"field", field}, {"value", value});
+}
+
+FrameParser::FrameParser(int maxBufferSize)
+    : m_head(0), m_maxBufferSize(maxBufferSize)
+{
+}
+
+void FrameParser::append(const QByteArray &bytes)
+{
+    // 已取走的字节超过一半时再整体前移，避免每取一帧就搬移一次缓冲区
+    if (m_head > 0 && m_head >= m_buffer.size() / 2) {
+        m_buffer.remove(0, m_head);
+        m_head = 0;
+    }
+    m_buffer.append(bytes);
+}
+
+bool FrameParser::nextFrame(QByteArray &frame)
+{
+    while (m_head < m_buffer.size()) {
+        int start = m_buffer.indexOf(kFramePrefix, m_head);
+        if (start < 0) {
+            // 没有帧头：末尾可能是半个帧头（如"{Par"），保留它等待后续字节，其余丢弃
+            int keepFrom = m_buffer.size();
+            int brace = m_buffer.lastIndexOf('{');
+            if (brace >= m_head && m_buffer.size() - brace < kFramePrefix.size()
+                && kFramePrefix.startsWith(QByteArrayView(m_buffer).mid(brace))) {
+                keepFrom = brace;
+            }
+            m_discarded.append(m_buffer.constData() + m_head, keepFrom - m_head);
+            m_head = keepFrom;
+            return false;
+        }
+
+        if (start > m_head) {
+            m_discarded.append(m_buffer.constData() + m_head, start - m_head);
+            m_head = start;
+        }
+
+        int end = m_buffer.indexOf(kFrameSuffix, start + kFramePrefix.size());
+        int nextStart = m_buffer.indexOf(kFramePrefix, start + kFramePrefix.size());
+        if (nextStart >= 0 && (end < 0 || nextStart < end)) {
+            // 帧尾之前又出现了新的帧头，说明当前帧不完整，丢弃后从新帧头继续
+            m_discarded.append(m_buffer.constData() + start, nextStart - start);
+            m_head = nextStart;
+            continue;
+        }
+
+        if (end < 0) {
+            // 帧尾还没到；超过上限仍未收齐则视为坏帧丢弃
+            if (m_buffer.size() - m_head > m_maxBufferSize) {
+                LOG_WARNING("parser", "帧长度超过上限，丢弃", {"bytes", int(m_buffer.size() - m_head)});
+                m_discarded.append(m_buffer.constData() + m_head, m_buffer.size() - m_head);
+                m_buffer.clear();
+                m_head = 0;
+            }
+            return false;
+        }
+
+        int frameEnd = end + kFrameSuffix.size();
+        frame = m_buffer.mid(start, frameEnd - start);
+        m_head = frameEnd;
+        return true;
+    }
+    return false;
+}
+
+QByteArray FrameParser::takeDiscarded()
+{
+    QByteArray discarded;
+    discarded.swap(m_discarded);
+    return discarded;
+}
+
+void FrameParser::clear()
+{
+    m_buffer.clear();
+    m_discarded.clear();
+    m_head = 0;
+}
+
+bool FrameParser::parseSensorData(const QString &rawStr, SensorData &result)
+{
+    if (rawStr.isEmpty()) {
+        LOG_DEBUG("parser", "数据为空");
+        return false;
+    }
+
+    // 1. 校验外层格式并提取核心内容
+    const QString prefix = "{Params[";
+    const QString suffix = "]}";
+    if (!rawStr.startsWith(prefix) || !rawStr.endsWith(suffix)) {
+        LOG_WARNING("parser", "数据格式错误，不符合 {Params[...]} 规则", {"frame", rawStr.left(64)});
+        return false;
+    }
+
+    // 提取中间的键值对部分（去掉前缀和后缀）
+    QString content = rawStr.mid(prefix.length(), rawStr.length() - prefix.length() - suffix.length());
+    if (content.isEmpty()) {
+        LOG_WARNING("parser", "数据内容为空");
+        return false;
+    }
+
+    // 2. 按 ; 分割键值对（过滤空字符串，避免最后一个 ; 导致的空项）
+    QStringList keyValueList = content.split(';', Qt::SkipEmptyParts);
+    if (keyValueList.isEmpty()) {
+        LOG_WARNING("parser", "未找到有效键值对");
+        return false;
+    }
+
+    // 3. 解析每个键值对并存储
+    QMap<QString, double> tempMap;  // 临时用哈希表存储，便于灵活赋值
+    for (const QString& kv : keyValueList) {
+        QStringList parts = kv.split(':', Qt::KeepEmptyParts);
+        if (parts.size() != 2) {  // 必须是 "键:值" 格式
+            LOG_WARNING("parser", "无效的键值对格式", {"pair", kv});
+            continue;
+        }
+
+        QString key = parts[0].trimmed();    // 参数名（如"atemp"）
+        QString valueStr = parts[1].trimmed();  // 参数值字符串（如"69.3"）
+
+        // 转换数值为double
+        bool ok = false;
+        double value = valueStr.toDouble(&ok);
+        if (!ok) {
+            LOG_WARNING("parser", "参数值转换失败", {"key", key}, {"value", valueStr});
+            continue;
+        }
+
+        tempMap[key] = value;  // 存入哈希表
+    }
+
+    // 4. 将哈希表的值赋值给结构体（确保参数存在，避免使用未初始化的值）
+    if (tempMap.contains("atemp"))    result.atemp = tempMap["atemp"];
+    if (tempMap.contains("ahumi"))    result.ahumi = tempMap["ahumi"];
+    if (tempMap.contains("oxygen"))   result.oxygen = tempMap["oxygen"];
+    if (tempMap.contains("stemp"))    result.stemp = tempMap["stemp"];
+    if (tempMap.contains("shumi2"))   result.shumi2 = tempMap["shumi2"];
+    if (tempMap.contains("light"))    result.light = tempMap["light"];
+    // node、seq来自网络，可能是任意数值：无效时保持默认值（node为0，seq为-1即不参与序号统计）
+    if (tempMap.contains("node")) {
+        const double node = tempMap["node"];
+        if (integralInRange(node, INT_MIN, INT_MAX)) {
+            result.node = static_cast<int>(node);
+        } else {
+            countInvalidField("node", node);
+        }
+    }
+    if (tempMap.contains("seq")) {
+        const double seq = tempMap["seq"];
+        if (integralInRange(seq, 0, 9007199254740992.0)) { // 2^53，double能精确表示的整数上限
+            result.seq = static_cast<long long>(seq);
+        } else {
+            countInvalidField("seq", seq);
+        }
+    }
+    result.time = QDateTime::currentMSecsSinceEpoch();
+    if (tempMap.contains("ts")) {
+        const double sent = tempMap["ts"];
+        const double nowUs = double(result.time) * 1000;
+        if (integralInRange(sent, qMax(0.0, nowUs - kMaxSentAgeUs), nowUs + kMaxSentAheadUs)) {
+            result.sent = static_cast<long long>(sent);
+        } else {
+            countInvalidField("ts", sent); // 保持0，不参与延迟统计
+        }
+    }
+
+    return true;
+}
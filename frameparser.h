@@ -0,0 +1,48 @@
+﻿#ifndef FRAMEPARSER_H
+#define FRAMEPARSER_H
+
+#include <QByteArray>
+#include <QString>
+#include <atomic>
+#include "sensordata.h"
+
+// FrameParser - 字节流分帧与报文解析
+// TCP和串口都是“流式”的：一帧数据可能被拆成几次到达，也可能几帧粘在一起到达。
+// append()把收到的字节放进重组缓冲区，nextFrame()每次取出一帧完整的 {Params[...]} 报文。
+class FrameParser
+{
+public:
+    explicit FrameParser(int maxBufferSize = 64 * 1024);
+
+    // 追加新收到的字节
+    void append(const QByteArray &bytes);
+
+    // 取出下一帧完整报文，没有完整帧时返回false
+    bool nextFrame(QByteArray &frame);
+
+    // 取出分帧时丢弃的非报文字节（例如下位机的回显文本），供调试窗口显示
+    QByteArray takeDiscarded();
+
+    // 清空重组缓冲区（重连时调用，避免拼接上一次连接的残帧）
+    void clear();
+
+    // 当前缓冲区中尚未成帧的字节数
+    int bufferedBytes() const { return m_buffer.size() - m_head; }
+
+    // 解析一帧 {Params[key:value;...]} 报文，格式错误返回false
+    static bool parseSensorData(const QString &rawStr, SensorData &result);
+
+    // 是否向调试窗口发送原始数据（rawdata信号）；调试窗口关闭时关掉，省去每帧一个QString的开销
+    static void setRawDataEnabled(bool enabled) { s_rawDataEnabled.store(enabled, std::memory_order_relaxed); }
+    static bool rawDataEnabled() { return s_rawDataEnabled.load(std::memory_order_relaxed); }
+
+private:
+    QByteArray m_buffer;    // 重组缓冲区
+    int m_head;             // 缓冲区中已处理到的位置
+    QByteArray m_discarded; // 被丢弃的非报文字节
+    int m_maxBufferSize;    // 缓冲区上限，防止一直收不到帧尾时无限增长
+
+    static std::atomic<bool> s_rawDataEnabled;
+};
+
+#endif // FRAMEPARSER_H
@@ -0,0 +1,256 @@
+﻿// historychart.cpp - 主界面图表的历史模式（按需查询数据库瓦片）
+
+#include "historychart.h"
+#include <QDateTime>
+#include <QTimer>
+#include <QtMath>
+#include <QDebug>
+
+HistoryChart::HistoryChart(const QList<QCustomPlot *> &plots, QObject *parent)
+    : QObject(parent)
+    , m_plots(plots)
+    , m_cache(kCacheRows)
+{
+    m_refreshTimer = new QTimer(this);
+    m_refreshTimer->setSingleShot(true);
+    connect(m_refreshTimer, &QTimer::timeout, this, &HistoryChart::refresh);
+
+    for (QCustomPlot *plot : m_plots) {
+        connect(plot->xAxis, qOverload<const QCPRange &>(&QCPAxis::rangeChanged),
+                this, &HistoryChart::onRangeChanged);
+    }
+}
+
+//进入历史模式
+void HistoryChart::start(double upper, double span)
+{
+    m_active = true;
+    for (QCustomPlot *plot : m_plots) {
+        // 只允许时间方向拖动和缩放，数值轴保持不变
+        plot->setInteractions(QCP::iRangeDrag | QCP::iRangeZoom);
+        plot->axisRect()->setRangeDrag(Qt::Horizontal);
+        plot->axisRect()->setRangeZoom(Qt::Horizontal);
+        setTickerFormat(plot, "MM-dd\nHH:mm:ss"); // 可能跨越多天，显示日期
+        for (int i = 0; i < plot->graphCount(); ++i) {
+            plot->graph(i)->data()->clear();
+        }
+    }
+    // 设置第一个图表的范围，onRangeChanged会同步到其余图表并安排刷新
+    m_plots.first()->xAxis->setRange(upper - span, upper);
+}
+
+//退出历史模式
+void HistoryChart::stop()
+{
+    m_active = false;
+    m_refreshTimer->stop();
+    for (QCustomPlot *plot : m_plots) {
+        plot->setInteractions(QCP::Interactions());
+        setTickerFormat(plot, "HH:mm:ss");
+    }
+}
+
+void HistoryChart::setTickerFormat(QCustomPlot *plot, const QString &format)
+{
+    QSharedPointer<QCPAxisTickerDateTime> ticker = plot->xAxis->ticker().dynamicCast<QCPAxisTickerDateTime>();
+    if (ticker) {
+        ticker->setDateTimeFormat(format);
+    }
+}
+
+//任一图表的时间轴变化：同步其余图表，并在下一帧刷新
+void HistoryChart::onRangeChanged(const QCPRange &range)
+{
+    if (!m_active || m_syncing) {
+        return;
+    }
+    m_syncing = true;
+    for (QCustomPlot *plot : m_plots) {
+        if (plot->xAxis->range() != range) {
+            plot->xAxis->setRange(range);
+            plot->replot(QCustomPlot::rpQueuedReplot);
+        }
+    }
+    m_syncing = false;
+    m_range = range;
+    // 拖动时每次鼠标移动都会触发，合并到约60fps刷新一次
+    scheduleRefresh(16);
+}
+
+//数据库线程返回瓦片
+void HistoryChart::onTileReady(const HistoryTile &tile)
+{
+    m_pending.remove(tile.key);
+    if (!tile.ok) {
+        // 数据库未连接或查询失败，稍后再试，不立刻重发
+        m_retryAfter = QDateTime::currentMSecsSinceEpoch() + kRetryDelayMs;
+        if (m_active) {
+            scheduleRefresh(kRetryDelayMs);
+        }
+        return;
+    }
+    m_cache.insert(tile.key, new HistoryTile(tile), tile.rows.size() + 1);
+    if (m_active) {
+        scheduleRefresh();
+    }
+}
+
+void HistoryChart::scheduleRefresh(int delayMs)
+{
+    if (!m_refreshTimer->isActive()) {
+        m_refreshTimer->start(delayMs);
+    }
+}
+
+//按当前范围刷新曲线并请求缺少的瓦片
+void HistoryChart::refresh()
+{
+    if (!m_active || m_plots.isEmpty()) {
+        return;
+    }
+    m_range = m_plots.first()->xAxis->range();
+    const int level = levelFor(m_range);
+    const QList<HistoryTileKey> visible = visibleTiles(m_range, level);
+    rebuildGraphs(visible);
+    requestMissing(visible);
+}
+
+//选择分辨率：每个像素大约一个桶
+int HistoryChart::levelFor(const QCPRange &range) const
+{
+    const int width = qMax(1, m_plots.first()->axisRect()->width());
+    const double secondsPerPixel = range.size() / width;
+    if (secondsPerPixel <= 1.0) {
+        return 0;
+    }
+    return qBound(0, int(qCeil(std::log2(secondsPerPixel))), int(HistoryTileKey::kMaxLevel));
+}
+
+//覆盖可见范围的瓦片
+QList<HistoryTileKey> HistoryChart::visibleTiles(const QCPRange &range, int level) const
+{
+    QList<HistoryTileKey> tiles;
+    HistoryTileKey key;
+    key.level = level;
+    const double span = double(key.spanSeconds());
+    const qint64 first = qint64(qFloor(range.lower / span));
+    const qint64 last = qint64(qFloor(range.upper / span));
+    for (qint64 index = first; index <= last; ++index) {
+        key.index = index;
+        tiles.append(key);
+    }
+    return tiles;
+}
+
+//瓦片是否需要（重新）查询
+bool HistoryChart::needsFetch(const HistoryTileKey &key) const
+{
+    if (m_pending.contains(key)) {
+        return false;
+    }
+    const HistoryTile *tile = m_cache.object(key);
+    if (!tile) {
+        return true;
+    }
+    // 查询时还没结束的瓦片之后可能有新数据写入
+    const bool open = key.endSeconds() * 1000 > tile->fetchedAt;
+    return open && QDateTime::currentMSecsSinceEpoch() - tile->fetchedAt > kOpenTileMaxAgeMs;
+}
+
+//请求缺少的瓦片：先可见的，再预取相邻和上一级的
+void HistoryChart::requestMissing(const QList<HistoryTileKey> &visible)
+{
+    if (visible.isEmpty() || QDateTime::currentMSecsSinceEpoch() < m_retryAfter) {
+        return;
+    }
+
+    QList<HistoryTileKey> wanted = visible;
+    HistoryTileKey before = visible.first();
+    before.index -= 1;
+    HistoryTileKey after = visible.last();
+    after.index += 1;
+    wanted << before << after;
+    if (visible.first().level < HistoryTileKey::kMaxLevel) {
+        // 缩小时需要的上一级瓦片
+        QSet<qint64> parents;
+        for (const HistoryTileKey &key : visible) {
+            parents.insert(key.index >> 1);
+        }
+        for (qint64 index : parents) {
+            HistoryTileKey parent;
+            parent.level = visible.first().level + 1;
+            parent.index = index;
+            wanted << parent;
+        }
+    }
+
+    // 不超过在途上限；其余的等已发出的查询返回后再请求，
+    // 拖动过程中过时的瓦片因此不会被请求
+    for (const HistoryTileKey &key : wanted) {
+        if (m_pending.size() >= kMaxPending) {
+            break;
+        }
+        if (needsFetch(key)) {
+            m_pending.insert(key);
+            emit requestTile(key);
+        }
+    }
+}
+
+//用缓存中的瓦片重建曲线数据
+void HistoryChart::rebuildGraphs(const QList<HistoryTileKey> &visible)
+{
+    const int channels = m_plots.size() * 3;
+    // 所有曲线共用一列时间，各自引用其中一个通道
+    QSharedPointer<QCPDataColumns> columns(new QCPDataColumns(channels));
+    QVector<double> values(channels);
+
+    for (const HistoryTileKey &key : visible) {
+        // 缺少的瓦片用缓存中更粗的瓦片顶替，只取其中落在本瓦片时间段内的行
+        const HistoryTile *tile = nullptr;
+        HistoryTileKey lookup = key;
+        for (int up = 0; up <= 4 && lookup.level <= HistoryTileKey::kMaxLevel; ++up) {
+            tile = m_cache.object(lookup);
+            if (tile) {
+                break;
+            }
+            lookup.level += 1;
+            lookup.index >>= 1;
+        }
+        if (!tile) {
+            continue;
+        }
+        const qint64 startMs = key.startSeconds() * 1000;
+        const qint64 endMs = key.endSeconds() * 1000;
+        for (const SensorData &row : tile->rows) {
+            if (row.time < startMs || row.time >= endMs) {
+                continue;
+            }
+            for (int channel = 0; channel < channels; ++channel) {
+                values[channel] = channelValue(row, channel);
+            }
+            columns->append(row.time / 1000.0, values.constData());
+        }
+    }
+
+    for (int i = 0; i < m_plots.size(); ++i) {
+        QCustomPlot *plot = m_plots.at(i);
+        for (int j = 0; j < plot->graphCount() && j < 3; ++j) {
+            plot->graph(j)->setData(QSharedPointer<QCPGraphDataContainer>(new QCPGraphDataContainer(columns, i * 3 + j)));
+        }
+        plot->replot(QCustomPlot::rpQueuedReplot);
+    }
+}
+
+double HistoryChart::channelValue(const SensorData &data, int channel)
+{
+    switch (channel) {
+    case 0: return data.atemp;
+    case 1: return data.ahumi;
+    case 2: return data.oxygen;
+    case 3: return data.stemp;
+    case 4: return data.shumi2;
+    case 5: return data.light;
+    default: return 0;
+    }
+}
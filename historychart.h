@@ -0,0 +1,69 @@
+﻿#ifndef HISTORYCHART_H
+#define HISTORYCHART_H
+
+#include <QObject>
+#include <QList>
+#include <QCache>
+#include <QSet>
+#include "qcustomplot.h"
+#include "historytile.h"
+
+class QTimer;
+
+// HistoryChart - 主界面两个图表的历史模式
+// 进入历史模式后图表可以水平拖动/缩放，两个图表的时间轴保持同步。
+// 时间轴变化时按当前可见范围和像素宽度选出需要的瓦片（时间窗口 × 分辨率），
+// 通过requestTile信号交给数据库线程异步查询，查询结果放入LRU缓存后再刷新曲线，
+// 界面线程只做缓存查找和setData，不等待数据库。
+// 缺少的瓦片先用缓存中更粗一级的瓦片顶替，同时预取左右相邻和上一级的瓦片。
+//
+// 图表i的第j条曲线对应SensorData的第 i*3+j 个数值（与实时模式相同）。
+class HistoryChart : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HistoryChart(const QList<QCustomPlot *> &plots, QObject *parent = nullptr);
+
+    bool isActive() const { return m_active; }
+
+    // 进入历史模式，显示 [upper - span, upper]（Unix时间，秒）
+    void start(double upper, double span);
+    // 退出历史模式，恢复为不可交互的实时图表（曲线数据由调用方重新设置）
+    void stop();
+
+signals:
+    void requestTile(const HistoryTileKey &key);//请求数据库线程查询一个瓦片
+
+public slots:
+    void onTileReady(const HistoryTile &tile);//数据库线程返回瓦片
+
+private slots:
+    void onRangeChanged(const QCPRange &range);//任一图表的时间轴变化
+    void refresh();//按当前范围刷新曲线并请求缺少的瓦片
+
+private:
+    static const int kMaxPending = 4;         // 同时在途的查询数，拖动时不把数据库线程的队列堆满
+    static const int kCacheRows = 200000;     // LRU缓存容量（按行数计）
+    static const int kOpenTileMaxAgeMs = 5000; // 覆盖当前时间的瓦片的有效期
+    static const int kRetryDelayMs = 2000;    // 查询失败（如数据库未连接）后的重试间隔
+
+    QList<QCustomPlot *> m_plots;
+    QCache<HistoryTileKey, HistoryTile> m_cache; // 瓦片LRU缓存
+    QSet<HistoryTileKey> m_pending;               // 已请求、尚未返回的瓦片
+    QTimer *m_refreshTimer = nullptr;             // 把一帧内的多次范围变化合并成一次刷新
+    QCPRange m_range;
+    bool m_active = false;
+    bool m_syncing = false;
+    qint64 m_retryAfter = 0;
+
+    int levelFor(const QCPRange &range) const;
+    QList<HistoryTileKey> visibleTiles(const QCPRange &range, int level) const;
+    bool needsFetch(const HistoryTileKey &key) const;
+    void requestMissing(const QList<HistoryTileKey> &visible);
+    void rebuildGraphs(const QList<HistoryTileKey> &visible);
+    void scheduleRefresh(int delayMs = 0);
+    static void setTickerFormat(QCustomPlot *plot, const QString &format);
+    static double channelValue(const SensorData &data, int channel);
+};
+
+#endif // HISTORYCHART_H
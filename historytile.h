@@ -0,0 +1,44 @@
+﻿#ifndef HISTORYTILE_H
+#define HISTORYTILE_H
+
+#include <QHash>
+#include <QMetaType>
+#include <QVector>
+#include "sensordata.h"
+
+// HistoryTileKey - 历史曲线的数据瓦片编号（时间窗口 × 分辨率）
+// 第level级的桶宽为2^level秒，每个瓦片固定kBuckets个桶，
+// 瓦片index覆盖 [index*spanSeconds, (index+1)*spanSeconds) 秒（Unix时间）。
+struct HistoryTileKey {
+    static const int kBuckets = 256; // 每个瓦片的桶数
+    static const int kMaxLevel = 20; // 最粗一级桶宽约12天
+
+    int level = 0;
+    qint64 index = 0;
+
+    qint64 bucketSeconds() const { return qint64(1) << level; }
+    qint64 spanSeconds() const { return bucketSeconds() * kBuckets; }
+    qint64 startSeconds() const { return index * spanSeconds(); }
+    qint64 endSeconds() const { return startSeconds() + spanSeconds(); }
+
+    bool operator==(const HistoryTileKey &other) const { return level == other.level && index == other.index; }
+    bool operator!=(const HistoryTileKey &other) const { return !(*this == other); }
+};
+
+inline size_t qHash(const HistoryTileKey &key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.level, key.index);
+}
+
+// HistoryTile - 数据库按桶聚合后的一个瓦片
+struct HistoryTile {
+    HistoryTileKey key;
+    bool ok = false;          // 查询是否成功（失败的瓦片不进缓存）
+    qint64 fetchedAt = 0;     // 查询时刻（毫秒），覆盖当前时间的瓦片过一段时间需要重新查询
+    QVector<SensorData> rows; // 每个有数据的桶一行：time为桶中点（毫秒），数值为桶内平均值
+};
+
+Q_DECLARE_METATYPE(HistoryTileKey)
+Q_DECLARE_METATYPE(HistoryTile)
+
+#endif // HISTORYTILE_H
@@ -0,0 +1,178 @@
+﻿// latencytrace.cpp - 读数各阶段延迟的直方图与抽样追踪
+
+#include "latencytrace.h"
+#include "metrics.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <chrono>
+
+static const int kSampleShift = 6;     // 抽样比例1/2^6
+static const int kMaxSpans = 32768;    // 最多保留的抽样区间数，满了覆盖最旧的
+
+namespace {
+
+struct Span {
+    const char *name;
+    const char *category;
+    quint64 id;
+    qint64 begin;
+    qint64 end;
+    int node;
+    qint64 seq;
+};
+
+// 抽样区间的环形缓冲：只有被抽中的读数才加锁写入
+struct SpanRing {
+    QMutex mutex;
+    QVector<Span> spans;
+    int next = 0;
+};
+
+SpanRing &spanRing()
+{
+    static SpanRing ring;
+    return ring;
+}
+
+MetricHistogram *stageHistogram(const char *stage)
+{
+    return Metrics::instance().histogram("sensor_latency_seconds", "读数各阶段的延迟", 1e-6,
+                                         QString("stage=\"%1\"").arg(QLatin1String(stage)));
+}
+
+MetricHistogram *pathHistogram(const char *path)
+{
+    return Metrics::instance().histogram("sensor_reading_latency_seconds", "读数从套接字读出到入库提交/首次显示的延迟", 1e-6,
+                                         QString("path=\"%1\"").arg(QLatin1String(path)));
+}
+
+// 同一条读数在三个线程上算出同一个编号：既决定是否抽样，也是trace中把各阶段串起来的id
+quint64 traceId(const SensorData &data)
+{
+    quint64 h = quint64(data.readAt) * 0x9E3779B97F4A7C15ull;
+    h ^= (quint64(data.parsedAt) + (quint64(quint32(data.node)) << 32) + quint64(data.seq)) * 0xC2B2AE3D27D4EB4Full;
+    return h ^ (h >> 29);
+}
+
+bool isSampled(const SensorData &data)
+{
+    return (traceId(data) >> (64 - kSampleShift)) == 0;
+}
+
+// 未追踪（readAt为0，例如从磁盘溢出文件读回的数据）或时钟倒退时不计入
+void recordStage(MetricHistogram *histogram, qint64 begin, qint64 end)
+{
+    if (begin > 0 && end >= begin) {
+        histogram->record(end - begin);
+    }
+}
+
+} // namespace
+
+qint64 LatencyTrace::now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void LatencyTrace::recordEnqueued(SensorData &data)
+{
+    static MetricHistogram *const parse = stageHistogram("parse");
+    static MetricHistogram *const enqueue = stageHistogram("enqueue");
+
+    data.enqueuedAt = now();
+    if (data.readAt <= 0) {
+        return;
+    }
+    recordStage(parse, data.readAt, data.parsedAt);
+    recordStage(enqueue, data.parsedAt, data.enqueuedAt);
+    if (isSampled(data)) {
+        recordSpan("parse", "ingest", data, data.readAt, data.parsedAt);
+        recordSpan("enqueue", "ingest", data, data.parsedAt, data.enqueuedAt);
+    }
+}
+
+void LatencyTrace::recordCommitted(const QVector<SensorData> &batch, qint64 writeStart, qint64 committedAt)
+{
+    static MetricHistogram *const storeWait = stageHistogram("store_wait");
+    static MetricHistogram *const commit = stageHistogram("commit");
+    static MetricHistogram *const total = pathHistogram("store");
+
+    for (const SensorData &data : batch) {
+        if (data.readAt <= 0) {
+            continue;
+        }
+        recordStage(storeWait, data.enqueuedAt, writeStart);
+        recordStage(commit, writeStart, committedAt);
+        recordStage(total, data.readAt, committedAt);
+        if (isSampled(data)) {
+            recordSpan("store_wait", "store", data, data.enqueuedAt, writeStart);
+            recordSpan("commit", "store", data, writeStart, committedAt);
+        }
+    }
+}
+
+void LatencyTrace::recordPainted(const QVector<SensorData> &readings, qint64 replotStart, qint64 replotEnd)
+{
+    static MetricHistogram *const uiWait = stageHistogram("ui_wait");
+    static MetricHistogram *const replot = stageHistogram("replot");
+    static MetricHistogram *const total = pathHistogram("paint");
+
+    for (const SensorData &data : readings) {
+        if (data.readAt <= 0) {
+            continue;
+        }
+        recordStage(uiWait, data.enqueuedAt, replotStart);
+        recordStage(replot, replotStart, replotEnd);
+        recordStage(total, data.readAt, replotEnd);
+        if (isSampled(data)) {
+            recordSpan("ui_wait", "ui", data, data.enqueuedAt, replotStart);
+            recordSpan("replot", "ui", data, replotStart, replotEnd);
+        }
+    }
+}
+
+void LatencyTrace::recordSpan(const char *name, const char *category, const SensorData &data, qint64 begin, qint64 end)
+{
+    if (begin <= 0 || end < begin) {
+        return;
+    }
+    const Span span{name, category, traceId(data), begin, end, data.node, data.seq};
+    SpanRing &ring = spanRing();
+    QMutexLocker locker(&ring.mutex);
+    if (ring.spans.size() < kMaxSpans) {
+        ring.spans.append(span);
+    } else {
+        ring.spans[ring.next] = span;
+    }
+    ring.next = (ring.next + 1) % kMaxSpans;
+}
+
+// 每个区间导出为一对异步事件（ph为b/e）：同一条读数的同一类别（ingest/store/ui）显示在同一行
+QByteArray LatencyTrace::traceJson()
+{
+    QVector<Span> spans;
+    {
+        SpanRing &ring = spanRing();
+        QMutexLocker locker(&ring.mutex);
+        spans = ring.spans;
+    }
+
+    QByteArray json;
+    json.reserve(spans.size() * 260 + 64);
+    json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const Span &span : spans) {
+        const QByteArray common = QByteArray("\"name\":\"") + span.name + "\",\"cat\":\"" + span.category
+                                  + "\",\"id\":\"0x" + QByteArray::number(span.id, 16) + "\",\"pid\":1,\"tid\":1";
+        if (!first) {
+            json += ',';
+        }
+        first = false;
+        json += "\n{" + common + ",\"ph\":\"b\",\"ts\":" + QByteArray::number(span.begin)
+                + ",\"args\":{\"node\":" + QByteArray::number(span.node) + ",\"seq\":" + QByteArray::number(span.seq) + "}}";
+        json += ",\n{" + common + ",\"ph\":\"e\",\"ts\":" + QByteArray::number(span.end) + "}";
+    }
+    json += "\n]}\n";
+    return json;
+}
@@ -0,0 +1,42 @@
+﻿#ifndef LATENCYTRACE_H
+#define LATENCYTRACE_H
+
+#include <QByteArray>
+#include <QVector>
+#include "sensordata.h"
+
+// LatencyTrace - 每条读数从套接字读出到入库提交、到首次显示在曲线上的各阶段延迟
+// 接收线程在SensorData中记下三个时刻：读出（readAt）、解析完成（parsedAt）、进入队列（enqueuedAt）；
+// 数据库线程提交后、界面线程重绘后再各记一次。时刻取now()（单调时钟，微秒）。
+//
+// 各阶段延迟全部进入直方图 sensor_latency_seconds{stage=...}：
+//     parse      读出 -> 解析完成（同一次读到的多帧依次解析，后面的帧包含前面帧的解析时间）
+//     enqueue    解析完成 -> 进入队列
+//     store_wait 进入队列 -> 所在批次开始写入
+//     commit     所在批次开始写入 -> 提交完成
+//     ui_wait    进入队列 -> 显示它的那次重绘开始
+//     replot     重绘开始 -> 重绘结束
+// 端到端延迟进入 sensor_reading_latency_seconds{path="store"|"paint"}（从读出算起）。
+// 另按约1/64抽样保存各阶段区间，traceJson()导出Chrome trace-event格式
+// （MetricsServer的GET /trace，用chrome://tracing或ui.perfetto.dev打开）。
+class LatencyTrace
+{
+public:
+    // 单调时钟，微秒
+    static qint64 now();
+
+    // 入队前调用（接收线程）：记下入队时刻，累加parse/enqueue两段
+    static void recordEnqueued(SensorData &data);
+    // 一批数据提交后调用（数据库线程）
+    static void recordCommitted(const QVector<SensorData> &batch, qint64 writeStart, qint64 committedAt);
+    // 显示这些读数的重绘结果已显示后调用（界面线程，QCustomPlot::afterRasterize），replotEnd为显示时刻
+    static void recordPainted(const QVector<SensorData> &readings, qint64 replotStart, qint64 replotEnd);
+
+    // 抽样区间的Chrome trace-event JSON
+    static QByteArray traceJson();
+
+private:
+    static void recordSpan(const char *name, const char *category, const SensorData &data, qint64 begin, qint64 end);
+};
+
+#endif // LATENCYTRACE_H
@@ -0,0 +1,478 @@
+﻿// logger.cpp - 异步结构化日志：每线程无锁缓冲、后台写线程、按大小轮转的JSON Lines文件
+
+#include "logger.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+std::atomic<int> Logger::s_level{int(LogLevel::Info)};
+
+namespace {
+
+const int kBufferCapacity = 1024;  // 每个线程缓冲的记录数，写线程约每50毫秒取空一次
+const int kWriterIntervalMs = 50;
+
+struct LogRecord {
+    LogSite *site = nullptr;  // 日志宏的调用点；来自qDebug()等时为nullptr
+    LogLevel level = LogLevel::Info;
+    qint64 timeMs = 0;
+    quintptr threadId = 0;
+    int repeated = 0;         // 此前因限流被省略的条数
+    int fieldCount = 0;
+    LogField fields[Logger::kMaxFields];
+    QString text;             // qDebug()等的消息文本
+    QByteArray category;      // qDebug()等的日志类别
+};
+
+// 单生产者（所属线程）单消费者（写线程）的环形缓冲
+class LogBuffer
+{
+public:
+    LogBuffer() : m_records(kBufferCapacity) {}
+
+    bool push(LogRecord &&record)
+    {
+        const quint32 tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) >= quint32(kBufferCapacity)) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_records[tail % kBufferCapacity] = std::move(record);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(LogRecord &record)
+    {
+        const quint32 head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        record = std::move(m_records[head % kBufferCapacity]);
+        m_records[head % kBufferCapacity] = LogRecord(); // 释放字符串和QVariant
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    quint64 takeDropped() { return m_dropped.exchange(0, std::memory_order_relaxed); }
+
+    std::atomic<bool> orphaned{false}; // 所属线程已结束，取空后由写线程删除
+
+private:
+    std::vector<LogRecord> m_records;
+    std::atomic<quint32> m_head{0};
+    std::atomic<quint32> m_tail{0};
+    std::atomic<quint64> m_dropped{0};
+};
+
+// 线程结束时把缓冲标记为无主，剩余记录仍由写线程写出
+struct ThreadBuffer {
+    LogBuffer *buffer = nullptr;
+    ~ThreadBuffer()
+    {
+        if (buffer) {
+            buffer->orphaned.store(true, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadBuffer t_buffer;
+
+class LogWriter
+{
+public:
+    void start(const Logger::Options &options);
+    void stop();
+    bool isRunning() const { return m_running.load(std::memory_order_acquire); }
+    LogBuffer *threadBuffer();
+
+private:
+    void run();
+    void drain();
+    void write(const LogRecord &record);
+    void writeLine(const QByteArray &line);
+    void rotate();
+    QString fileName(int index) const;
+
+    Logger::Options m_options;
+    std::atomic<bool> m_running{false};
+    QThread *m_thread = nullptr;
+    QMutex m_mutex;              // 保护m_buffers和m_stopping
+    QWaitCondition m_wake;
+    bool m_stopping = false;
+    QList<LogBuffer *> m_buffers;
+    QFile m_file;
+    std::vector<LogRecord> m_pending; // 写线程专用：一轮取出的记录按时间排序后写出
+};
+
+LogWriter &writer()
+{
+    static LogWriter instance;
+    return instance;
+}
+
+QtMessageHandler s_previousHandler = nullptr;
+
+const char *levelName(LogLevel level)
+{
+    switch (level) {
+    case LogLevel::Trace: return "trace";
+    case LogLevel::Debug: return "debug";
+    case LogLevel::Info: return "info";
+    case LogLevel::Warning: return "warning";
+    case LogLevel::Error: return "error";
+    }
+    return "info";
+}
+
+void appendJsonString(QByteArray &out, const QByteArray &utf8)
+{
+    out += '"';
+    for (const char c : utf8) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (uchar(c) < 0x20) {
+                out += "\\u00" + QByteArray::number(uchar(c), 16).rightJustified(2, '0');
+            } else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+void appendJsonValue(QByteArray &out, const QVariant &value)
+{
+    switch (value.typeId()) {
+    case QMetaType::Bool:
+        out += value.toBool() ? "true" : "false";
+        break;
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+        out += value.toByteArray();
+        break;
+    case QMetaType::Float:
+    case QMetaType::Double: {
+        const double d = value.toDouble();
+        out += std::isfinite(d) ? QByteArray::number(d, 'g', 10) : QByteArray("null");
+        break;
+    }
+    default:
+        appendJsonString(out, value.toString().toUtf8());
+    }
+}
+
+// qDebug()等转入异步日志；qFatal仍交给原处理函数（它会终止程序）
+void qtMessageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message)
+{
+    LogLevel level = LogLevel::Debug;
+    switch (type) {
+    case QtDebugMsg: level = LogLevel::Debug; break;
+    case QtInfoMsg: level = LogLevel::Info; break;
+    case QtWarningMsg: level = LogLevel::Warning; break;
+    case QtCriticalMsg: level = LogLevel::Error; break;
+    case QtFatalMsg:
+        if (s_previousHandler) {
+            s_previousHandler(type, context, message);
+        }
+        return;
+    }
+    if (!Logger::enabled(level)) {
+        return;
+    }
+    LogRecord record;
+    record.level = level;
+    record.timeMs = QDateTime::currentMSecsSinceEpoch();
+    record.threadId = quintptr(QThread::currentThreadId());
+    record.text = message;
+    record.category = (context.category && qstrcmp(context.category, "default") != 0) ? QByteArray(context.category) : QByteArray("qt");
+    writer().threadBuffer()->push(std::move(record));
+}
+
+void LogWriter::start(const Logger::Options &options)
+{
+    if (isRunning()) {
+        return;
+    }
+    m_options = options;
+    QDir().mkpath(m_options.directory);
+    m_file.setFileName(fileName(0));
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        std::fprintf(stderr, "[Logger] 无法打开日志文件 %s\n", qPrintable(m_file.fileName()));
+    }
+    m_stopping = false;
+    m_running.store(true, std::memory_order_release);
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->setObjectName("logger");
+    m_thread->start(QThread::LowPriority);
+}
+
+void LogWriter::stop()
+{
+    if (!isRunning()) {
+        return;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_wake.wakeAll();
+    }
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+    m_running.store(false, std::memory_order_release);
+    m_file.close();
+}
+
+LogBuffer *LogWriter::threadBuffer()
+{
+    if (!t_buffer.buffer) {
+        LogBuffer *buffer = new LogBuffer;
+        QMutexLocker locker(&m_mutex);
+        m_buffers.append(buffer);
+        t_buffer.buffer = buffer;
+    }
+    return t_buffer.buffer;
+}
+
+void LogWriter::run()
+{
+    for (;;) {
+        bool stopping;
+        {
+            QMutexLocker locker(&m_mutex);
+            if (!m_stopping) {
+                m_wake.wait(&m_mutex, kWriterIntervalMs);
+            }
+            stopping = m_stopping;
+        }
+        drain();
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+// 取空所有线程的缓冲，按时间排序后写出；所属线程已结束的缓冲取空后删除
+void LogWriter::drain()
+{
+    QList<LogBuffer *> buffers;
+    {
+        QMutexLocker locker(&m_mutex);
+        buffers = m_buffers;
+    }
+
+    quint64 dropped = 0;
+    QList<LogBuffer *> finished;
+    LogRecord record;
+    for (LogBuffer *buffer : buffers) {
+        // 先读标记再取：标记之前写入的记录一定能取到
+        const bool orphaned = buffer->orphaned.load(std::memory_order_acquire);
+        while (buffer->pop(record)) {
+            m_pending.push_back(std::move(record));
+        }
+        dropped += buffer->takeDropped();
+        if (orphaned) {
+            finished.append(buffer);
+        }
+    }
+    if (!finished.isEmpty()) {
+        QMutexLocker locker(&m_mutex);
+        for (LogBuffer *buffer : finished) {
+            m_buffers.removeOne(buffer);
+            delete buffer;
+        }
+    }
+
+    if (dropped > 0) {
+        LogRecord note;
+        note.level = LogLevel::Warning;
+        note.timeMs = QDateTime::currentMSecsSinceEpoch();
+        note.category = "log";
+        note.text = QString("日志缓冲区已满，丢弃%1条").arg(dropped);
+        m_pending.push_back(std::move(note));
+    }
+    if (m_pending.empty()) {
+        return;
+    }
+
+    std::stable_sort(m_pending.begin(), m_pending.end(),
+                     [](const LogRecord &a, const LogRecord &b) { return a.timeMs < b.timeMs; });
+    for (const LogRecord &r : m_pending) {
+        write(r);
+    }
+    m_pending.clear();
+    m_file.flush();
+}
+
+void LogWriter::write(const LogRecord &record)
+{
+    const QByteArray time = QDateTime::fromMSecsSinceEpoch(record.timeMs).toString("yyyy-MM-ddTHH:mm:ss.zzz").toUtf8();
+    const QByteArray category = record.site ? QByteArray(record.site->category) : record.category;
+    const QByteArray message = record.site ? QByteArray(record.site->message) : record.text.toUtf8();
+
+    QByteArray line;
+    line.reserve(160);
+    line += "{\"ts\":\"" + time + "\",\"level\":\"" + levelName(record.level) + "\",\"cat\":";
+    appendJsonString(line, category);
+    line += ",\"thread\":" + QByteArray::number(quint64(record.threadId)) + ",\"msg\":";
+    appendJsonString(line, message);
+    for (int i = 0; i < record.fieldCount; ++i) {
+        line += ',';
+        appendJsonString(line, record.fields[i].key);
+        line += ':';
+        appendJsonValue(line, record.fields[i].value);
+    }
+    if (record.repeated > 0) {
+        line += ",\"repeated\":" + QByteArray::number(record.repeated);
+    }
+    if (record.site) {
+        line += ",\"src\":";
+        appendJsonString(line, QFileInfo(QString::fromUtf8(record.site->file)).fileName().toUtf8()
+                                   + ':' + QByteArray::number(record.site->line));
+    }
+    line += "}\n";
+    writeLine(line);
+
+    if (int(record.level) >= int(m_options.consoleLevel)) {
+        QByteArray console = time.mid(11) + ' ' + levelName(record.level) + ' ' + category + ": " + message;
+        for (int i = 0; i < record.fieldCount; ++i) {
+            console += QByteArray(" ") + record.fields[i].key + '=' + record.fields[i].value.toString().toUtf8();
+        }
+        if (record.repeated > 0) {
+            console += " (省略重复" + QByteArray::number(record.repeated) + "条)";
+        }
+        std::fprintf(stderr, "%s\n", console.constData());
+    }
+}
+
+void LogWriter::writeLine(const QByteArray &line)
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+    if (m_file.size() + line.size() > m_options.maxFileBytes) {
+        rotate();
+    }
+    m_file.write(line);
+}
+
+// <名称>.log -> <名称>.1.log -> …… 最旧的一个删除
+void LogWriter::rotate()
+{
+    m_file.close();
+    QFile::remove(fileName(m_options.maxFiles - 1));
+    for (int i = m_options.maxFiles - 2; i >= 0; --i) {
+        QFile::rename(fileName(i), fileName(i + 1));
+    }
+    m_file.setFileName(fileName(0));
+    m_file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+}
+
+QString LogWriter::fileName(int index) const
+{
+    const QString name = index == 0 ? QString("%1.log").arg(m_options.baseName)
+                                    : QString("%1.%2.log").arg(m_options.baseName).arg(index);
+    return QDir(m_options.directory).filePath(name);
+}
+
+} // namespace
+
+bool LogSite::admit(qint64 nowMs, int *repeated)
+{
+    qint64 start = windowStart.load(std::memory_order_relaxed);
+    if (nowMs - start >= 1000 && windowStart.compare_exchange_strong(start, nowMs, std::memory_order_relaxed)) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    if (count.fetch_add(1, std::memory_order_relaxed) >= kMaxPerSecond) {
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    *repeated = suppressed.exchange(0, std::memory_order_relaxed);
+    return true;
+}
+
+void Logger::start(const Options &options)
+{
+    setLevel(options.level);
+    writer().start(options);
+    s_previousHandler = qInstallMessageHandler(qtMessageHandler);
+}
+
+void Logger::stop()
+{
+    qInstallMessageHandler(s_previousHandler);
+    writer().stop();
+}
+
+LogLevel Logger::levelFromName(const QString &name, LogLevel fallback)
+{
+    const QString lower = name.trimmed().toLower();
+    for (LogLevel level : {LogLevel::Trace, LogLevel::Debug, LogLevel::Info, LogLevel::Warning, LogLevel::Error}) {
+        if (lower == QLatin1String(levelName(level))) {
+            return level;
+        }
+    }
+    return fallback;
+}
+
+void Logger::log(LogSite &site, std::initializer_list<LogField> fields)
+{
+    // 未启动写线程时（例如tools下的工具程序）直接交给Qt的日志输出
+    if (!writer().isRunning()) {
+        QString text = QString::fromUtf8(site.category) + ": " + QString::fromUtf8(site.message);
+        for (const LogField &field : fields) {
+            if (!field.key) {
+                continue;
+            }
+            text += QString(" %1=%2").arg(QString::fromUtf8(field.key), field.value.toString());
+        }
+        QMessageLogger logger(site.file, site.line, nullptr);
+        if (site.level >= LogLevel::Warning) {
+            logger.warning().noquote() << text;
+        } else if (site.level == LogLevel::Info) {
+            logger.info().noquote() << text;
+        } else {
+            logger.debug().noquote() << text;
+        }
+        return;
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    LogRecord record;
+    if (!site.admit(now, &record.repeated)) {
+        return;
+    }
+    record.site = &site;
+    record.level = site.level;
+    record.timeMs = now;
+    record.threadId = quintptr(QThread::currentThreadId());
+    for (const LogField &field : fields) {
+        if (!field.key) {
+            continue;
+        }
+        if (record.fieldCount == kMaxFields) {
+            break;
+        }
+        record.fields[record.fieldCount++] = field;
+    }
+    writer().threadBuffer()->push(std::move(record));
+}
@@ -0,0 +1,106 @@
+﻿#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <QString>
+#include <QVariant>
+#include <atomic>
+#include <initializer_list>
+
+// Logger - 异步结构化日志
+// 调用线程只做三件事：按级别过滤（一次原子读）、按调用点限流、把参数原样放进本线程的无锁环形缓冲；
+// 格式化（JSON Lines）、写文件和输出到终端都在后台写线程中完成，接收线程不会因为写日志而阻塞。
+// 缓冲区满时丢弃新记录并计数，不等待。日志文件按大小轮转：<名称>.log、<名称>.1.log ……
+//
+// 用法：
+//     LOG_WARNING("db", "数据库连接未打开，丢弃数据", {"rows", int(batch.size())});
+//     LOG_TRACE("tcp", "数据到达", {"bytes", int(bytes.size())}, {"node", node});
+// 级别不够时参数不会被求值。LOG_TRACE只在定义了SENSOR_LOG_ENABLE_TRACE时才编译进来（调试构建），
+// 发布构建中整条语句不存在。
+// start()之后qDebug()/qWarning()等也经由此日志输出（类别为Qt日志类别，默认"qt"）。
+
+enum class LogLevel : int {
+    Trace,
+    Debug,
+    Info,
+    Warning,
+    Error
+};
+
+struct LogField {
+    const char *key;   // nullptr表示列表结尾（日志宏自动添加），不输出
+    QVariant value;
+};
+
+// 调用点的静态信息和重复限流状态（由日志宏为每个调用点生成一个静态对象）
+struct LogSite {
+    LogSite(LogLevel level, const char *category, const char *message, const char *file, int line)
+        : level(level), category(category), message(message), file(file), line(line) {}
+
+    // 每秒最多kMaxPerSecond条，其余只计数，下一条放行的记录带上被省略的条数
+    bool admit(qint64 nowMs, int *repeated);
+
+    static const int kMaxPerSecond = 20;
+
+    const LogLevel level;
+    const char *const category;
+    const char *const message;
+    const char *const file;
+    const int line;
+    std::atomic<qint64> windowStart{0};
+    std::atomic<int> count{0};
+    std::atomic<int> suppressed{0};
+};
+
+class Logger
+{
+public:
+    struct Options {
+        QString directory;                    // 日志目录，不存在时创建
+        QString baseName = "SerialAndTCP";    // 文件名（不含扩展名）
+        qint64 maxFileBytes = 16 * 1024 * 1024; // 单个文件上限，超过则轮转
+        int maxFiles = 5;                     // 保留的文件数（含当前文件）
+        LogLevel level = LogLevel::Info;      // 记录的最低级别
+        LogLevel consoleLevel = LogLevel::Warning; // 同时输出到终端的最低级别
+    };
+
+    // 启动写线程并接管Qt的日志输出
+    static void start(const Options &options);
+    // 写完所有缓冲中的记录后停止写线程（程序退出前调用）
+    static void stop();
+
+    static bool enabled(LogLevel level) { return int(level) >= s_level.load(std::memory_order_relaxed); }
+    static void setLevel(LogLevel level) { s_level.store(int(level), std::memory_order_relaxed); }
+    // 解析"trace"/"debug"/"info"/"warning"/"error"，无法识别时返回fallback
+    static LogLevel levelFromName(const QString &name, LogLevel fallback);
+
+    // 由日志宏调用；最多记录kMaxFields个字段，多余的忽略，key为nullptr的字段跳过
+    static void log(LogSite &site, std::initializer_list<LogField> fields);
+
+    static const int kMaxFields = 4;
+
+private:
+    static std::atomic<int> s_level;
+};
+
+// 各LOG_*宏的参数整体作为__VA_ARGS__传入，再在末尾补一个空字段，SENSOR_LOG_的可变部分因此总不为空：
+// 不带字段的LOG_WARNING("parser", "数据内容为空")在C++17下也是合法的宏调用（-Wpedantic不报警告），不需要__VA_OPT__
+#define SENSOR_LOG(logLevel, ...) SENSOR_LOG_(logLevel, __VA_ARGS__, LogField{})
+#define SENSOR_LOG_(logLevel, category, message, ...)                                           \
+    do {                                                                                         \
+        if (Logger::enabled(logLevel)) {                                                         \
+            static LogSite sensorLogSite_(logLevel, category, message, __FILE__, __LINE__);      \
+            Logger::log(sensorLogSite_, {__VA_ARGS__});                                          \
+        }                                                                                        \
+    } while (0)
+
+#ifdef SENSOR_LOG_ENABLE_TRACE
+#define LOG_TRACE(...) SENSOR_LOG(LogLevel::Trace, __VA_ARGS__)
+#else
+#define LOG_TRACE(...) do {} while (0)
+#endif
+#define LOG_DEBUG(...) SENSOR_LOG(LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...) SENSOR_LOG(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARNING(...) SENSOR_LOG(LogLevel::Warning, __VA_ARGS__)
+#define LOG_ERROR(...) SENSOR_LOG(LogLevel::Error, __VA_ARGS__)
+
+#endif // LOGGER_H
@@ -0,0 +1,141 @@
+﻿#include "logringmodel.h"
+
+LogRingModel::LogRingModel(int capacity, QObject *parent)
+    : QAbstractListModel(parent)
+{
+    m_all.items.resize(qMax(1, capacity));
+    m_visible.items.resize(qMax(1, capacity));
+}
+
+bool LogRingModel::Ring::push(const Entry &e)
+{
+    if (size < items.size()) {
+        items[(head + size) % items.size()] = e;
+        size++;
+        return false;
+    }
+    items[head] = e;
+    head = (head + 1) % items.size();
+    return true;
+}
+
+int LogRingModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_visible.size;
+}
+
+QVariant LogRingModel::data(const QModelIndex &index, int role) const
+{
+    if (role != Qt::DisplayRole || !index.isValid() || index.row() >= m_visible.size) {
+        return QVariant();
+    }
+    return m_visible.at(index.row()).text;
+}
+
+// 从原始报文中取出node字段，如 "{Params[node:3;atemp:...]}"
+int LogRingModel::parseNode(const QString &line)
+{
+    int pos = line.indexOf("node:");
+    if (pos < 0) {
+        return -1;
+    }
+    pos += 5;
+    int end = pos;
+    while (end < line.size() && line.at(end).isDigit()) {
+        end++;
+    }
+    bool ok = false;
+    int node = QStringView(line).mid(pos, end - pos).toInt(&ok);
+    return ok ? node : -1;
+}
+
+void LogRingModel::appendLines(const QVector<QString> &lines)
+{
+    if (lines.isEmpty()) {
+        return;
+    }
+
+    QVector<Entry> shown;
+    for (const QString &line : lines) {
+        Entry e;
+        e.text = line;
+        e.node = parseNode(line);
+        m_all.push(e);
+        if (!m_paused && matches(e)) {
+            shown.append(e);
+        }
+    }
+    if (shown.isEmpty()) {
+        return;
+    }
+
+    const int capacity = m_visible.items.size();
+    if (shown.size() >= capacity) {
+        // 一批就超过容量：直接重建
+        beginResetModel();
+        m_visible.head = 0;
+        m_visible.size = 0;
+        for (int i = shown.size() - capacity; i < shown.size(); ++i) {
+            m_visible.push(shown[i]);
+        }
+        endResetModel();
+        return;
+    }
+
+    // 先移除放不下的最旧行，再在末尾插入新行
+    int overflow = m_visible.size + shown.size() - capacity;
+    if (overflow > 0) {
+        beginRemoveRows(QModelIndex(), 0, overflow - 1);
+        m_visible.head = (m_visible.head + overflow) % capacity;
+        m_visible.size -= overflow;
+        endRemoveRows();
+    }
+    beginInsertRows(QModelIndex(), m_visible.size, m_visible.size + shown.size() - 1);
+    for (const Entry &e : shown) {
+        m_visible.push(e);
+    }
+    endInsertRows();
+}
+
+void LogRingModel::setNodeFilter(int node)
+{
+    if (node == m_nodeFilter) {
+        return;
+    }
+    m_nodeFilter = node;
+    rebuildVisible();
+}
+
+void LogRingModel::setPaused(bool paused)
+{
+    if (paused == m_paused) {
+        return;
+    }
+    m_paused = paused;
+    if (!m_paused) {
+        // 恢复时把暂停期间保存的数据一次性显示出来
+        rebuildVisible();
+    }
+}
+
+void LogRingModel::clear()
+{
+    beginResetModel();
+    m_all.head = m_all.size = 0;
+    m_visible.head = m_visible.size = 0;
+    endResetModel();
+}
+
+void LogRingModel::rebuildVisible()
+{
+    beginResetModel();
+    m_visible.head = 0;
+    m_visible.size = 0;
+    for (int i = 0; i < m_all.size; ++i) {
+        const Entry &e = m_all.at(i);
+        if (matches(e)) {
+            m_visible.push(e);
+        }
+    }
+    endResetModel();
+}
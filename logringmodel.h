@@ -0,0 +1,61 @@
+﻿#ifndef LOGRINGMODEL_H
+#define LOGRINGMODEL_H
+
+#include <QAbstractListModel>
+#include <QVector>
+#include <QString>
+
+// LogRingModel - 定长环形日志模型，供调试窗口的QListView显示原始数据
+// 超过容量时丢弃最旧的行，内存不会随运行时间增长；
+// 配合uniformItemSizes的QListView只绘制可见的行，追加数据不需要重新排版整个文档。
+// 所有行都保存在m_all中，符合节点过滤条件且未暂停时同时进入m_visible供视图显示。
+class LogRingModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    explicit LogRingModel(int capacity = 5000, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    // 批量追加，一帧调用一次
+    void appendLines(const QVector<QString> &lines);
+
+    // 节点过滤，node<0表示不过滤
+    void setNodeFilter(int node);
+
+    // 暂停：新数据照常保存但视图不更新，恢复时一次性刷新
+    void setPaused(bool paused);
+    bool isPaused() const { return m_paused; }
+
+    // 清空
+    void clear();
+
+    int totalCount() const { return m_all.size; }
+
+private:
+    struct Entry {
+        QString text;
+        int node = -1;// 报文中的node字段，没有时为-1
+    };
+
+    // 定长环形缓冲
+    struct Ring {
+        QVector<Entry> items;
+        int head = 0;
+        int size = 0;
+        const Entry &at(int i) const { return items[(head + i) % items.size()]; }
+        bool push(const Entry &e);//满时覆盖最旧的，返回true表示覆盖了
+    };
+
+    Ring m_all;      // 全部行
+    Ring m_visible;  // 视图中显示的行
+    int m_nodeFilter = -1;
+    bool m_paused = false;
+
+    bool matches(const Entry &e) const { return m_nodeFilter < 0 || e.node == m_nodeFilter; }
+    static int parseNode(const QString &line);
+    void rebuildVisible();
+};
+
+#endif // LOGRINGMODEL_H
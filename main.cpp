@@ -1,11 +1,75 @@
 ﻿#include "widget.h"
+#include "metricsserver.h"
+#include "logger.h"
+#include "config.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
 
 int main(int argc, char *argv[])
 {
+    // 启动计时：到开始监听、首次显示、初始化完成的耗时记入日志和指标
+    QElapsedTimer startupClock;
+    startupClock.start();
+
     QApplication a(argc, argv);
-    Widget w;
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption configOption("config", "配置文件（INI，修改后自动重新载入）", "file",
+                                    QCoreApplication::applicationDirPath() + "/SerialAndTCP.ini");
+    QCommandLineOption metricsPortOption("metrics-port", "Prometheus /metrics端口（0表示不启用，默认取配置文件）", "port");
+    QCommandLineOption metricsBindOption("metrics-bind", "指标服务监听的地址（默认取配置文件，未配置时为127.0.0.1）", "address");
+    QCommandLineOption logDirOption("log-dir", "日志目录", "dir", QCoreApplication::applicationDirPath() + "/logs");
+    QCommandLineOption logLevelOption("log-level", "日志级别（trace/debug/info/warning/error，默认取配置文件）", "level");
+    QCommandLineOption captureOption("capture", "把TCP连接收到的原始字节记录到抓包文件（tools/replay回放）", "file");
+    parser.addOption(configOption);
+    parser.addOption(metricsPortOption);
+    parser.addOption(metricsBindOption);
+    parser.addOption(logDirOption);
+    parser.addOption(logLevelOption);
+    parser.addOption(captureOption);
+    parser.process(a);
+
+    // 配置在其他模块之前载入；命令行指定的指标端口、地址和日志级别优先于配置文件
+    Config &config = Config::instance();
+    config.load(parser.value(configOption));
+    const bool logLevelFixed = parser.isSet(logLevelOption);
+    const bool metricsPortFixed = parser.isSet(metricsPortOption);
+    const bool metricsBindFixed = parser.isSet(metricsBindOption);
+
+    Logger::Options logOptions;
+    logOptions.directory = parser.value(logDirOption);
+    logOptions.level = Logger::levelFromName(logLevelFixed ? parser.value(logLevelOption) : Config::current().logLevel, LogLevel::Info);
+    Logger::start(logOptions);
+
+    const quint16 fixedMetricsPort = quint16(parser.value(metricsPortOption).toUInt());
+    const QString fixedMetricsBind = parser.value(metricsBindOption);
+    auto metricsPortOf = [=](const AppConfig &c) { return metricsPortFixed ? fixedMetricsPort : c.metricsPort; };
+    auto metricsBindOf = [=](const AppConfig &c) { return QHostAddress(metricsBindFixed ? fixedMetricsBind : c.metricsBind); };
+
+    MetricsServer metricsServer;
+    metricsServer.start(metricsPortOf(Config::current()), metricsBindOf(Config::current()));
+
+    // 配置文件修改后切换日志级别、指标端口和地址
+    QObject::connect(&config, &Config::changed, &metricsServer,
+                     [&metricsServer, logLevelFixed, metricsPortOf, metricsBindOf](const AppConfig *previous, const AppConfig *current) {
+        if (!logLevelFixed && previous->logLevel != current->logLevel) {
+            Logger::setLevel(Logger::levelFromName(current->logLevel, LogLevel::Info));
+        }
+        if (metricsPortOf(*previous) != metricsPortOf(*current) || metricsBindOf(*previous) != metricsBindOf(*current)) {
+            metricsServer.close();
+            metricsServer.start(metricsPortOf(*current), metricsBindOf(*current));
+        }
+    });
+
+    Widget w(startupClock);
+    if (parser.isSet(captureOption)) {
+        w.startCapture(parser.value(captureOption));
+    }
     w.show();
-    return a.exec();
+    const int result = a.exec();
+    Logger::stop();
+    return result;
 }
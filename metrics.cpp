@@ -0,0 +1,263 @@
+﻿// metrics.cpp - 指标注册表与Prometheus文本格式导出
+
+#include "metrics.h"
+#include <QMutexLocker>
+#include <QStringList>
+#include <QSet>
+
+// 每个线程第一次计数时按顺序分到一个分片
+int MetricCounter::shardIndex()
+{
+    static std::atomic<int> nextShard{0};
+    thread_local const int shard = nextShard.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return shard;
+}
+
+quint64 MetricCounter::value() const
+{
+    quint64 total = 0;
+    for (const Shard &shard : m_shards) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+// 小于kSubBuckets的值各占一个桶；其余按最高位所在的2的幂区间，再取其后kSubBits位细分
+int MetricHistogram::bucketOf(qint64 value)
+{
+    if (value < kSubBuckets) {
+        return value < 0 ? 0 : int(value);
+    }
+    int exponent = 63;
+    while (!(quint64(value) >> exponent)) {
+        --exponent;
+    }
+    const int sub = int((quint64(value) >> (exponent - kSubBits)) & (kSubBuckets - 1));
+    return kSubBuckets + (exponent - kSubBits) * kSubBuckets + sub;
+}
+
+qint64 MetricHistogram::bucketLower(int bucket)
+{
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    const int exponent = (bucket - kSubBuckets) / kSubBuckets + kSubBits;
+    const int sub = (bucket - kSubBuckets) % kSubBuckets;
+    return qint64(kSubBuckets + sub) << (exponent - kSubBits);
+}
+
+qint64 MetricHistogram::bucketUpper(int bucket)
+{
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    const int exponent = (bucket - kSubBuckets) / kSubBuckets + kSubBits;
+    // 无符号相加：最后一个桶的上界正好是qint64的最大值
+    return qint64(quint64(bucketLower(bucket)) + (quint64(1) << (exponent - kSubBits)) - 1);
+}
+
+void MetricHistogram::record(qint64 value)
+{
+    if (value < 0) {
+        value = 0;
+    }
+    m_buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(quint64(value), std::memory_order_relaxed);
+}
+
+quint64 MetricHistogram::countAtOrBelow(qint64 value) const
+{
+    quint64 total = 0;
+    for (int bucket = 0; bucket < kBuckets && bucketUpper(bucket) <= value; ++bucket) {
+        total += m_buckets[bucket].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+qint64 MetricHistogram::quantile(double q) const
+{
+    quint64 total = 0;
+    quint64 counts[kBuckets];
+    for (int bucket = 0; bucket < kBuckets; ++bucket) {
+        counts[bucket] = m_buckets[bucket].load(std::memory_order_relaxed);
+        total += counts[bucket];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    const quint64 rank = quint64(qBound(0.0, q, 1.0) * (total - 1)) + 1;
+    quint64 seen = 0;
+    for (int bucket = 0; bucket < kBuckets; ++bucket) {
+        seen += counts[bucket];
+        if (seen >= rank) {
+            return (bucketLower(bucket) + bucketUpper(bucket)) / 2;
+        }
+    }
+    return bucketUpper(kBuckets - 1);
+}
+
+Metrics &Metrics::instance()
+{
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::Series &Metrics::series(const QString &name, const QString &help, Type type, const QString &labels)
+{
+    auto family = m_families.find(name);
+    if (family == m_families.end()) {
+        family = m_families.insert(name, Family());
+        family->type = type;
+        family->help = help;
+    }
+    return family->series[labels];
+}
+
+MetricCounter *Metrics::counter(const QString &name, const QString &help, const QString &labels)
+{
+    QMutexLocker locker(&m_mutex);
+    Series &s = series(name, help, Type::Counter, labels);
+    if (!s.counter) {
+        s.counter = new MetricCounter;
+    }
+    return s.counter;
+}
+
+MetricGauge *Metrics::gauge(const QString &name, const QString &help, const QString &labels)
+{
+    QMutexLocker locker(&m_mutex);
+    Series &s = series(name, help, Type::Gauge, labels);
+    if (!s.gauge) {
+        s.gauge = new MetricGauge;
+    }
+    return s.gauge;
+}
+
+MetricHistogram *Metrics::histogram(const QString &name, const QString &help, double unitSeconds, const QString &labels)
+{
+    QMutexLocker locker(&m_mutex);
+    Series &s = series(name, help, Type::Histogram, labels);
+    if (!s.histogram) {
+        s.histogram = new MetricHistogram(unitSeconds);
+    }
+    return s.histogram;
+}
+
+void Metrics::counterCallback(const QString &name, const QString &help, const QString &labels, std::function<double()> read)
+{
+    QMutexLocker locker(&m_mutex);
+    series(name, help, Type::Counter, labels).read = std::move(read);
+}
+
+void Metrics::gaugeCallback(const QString &name, const QString &help, const QString &labels, std::function<double()> read)
+{
+    QMutexLocker locker(&m_mutex);
+    series(name, help, Type::Gauge, labels).read = std::move(read);
+}
+
+// 名称后接标签，extra为追加的标签（直方图的le）
+static QByteArray seriesName(const QString &name, const QString &labels, const QString &extra = QString())
+{
+    QStringList all;
+    if (!labels.isEmpty()) {
+        all << labels;
+    }
+    if (!extra.isEmpty()) {
+        all << extra;
+    }
+    return (all.isEmpty() ? name : name + '{' + all.join(',') + '}').toUtf8();
+}
+
+static QByteArray number(double value)
+{
+    return QByteArray::number(value, 'g', 17);
+}
+
+QByteArray Metrics::exposition() const
+{
+    // 直方图导出的le边界（秒），覆盖100微秒到10秒
+    static const double kBounds[] = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+                                     0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+
+    QMutexLocker locker(&m_mutex);
+    QByteArray out;
+    for (auto family = m_families.constBegin(); family != m_families.constEnd(); ++family) {
+        const QString &name = family.key();
+        const char *type = family->type == Type::Counter ? "counter" : family->type == Type::Gauge ? "gauge" : "histogram";
+        out += "# HELP " + name.toUtf8() + ' ' + family->help.toUtf8() + '\n';
+        out += "# TYPE " + name.toUtf8() + ' ' + type + '\n';
+        for (auto s = family->series.constBegin(); s != family->series.constEnd(); ++s) {
+            const QString &labels = s.key();
+            const Series &series = s.value();
+            if (series.histogram) {
+                const MetricHistogram *h = series.histogram;
+                for (double bound : kBounds) {
+                    const qint64 raw = qint64(bound / h->unitSeconds() + 0.5);
+                    out += seriesName(name + "_bucket", labels, "le=\"" + QString::number(bound) + '"') + ' '
+                           + QByteArray::number(h->countAtOrBelow(raw)) + '\n';
+                }
+                out += seriesName(name + "_bucket", labels, "le=\"+Inf\"") + ' ' + QByteArray::number(h->count()) + '\n';
+                out += seriesName(name + "_sum", labels) + ' ' + number(h->sum() * h->unitSeconds()) + '\n';
+                out += seriesName(name + "_count", labels) + ' ' + QByteArray::number(h->count()) + '\n';
+            } else if (series.counter) {
+                out += seriesName(name, labels) + ' ' + QByteArray::number(series.counter->value()) + '\n';
+            } else if (series.gauge) {
+                out += seriesName(name, labels) + ' ' + QByteArray::number(series.gauge->value()) + '\n';
+            } else if (series.read) {
+                out += seriesName(name, labels) + ' ' + number(series.read()) + '\n';
+            }
+        }
+    }
+    return out;
+}
+
+// 已分配独立node标签的节点，各传输方式、各接收对象共用
+static QMutex s_labelledNodesMutex;
+static QSet<int> s_labelledNodes;
+
+void NodeTrafficMetrics::recordFrame(int node, int bytes)
+{
+    auto found = m_nodes.constFind(node);
+    const NodeCounters counters = found != m_nodes.constEnd() ? *found : countersFor(node);
+    counters.messages->inc();
+    counters.bytes->inc(quint64(bytes));
+}
+
+NodeTrafficMetrics::NodeCounters NodeTrafficMetrics::countersFor(int node)
+{
+    bool labelled;
+    {
+        QMutexLocker locker(&s_labelledNodesMutex);
+        labelled = s_labelledNodes.contains(node);
+        if (!labelled && s_labelledNodes.size() < kMaxNodeLabels) {
+            s_labelledNodes.insert(node);
+            labelled = true;
+        }
+    }
+
+    NodeCounters counters = labelled ? NodeCounters() : m_other;
+    if (!counters.messages) {
+        const QString nodeLabel = labelled ? QString::number(node) : QStringLiteral("other");
+        const QString labels = QString("transport=\"%1\",node=\"%2\"").arg(m_transport, nodeLabel);
+        counters.messages = Metrics::instance().counter("sensor_messages_total", "解析成功的报文数", labels);
+        counters.bytes = Metrics::instance().counter("sensor_message_bytes_total", "解析成功的报文字节数", labels);
+        if (!labelled) {
+            m_other = counters;
+        }
+    }
+    // 本地缓存同样有上限，超出后未缓存的节点每帧多查一次上面的集合
+    if (m_nodes.size() < 2 * kMaxNodeLabels) {
+        m_nodes.insert(node, counters);
+    }
+    return counters;
+}
+
+void NodeTrafficMetrics::recordParseFailure()
+{
+    if (!m_parseFailures) {
+        m_parseFailures = Metrics::instance().counter("sensor_parse_failures_total", "格式错误、无法解析的报文数",
+                                                      QString("transport=\"%1\"").arg(m_transport));
+    }
+    m_parseFailures->inc();
+}
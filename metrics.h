@@ -0,0 +1,152 @@
+﻿#ifndef METRICS_H
+#define METRICS_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <functional>
+
+// 指标注册表：计数器、仪表、直方图，按Prometheus文本格式导出（MetricsServer在HTTP上提供）。
+// 注册（counter()/gauge()/histogram()）加锁，返回的指针在程序结束前一直有效；
+// 热路径只通过指针更新，不加锁、不分配内存。常见用法是在函数内用静态变量缓存指针：
+//     static MetricCounter *const parseFailures = Metrics::instance().counter("...", "...");
+//     parseFailures->inc();
+
+// MetricCounter - 单调递增计数器，按线程分片：
+// 每个线程固定写一个分片（各占一条缓存行），多个接收线程同时累加时互不争用，读取时求和。
+class MetricCounter
+{
+public:
+    void inc(quint64 n = 1) { m_shards[shardIndex()].value.fetch_add(n, std::memory_order_relaxed); }
+    quint64 value() const;
+
+private:
+    static const int kShards = 8;
+    struct alignas(64) Shard {
+        std::atomic<quint64> value{0};
+    };
+    Shard m_shards[kShards];
+
+    static int shardIndex();
+};
+
+// MetricGauge - 可增可减的瞬时值
+class MetricGauge
+{
+public:
+    void set(qint64 value) { m_value.store(value, std::memory_order_relaxed); }
+    void add(qint64 delta) { m_value.fetch_add(delta, std::memory_order_relaxed); }
+    qint64 value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<qint64> m_value{0};
+};
+
+// MetricHistogram - HDR式对数-线性直方图（记录非负整数，例如微秒）
+// 每个2的幂区间再等分为8个桶，相对误差不超过12.5%，覆盖0到2^63，桶数固定（约500个原子计数）。
+// 导出时换算到固定的le边界（秒），各次抓取的边界一致。
+class MetricHistogram
+{
+public:
+    explicit MetricHistogram(double unitSeconds) : m_unitSeconds(unitSeconds) {}
+
+    void record(qint64 value);
+
+    quint64 count() const { return m_count.load(std::memory_order_relaxed); }
+    quint64 sum() const { return m_sum.load(std::memory_order_relaxed); }
+    double unitSeconds() const { return m_unitSeconds; }
+
+    // 不大于value（原始单位）的记录数（按桶上界近似）
+    quint64 countAtOrBelow(qint64 value) const;
+    // q分位数的近似值（原始单位，取桶的中点）
+    qint64 quantile(double q) const;
+
+    static const int kSubBits = 3;
+    static const int kSubBuckets = 1 << kSubBits;
+    static const int kBuckets = kSubBuckets + (63 - kSubBits) * kSubBuckets;
+    static int bucketOf(qint64 value);
+    static qint64 bucketLower(int bucket);
+    static qint64 bucketUpper(int bucket);
+
+private:
+    const double m_unitSeconds; // 一个原始单位是多少秒（微秒为1e-6）
+    std::atomic<quint64> m_buckets[kBuckets] = {};
+    std::atomic<quint64> m_count{0};
+    std::atomic<quint64> m_sum{0};
+};
+
+class Metrics
+{
+public:
+    static Metrics &instance();
+
+    // labels为已格式化的标签，例如 node="3"；同名同标签重复注册返回同一个对象
+    MetricCounter *counter(const QString &name, const QString &help, const QString &labels = QString());
+    MetricGauge *gauge(const QString &name, const QString &help, const QString &labels = QString());
+    MetricHistogram *histogram(const QString &name, const QString &help, double unitSeconds, const QString &labels = QString());
+
+    // 抓取时才求值的指标（例如队列深度，已有统计接口的对象不必另外维护一份）
+    // 回调可能在任意线程调用，须线程安全
+    void counterCallback(const QString &name, const QString &help, const QString &labels, std::function<double()> read);
+    void gaugeCallback(const QString &name, const QString &help, const QString &labels, std::function<double()> read);
+
+    // Prometheus文本格式（text/plain; version=0.0.4）
+    QByteArray exposition() const;
+
+private:
+    Metrics() = default;
+    Q_DISABLE_COPY(Metrics)
+
+    enum class Type { Counter, Gauge, Histogram };
+    struct Series {
+        MetricCounter *counter = nullptr;
+        MetricGauge *gauge = nullptr;
+        MetricHistogram *histogram = nullptr;
+        std::function<double()> read;
+    };
+    struct Family {
+        Type type = Type::Counter;
+        QString help;
+        QMap<QString, Series> series; // 标签 -> 序列
+    };
+
+    mutable QMutex m_mutex;
+    QMap<QString, Family> m_families; // 按名称排序输出
+
+    Series &series(const QString &name, const QString &help, Type type, const QString &labels);
+};
+
+// NodeTrafficMetrics - 各节点的报文数和字节数（每个接收对象一个，只在其所在线程使用）
+// 本地缓存节点到计数器的映射，只有第一次见到某个节点时才去注册表加锁注册。
+// 节点号取自报文内容，不可信：全进程最多kMaxNodeLabels个节点有自己的node标签，之后出现的新节点都计入node="other"，
+// 伪造节点号的报文不会让指标序列和本地缓存无限增长。
+class NodeTrafficMetrics
+{
+public:
+    explicit NodeTrafficMetrics(const QString &transport) : m_transport(transport) {}
+
+    // 一帧解析成功
+    void recordFrame(int node, int bytes);
+    // 一帧解析失败
+    void recordParseFailure();
+
+    static const int kMaxNodeLabels = 256;
+
+private:
+    struct NodeCounters {
+        MetricCounter *messages = nullptr;
+        MetricCounter *bytes = nullptr;
+    };
+    QString m_transport;
+    QHash<int, NodeCounters> m_nodes;
+    NodeCounters m_other; // node="other"
+
+    // 第一次见到node时取得（必要时注册）它的计数器
+    NodeCounters countersFor(int node);
+    MetricCounter *m_parseFailures = nullptr;
+};
+
+#endif // METRICS_H
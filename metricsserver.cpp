@@ -0,0 +1,83 @@
+﻿// metricsserver.cpp - 指标的HTTP导出
+
+#include "metricsserver.h"
+#include "metrics.h"
+#include "latencytrace.h"
+#include "logger.h"
+#include <QTcpSocket>
+#include <QTimer>
+
+static const int kMaxRequestBytes = 8192;   // 请求头上限，超过即关闭连接
+static const int kConnectionTimeoutMs = 5000; // 连接的最长存活时间，超过即关闭（只连接不发请求的客户端）
+
+MetricsServer::MetricsServer(QObject *parent)
+    : QTcpServer(parent)
+{
+    connect(this, &QTcpServer::newConnection, this, &MetricsServer::onNewConnection);
+}
+
+bool MetricsServer::start(quint16 port, const QHostAddress &address)
+{
+    if (port == 0) {
+        return false;
+    }
+    if (address.isNull()) {
+        LOG_WARNING("metrics", "监听地址无效");
+        return false;
+    }
+    if (!listen(address, port)) {
+        LOG_WARNING("metrics", "监听失败", {"address", address.toString()}, {"port", port}, {"error", errorString()});
+        return false;
+    }
+    LOG_INFO("metrics", "指标导出已启动", {"url", QString("http://%1:%2/metrics").arg(address.toString()).arg(port)});
+    return true;
+}
+
+void MetricsServer::onNewConnection()
+{
+    while (QTcpSocket *socket = nextPendingConnection()) {
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        // 到期仍未关闭的连接直接断开；套接字先被删除时定时器随之取消
+        QTimer::singleShot(kConnectionTimeoutMs, socket, [socket]() {
+            socket->abort();
+            socket->deleteLater();
+        });
+        connect(socket, &QTcpSocket::readyRead, socket, [socket]() {
+            // 等到请求头收齐（只看请求行，忽略其余头部）
+            if (!socket->peek(kMaxRequestBytes).contains("\r\n\r\n")) {
+                if (socket->bytesAvailable() >= kMaxRequestBytes) {
+                    socket->abort();
+                }
+                return;
+            }
+            const QList<QByteArray> requestLine = socket->readLine(kMaxRequestBytes).trimmed().split(' ');
+            socket->readAll();
+
+            QByteArray status = "200 OK";
+            QByteArray contentType = "text/plain; version=0.0.4; charset=utf-8";
+            QByteArray body;
+            const QByteArray path = requestLine.size() >= 2 ? requestLine.at(1) : QByteArray();
+            if (requestLine.value(0) != "GET") {
+                status = "405 Method Not Allowed";
+                contentType = "text/plain; charset=utf-8";
+                body = "only GET is supported\n";
+            } else if (path == "/metrics" || path.startsWith("/metrics?")) {
+                body = Metrics::instance().exposition();
+            } else if (path == "/trace") {
+                contentType = "application/json";
+                body = LatencyTrace::traceJson();
+            } else {
+                status = "404 Not Found";
+                contentType = "text/plain; charset=utf-8";
+                body = "see /metrics or /trace\n";
+            }
+
+            socket->write("HTTP/1.1 " + status + "\r\n"
+                          "Content-Type: " + contentType + "\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                          "Connection: close\r\n\r\n");
+            socket->write(body);
+            socket->disconnectFromHost();
+        });
+    }
+}
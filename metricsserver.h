@@ -0,0 +1,24 @@
+﻿#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QTcpServer>
+#include <QHostAddress>
+
+// MetricsServer - 供Prometheus抓取的最小HTTP服务
+// GET /metrics 返回Metrics::exposition()，GET /trace 返回LatencyTrace::traceJson()，其余路径返回404；每个请求一个连接，应答后关闭。
+// 默认只监听本机地址；连接后几秒内没有发完请求（或没读走应答）的连接直接断开，不会一直占着。
+// 在界面线程运行：抓取间隔一般为数秒到数十秒，生成一次文本只需很短时间。
+class MetricsServer : public QTcpServer
+{
+    Q_OBJECT
+public:
+    explicit MetricsServer(QObject *parent = nullptr);
+
+    // 在address:port上监听（port为0表示不启用），返回是否成功
+    bool start(quint16 port, const QHostAddress &address = QHostAddress::LocalHost);
+
+private slots:
+    void onNewConnection();
+};
+
+#endif // METRICSSERVER_H
@@ -0,0 +1,152 @@
+﻿#ifndef MPSCRING_H
+#define MPSCRING_H
+
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include "queuestats.h"
+
+// MpscRing - 无锁多生产者/单消费者环形队列（定长元素）
+// 多个接收线程同时push，一个消费者（界面线程）按帧popBatch批量取出。
+// 与排队信号相比：入队不分配内存（排队信号每条都new一个QMetaCallEvent），也不争用接收方事件队列的互斥锁。
+// 算法为Dmitry Vyukov的有界队列：每个槽位带一个序号，生产者和消费者各自用CAS推进位置。
+// 队列满时push会替消费者弹出并丢弃最旧的一个元素（算法本身支持多个出队者，所以这样做是安全的）。
+// 槽位、入队位置、出队位置各占独立的缓存行，避免不同线程之间的伪共享。
+template <typename T>
+class MpscRing
+{
+public:
+    // capacity会向上取整为2的幂
+    MpscRing(const QString &name, int capacity)
+        : m_name(name)
+    {
+        size_t size = 2;
+        while (size < static_cast<size_t>(capacity)) {
+            size <<= 1;
+        }
+        m_mask = size - 1;
+        m_cells.reset(new Cell[size]);
+        for (size_t i = 0; i < size; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // 入队，队列满时返回false
+    bool tryPush(const T &item)
+    {
+        Cell *cell;
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;// 满
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = item;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 入队，队列满时丢弃最旧的元素；返回false表示发生了丢弃
+    bool push(const T &item)
+    {
+        bool evicted = false;
+        while (!tryPush(item)) {
+            T discarded;
+            if (tryPop(discarded)) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                evicted = true;
+            }
+        }
+        return !evicted;
+    }
+
+    // 一次取走最多maxItems个元素追加到out，返回取走的个数（只能由消费者线程调用）
+    int popBatch(QVector<T> &out, int maxItems)
+    {
+        int depth = static_cast<int>(m_enqueuePos.load(std::memory_order_relaxed)
+                                     - m_dequeuePos.load(std::memory_order_relaxed));
+        if (depth > m_highWater.load(std::memory_order_relaxed)) {
+            m_highWater.store(depth, std::memory_order_relaxed);
+        }
+
+        int n = 0;
+        T item;
+        while (n < maxItems && tryPop(item)) {
+            out.append(item);
+            ++n;
+        }
+        return n;
+    }
+
+    int capacity() const { return static_cast<int>(m_mask + 1); }
+
+    // 统计快照（近似值，可在任意线程调用）
+    QueueStats stats() const
+    {
+        QueueStats s;
+        size_t enq = m_enqueuePos.load(std::memory_order_relaxed);
+        size_t deq = m_dequeuePos.load(std::memory_order_relaxed);
+        quint64 dropped = m_dropped.load(std::memory_order_relaxed);
+        s.name = m_name;
+        s.depth = enq > deq ? static_cast<int>(enq - deq) : 0;
+        s.capacity = capacity();
+        s.pushed = enq;
+        s.dropped = dropped;
+        s.popped = deq - dropped;
+        s.highWater = m_highWater.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    static constexpr size_t kCacheLine = 64;
+
+    struct alignas(kCacheLine) Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    bool tryPop(T &item)
+    {
+        Cell *cell;
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;// 空
+            } else {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        item = cell->data;
+        cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    QString m_name;
+    size_t m_mask = 0;
+    std::unique_ptr<Cell[]> m_cells;
+    std::atomic<int> m_highWater{0};// 只由消费者写入，stats()可在任意线程读取
+
+    alignas(kCacheLine) std::atomic<size_t> m_enqueuePos{0};
+    alignas(kCacheLine) std::atomic<size_t> m_dequeuePos{0};
+    alignas(kCacheLine) std::atomic<quint64> m_dropped{0};
+};
+
+#endif // MPSCRING_H
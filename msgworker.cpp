@@ -1,11 +1,13 @@
 ﻿#include "msgworker.h"
 #include "sensordata.h"
+#include "latencytrace.h"
+#include "logger.h"
 
 #include <QByteArray>
+#include <QElapsedTimer>
 #include <QString>
-#include <QStringList>
-#include <QDebug>
-#include <QMap>
+
+static const int kDrainIdleMs = 20; // 退出时这么久没有新数据即认为已读完
 
 MsgWorker::MsgWorker(qintptr sock,QObject *parent)//构造函数
     : QThread{parent},m_sock(sock)
@@ -18,6 +20,12 @@ void MsgWorker::disconnect()//断开连接
     msgsocket->disconnectFromHost();
 }
 
+void MsgWorker::stopAndDrain(int drainMs)
+{
+    m_drainMs.store(qMax(0, drainMs));
+    quit();// 事件循环结束后在run()中读完剩余数据
+}
+
 MsgWorker::~MsgWorker()//析构函数
 {
     if(msgsocket){
@@ -31,118 +39,109 @@ void MsgWorker::run()
     //sql=new LinkSQL(this);
     msgsocket=new QTcpSocket;
     msgsocket->setSocketDescriptor(m_sock);
+    if (m_capture) {
+        m_captureId = m_capture->openConnection(QString("%1:%2").arg(msgsocket->peerAddress().toString()).arg(msgsocket->peerPort()));
+    }
     connect(msgsocket,&QTcpSocket::readyRead,this,[this](){//有数据要接受
-        qDebug()<<"--------------数据到达"<<'\n';
         msgreaddata(msgsocket);
     },Qt::DirectConnection);
     // 添加errorOccurred信号处理，确保异常断开时也能触发线程销毁流程
     connect(msgsocket, &QTcpSocket::errorOccurred, this, [this](QAbstractSocket::SocketError){
-        qDebug()<<"socket错误："<<msgsocket->errorString();
+        LOG_INFO("tcp", "socket错误", {"error", msgsocket->errorString()});
         quit();
         emit deletethread();
     }, Qt::DirectConnection);
     connect(msgsocket, &QTcpSocket::disconnected,this, [this](){
-        qDebug()<<"线程结束-------------"<<'\n';
+        LOG_DEBUG("tcp", "连接断开，线程结束");
         quit();// 终止事件循环，让run()退出
         emit deletethread();// 通知主线程销毁线程对象
     },Qt::DirectConnection);
+    static MetricGauge *const activeConnections =
+        Metrics::instance().gauge("sensor_connections_active", "当前TCP连接数");
+    activeConnections->add(1);
     exec();//开始事件循环
+    const int drainMs = m_drainMs.load();
+    if (drainMs >= 0) {
+        drainSocket(drainMs);
+    }
+    activeConnections->add(-1);
+    if (m_capture) {
+        m_capture->closeConnection(m_captureId);
+    }
+}
 
+//程序退出：先处理已在缓冲中的字节，再等内核缓冲中剩余的数据（一段时间没有新数据或到期限即结束）
+void MsgWorker::drainSocket(int drainMs)
+{
+    if (msgsocket->bytesAvailable() > 0) {
+        msgreaddata(msgsocket);
+    }
+    QElapsedTimer clock;
+    clock.start();
+    // waitForReadyRead读到数据时发出readyRead，由上面的直接连接调用msgreaddata
+    while (msgsocket->state() == QAbstractSocket::ConnectedState && clock.elapsed() < drainMs
+           && msgsocket->waitForReadyRead(int(qMin<qint64>(kDrainIdleMs, drainMs - clock.elapsed())))) {
+    }
+    msgsocket->disconnectFromHost();
 }
 
 //接收下位机传来的数据
 void MsgWorker::msgreaddata(QTcpSocket *msgtcp)
 {
-    //TCP 是 “流式传输”，客户端发送的多个数据包可能被合并成一个 “数据流” 到达服务器
-    //用while循环持续处理socket中所有可用数据
-    while(msgtcp->bytesAvailable()>0){//收到的数据不为空
-        if(msgtcp->bytesAvailable()<static_cast<qint64>(sizeof(qint64))){//可读取的字节数小于8字节
-            return;
-        }
-
-        // msgtcp->read(reinterpret_cast<char*>(&len), sizeof(len));//读取8字节的数据（二进制流），存入len变量。
-        // len = qFromBigEndian(len);// 网络字节序→主机字节序，因为之前传输的时候变成了大端，所以接收的时候要反转
-        // while (msgtcp->bytesAvailable() < len) {
-        //     if (!msgtcp->waitForReadyRead(1000))//等1s，超时为假，！假为真
-        //         break;
-        // }
-        QByteArray data = msgtcp->readAll();//读取全部数据
-        managejson(data,msgtcp);//解析数据
+    static MetricCounter *const receivedBytes =
+        Metrics::instance().counter("sensor_received_bytes_total", "从连接读到的字节数（含无法成帧的字节）", "transport=\"tcp\"");
+    const QByteArray bytes = msgtcp->readAll();
+    const qint64 readAt = LatencyTrace::now();
+    receivedBytes->inc(quint64(bytes.size()));
+    LOG_TRACE("tcp", "数据到达", {"bytes", int(bytes.size())});
+    if (m_capture) {
+        m_capture->write(m_captureId, bytes);
+    }
+    ingest(bytes, readAt);
+}
+
+void MsgWorker::ingest(const QByteArray &bytes, qint64 readAt)
+{
+    //TCP 是 “流式传输”，客户端发送的多个数据包可能被合并成一个 “数据流” 到达服务器，
+    //也可能一个数据包被拆成几段到达，所以先放进分帧器重组，再逐帧解析
+    m_parser.append(bytes);
+
+    QByteArray frame;
+    while (m_parser.nextFrame(frame)) {
+        managejson(frame, readAt);//解析数据
+    }
+
+    //不符合报文格式的字节（例如下位机的回显）仍然显示在调试窗口
+    QString discarded = QString(m_parser.takeDiscarded()).trimmed();
+    if (!discarded.isEmpty() && FrameParser::rawDataEnabled()) {
+        emit rawdata(discarded);
     }
 }
 
 void MsgWorker::sendstrdata(QByteArray data)//发送数据给下位机
 {
-    qDebug()<<"发送数据"<<'\n';
+    LOG_DEBUG("tcp", "发送数据", {"bytes", int(data.size())});
     msgsocket->write(data);
     msgsocket->flush();
 }
 
 
-void MsgWorker::managejson(QByteArray data, QTcpSocket *msgtcp)
+void MsgWorker::managejson(const QByteArray &data, qint64 readAt)
 {
     SensorData result;
-    // 1. 转换为QString并预处理（去除首尾空白字符）
+    // 转换为QString并预处理（去除首尾空白字符）
     QString rawStr = QString(data).trimmed();
-    emit rawdata(rawStr);//发送原始数据到调试终端。
-
-    if (rawStr.isEmpty()) {
-        qWarning() << "数据为空";
-        return;
+    if (FrameParser::rawDataEnabled()) {
+        emit rawdata(rawStr);//发送原始数据到调试终端。
     }
 
-    // 2. 校验外层格式并提取核心内容
-    const QString prefix = "{Params[";
-    const QString suffix = "]}";
-    if (!rawStr.startsWith(prefix) || !rawStr.endsWith(suffix)) {
-        qWarning() << "数据格式错误，不符合 {Params[...]} 规则";
+    if (!FrameParser::parseSensorData(rawStr, result)) {
+        m_traffic.recordParseFailure();
         return;
     }
-
-    // 提取中间的键值对部分（去掉前缀和后缀）
-    QString content = rawStr.mid(prefix.length(), rawStr.length() - prefix.length() - suffix.length());
-    if (content.isEmpty()) {
-        qWarning() << "数据内容为空";
-        return;
-    }
-
-    // 3. 按 ; 分割键值对（过滤空字符串，避免最后一个 ; 导致的空项）
-    QStringList keyValueList = content.split(';', Qt::SkipEmptyParts);
-    if (keyValueList.isEmpty()) {
-        qWarning() << "未找到有效键值对";
-        return;
-    }
-
-    // 4. 解析每个键值对并存储
-    QMap<QString, double> tempMap;  // 临时用哈希表存储，便于灵活赋值
-    for (const QString& kv : keyValueList) {
-        QStringList parts = kv.split(':', Qt::KeepEmptyParts);
-        if (parts.size() != 2) {  // 必须是 "键:值" 格式
-            qWarning() << "无效的键值对格式：" << kv;
-            continue;
-        }
-
-        QString key = parts[0].trimmed();    // 参数名（如"atemp"）
-        QString valueStr = parts[1].trimmed();  // 参数值字符串（如"69.3"）
-
-        // 转换数值为double
-        bool ok = false;
-        double value = valueStr.toDouble(&ok);
-        if (!ok) {
-            qWarning() << "参数值转换失败，键：" << key << "，值：" << valueStr;
-            continue;
-        }
-
-        tempMap[key] = value;  // 存入哈希表
-    }
-
-    // 5. 将哈希表的值赋值给结构体（确保参数存在，避免使用未初始化的值）
-    if (tempMap.contains("atemp"))    result.atemp = tempMap["atemp"];
-    if (tempMap.contains("ahumi"))    result.ahumi = tempMap["ahumi"];
-    if (tempMap.contains("oxygen"))   result.oxygen = tempMap["oxygen"];
-    if (tempMap.contains("stemp"))    result.stemp = tempMap["stemp"];
-    if (tempMap.contains("shumi2"))   result.shumi2 = tempMap["shumi2"];
-    if (tempMap.contains("light"))    result.light = tempMap["light"];
+    result.readAt = readAt;
+    result.parsedAt = LatencyTrace::now();
+    m_traffic.recordFrame(result.node, data.size());
 
     emit showsensordata(result);
 }
@@ -5,6 +5,11 @@
 #include<QThread>
 #include<QTcpSocket>
 #include "sensordata.h"
+#include "frameparser.h"
+#include "metrics.h"
+#include "packetcapture.h"
+#include <QSharedPointer>
+#include <atomic>
 
 class MsgWorker : public QThread
 {
@@ -14,17 +19,32 @@ public:
 
     void disconnect();//断开连接
 
+    // 把本连接收到的原始字节记录到抓包文件（在start()之前调用）
+    void setCapture(const QSharedPointer<PacketCapture> &capture) { m_capture = capture; }
+
+    // 程序退出时调用（任意线程）：结束事件循环，退出前最多用drainMs把套接字中已到达的数据读完并解析，然后断开连接
+    void stopAndDrain(int drainMs);
+
+    // 把一段收到的字节送入分帧和解析，readAt为读出时刻；回放工具不经过套接字直接调用
+    void ingest(const QByteArray &bytes, qint64 readAt);
+
     ~MsgWorker();
 
 private:
-    QTcpSocket *msgsocket;//tcp套接字对象
+    QTcpSocket *msgsocket = nullptr;//tcp套接字对象（run()中创建）
     qintptr m_sock;//用于初始化tcp套接字的描述符。
+    FrameParser m_parser;//分帧器，处理粘包和半包
+    NodeTrafficMetrics m_traffic{"tcp"};//各节点的报文数、字节数和解析失败数
+    QSharedPointer<PacketCapture> m_capture;//抓包文件（未启用时为空）
+    quint32 m_captureId = 0;//本连接在抓包文件中的编号
+    std::atomic<int> m_drainMs{-1};//stopAndDrain()给出的读完期限，-1表示未要求退出
 
 protected:
     void run()override;
 
 private:
-    void managejson(QByteArray data,QTcpSocket *msgtcp);//解析数据
+    void managejson(const QByteArray &data,qint64 readAt);//解析数据，readAt为读出时刻
+    void drainSocket(int drainMs);//退出前读完套接字中已到达的数据
 
 signals:
     void deletethread();//要销毁线程
@@ -1,83 +1,74 @@
 ﻿// mysql.cpp - MySQL数据库连接与管理界面实现
 // 负责管理数据库连接界面和与DatabaseWorker的交互，
-// 使用多线程方式处理数据库操作，确保UI界面的响应性。
+// 数据库操作在主窗口创建的数据库线程中执行，确保UI界面的响应性。
 
 #include "mysql.h"
 #include "ui_mysql.h"
 #include "databaseworker.h"
+#include "logger.h"
 #include <QMessageBox>
-#include <QDebug> // Qt消息框类
+#include <QThread>
 #include <QList>
 #include <QVariantList>
 #include <QTableWidgetItem>
+#include "qcustomplot.h"
 
-Mysql::Mysql(QWidget *parent) :
+static const int kDistributionDays = 90; // 每日分布显示的天数
+
+Mysql::Mysql(DatabaseWorker *worker, QWidget *parent) :
     QWidget(parent),
-    ui(new Ui::Mysql)
+    ui(new Ui::Mysql),
+    dbWorker(worker)
 {
     ui->setupUi(this);
     
-    // 初始化数据库工作线程
-    initDatabaseThread();
-    
     // 连接信号和槽
     connect(dbWorker, &DatabaseWorker::connectionStatusChanged, this, &Mysql::on_connectionStatusChanged);
-    connect(this, &Mysql::connectToDatabaseSignal, dbWorker, &DatabaseWorker::connectToDatabase);
     connect(dbWorker, &DatabaseWorker::queryResultsReady, this, &Mysql::on_queryResultsReady);
+    connect(dbWorker, &DatabaseWorker::dailyDistributionReady, this, &Mysql::on_dailyDistributionReady);
     
-    // 应用启动时默认尝试连接数据库
-    connectToDatabase();
+    initDistributionPlot();
+    
+    // 连接在启动时已由主窗口发起，这里只显示当前状态，之后的变化由connectionStatusChanged更新
+    on_connectionStatusChanged(dbWorker->isConnected(), dbWorker->isConnected() ? "数据库连接成功" : "正在连接数据库...");
 }
 
 // Mysql析构函数 - 清理资源
 Mysql::~Mysql()
 {
-    // 清理数据库线程资源
-    if (dbThread) {
-        // 断开信号连接
-        dbThread->disconnect(dbWorker);
-        
-        // 请求线程退出并等待
-        dbThread->quit();
-        dbThread->wait(3000); // 最多等待3秒
-        
-        // 释放线程对象
-        delete dbThread;
-        dbThread = nullptr;
-    }
-    
-    // 确保dbWorker置空
-    dbWorker = nullptr;
-    
     // 释放UI对象
     delete ui;
 }
 
-// 初始化数据库工作线程
-void Mysql::initDatabaseThread()
+// 初始化每日分布箱线图，放在表格的位置，先隐藏
+void Mysql::initDistributionPlot()
 {
-    dbThread = new QThread(this);
-    dbWorker = new DatabaseWorker();
-    
-    // 将工作对象移动到工作线程
-    dbWorker->moveToThread(dbThread);
-    
-    // 连接线程完成信号，确保线程结束时清理工作对象
-    connect(dbThread, &QThread::finished, dbWorker, &QObject::deleteLater);
-    
-    // 启动工作线程
-    dbThread->start();
+    distributionPlot = new QCustomPlot(this);
+    distributionBoxes = new QCPStatisticalBox(distributionPlot->xAxis, distributionPlot->yAxis);
+    distributionBoxes->setWidth(0.6 * 86400); // 键为当天正午（秒），箱宽约0.6天
+    distributionBoxes->setWhiskerWidth(0.3 * 86400);
+    distributionBoxes->setBrush(QColor(60, 120, 200, 80));
+
+    QSharedPointer<QCPAxisTickerDateTime> dateTicker(new QCPAxisTickerDateTime);
+    dateTicker->setDateTimeFormat("MM-dd");
+    dateTicker->setDateTimeSpec(Qt::LocalTime);
+    distributionPlot->xAxis->setTicker(dateTicker);
+    distributionPlot->xAxis->setLabel("日期");
+
+    ui->verticalLayout_4->insertWidget(ui->verticalLayout_4->indexOf(ui->datetable) + 1, distributionPlot);
+    distributionPlot->hide();
 }
 
-// 请求数据库连接
-void Mysql::connectToDatabase()
+// 显示表格，隐藏箱线图
+void Mysql::showTable()
 {
-    emit connectToDatabaseSignal();
+    distributionPlot->hide();
+    ui->datetable->show();
 }
 
 bool Mysql::chackconnect()
 {
-    if(dbWorker && dbThread && dbThread->isRunning())
+    if(dbWorker && dbWorker->thread()->isRunning())
     {
         return true;
     }else
@@ -86,11 +77,6 @@ bool Mysql::chackconnect()
     }
 }
 
-DatabaseWorker* Mysql::getdataworker()
-{
-    return dbWorker;
-}
-
 // 处理数据库连接状态变化
 void Mysql::on_connectionStatusChanged(bool connected, const QString &message)
 {
@@ -103,13 +89,15 @@ void Mysql::on_connectionStatusChanged(bool connected, const QString &message)
 // 处理查询结果
 void Mysql::on_queryResultsReady(bool success, const QList<QVariantList> &results, const QString &message)
 {
-    qDebug() << "[Mysql] 查询结果: 成功=" << success;
+    LOG_DEBUG("db", "查询结果", {"success", success}, {"rows", results.size()});
     
     if (!success) {
         ui->status->setText("查询失败: " + message);
         return;
     }
     
+    showTable();
+    
     // 清空表格
     ui->datetable->clear();
     ui->datetable->setRowCount(0);
@@ -156,36 +144,6 @@ void Mysql::closeEvent(QCloseEvent *event)
     this->hide();
 }
 
-// 公共方法：断开数据库连接
-void Mysql::disconnectDatabase()
-{
-    if (chackconnect()) {
-        QMetaObject::invokeMethod(dbWorker, "disconnectFromDatabase", Qt::BlockingQueuedConnection);
-    }
-}
-
-// 公共方法：存储温室环境数据到数据库
-void Mysql::storeDataToDatabase(double airTemp, double airHumidity, double oxygenContent, double soilTemp, double soilHumidity, double lightIntensity)
-{
-    if (chackconnect()) {
-        // 使用BlockingQueuedConnection确保线程安全和操作完成
-        bool success = QMetaObject::invokeMethod(dbWorker, "storeGreenhouseData", 
-                                 Qt::BlockingQueuedConnection,
-                                 Q_ARG(double, airTemp),
-                                 Q_ARG(double, airHumidity),
-                                 Q_ARG(double, oxygenContent),
-                                 Q_ARG(double, soilTemp),
-                                 Q_ARG(double, soilHumidity),
-                                 Q_ARG(double, lightIntensity));
-        
-        if (!success) {
-            qDebug() << "[Mysql] 调用数据库工作线程失败";
-        }
-    } else {
-        qDebug() << "[Mysql] 数据库工作线程不可用";
-    }
-}
-
 // 处理退出按钮点击事件
 void Mysql::on_exit_clicked()
 {
@@ -194,25 +152,21 @@ void Mysql::on_exit_clicked()
 //显示所有数据
 void Mysql::on_showall_clicked()
 {
-    qDebug() << "[Mysql] showall按钮被点击";
-    
     // 使用数据库工作线程查询数据
     if (chackconnect()) {
-        qDebug() << "[Mysql] 发送查询信号";
-        
         // 使用信号槽机制调用数据库工作线程的查询方法
         QMetaObject::invokeMethod(dbWorker, "queryAllGreenhouseData", Qt::QueuedConnection);
         
         ui->status->setText("正在查询数据...");
     } else {
-        qDebug() << "[Mysql] 数据库工作线程不可用";
+        LOG_WARNING("db", "数据库工作线程不可用");
         ui->status->setText("数据库工作线程不可用");
     }
 }
 //清空表格中的数据
 void Mysql::on_deleteall_clicked()
 {
-    qDebug() << "[Mysql] deleteall按钮被点击";
+    showTable();
     // 清空表格
     ui->datetable->clear();
     ui->datetable->setRowCount(0);
@@ -229,8 +183,6 @@ void Mysql::on_deleteall_clicked()
 // 查询按钮点击事件处理
 void Mysql::on_inquire_clicked()
 {
-    qDebug() << "[Mysql] 时间查询按钮被点击";
-    
     // 获取开始和结束时间
     QDateTime startTime = ui->dateTimeON->dateTime();
     QDateTime endTime = ui->dateTimeOFF->dateTime();
@@ -260,8 +212,6 @@ void Mysql::on_inquire_clicked()
 // 现在时间按钮点击事件处理
 void Mysql::on_nowtime_clicked()
 {
-    qDebug() << "[Mysql] 现在时间按钮被点击";
-    
     // 设置结束时间为当前时间
     ui->dateTimeOFF->setDateTime(QDateTime::currentDateTime());
 }
@@ -269,8 +219,6 @@ void Mysql::on_nowtime_clicked()
 // 最近一天查询按钮点击事件处理
 void Mysql::on_oneday_clicked()
 {
-    qDebug() << "[Mysql] 最近一天按钮被点击";
-    
     QDateTime endTime = QDateTime::currentDateTime();
     QDateTime startTime = endTime.addDays(-1);
     
@@ -284,8 +232,6 @@ void Mysql::on_oneday_clicked()
 // 最近三天查询按钮点击事件处理
 void Mysql::on_threeday_clicked()
 {
-    qDebug() << "[Mysql] 最近三天按钮被点击";
-    
     QDateTime endTime = QDateTime::currentDateTime();
     QDateTime startTime = endTime.addDays(-3);
     
@@ -299,8 +245,6 @@ void Mysql::on_threeday_clicked()
 // 最近一周查询按钮点击事件处理
 void Mysql::on_aweek_clicked()
 {
-    qDebug() << "[Mysql] 最近一周按钮被点击";
-    
     QDateTime endTime = QDateTime::currentDateTime();
     QDateTime startTime = endTime.addDays(-7);
     
@@ -314,8 +258,6 @@ void Mysql::on_aweek_clicked()
 // 值查询按钮点击事件处理
 void Mysql::on_dateinquire_clicked()
 {
-    qDebug() << "[Mysql] 值查询按钮被点击";
-    
     // 获取用户选择的属性名称
     QString attributeName = ui->comboBox->currentText();
     
@@ -358,3 +300,63 @@ void Mysql::on_dateinquire_clicked()
         ui->status->setStyleSheet("color: red;");
     }
 }
+
+// 每日分布按钮点击事件处理
+void Mysql::on_distribution_clicked()
+{
+    // 属性下拉框的顺序与通道顺序一致
+    const int channel = ui->comboBox->currentIndex();
+    const QDate to = QDate::currentDate();
+    const QDate from = to.addDays(-(kDistributionDays - 1));
+    
+    if (chackconnect()) {
+        ui->status->setText(QString("正在查询%1最近%2天的分布...").arg(ui->comboBox->currentText()).arg(kDistributionDays));
+        QMetaObject::invokeMethod(dbWorker, "queryDailyDistribution",
+                                 Qt::QueuedConnection,
+                                 Q_ARG(int, channel),
+                                 Q_ARG(QDate, from),
+                                 Q_ARG(QDate, to));
+    } else {
+        ui->status->setText("数据库工作线程不可用");
+        ui->status->setStyleSheet("color: red;");
+    }
+}
+
+// 处理每日分布查询结果：每天一个箱（最小值、四分位数、中位数、最大值）
+void Mysql::on_dailyDistributionReady(bool success, int channel, const QVector<DailyDistribution> &days, const QString &message)
+{
+    if (!success) {
+        ui->status->setText("查询失败: " + message);
+        return;
+    }
+    
+    QVector<double> keys, minimum, lowerQuartile, median, upperQuartile, maximum;
+    for (const DailyDistribution &day : days) {
+        keys.append(QDateTime(day.day, QTime(12, 0)).toSecsSinceEpoch());
+        minimum.append(day.minimum);
+        lowerQuartile.append(day.lowerQuartile);
+        median.append(day.median);
+        upperQuartile.append(day.upperQuartile);
+        maximum.append(day.maximum);
+    }
+    distributionBoxes->setData(keys, minimum, lowerQuartile, median, upperQuartile, maximum, true);
+    distributionBoxes->setName(ui->comboBox->itemText(channel));
+    distributionPlot->yAxis->setLabel(ui->comboBox->itemText(channel));
+    
+    // 横轴固定为最近kDistributionDays天，没有数据的日期留空
+    const QDate today = QDate::currentDate();
+    distributionPlot->xAxis->setRange(QDateTime(today.addDays(-kDistributionDays), QTime(12, 0)).toSecsSinceEpoch(),
+                                      QDateTime(today.addDays(1), QTime(12, 0)).toSecsSinceEpoch());
+    bool foundRange = false;
+    QCPRange valueRange = distributionBoxes->getValueRange(foundRange);
+    if (foundRange) {
+        const double margin = qMax(0.05 * valueRange.size(), 1.0);
+        distributionPlot->yAxis->setRange(valueRange.lower - margin, valueRange.upper + margin);
+    }
+    
+    ui->datetable->hide();
+    distributionPlot->show();
+    distributionPlot->replot();
+    
+    ui->status->setText(QString("%1：已显示 %2 天的分布").arg(ui->comboBox->itemText(channel)).arg(days.size()));
+}
@@ -2,68 +2,48 @@
 #define MYSQL_H
 
 #include <QWidget>   // Qt窗口基类
-#include <QThread>     // Qt线程类，用于多线程操作
 #include <QCloseEvent> // Qt关闭事件类
 #include "databaseworker.h" // 数据库工作线程类
 
+class QCustomPlot;
+class QCPStatisticalBox;
+
 namespace Ui {
 // Ui命名空间中的Mysql类 - 由Qt的uic工具自动生成，包含UI界面的定义
 class Mysql;
 }
 
 // Mysql - MySQL数据库连接管理窗口类
-// 负责创建用户界面，管理数据库工作线程，处理数据库连接状态显示，
-// 以及响应用户交互操作。
+// 负责创建用户界面，显示数据库连接状态，以及响应用户交互操作。
+// 数据库工作线程由主窗口在启动时创建，本窗口在第一次打开时才创建，只使用已有的工作对象。
 class Mysql : public QWidget
 {
     Q_OBJECT // Qt元对象系统宏，启用信号槽机制
 
 public:
 
-    explicit Mysql(QWidget *parent = nullptr);
+    explicit Mysql(DatabaseWorker *worker, QWidget *parent = nullptr);
     
-    //析构函数负责清理资源，包括数据库线程和UI组件
+    //析构函数负责清理UI组件（数据库工作对象归主窗口所有）
     ~Mysql();
     
     //重写QWidget的虚函数，处理窗口关闭事件
     void closeEvent(QCloseEvent *event) override;
     
-    //断开数据库连接
-    // 供主窗口在关闭时调用，确保数据库连接被正确断开
-    void disconnectDatabase();
-    
-    //存储温室环境数据到数据库
-    // 供主窗口调用，将传感器数据存储到数据库中
-    void storeDataToDatabase(double airTemp, double airHumidity, double oxygenContent, double soilTemp, double soilHumidity, double lightIntensity);
-
-    //检查数据库连接
+    //检查数据库工作线程是否可用
     bool chackconnect();
 
-    //获取数据库工作对象
-    DatabaseWorker* getdataworker();
-
-signals:
-    // 连接数据库信号 - 触发数据库工作线程中的连接操作
-    void connectToDatabaseSignal();
-    // 断开数据库连接信号 - 触发数据库工作线程中的断开操作
-    void disconnectFromDatabase();
-
-
-
 private:
     Ui::Mysql *ui;
     
     //数据库工作对象，在独立线程中执行数据库操作
     DatabaseWorker *dbWorker;
     
-    //执行数据库操作的线程
-    QThread *dbThread;
-    
-    //初始化数据库工作线程
-    void initDatabaseThread();
-    
-    //请求数据库连接
-    void connectToDatabase();
+    //每日分布箱线图（与表格共用位置，点击“每日分布”时显示，表格有新结果时隐藏）
+    QCustomPlot *distributionPlot = nullptr;
+    QCPStatisticalBox *distributionBoxes = nullptr;
+    void initDistributionPlot();
+    void showTable();
 
 private slots:
     // on_connectionStatusChanged - 处理数据库连接状态变化的槽函数
@@ -74,6 +54,9 @@ private slots:
     // 处理查询结果
     void on_queryResultsReady(bool success, const QList<QVariantList> &results, const QString &message);
     
+    // 处理每日分布查询结果
+    void on_dailyDistributionReady(bool success, int channel, const QVector<DailyDistribution> &days, const QString &message);
+    
     void on_exit_clicked();//处理退出按钮点击事件的槽函数
     void on_showall_clicked();//显示所有数据按钮
     void on_deleteall_clicked();//将表格里面的数据清空
@@ -83,6 +66,7 @@ private slots:
     void on_threeday_clicked();//最近三天查询按钮点击事件处理
     void on_aweek_clicked();//最近一周查询按钮点击事件处理
     void on_dateinquire_clicked();//值查询按钮点击事件处理
+    void on_distribution_clicked();//每日分布按钮点击事件处理：所选属性最近90天的箱线图
 };
 
 #endif // MYSQL_H
@@ -1,4 +1,5 @@
 ﻿#include "mytcpserver.h"
+#include "metrics.h"
 
 MyTcpServer::MyTcpServer(QObject *parent)
     : QTcpServer{parent}
@@ -9,6 +10,9 @@ MyTcpServer::MyTcpServer(QObject *parent)
 //并传入一个唯一的socketDescriptor，传的是socket描述符，根据socket秒速符，可以初始化TcpSocket
 void MyTcpServer::incomingConnection(qintptr socketDescriptor)
 {
+    static MetricCounter *const accepted =
+        Metrics::instance().counter("sensor_connections_accepted_total", "接受的TCP连接数");
+    accepted->inc();
     //函数体内直接通过emit newDescriptor(socketDescriptor)发射信号
     emit newDescriptor(socketDescriptor);
 }
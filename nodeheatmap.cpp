@@ -0,0 +1,287 @@
+﻿// nodeheatmap.cpp - 全部节点 × 时间的热力图窗口
+
+#include "nodeheatmap.h"
+#include <QComboBox>
+#include <QDateTime>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QTimer>
+#include <QVBoxLayout>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+NodeHeatmap::NodeHeatmap(QWidget *parent)
+    : QWidget(parent)
+{
+    setWindowTitle("节点热力图");
+    resize(1000, 700);
+
+    m_channelBox = new QComboBox(this);
+    m_channelBox->addItems({"空气温度", "空气湿度", "氧气含量", "土壤温度", "土壤湿度", "光照"});
+    connect(m_channelBox, qOverload<int>(&QComboBox::currentIndexChanged), this, &NodeHeatmap::onChannelChanged);
+
+    QHBoxLayout *toolLayout = new QHBoxLayout;
+    toolLayout->addWidget(new QLabel("通道：", this));
+    toolLayout->addWidget(m_channelBox);
+    toolLayout->addStretch();
+
+    m_plot = new QCustomPlot(this);
+    m_map = new QCPColorMap(m_plot->xAxis, m_plot->yAxis);
+    // 不插值：一个单元对应图像的一个像素，重绘时才能只给改动的列着色
+    // （节点数不超过100时图像会被放大，此时退回整幅着色，但数据量本身很小）
+    m_map->setInterpolate(false);
+    m_map->setTightBoundary(true);
+    QCPColorGradient gradient(QCPColorGradient::gpJet);
+    gradient.setNanHandling(QCPColorGradient::nhTransparent); // 没有数据的分钟显示为空白
+    m_map->setGradient(gradient);
+
+    m_scale = new QCPColorScale(m_plot);
+    m_plot->plotLayout()->addElement(0, 1, m_scale);
+    m_map->setColorScale(m_scale);
+    m_scale->axis()->setLabel(m_channelBox->currentText());
+    QCPMarginGroup *marginGroup = new QCPMarginGroup(m_plot);
+    m_plot->axisRect()->setMarginGroup(QCP::msBottom | QCP::msTop, marginGroup);
+    m_scale->setMarginGroup(QCP::msBottom | QCP::msTop, marginGroup);
+
+    QSharedPointer<QCPAxisTickerDateTime> timeTicker(new QCPAxisTickerDateTime);
+    timeTicker->setDateTimeFormat("HH:mm");
+    timeTicker->setDateTimeSpec(Qt::LocalTime);
+    m_plot->xAxis->setTicker(timeTicker);
+    m_plot->xAxis->setLabel("时间");
+    m_plot->yAxis->setTicker(QSharedPointer<QCPAxisTickerText>(new QCPAxisTickerText));
+    m_plot->yAxis->setLabel("节点");
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addLayout(toolLayout);
+    layout->addWidget(m_plot);
+
+    m_tickTimer = new QTimer(this);
+    connect(m_tickTimer, &QTimer::timeout, this, &NodeHeatmap::onTick);
+    m_tickTimer->start(1000);
+
+    advanceTo(bucketOf(QDateTime::currentMSecsSinceEpoch()));
+}
+
+//累加一批读数：只更新各节点当前分钟的单元
+void NodeHeatmap::addReadings(const QVector<SensorData> &readings)
+{
+    if (readings.isEmpty()) {
+        return;
+    }
+    QCPColorMapData *data = m_map->data();
+    bool rowsChanged = false; // 出现新节点后行号会变化，本批结束后整幅重建
+    for (const SensorData &reading : readings) {
+        qint64 bucket = bucketOf(reading.time > 0 ? reading.time : QDateTime::currentMSecsSinceEpoch());
+        if (bucket > m_lastBucket) {
+            advanceTo(bucket);
+        } else {
+            bucket = m_lastBucket; // 跨分钟时稍晚取出的读数计入当前分钟
+        }
+
+        bool inserted = false;
+        const int rowIndex = rowFor(reading.node, &inserted);
+        rowsChanged |= inserted;
+        NodeRow &row = m_rows[rowIndex];
+        if (row.countBucket != bucket) {
+            std::fill(row.sums, row.sums + kChannels, 0.0);
+            row.count = 0;
+            row.countBucket = bucket;
+        }
+        ++row.count;
+        const int slot = slotOf(bucket);
+        for (int channel = 0; channel < kChannels; ++channel) {
+            row.sums[channel] += channelValue(reading, channel);
+            row.means[channel * kBuckets + slot] = float(row.sums[channel] / row.count);
+        }
+
+        if (!rowsChanged) {
+            const double value = row.means.at(m_channel * kBuckets + slot);
+            data->setCell(kBuckets - 1, rowIndex, value);
+            includeValue(value);
+        }
+    }
+    if (rowsChanged) {
+        rebuildMap();
+    }
+    m_dirty = true;
+    replotIfVisible();
+}
+
+void NodeHeatmap::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    m_dirty = true;
+    replotIfVisible();
+}
+
+//切换显示的通道：从各节点的环形缓冲重建整幅图
+void NodeHeatmap::onChannelChanged(int channel)
+{
+    if (channel < 0 || channel >= kChannels) {
+        return;
+    }
+    m_channel = channel;
+    m_scale->axis()->setLabel(m_channelBox->itemText(channel));
+    rebuildMap();
+    replotIfVisible();
+}
+
+void NodeHeatmap::onTick()
+{
+    advanceTo(bucketOf(QDateTime::currentMSecsSinceEpoch()));
+    replotIfVisible();
+}
+
+//节点所在的行，新节点按编号顺序插入
+int NodeHeatmap::rowFor(int node, bool *inserted)
+{
+    const auto found = m_rowOfNode.constFind(node);
+    if (found != m_rowOfNode.constEnd()) {
+        *inserted = false;
+        return found.value();
+    }
+
+    NodeRow row;
+    row.node = node;
+    row.means.fill(std::numeric_limits<float>::quiet_NaN(), kChannels * kBuckets);
+    const auto position = std::lower_bound(m_rows.begin(), m_rows.end(), node,
+                                           [](const NodeRow &r, int n) { return r.node < n; });
+    const int rowIndex = int(position - m_rows.begin());
+    m_rows.insert(rowIndex, row);
+    for (int i = rowIndex; i < m_rows.size(); ++i) {
+        m_rowOfNode[m_rows.at(i).node] = i;
+    }
+    *inserted = true;
+    return rowIndex;
+}
+
+//进入新的一分钟：清空被复用的环形缓冲槽，整幅图左移，新列为空
+void NodeHeatmap::advanceTo(qint64 bucket)
+{
+    if (m_lastBucket >= 0 && bucket <= m_lastBucket) {
+        return;
+    }
+    const qint64 steps = m_lastBucket < 0 ? qint64(kBuckets) : bucket - m_lastBucket;
+    const qint64 clearFrom = bucket - qMin(steps, qint64(kBuckets)) + 1;
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    for (NodeRow &row : m_rows) {
+        for (qint64 b = clearFrom; b <= bucket; ++b) {
+            const int slot = slotOf(b);
+            for (int channel = 0; channel < kChannels; ++channel) {
+                row.means[channel * kBuckets + slot] = nan;
+            }
+        }
+    }
+    m_lastBucket = bucket;
+
+    QCPColorMapData *data = m_map->data();
+    if (steps >= kBuckets || data->isEmpty() || data->valueSize() != m_rows.size()) {
+        rebuildMap();
+        return;
+    }
+    data->shiftKeys(int(steps));
+    for (int rowIndex = 0; rowIndex < data->valueSize(); ++rowIndex) {
+        for (int k = kBuckets - int(steps); k < kBuckets; ++k) {
+            data->setCell(k, rowIndex, qQNaN());
+        }
+    }
+    m_dirty = true;
+}
+
+//从各节点的环形缓冲重建整幅图（出现新节点、切换通道或长时间没有前进时）
+void NodeHeatmap::rebuildMap()
+{
+    QCPColorMapData *data = m_map->data();
+    const int rows = m_rows.size();
+    m_dirty = true;
+    if (rows == 0 || m_lastBucket < 0) {
+        data->setSize(0, 0);
+        return;
+    }
+
+    const qint64 first = m_lastBucket - kBuckets + 1;
+    data->setSize(kBuckets, rows);
+    data->setRange(QCPRange(first * kBucketSeconds + kBucketSeconds / 2.0, m_lastBucket * kBucketSeconds + kBucketSeconds / 2.0),
+                   rows > 1 ? QCPRange(0, rows - 1) : QCPRange(-0.5, 0.5));
+
+    double lower = std::numeric_limits<double>::max();
+    double upper = -std::numeric_limits<double>::max();
+    for (int rowIndex = 0; rowIndex < rows; ++rowIndex) {
+        const float *means = m_rows.at(rowIndex).means.constData() + m_channel * kBuckets;
+        for (int k = 0; k < kBuckets; ++k) {
+            const double value = means[slotOf(first + k)];
+            data->setCell(k, rowIndex, value);
+            if (!std::isnan(value)) {
+                lower = qMin(lower, value);
+                upper = qMax(upper, value);
+            }
+        }
+    }
+    m_hasBounds = lower <= upper;
+    if (m_hasBounds) {
+        m_valueBounds = lower < upper ? QCPRange(lower, upper) : QCPRange(lower - 1, upper + 1);
+        m_map->setDataRange(m_valueBounds);
+    }
+
+    updateRowTicks();
+    m_plot->yAxis->setRange(-0.5, rows - 0.5);
+}
+
+//纵轴标签为节点编号，节点很多时只标一部分
+void NodeHeatmap::updateRowTicks()
+{
+    QSharedPointer<QCPAxisTickerText> ticker = m_plot->yAxis->ticker().dynamicCast<QCPAxisTickerText>();
+    if (!ticker) {
+        return;
+    }
+    ticker->clear();
+    const int step = qMax(1, (int(m_rows.size()) + 19) / 20); // 最多约20个标签
+    for (int rowIndex = 0; rowIndex < m_rows.size(); rowIndex += step) {
+        ticker->addTick(rowIndex, QString::number(m_rows.at(rowIndex).node));
+    }
+}
+
+//颜色范围只在数值超出时扩大，并多留10%余量：改变颜色范围需要整幅重新着色
+void NodeHeatmap::includeValue(double value)
+{
+    if (std::isnan(value) || (m_hasBounds && m_valueBounds.contains(value))) {
+        return;
+    }
+    if (!m_hasBounds) {
+        m_valueBounds = QCPRange(value - 1, value + 1);
+        m_hasBounds = true;
+    } else {
+        const double margin = 0.1 * m_valueBounds.size();
+        if (value < m_valueBounds.lower) {
+            m_valueBounds.lower = value - margin;
+        } else {
+            m_valueBounds.upper = value + margin;
+        }
+    }
+    m_map->setDataRange(m_valueBounds);
+}
+
+void NodeHeatmap::replotIfVisible()
+{
+    if (!m_dirty || !isVisible()) {
+        return;
+    }
+    m_dirty = false;
+    // 横轴覆盖最近kBuckets分钟（每列以分钟中点为中心）
+    m_plot->xAxis->setRange(double(m_lastBucket - kBuckets + 1) * kBucketSeconds, double(m_lastBucket + 1) * kBucketSeconds);
+    m_plot->replot(QCustomPlot::rpQueuedReplot);
+}
+
+double NodeHeatmap::channelValue(const SensorData &data, int channel)
+{
+    switch (channel) {
+    case 0: return data.atemp;
+    case 1: return data.ahumi;
+    case 2: return data.oxygen;
+    case 3: return data.stemp;
+    case 4: return data.shumi2;
+    case 5: return data.light;
+    default: return 0;
+    }
+}
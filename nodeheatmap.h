@@ -0,0 +1,74 @@
+﻿#ifndef NODEHEATMAP_H
+#define NODEHEATMAP_H
+
+#include <QWidget>
+#include <QVector>
+#include <QHash>
+#include "qcustomplot.h"
+#include "sensordata.h"
+
+class QComboBox;
+class QTimer;
+
+// NodeHeatmap - 全部节点 × 时间的热力图窗口（节点很多时代替每个节点六条曲线）
+// 行为节点（按节点编号排序），列为一分钟的时间桶，颜色表示所选通道在该分钟内的平均值。
+// 读数按分钟桶累加：当前分钟只更新最后一列，进入新的一分钟时整幅图左移一列（QCPColorMapData::shiftKeys），
+// 重绘时只给改动的列重新着色，不重建整张图。出现新节点或切换通道时才从各节点的环形缓冲重建。
+// 最多保留kBuckets列（24小时），1000个节点 × 1440分钟时每帧的着色量仍只有一列。
+class NodeHeatmap : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit NodeHeatmap(QWidget *parent = nullptr);
+
+    // 累加一批读数（界面线程每帧调用，窗口隐藏时也累加，打开时即可看到之前的数据）
+    void addReadings(const QVector<SensorData> &readings);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+
+private slots:
+    void onChannelChanged(int channel);//切换显示的通道
+    void onTick();//每秒检查是否进入新的一分钟（没有读数时列也要前进）
+
+private:
+    static const int kBuckets = 1440;   // 保留的分钟数（24小时）
+    static const int kChannels = 6;     // 空气温度、空气湿度、氧气、土壤温度、土壤湿度、光照
+    static const int kBucketSeconds = 60;
+
+    // 一个节点：各通道每分钟平均值的环形缓冲（下标 = 分钟序号 % kBuckets，无数据为NaN）
+    // 以及当前分钟的累加和
+    struct NodeRow {
+        int node = 0;
+        QVector<float> means;       // kChannels * kBuckets
+        double sums[kChannels] = {};
+        int count = 0;              // 当前分钟的读数条数
+        qint64 countBucket = -1;    // sums/count所属的分钟
+    };
+
+    QCustomPlot *m_plot = nullptr;
+    QCPColorMap *m_map = nullptr;
+    QCPColorScale *m_scale = nullptr;
+    QComboBox *m_channelBox = nullptr;
+    QTimer *m_tickTimer = nullptr;
+
+    QVector<NodeRow> m_rows;         // 按节点编号排序
+    QHash<int, int> m_rowOfNode;     // 节点编号 -> 行
+    int m_channel = 0;               // 当前显示的通道
+    qint64 m_lastBucket = -1;        // 最新一列对应的分钟序号（Unix时间/60）
+    QCPRange m_valueBounds;          // 当前通道已显示数值的范围，决定颜色范围
+    bool m_hasBounds = false;
+    bool m_dirty = false;            // 有改动尚未重绘
+
+    int rowFor(int node, bool *inserted);
+    void advanceTo(qint64 bucket);
+    void rebuildMap();
+    void updateRowTicks();
+    void includeValue(double value);
+    void replotIfVisible();
+    static qint64 bucketOf(qint64 msecs) { return msecs / 1000 / kBucketSeconds; }
+    static int slotOf(qint64 bucket) { return int(bucket % kBuckets); }
+    static double channelValue(const SensorData &data, int channel);
+};
+
+#endif // NODEHEATMAP_H
@@ -0,0 +1,103 @@
+﻿// packetcapture.cpp - 接收字节流的抓包文件读写
+
+#include "packetcapture.h"
+#include <QDateTime>
+#include <QMutexLocker>
+
+static const quint32 kCaptureMagic = 0x534E4350; // 'SNCP'
+static const quint16 kCaptureVersion = 1;
+
+PacketCapture::~PacketCapture()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+}
+
+bool PacketCapture::open(const QString &fileName)
+{
+    QMutexLocker locker(&m_mutex);
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    m_out.setDevice(&m_file);
+    m_out.setVersion(QDataStream::Qt_6_0);
+    m_out << kCaptureMagic << kCaptureVersion << qint64(QDateTime::currentMSecsSinceEpoch());
+    m_clock.start();
+    return true;
+}
+
+quint32 PacketCapture::openConnection(const QString &peer)
+{
+    quint32 connection;
+    {
+        QMutexLocker locker(&m_mutex);
+        connection = m_nextConnection++;
+    }
+    append(Opened, connection, peer.toUtf8());
+    return connection;
+}
+
+void PacketCapture::write(quint32 connection, const QByteArray &bytes)
+{
+    append(Data, connection, bytes);
+}
+
+void PacketCapture::closeConnection(quint32 connection)
+{
+    append(Closed, connection, QByteArray());
+    // 连接断开时落盘，程序异常退出时最多丢失仍在连接中的数据
+    QMutexLocker locker(&m_mutex);
+    m_file.flush();
+}
+
+// 时刻在锁内取，保证文件中的记录按时刻排序
+void PacketCapture::append(RecordType type, quint32 connection, const QByteArray &bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_file.isOpen()) {
+        return;
+    }
+    m_out << quint8(type) << connection << qint64(m_clock.nsecsElapsed() / 1000) << bytes;
+}
+
+bool PacketCaptureReader::open(const QString &fileName)
+{
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    m_in.setDevice(&m_file);
+    m_in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    m_in >> magic >> version >> m_startMs;
+    if (m_in.status() != QDataStream::Ok || magic != kCaptureMagic) {
+        m_error = "不是抓包文件";
+        return false;
+    }
+    if (version != kCaptureVersion) {
+        m_error = QString("不支持的抓包文件版本%1").arg(version);
+        return false;
+    }
+    return true;
+}
+
+bool PacketCaptureReader::next(PacketCapture::Record &record)
+{
+    if (m_in.atEnd()) {
+        return false;
+    }
+    quint8 type = 0;
+    m_in >> type >> record.connection >> record.timeUs >> record.bytes;
+    if (m_in.status() != QDataStream::Ok || type > PacketCapture::Closed) {
+        // 程序异常退出时最后一条记录可能不完整
+        m_error = "抓包文件在记录中间结束";
+        return false;
+    }
+    record.type = PacketCapture::RecordType(type);
+    return true;
+}
@@ -0,0 +1,72 @@
+﻿#ifndef PACKETCAPTURE_H
+#define PACKETCAPTURE_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+
+// PacketCapture - 把各TCP连接收到的原始字节连同时刻记录到一个抓包文件，供tools/replay回放
+// 文件格式（QDataStream，大端）：
+//     文件头  quint32 魔数'SNCP'  quint16 版本1  qint64 开始时刻（毫秒时间戳）
+//     记录    quint8 类型  quint32 连接编号  qint64 距开始的微秒数  QByteArray 内容
+// 类型为Opened时内容是对端地址，Data时是一次readAll()读到的字节（保留原来的拆包/粘包），Closed时为空。
+// 多个接收线程共用一个文件，写入加锁；只在排查问题时打开，平时不影响接收链路。
+class PacketCapture
+{
+public:
+    enum RecordType : quint8 {
+        Opened = 0,
+        Data = 1,
+        Closed = 2
+    };
+
+    struct Record {
+        RecordType type = Data;
+        quint32 connection = 0;
+        qint64 timeUs = 0;
+        QByteArray bytes;
+    };
+
+    ~PacketCapture();
+
+    // 创建（覆盖）抓包文件
+    bool open(const QString &fileName);
+    QString errorString() const { return m_file.errorString(); }
+
+    // 新连接，返回其编号
+    quint32 openConnection(const QString &peer);
+    void write(quint32 connection, const QByteArray &bytes);
+    void closeConnection(quint32 connection);
+
+private:
+    void append(RecordType type, quint32 connection, const QByteArray &bytes);
+
+    QMutex m_mutex;
+    QFile m_file;
+    QDataStream m_out;
+    QElapsedTimer m_clock;
+    quint32 m_nextConnection = 1;
+};
+
+// PacketCaptureReader - 按写入顺序逐条读出抓包文件中的记录（时刻单调不减）
+class PacketCaptureReader
+{
+public:
+    bool open(const QString &fileName);
+    QString errorString() const { return m_error; }
+    qint64 startMs() const { return m_startMs; }
+
+    // 读出下一条记录，文件结束或损坏时返回false（损坏时errorString()非空）
+    bool next(PacketCapture::Record &record);
+
+private:
+    QFile m_file;
+    QDataStream m_in;
+    QString m_error;
+    qint64 m_startMs = 0;
+};
+
+#endif // PACKETCAPTURE_H
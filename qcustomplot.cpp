@@ -25,6 +25,18 @@
 
 #include "qcustomplot.h"
 
+#include <atomic>
+
+// instruction set for qcpLinearDataToPixels, chosen at compile time (e.g. -mavx2 or /arch:AVX2). The
+// vector paths reinterpret QPointF as two doubles, so they're only used if qreal is double:
+#if !defined(QT_COORD_TYPE) && defined(__AVX__)
+#  include <immintrin.h>
+#  define QCP_SIMD_AVX
+#elif !defined(QT_COORD_TYPE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#  include <emmintrin.h>
+#  define QCP_SIMD_SSE2
+#endif
+
 
 /* including file 'src/vector2d.cpp'       */
 /* modified 2022-11-06T12:45:56, size 7973 */
@@ -720,6 +732,247 @@ void QCPPaintBufferPixmap::reallocateBuffer()
 }
 
 
+#ifdef QCP_THREADED_RASTER_SUPPORTED
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////// QCPPaintBufferImage
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! \class QCPPaintBufferImage
+  \brief A paint buffer that rasterizes into a QImage on a worker thread
+
+  This paint buffer is used for layers in \ref QCPLayer::lmBuffered mode if \ref
+  QCustomPlot::setThreadedRendering is enabled.
+
+  While the layer is drawn on the GUI thread, the paint commands are only recorded into a QPicture.
+  This recording is an immutable snapshot of the layer: all data has already been resolved to
+  pixel coordinates, so nothing of the plot is accessed afterwards. \ref donePainting hands the
+  recording to the thread pool of the parent plot, where it is played back into a new QImage with
+  software rasterization (including antialiasing). When the image is finished, it replaces the
+  previously shown image and the target widget is updated. \ref draw, called from the paint event,
+  only blits the latest finished image.
+
+  All buffered layers of one \ref QCustomPlot::replot are rasterized concurrently on the thread
+  pool and grouped in a \ref Batch: their images are only shown once the last of them is finished,
+  so the composited result is consistent and the time until it is shown is that of the slowest
+  layer, not the sum of all layers.
+
+  If recordings are submitted faster than they can be rasterized, outdated recordings are skipped.
+  The shown content of threaded layers may therefore lag one frame behind the layers drawn on the
+  GUI thread.
+
+  The recording is done with \ref QCPPainter::pmNoCaching, because cached label pixmaps must not be
+  rasterized outside the GUI thread.
+*/
+
+/*! \internal
+
+  Plays back a recorded layer into a QImage on a worker thread, see \ref QCPPaintBufferImage.
+*/
+class QCPPaintBufferImageJob : public QRunnable
+{
+public:
+  QCPPaintBufferImageJob(const QPicture &picture, const QSize &pixelSize, double devicePixelRatio, const QColor &clearColor, quint64 generation,
+                         const QSharedPointer<QCPPaintBufferImage::Frame> &frame, const QSharedPointer<QCPPaintBufferImage::Batch> &batch, QWidget *target) :
+    mPicture(picture),
+    mPixelSize(pixelSize),
+    mDevicePixelRatio(devicePixelRatio),
+    mClearColor(clearColor),
+    mGeneration(generation),
+    mFrame(frame),
+    mBatch(batch),
+    mTarget(target)
+  {
+  }
+  
+  virtual void run() Q_DECL_OVERRIDE
+  {
+    if (mFrame->submittedGeneration.loadAcquire() == mGeneration) // else a newer recording is already waiting, skip this one
+    {
+      QImage image(mPixelSize, QImage::Format_ARGB32_Premultiplied);
+#ifdef QCP_DEVICEPIXELRATIO_SUPPORTED
+      image.setDevicePixelRatio(mDevicePixelRatio);
+#endif
+      image.fill(mClearColor);
+      {
+        QPainter painter(&image);
+        mPicture.play(&painter);
+      }
+      QMutexLocker locker(&mFrame->mutex);
+      if (mGeneration > mFrame->shownGeneration)
+        mFrame->staged.insert(mGeneration, image);
+    }
+    
+    if (mBatch) // shown together with the other layers of the same replot
+    {
+      mBatch->finishOne(mBatch);
+    } else // single layer replot (QCPLayer::replot), show right away
+    {
+      mFrame->promote(mGeneration);
+      QPointer<QWidget> target = mTarget;
+      QMetaObject::invokeMethod(QCoreApplication::instance(), [target]() { if (target) target->update(); }, Qt::QueuedConnection);
+    }
+  }
+  
+private:
+  QPicture mPicture;
+  QSize mPixelSize;
+  double mDevicePixelRatio;
+  QColor mClearColor;
+  quint64 mGeneration;
+  QSharedPointer<QCPPaintBufferImage::Frame> mFrame;
+  QSharedPointer<QCPPaintBufferImage::Batch> mBatch;
+  QPointer<QWidget> mTarget;
+};
+
+/*! \internal
+
+  Makes the image rasterized for \a generation the shown one, unless a newer generation is already
+  shown. If the recording of \a generation was skipped because a newer one was submitted, the shown
+  image stays until the batch of the newer one is promoted. Staged images up to \a generation are
+  discarded either way. Returns whether the shown image is now that of \a generation or a newer
+  one. Thread-safe.
+*/
+bool QCPPaintBufferImage::Frame::promote(quint64 generation)
+{
+  QMutexLocker locker(&mutex);
+  QMap<quint64, QImage>::iterator it = staged.find(generation);
+  if (it != staged.end() && generation > shownGeneration)
+  {
+    image = it.value();
+    shownGeneration = generation;
+  }
+  while (!staged.isEmpty() && staged.firstKey() <= generation)
+    staged.erase(staged.begin());
+  return shownGeneration >= generation;
+}
+
+/*! \internal
+
+  Called by each job of the batch \a self when it finished (or skipped) rasterization. The last one
+  promotes the images of all layers in the batch on the GUI thread, each with the generation it
+  submitted in this batch, and updates the target widget. If all layers now show the content of
+  this replot (or of a newer one), \ref QCustomPlot::afterRasterize is emitted.
+*/
+void QCPPaintBufferImage::Batch::finishOne(const QSharedPointer<Batch> &self)
+{
+  if (pending.deref())
+    return;
+  QSharedPointer<Batch> batch = self;
+  QMetaObject::invokeMethod(QCoreApplication::instance(), [batch]()
+  {
+    bool shown = true;
+    for (int i=0; i<batch->frames.size(); ++i)
+    {
+      if (!batch->frames.at(i).first->promote(batch->frames.at(i).second))
+        shown = false;
+    }
+    if (batch->target)
+    {
+      batch->target->update();
+      if (shown)
+      {
+        if (QCustomPlot *plot = qobject_cast<QCustomPlot*>(batch->target.data()))
+          emit plot->afterRasterize(batch->replotCount);
+      }
+    }
+  }, Qt::QueuedConnection);
+}
+
+/*! \internal
+
+  Called by \ref QCustomPlot::replot after all layers of the replot have been submitted to \a
+  batch.
+*/
+void QCPPaintBufferImage::Batch::seal(const QSharedPointer<Batch> &batch)
+{
+  batch->finishOne(batch);
+}
+
+/*!
+  Creates an image paint buffer with the specified \a size and \a devicePixelRatio. Recordings are
+  rasterized on \a threadPool, and \a target is updated whenever a new image is available.
+*/
+QCPPaintBufferImage::QCPPaintBufferImage(const QSize &size, double devicePixelRatio, QThreadPool *threadPool, QWidget *target) :
+  QCPAbstractPaintBuffer(size, devicePixelRatio),
+  mClearColor(Qt::transparent),
+  mGeneration(0),
+  mThreadPool(threadPool),
+  mTarget(target),
+  mFrame(new Frame)
+{
+  QCPPaintBufferImage::reallocateBuffer();
+}
+
+QCPPaintBufferImage::~QCPPaintBufferImage()
+{
+  // invalidate queued recordings, the frame itself is kept alive by running jobs
+  mFrame->submittedGeneration.storeRelease(0);
+}
+
+/* inherits documentation from base class */
+QCPPainter *QCPPaintBufferImage::startPainting()
+{
+  mPicture = QPicture();
+  QCPPainter *result = new QCPPainter(&mPicture);
+  result->setMode(QCPPainter::pmNoCaching);
+  return result;
+}
+
+/* inherits documentation from base class */
+void QCPPaintBufferImage::donePainting()
+{
+  const quint64 generation = ++mGeneration;
+  mFrame->submittedGeneration.storeRelease(generation);
+  QSize pixelSize = mSize;
+#ifdef QCP_DEVICEPIXELRATIO_SUPPORTED
+  pixelSize = mSize*mDevicePixelRatio;
+#endif
+  if (mBatch)
+  {
+    mBatch->pending.ref();
+    int index = 0;
+    while (index < mBatch->frames.size() && mBatch->frames.at(index).first != mFrame)
+      ++index;
+    if (index < mBatch->frames.size())
+      mBatch->frames[index].second = generation;
+    else
+      mBatch->frames.append(qMakePair(mFrame, generation));
+  }
+  mThreadPool->start(new QCPPaintBufferImageJob(mPicture, pixelSize, mDevicePixelRatio, mClearColor, generation, mFrame, mBatch, mTarget.data()));
+}
+
+/* inherits documentation from base class */
+void QCPPaintBufferImage::draw(QCPPainter *painter) const
+{
+  if (painter && painter->isActive())
+  {
+    QMutexLocker locker(&mFrame->mutex);
+    if (!mFrame->image.isNull())
+      painter->drawImage(0, 0, mFrame->image);
+  } else
+    qDebug() << Q_FUNC_INFO << "invalid or inactive painter passed";
+}
+
+/* inherits documentation from base class */
+void QCPPaintBufferImage::clear(const QColor &color)
+{
+  // the image is filled on the worker thread when the next recording is rasterized
+  mClearColor = color;
+  mPicture = QPicture();
+}
+
+/* inherits documentation from base class */
+void QCPPaintBufferImage::reallocateBuffer()
+{
+  setInvalidated();
+#ifndef QCP_DEVICEPIXELRATIO_SUPPORTED
+  mDevicePixelRatio = 1.0;
+#endif
+  // the shown image keeps its old size until the next recording has been rasterized
+}
+#endif // QCP_THREADED_RASTER_SUPPORTED
+
+
 #ifdef QCP_OPENGL_PBUFFER
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////// QCPPaintBufferGlPbuffer
@@ -2758,6 +3011,19 @@ QCPDataSelection QCPDataSelection::inverse(const QCPDataRange &outerRange) const
 /* end of 'src/selection.cpp' */
 
 
+/* including file 'src/datacontainer.cpp'   */
+
+/*! \relates QCPDataContainer
+  Returns a new, process-wide unique value for \ref QCPDataContainer::revision. Thread-safe.
+*/
+quint64 qcpNextDataRevision()
+{
+  static std::atomic<quint64> counter(0);
+  return ++counter;
+}
+/* end of 'src/datacontainer.cpp' */
+
+
 /* including file 'src/selectionrect.cpp'  */
 /* modified 2022-11-06T12:45:56, size 9215 */
 
@@ -6527,7 +6793,16 @@ double QCPAxisTicker::cleanMantissa(double input) const
 QCPAxisTickerDateTime::QCPAxisTickerDateTime() :
   mDateTimeFormat(QLatin1String("hh:mm:ss\ndd.MM.yy")),
   mDateTimeSpec(Qt::LocalTime),
-  mDateStrategy(dsNone)
+  mDateStrategy(dsNone),
+  mCachedResultValid(false),
+  mCachedHasSubTicks(false),
+  mCachedHasLabels(false),
+  mCachedTickCount(0),
+  mCachedTickOrigin(0),
+  mCachedTickStepStrategy(tssReadability),
+  mTickPositionCacheStep(0),
+  mTickPositionCacheOrigin(0),
+  mTickPositionCacheStrategy(dsNone)
 {
   setTickCount(4);
 }
@@ -6571,6 +6846,8 @@ QCPAxisTickerDateTime::QCPAxisTickerDateTime() :
 */
 void QCPAxisTickerDateTime::setDateTimeFormat(const QString &format)
 {
+  if (format != mDateTimeFormat)
+    clearCaches();
   mDateTimeFormat = format;
 }
 
@@ -6589,6 +6866,8 @@ void QCPAxisTickerDateTime::setDateTimeFormat(const QString &format)
 */
 void QCPAxisTickerDateTime::setDateTimeSpec(Qt::TimeSpec spec)
 {
+  if (spec != mDateTimeSpec)
+    clearCaches();
   mDateTimeSpec = spec;
 }
 
@@ -6601,6 +6880,7 @@ void QCPAxisTickerDateTime::setDateTimeSpec(Qt::TimeSpec spec)
 */
 void QCPAxisTickerDateTime::setTimeZone(const QTimeZone &zone)
 {
+  clearCaches();
   mTimeZone = zone;
   mDateTimeSpec = Qt::TimeZone;
 }
@@ -6632,6 +6912,57 @@ void QCPAxisTickerDateTime::setTickOrigin(const QDateTime &origin)
   setTickOrigin(dateTimeToKey(origin));
 }
 
+/*!
+  Reimplemented to reuse the results of previous calls. Replotting a live chart calls this method
+  once per frame, while the axis range usually stays the same or only slides by a few seconds.
+  
+  If \a range, \a locale and the tick count, tick origin and tick step strategy are the same as in
+  the previous call, the previously generated ticks, sub ticks and labels are returned without
+  any date/time arithmetic. Otherwise the base class implementation generates them, but the
+  corrected positions of ticks (see \ref createTickVector) and the tick label strings (see \ref
+  getTickLabel) that were already computed for a previous range are looked up instead of being
+  computed again. Labels that stay visible thus keep their text, so the rendered label pixmaps of
+  the axis painter are reused (see \ref QCP::phCacheLabels), and the axis keeps its cached margin
+  as long as the largest label has the same size (see \ref QCPAxis::setupTickVectors).
+  
+  The caches are cleared when the date time format, time spec or time zone changes.
+  
+  \seebaseclassmethod
+*/
+void QCPAxisTickerDateTime::generate(const QCPRange &range, const QLocale &locale, QChar formatChar, int precision, QVector<double> &ticks, QVector<double> *subTicks, QVector<QString> *tickLabels)
+{
+  if (mCachedResultValid && range == mCachedRange && locale == mCachedLocale && mTickCount == mCachedTickCount &&
+      mTickOrigin == mCachedTickOrigin && mTickStepStrategy == mCachedTickStepStrategy &&
+      (!subTicks || mCachedHasSubTicks) && (!tickLabels || mCachedHasLabels))
+  {
+    ticks = mCachedTicks;
+    if (subTicks)
+      *subTicks = mCachedSubTicks;
+    if (tickLabels)
+      *tickLabels = mCachedTickLabels;
+    return;
+  }
+  
+  if (locale != mLabelCacheLocale)
+  {
+    mLabelCache.clear();
+    mLabelCacheLocale = locale;
+  }
+  QCPAxisTicker::generate(range, locale, formatChar, precision, ticks, subTicks, tickLabels);
+  
+  mCachedResultValid = true;
+  mCachedRange = range;
+  mCachedLocale = locale;
+  mCachedTickCount = mTickCount;
+  mCachedTickOrigin = mTickOrigin;
+  mCachedTickStepStrategy = mTickStepStrategy;
+  mCachedTicks = ticks;
+  mCachedHasSubTicks = subTicks;
+  mCachedSubTicks = subTicks ? *subTicks : QVector<double>();
+  mCachedHasLabels = tickLabels;
+  mCachedTickLabels = tickLabels ? *tickLabels : QVector<QString>();
+}
+
 /*! \internal
   
   Returns a sensible tick step with intervals appropriate for a date-time-display, such as weekly,
@@ -6713,20 +7044,33 @@ int QCPAxisTickerDateTime::getSubTickCount(double tickStep)
   (\ref setDateTimeFormat), time spec (\ref setDateTimeSpec), and possibly time zone (\ref
   setTimeZone).
   
+  Labels are cached by tick coordinate, so formatting happens only once for each tick that stays
+  visible while the axis range slides. The locale belonging to the cached labels is checked in
+  \ref generate.
+  
   \seebaseclassmethod
 */
 QString QCPAxisTickerDateTime::getTickLabel(double tick, const QLocale &locale, QChar formatChar, int precision)
 {
   Q_UNUSED(precision)
   Q_UNUSED(formatChar)
+  QHash<double, QString>::const_iterator cached = mLabelCache.constFind(tick);
+  if (cached != mLabelCache.constEnd())
+    return cached.value();
+  if (mLabelCache.size() >= 1000) // a live axis keeps producing new ticks, don't let the cache grow without bounds
+    mLabelCache.clear();
+  
+  QString result;
 # if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
   if (mDateTimeSpec == Qt::TimeZone)
-    return locale.toString(keyToDateTime(tick).toTimeZone(mTimeZone), mDateTimeFormat);
+    result = locale.toString(keyToDateTime(tick).toTimeZone(mTimeZone), mDateTimeFormat);
   else
-    return locale.toString(keyToDateTime(tick).toTimeSpec(mDateTimeSpec), mDateTimeFormat);
+    result = locale.toString(keyToDateTime(tick).toTimeSpec(mDateTimeSpec), mDateTimeFormat);
 # else
-  return locale.toString(keyToDateTime(tick).toTimeSpec(mDateTimeSpec), mDateTimeFormat);
+  result = locale.toString(keyToDateTime(tick).toTimeSpec(mDateTimeSpec), mDateTimeFormat);
 # endif
+  mLabelCache.insert(tick, result);
+  return result;
 }
 
 /*! \internal
@@ -6739,39 +7083,61 @@ QString QCPAxisTickerDateTime::getTickLabel(double tick, const QLocale &locale,
 QVector<double> QCPAxisTickerDateTime::createTickVector(double tickStep, const QCPRange &range)
 {
   QVector<double> result = QCPAxisTicker::createTickVector(tickStep, range);
-  if (!result.isEmpty())
+  if (!result.isEmpty() && mDateStrategy != dsNone)
   {
-    if (mDateStrategy == dsUniformTimeInDay)
+    // the correction of a tick only depends on its uncorrected coordinate, the tick step, the date
+    // strategy and the tick origin, so ticks that stay visible while the range slides are looked up:
+    if (tickStep != mTickPositionCacheStep || mTickOrigin != mTickPositionCacheOrigin || mDateStrategy != mTickPositionCacheStrategy || mTickPositionCache.size() >= 1000)
+    {
+      mTickPositionCache.clear();
+      mTickPositionCacheStep = tickStep;
+      mTickPositionCacheOrigin = mTickOrigin;
+      mTickPositionCacheStrategy = mDateStrategy;
+    }
+    QDateTime uniformDateTime = keyToDateTime(mTickOrigin); // the time (and for dsUniformDayInMonth, the day in month) of this datetime will be set for all other ticks, if possible
+    QDateTime tickDateTime;
+    for (int i=0; i<result.size(); ++i)
     {
-      QDateTime uniformDateTime = keyToDateTime(mTickOrigin); // the time of this datetime will be set for all other ticks, if possible
-      QDateTime tickDateTime;
-      for (int i=0; i<result.size(); ++i)
+      const double uncorrectedTick = result.at(i);
+      QHash<double, double>::const_iterator cached = mTickPositionCache.constFind(uncorrectedTick);
+      if (cached != mTickPositionCache.constEnd())
       {
-        tickDateTime = keyToDateTime(result.at(i));
-        tickDateTime.setTime(uniformDateTime.time());
-        result[i] = dateTimeToKey(tickDateTime);
+        result[i] = cached.value();
+        continue;
       }
-    } else if (mDateStrategy == dsUniformDayInMonth)
-    {
-      QDateTime uniformDateTime = keyToDateTime(mTickOrigin); // this day (in month) and time will be set for all other ticks, if possible
-      QDateTime tickDateTime;
-      for (int i=0; i<result.size(); ++i)
+      tickDateTime = keyToDateTime(uncorrectedTick);
+      tickDateTime.setTime(uniformDateTime.time());
+      if (mDateStrategy == dsUniformDayInMonth)
       {
-        tickDateTime = keyToDateTime(result.at(i));
-        tickDateTime.setTime(uniformDateTime.time());
         int thisUniformDay = uniformDateTime.date().day() <= tickDateTime.date().daysInMonth() ? uniformDateTime.date().day() : tickDateTime.date().daysInMonth(); // don't exceed month (e.g. try to set day 31 in February)
         if (thisUniformDay-tickDateTime.date().day() < -15) // with leap years involved, date month may jump backwards or forwards, and needs to be corrected before setting day
           tickDateTime = tickDateTime.addMonths(1);
         else if (thisUniformDay-tickDateTime.date().day() > 15) // with leap years involved, date month may jump backwards or forwards, and needs to be corrected before setting day
           tickDateTime = tickDateTime.addMonths(-1);
         tickDateTime.setDate(QDate(tickDateTime.date().year(), tickDateTime.date().month(), thisUniformDay));
-        result[i] = dateTimeToKey(tickDateTime);
       }
+      result[i] = dateTimeToKey(tickDateTime);
+      mTickPositionCache.insert(uncorrectedTick, result.at(i));
     }
   }
   return result;
 }
 
+/*! \internal
+  
+  Discards all cached ticks, tick positions and tick labels, so the next call to \ref generate
+  creates them from scratch. Called when a property changes that influences the tick labels.
+*/
+void QCPAxisTickerDateTime::clearCaches()
+{
+  mCachedResultValid = false;
+  mCachedTicks.clear();
+  mCachedSubTicks.clear();
+  mCachedTickLabels.clear();
+  mTickPositionCache.clear();
+  mLabelCache.clear();
+}
+
 /*!
   A convenience method which turns \a key (in seconds since Epoch 1. Jan 1970, 00:00 UTC) into a
   QDateTime object. This can be used to turn axis coordinates to actual QDateTimes.
@@ -9349,6 +9715,49 @@ double QCPAxis::coordToPixel(double value) const
   }
 }
 
+/*!
+  If the axis has a linear scale (\ref stLinear), sets \a scale and \a offset such that <tt>pixel =
+  coord*scale + offset</tt> gives the same result as \ref coordToPixel for the current range, axis
+  rect and range reversal, and returns true. For logarithmic axes, returns false and leaves \a scale
+  and \a offset unchanged.
+
+  This allows transforming many coordinates in one pass without calling \ref coordToPixel for each
+  of them, see \ref qcpLinearDataToPixels.
+
+  \see coordToPixel
+*/
+bool QCPAxis::linearPixelTransform(double *scale, double *offset) const
+{
+  if (mScaleType != stLinear || !scale || !offset)
+    return false;
+  if (orientation() == Qt::Horizontal)
+  {
+    const double factor = mAxisRect->width()/mRange.size();
+    if (!mRangeReversed)
+    {
+      *scale = factor;
+      *offset = mAxisRect->left()-mRange.lower*factor;
+    } else
+    {
+      *scale = -factor;
+      *offset = mAxisRect->left()+mRange.upper*factor;
+    }
+  } else // orientation() == Qt::Vertical
+  {
+    const double factor = mAxisRect->height()/mRange.size();
+    if (!mRangeReversed)
+    {
+      *scale = -factor;
+      *offset = mAxisRect->bottom()+mRange.lower*factor;
+    } else
+    {
+      *scale = factor;
+      *offset = mAxisRect->bottom()-mRange.upper*factor;
+    }
+  }
+  return true;
+}
+
 /*!
   Returns the part of the axis that is hit by \a pos (in pixels). The return value of this function
   is independent of the user-selectable parts defined with \ref setSelectableParts. Further, this
@@ -9738,7 +10147,15 @@ void QCPAxis::setupTickVectors()
   
   QVector<QString> oldLabels = mTickVectorLabels;
   mTicker->generate(mRange, mParentPlot->locale(), mNumberFormatChar, mNumberPrecision, mTickVector, mSubTicks ? &mSubTickVector : nullptr, mTickLabels ? &mTickVectorLabels : nullptr);
-  mCachedMarginValid &= mTickVectorLabels == oldLabels; // if labels have changed, margin might have changed, too
+  if (mCachedMarginValid && mTickVectorLabels != oldLabels) // if labels have changed, margin might have changed, too
+  {
+    // the margin only depends on the largest tick label. When the labels merely slide along with the
+    // range (e.g. a live time axis), keep the cached margin so the axis rect doesn't need a new layout:
+    if (oldLabels.isEmpty() || mTickVectorLabels.isEmpty() || !mTicks)
+      mCachedMarginValid = false;
+    else if (mAxisPainter->tickLabelSide == lsOutside)
+      mCachedMarginValid = mAxisPainter->maxTickLabelSize(mTickVectorLabels) == mAxisPainter->tickLabelsSize();
+  }
 }
 
 /*! \internal
@@ -10140,14 +10557,13 @@ int QCPAxisPainterPrivate::size()
     result += qMax(0, qMax(tickLengthOut, subTickLengthOut));
   
   // calculate size of tick labels:
+  mTickLabelsSize = QSize(0, 0);
   if (tickLabelSide == QCPAxis::lsOutside)
   {
-    QSize tickLabelsSize(0, 0);
     if (!tickLabels.isEmpty())
     {
-      foreach (const QString &tickLabel, tickLabels)
-        getMaxTickLabelSize(tickLabelFont, tickLabel, &tickLabelsSize);
-      result += QCPAxis::orientation(type) == Qt::Horizontal ? tickLabelsSize.height() : tickLabelsSize.width();
+      mTickLabelsSize = maxTickLabelSize(tickLabels);
+      result += QCPAxis::orientation(type) == Qt::Horizontal ? mTickLabelsSize.height() : mTickLabelsSize.width();
     result += tickLabelPadding;
     }
   }
@@ -10164,6 +10580,23 @@ int QCPAxisPainterPrivate::size()
   return result;
 }
 
+/*! \internal
+  
+  Returns the width and height of the largest of the tick labels \a labels, as they would be drawn
+  with the current tick label font. Sizes of labels that are already in the label cache are taken
+  from the cached pixmaps, so for an axis whose labels repeat from replot to replot no text needs to
+  be measured.
+  
+  \see tickLabelsSize
+*/
+QSize QCPAxisPainterPrivate::maxTickLabelSize(const QVector<QString> &labels) const
+{
+  QSize result(0, 0);
+  foreach (const QString &label, labels)
+    getMaxTickLabelSize(tickLabelFont, label, &result);
+  return result;
+}
+
 /*! \internal
   
   Clears the internal label cache. Upon the next \ref draw, all labels will be created new. This
@@ -13487,7 +13920,23 @@ QCP::Interaction QCPAbstractItem::selectionCategory() const
   It is safe to mutually connect the replot slot with this signal on two QCustomPlots to make them
   replot synchronously, it won't cause an infinite recursion.
   
-  \see replot, beforeReplot, afterLayout
+  \see replot, beforeReplot, afterLayout, afterRasterize
+*/
+
+/*! \fn void QCustomPlot::afterRasterize(quint64 replotCount)
+
+  This signal is emitted once the content of the replot with the given \a replotCount (see \ref
+  replotCount) is ready to be shown, i.e. the next paint event shows it (or a newer replot).
+
+  Without threaded rendering, this is right after \ref afterReplot. With threaded rendering (\ref
+  setThreadedRendering), the buffered layers are still being rasterized on the thread pool when
+  \ref afterReplot is emitted; this signal follows once all of them are finished and shown. If the
+  rasterization of a replot was skipped because a newer replot was already submitted, only the
+  newer replot emits the signal, so a handler should treat everything up to \a replotCount as shown.
+
+  The signal is always emitted on the GUI thread.
+
+  \see afterReplot
 */
 
 /* end of documentation of signals */
@@ -13618,6 +14067,7 @@ QCustomPlot::QCustomPlot(QWidget *parent) :
   mSelectionRectMode(QCP::srmNone),
   mSelectionRect(nullptr),
   mOpenGl(false),
+  mThreadedRendering(false),
   mMouseHasMoved(false),
   mMouseEventLayerable(nullptr),
   mMouseSignalLayerable(nullptr),
@@ -13625,9 +14075,11 @@ QCustomPlot::QCustomPlot(QWidget *parent) :
   mReplotQueued(false),
   mReplotTime(0),
   mReplotTimeAverage(0),
+  mReplotCount(0),
   mOpenGlMultisamples(16),
   mOpenGlAntialiasedElementsBackup(QCP::aeNone),
-  mOpenGlCacheLabelsBackup(true)
+  mOpenGlCacheLabelsBackup(true),
+  mRasterThreadPool(nullptr)
 {
   setAttribute(Qt::WA_NoMousePropagation);
   setFocusPolicy(Qt::ClickFocus);
@@ -14101,6 +14553,46 @@ void QCustomPlot::setOpenGl(bool enabled, int multisampling)
 #endif
 }
 
+/*!
+  Enables rasterization of buffered layers on a worker thread.
+
+  If \a enabled is set to true, every layer in \ref QCPLayer::lmBuffered mode gets a \ref
+  QCPPaintBufferImage. During \ref replot, the layer is only recorded on the GUI thread; the
+  expensive software rasterization (e.g. antialiased lines of dense graphs) happens on a thread
+  pool owned by this QCustomPlot, and the paint event only blits the finished images. Layers in
+  \ref QCPLayer::lmLogical mode are still rasterized on the GUI thread as before.
+
+  All buffered layers of a replot are rasterized concurrently (one thread per core) and composited
+  once the slowest of them is finished. To move graphs off the GUI thread, place them on layers in
+  \ref QCPLayer::lmBuffered mode (see \ref addLayer, \ref QCPLayer::setMode and \ref
+  QCPLayerable::setLayer). Giving each dense graph its own buffered layer lets them be rasterized in
+  parallel.
+
+  This is a CPU rendering path. It has no effect while OpenGL is enabled (\ref setOpenGl).
+
+  \note Threaded rendering requires Qt 5.10 or newer.
+*/
+void QCustomPlot::setThreadedRendering(bool enabled)
+{
+#ifdef QCP_THREADED_RASTER_SUPPORTED
+  if (mThreadedRendering == enabled)
+    return;
+  mThreadedRendering = enabled;
+  if (mThreadedRendering && !mRasterThreadPool)
+  {
+    mRasterThreadPool = new QThreadPool(this);
+    mRasterThreadPool->setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+    mRasterThreadPool->setExpiryTimeout(-1); // replots are frequent, keep the threads around
+  }
+  // recreate all paint buffers:
+  mPaintBuffers.clear();
+  setupPaintBuffers();
+#else
+  Q_UNUSED(enabled)
+  qDebug() << Q_FUNC_INFO << "Threaded rendering requires Qt 5.10 or newer";
+#endif
+}
+
 /*!
   Sets the viewport of this QCustomPlot. Usually users of QCustomPlot don't need to change the
   viewport manually.
@@ -15131,6 +15623,7 @@ void QCustomPlot::replot(QCustomPlot::RefreshPriority refreshPriority)
     return;
   mReplotting = true;
   mReplotQueued = false;
+  ++mReplotCount;
   emit beforeReplot();
   
 # if QT_VERSION < QT_VERSION_CHECK(4, 8, 0)
@@ -15144,10 +15637,34 @@ void QCustomPlot::replot(QCustomPlot::RefreshPriority refreshPriority)
   updateLayout();
   // draw all layered objects (grid, axes, plottables, items, legend,...) into their buffers:
   setupPaintBuffers();
+#ifdef QCP_THREADED_RASTER_SUPPORTED
+  // threaded layers of this replot are rasterized concurrently and shown together:
+  QSharedPointer<QCPPaintBufferImage::Batch> rasterBatch;
+  if (mThreadedRendering)
+  {
+    rasterBatch.reset(new QCPPaintBufferImage::Batch(this, mReplotCount));
+    foreach (QSharedPointer<QCPAbstractPaintBuffer> buffer, mPaintBuffers)
+    {
+      if (QCPPaintBufferImage *imageBuffer = dynamic_cast<QCPPaintBufferImage*>(buffer.data()))
+        imageBuffer->setBatch(rasterBatch);
+    }
+  }
+#endif
   foreach (QCPLayer *layer, mLayers)
     layer->drawToPaintBuffer();
   foreach (QSharedPointer<QCPAbstractPaintBuffer> buffer, mPaintBuffers)
     buffer->setInvalidated(false);
+#ifdef QCP_THREADED_RASTER_SUPPORTED
+  if (rasterBatch)
+  {
+    foreach (QSharedPointer<QCPAbstractPaintBuffer> buffer, mPaintBuffers)
+    {
+      if (QCPPaintBufferImage *imageBuffer = dynamic_cast<QCPPaintBufferImage*>(buffer.data()))
+        imageBuffer->setBatch(QSharedPointer<QCPPaintBufferImage::Batch>());
+    }
+    QCPPaintBufferImage::Batch::seal(rasterBatch);
+  }
+#endif
   
   if ((refreshPriority == rpRefreshHint && mPlottingHints.testFlag(QCP::phImmediateRefresh)) || refreshPriority==rpImmediateRefresh)
     repaint();
@@ -15165,6 +15682,10 @@ void QCustomPlot::replot(QCustomPlot::RefreshPriority refreshPriority)
     mReplotTimeAverage = mReplotTime; // no previous replots to average with, so initialize with replot time
   
   emit afterReplot();
+#ifdef QCP_THREADED_RASTER_SUPPORTED
+  if (!rasterBatch) // else emitted once the batch is shown, see QCPPaintBufferImage::Batch::finishOne
+#endif
+    emit afterRasterize(mReplotCount);
   mReplotting = false;
 }
 
@@ -15179,6 +15700,14 @@ double QCustomPlot::replotTime(bool average) const
   return average ? mReplotTimeAverage : mReplotTime;
 }
 
+/*! \fn quint64 QCustomPlot::replotCount() const
+
+  Returns the number of replots so far. It is incremented at the start of every \ref replot, so
+  during \ref beforeReplot and \ref afterReplot it is the number of the current replot.
+
+  \see afterRasterize
+*/
+
 /*!
   Rescales the axes such that all plottables (like graphs) in the plot are fully visible.
   
@@ -15838,9 +16367,14 @@ void QCustomPlot::drawBackground(QCPPainter *painter)
 */
 void QCustomPlot::setupPaintBuffers()
 {
+  // buffered layers get an image paint buffer rasterized on the worker thread, if enabled:
+#ifdef QCP_THREADED_RASTER_SUPPORTED
+  const bool threaded = mThreadedRendering && !mOpenGl;
+#else
+  const bool threaded = false;
+#endif
   int bufferIndex = 0;
-  if (mPaintBuffers.isEmpty())
-    mPaintBuffers.append(QSharedPointer<QCPAbstractPaintBuffer>(createPaintBuffer()));
+  ensurePaintBuffer(bufferIndex, false);
   
   for (int layerIndex = 0; layerIndex < mLayers.size(); ++layerIndex)
   {
@@ -15851,14 +16385,12 @@ void QCustomPlot::setupPaintBuffers()
     } else if (layer->mode() == QCPLayer::lmBuffered)
     {
       ++bufferIndex;
-      if (bufferIndex >= mPaintBuffers.size())
-        mPaintBuffers.append(QSharedPointer<QCPAbstractPaintBuffer>(createPaintBuffer()));
+      ensurePaintBuffer(bufferIndex, threaded);
       layer->mPaintBuffer = mPaintBuffers.at(bufferIndex).toWeakRef();
       if (layerIndex < mLayers.size()-1 && mLayers.at(layerIndex+1)->mode() == QCPLayer::lmLogical) // not last layer, and next one is logical, so prepare another buffer for next layerables
       {
         ++bufferIndex;
-        if (bufferIndex >= mPaintBuffers.size())
-          mPaintBuffers.append(QSharedPointer<QCPAbstractPaintBuffer>(createPaintBuffer()));
+        ensurePaintBuffer(bufferIndex, false);
       }
     }
   }
@@ -15898,6 +16430,41 @@ QCPAbstractPaintBuffer *QCustomPlot::createPaintBuffer()
     return new QCPPaintBufferPixmap(viewport().size(), mBufferDevicePixelRatio);
 }
 
+/*! \internal
+
+  This method is used by \ref setupPaintBuffers to create paint buffers for buffered layers when
+  \ref setThreadedRendering is enabled. Falls back to \ref createPaintBuffer if threaded rendering
+  isn't supported.
+*/
+QCPAbstractPaintBuffer *QCustomPlot::createThreadedPaintBuffer()
+{
+#ifdef QCP_THREADED_RASTER_SUPPORTED
+  if (mRasterThreadPool)
+    return new QCPPaintBufferImage(viewport().size(), mBufferDevicePixelRatio, mRasterThreadPool, this);
+#endif
+  return createPaintBuffer();
+}
+
+/*! \internal
+
+  Makes sure the paint buffer at \a index exists and is of the right kind, i.e. a \ref
+  QCPPaintBufferImage if \a threaded is true, and a buffer from \ref createPaintBuffer otherwise.
+  Used by \ref setupPaintBuffers.
+*/
+void QCustomPlot::ensurePaintBuffer(int index, bool threaded)
+{
+  if (index >= mPaintBuffers.size())
+  {
+    mPaintBuffers.append(QSharedPointer<QCPAbstractPaintBuffer>(threaded ? createThreadedPaintBuffer() : createPaintBuffer()));
+    return;
+  }
+#ifdef QCP_THREADED_RASTER_SUPPORTED
+  const bool isThreaded = dynamic_cast<QCPPaintBufferImage*>(mPaintBuffers.at(index).data()) != nullptr;
+  if (isThreaded != threaded) // layer mode or threaded rendering setting changed
+    mPaintBuffers[index] = QSharedPointer<QCPAbstractPaintBuffer>(threaded ? createThreadedPaintBuffer() : createPaintBuffer());
+#endif
+}
+
 /*!
   This method returns whether any of the paint buffers held by this QCustomPlot instance are
   invalidated.
@@ -20810,27 +21377,1194 @@ QCPGraphData::QCPGraphData(double key, double value) :
 {
 }
 
+/*! \relates QCPGraphData
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
-//////////////////// QCPGraph
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
-/*! \class QCPGraph
-  \brief A plottable representing a graph in a plot.
+  Transforms \a count data points starting at \a data to pixel coordinates and writes them to \a
+  pixels, which must have room for \a count points. Both axes must be linear; the transform of each
+  axis is given as <tt>pixel = coord*scale + offset</tt>, as obtained from \ref
+  QCPAxis::linearPixelTransform. If \a keyVertical is true, the key is written to the y coordinate and
+  the value to the x coordinate of each point, otherwise the other way around.
 
-  \image html QCPGraph.png
-  
-  Usually you create new graphs by calling QCustomPlot::addGraph. The resulting instance can be
-  accessed via QCustomPlot::graph.
+  Since \ref QCPGraphData and QPointF both consist of two consecutive doubles, the transform is a
+  single multiply-add per point that is applied in one linear pass with AVX (two points per
+  instruction) or SSE2 (one point per instruction), depending on the instruction set the library is
+  compiled for. Otherwise, or if qreal isn't double, a scalar loop is used. NaN coordinates stay NaN,
+  just like with \ref QCPAxis::coordToPixel.
 
-  To plot data, assign it with the \ref setData or \ref addData functions. Alternatively, you can
-  also access and modify the data via the \ref data method, which returns a pointer to the internal
-  \ref QCPGraphDataContainer.
-  
-  Graphs are used to display single-valued data. Single-valued means that there should only be one
-  data point per unique key coordinate. In other words, the graph can't have \a loops. If you do
-  want to plot non-single-valued curves, rather use the QCPCurve plottable.
-  
+  \see QCPGraph::dataToLines
+*/
+void qcpLinearDataToPixels(const QCPGraphData *data, int count, double keyScale, double keyOffset, double valueScale, double valueOffset, bool keyVertical, QPointF *pixels)
+{
+  int i = 0;
+#if defined(QCP_SIMD_AVX)
+  const __m256d scale = _mm256_setr_pd(keyScale, valueScale, keyScale, valueScale);
+  const __m256d offset = _mm256_setr_pd(keyOffset, valueOffset, keyOffset, valueOffset);
+  const double *src = reinterpret_cast<const double*>(data);
+  double *dst = reinterpret_cast<double*>(pixels);
+  for (; i+1 < count; i += 2)
+  {
+#  if defined(__FMA__) || defined(__AVX2__)
+    __m256d p = _mm256_fmadd_pd(_mm256_loadu_pd(src+i*2), scale, offset);
+#  else
+    __m256d p = _mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(src+i*2), scale), offset);
+#  endif
+    if (keyVertical)
+      p = _mm256_permute_pd(p, 0x5); // swap key and value within each point
+    _mm256_storeu_pd(dst+i*2, p);
+  }
+#elif defined(QCP_SIMD_SSE2)
+  const __m128d scale = _mm_setr_pd(keyScale, valueScale);
+  const __m128d offset = _mm_setr_pd(keyOffset, valueOffset);
+  const double *src = reinterpret_cast<const double*>(data);
+  double *dst = reinterpret_cast<double*>(pixels);
+  for (; i < count; ++i)
+  {
+    __m128d p = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(src+i*2), scale), offset);
+    if (keyVertical)
+      p = _mm_shuffle_pd(p, p, 0x1); // swap key and value
+    _mm_storeu_pd(dst+i*2, p);
+  }
+#endif
+  // scalar fallback, and the remaining point of the AVX loop:
+  if (keyVertical)
+  {
+    for (; i < count; ++i)
+    {
+      pixels[i].setX(data[i].value*valueScale+valueOffset);
+      pixels[i].setY(data[i].key*keyScale+keyOffset);
+    }
+  } else
+  {
+    for (; i < count; ++i)
+    {
+      pixels[i].setX(data[i].key*keyScale+keyOffset);
+      pixels[i].setY(data[i].value*valueScale+valueOffset);
+    }
+  }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////// QCPDataColumns
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! \class QCPDataColumns
+  \brief Several value channels that share one key column
+
+  Stores one ascending key array and \ref channelCount value arrays of the same length, e.g. the
+  timestamps and the readings of several sensors that are sampled together. Appending a row with
+  \ref append writes the key only once, no matter how many channels there are.
+
+  If QCustomPlot is compiled with \c QCUSTOMPLOT_USE_SOA_GRAPHDATA, graphs can display a channel
+  without copying it: pass a view container to \ref QCPGraph::setData(QSharedPointer<QCPGraphDataContainer> data),
+  created with \ref QCPDataContainer<QCPGraphData>::QCPDataContainer(const QSharedPointer<QCPDataColumns> &columns, int channel)
+  "QCPGraphDataContainer(columns, channel)". The graphs then always show the current content of the
+  columns; they only need a replot after rows were added or removed.
+
+  Like \ref QCPDataContainer, removing rows from the front (\ref removeFirst, \ref removeBefore)
+  only advances a head offset, and the arrays are compacted once the removed part is as large as
+  the remaining data.
+
+  The class isn't thread-safe. Modify it in the thread that renders the graphs using it.
+*/
+
+/*!
+  Constructs empty columns with \a channelCount value channels.
+*/
+QCPDataColumns::QCPDataColumns(int channelCount) :
+  mValues(qMax(0, channelCount)),
+  mHead(0),
+  mRevision(qcpNextDataRevision()),
+  mFrontRemoved(0)
+{
+}
+
+/*!
+  Appends a row with the key \a key and one value per channel from \a values, which must hold \ref
+  channelCount values.
+
+  Keys are expected to arrive in ascending order. A key smaller than the last one is inserted at its
+  sorted position, which is slower and changes the \ref revision.
+*/
+void QCPDataColumns::append(double key, const double *values)
+{
+  if (isEmpty() || !(key < mKeys.last()))
+  {
+    mKeys.append(key);
+    for (int i=0; i<mValues.size(); ++i)
+      mValues[i].append(values[i]);
+  } else
+  {
+    const int index = int(std::upper_bound(mKeys.constBegin()+mHead, mKeys.constEnd(), key)-mKeys.constBegin());
+    mKeys.insert(index, key);
+    for (int i=0; i<mValues.size(); ++i)
+      mValues[i].insert(index, values[i]);
+    mRevision = qcpNextDataRevision();
+  }
+}
+
+/*!
+  Removes all rows with keys smaller than \a key.
+*/
+void QCPDataColumns::removeBefore(double key)
+{
+  removeFirst(int(std::lower_bound(mKeys.constBegin()+mHead, mKeys.constEnd(), key)-(mKeys.constBegin()+mHead)));
+}
+
+/*!
+  Removes the \a count oldest rows (the rows with the smallest keys).
+*/
+void QCPDataColumns::removeFirst(int count)
+{
+  count = qBound(0, count, size());
+  if (count == 0)
+    return;
+  mHead += count;
+  mFrontRemoved += count;
+  if (mHead > 1000 && mHead >= size())
+    compact();
+}
+
+/*!
+  Removes all rows.
+*/
+void QCPDataColumns::clear()
+{
+  mKeys.clear();
+  for (int i=0; i<mValues.size(); ++i)
+    mValues[i].clear();
+  mHead = 0;
+  mRevision = qcpNextDataRevision();
+  mFrontRemoved = 0;
+}
+
+/*! \internal
+
+  Moves the remaining rows to the beginning of the arrays. Each removed row is moved at most once on
+  average, since this is only done once the head offset is as large as the remaining data.
+*/
+void QCPDataColumns::compact()
+{
+  const int n = size();
+  std::copy(mKeys.constBegin()+mHead, mKeys.constEnd(), mKeys.begin());
+  mKeys.resize(n);
+  for (int i=0; i<mValues.size(); ++i)
+  {
+    std::copy(mValues.at(i).constBegin()+mHead, mValues.at(i).constEnd(), mValues[i].begin());
+    mValues[i].resize(n);
+  }
+  mHead = 0;
+}
+
+
+#ifdef QCP_SOA_GRAPH_DATA
+/*! \internal
+
+  Finds the smallest and largest of the \a count values starting at \a values, ignoring NaN and
+  infinite values, and values outside \a signDomain. Returns false if no value qualifies, in which
+  case \a minValue and \a maxValue are undefined.
+
+  Uses AVX or SSE2 if the library is compiled for it, like \ref qcpLinearDataToPixels.
+*/
+static bool qcpFiniteMinMax(const double *values, int count, QCP::SignDomain signDomain, double *minValue, double *maxValue)
+{
+  const double inf = std::numeric_limits<double>::infinity();
+  double lower = inf;
+  double upper = -inf;
+  int i = 0;
+#if defined(QCP_SIMD_AVX)
+  {
+    const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+    const __m256d posInf = _mm256_set1_pd(inf);
+    const __m256d negInf = _mm256_set1_pd(-inf);
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d vLower = posInf;
+    __m256d vUpper = negInf;
+    for (; i+3 < count; i += 4)
+    {
+      const __m256d v = _mm256_loadu_pd(values+i);
+      __m256d valid = _mm256_cmp_pd(_mm256_and_pd(v, absMask), posInf, _CMP_LT_OQ); // false for NaN and +-inf
+      if (signDomain == QCP::sdPositive)
+        valid = _mm256_and_pd(valid, _mm256_cmp_pd(v, zero, _CMP_GT_OQ));
+      else if (signDomain == QCP::sdNegative)
+        valid = _mm256_and_pd(valid, _mm256_cmp_pd(v, zero, _CMP_LT_OQ));
+      vLower = _mm256_min_pd(vLower, _mm256_blendv_pd(posInf, v, valid));
+      vUpper = _mm256_max_pd(vUpper, _mm256_blendv_pd(negInf, v, valid));
+    }
+    double l[4], u[4];
+    _mm256_storeu_pd(l, vLower);
+    _mm256_storeu_pd(u, vUpper);
+    for (int k=0; k<4; ++k)
+    {
+      lower = qMin(lower, l[k]);
+      upper = qMax(upper, u[k]);
+    }
+  }
+#elif defined(QCP_SIMD_SSE2)
+  {
+    const __m128d absMask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+    const __m128d posInf = _mm_set1_pd(inf);
+    const __m128d negInf = _mm_set1_pd(-inf);
+    const __m128d zero = _mm_setzero_pd();
+    __m128d vLower = posInf;
+    __m128d vUpper = negInf;
+    for (; i+1 < count; i += 2)
+    {
+      const __m128d v = _mm_loadu_pd(values+i);
+      __m128d valid = _mm_cmplt_pd(_mm_and_pd(v, absMask), posInf); // false for NaN and +-inf
+      if (signDomain == QCP::sdPositive)
+        valid = _mm_and_pd(valid, _mm_cmpgt_pd(v, zero));
+      else if (signDomain == QCP::sdNegative)
+        valid = _mm_and_pd(valid, _mm_cmplt_pd(v, zero));
+      vLower = _mm_min_pd(vLower, _mm_or_pd(_mm_and_pd(valid, v), _mm_andnot_pd(valid, posInf)));
+      vUpper = _mm_max_pd(vUpper, _mm_or_pd(_mm_and_pd(valid, v), _mm_andnot_pd(valid, negInf)));
+    }
+    double l[2], u[2];
+    _mm_storeu_pd(l, vLower);
+    _mm_storeu_pd(u, vUpper);
+    lower = qMin(l[0], l[1]);
+    upper = qMax(u[0], u[1]);
+  }
+#endif
+  // scalar fallback, and the remaining values of the vector loops:
+  for (; i < count; ++i)
+  {
+    const double v = values[i];
+    if (!std::isfinite(v) || (signDomain == QCP::sdPositive && !(v > 0)) || (signDomain == QCP::sdNegative && !(v < 0)))
+      continue;
+    if (v < lower)
+      lower = v;
+    if (v > upper)
+      upper = v;
+  }
+  *minValue = lower;
+  *maxValue = upper;
+  return lower <= upper;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////// QCPDataContainer<QCPGraphData>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! \class QCPDataContainer<QCPGraphData>
+  \brief Struct-of-arrays data container for QCPGraph
+
+  This specialization of \ref QCPDataContainer is used instead of the generic template when
+  QCustomPlot is compiled with the define \c QCUSTOMPLOT_USE_SOA_GRAPHDATA. It offers the same
+  interface, so \ref QCPGraph (and everything else using \ref QCPGraphDataContainer) works with it
+  unchanged, but stores the keys and values in two separate arrays instead of one array of \ref
+  QCPGraphData:
+
+  \li Binary searches (\ref findBegin, \ref findEnd, \ref removeBefore etc.) only touch the key
+  array, so twice as many keys fit into each cache line.
+  \li \ref valueRange scans only the value array, using SSE2/AVX min/max instructions where the
+  library is compiled for them (see \ref qcpLinearDataToPixels).
+  \li Removing data from the front (\ref removeBefore, e.g. for a rolling time window) only
+  advances a head offset. The arrays are compacted once the removed part is as large as the
+  remaining data, so trimming is amortized O(1) per point. Prepending reuses the space in front of
+  the head offset, like the preallocation of the generic container.
+
+  A container can also be a view of one value channel of a \ref QCPDataColumns object, see \ref
+  QCPDataContainer(const QSharedPointer<QCPDataColumns> &columns, int channel). Several graphs can
+  then share one key column without copying it.
+
+  Since the data points aren't stored as \ref QCPGraphData objects, the iterators are proxies:
+  dereferencing a \ref const_iterator returns a \ref QCPGraphData by value, and its \c operator->
+  gives access to \a key, \a value and the usual data point methods (\a sortKey, \a mainValue,
+  ...). The non-const \ref iterator returns references into the arrays, so data can still be
+  modified in place. Raw access to the arrays is available with \ref constKeyData and \ref
+  constValueData.
+*/
+
+/*!
+  Constructs an empty container.
+*/
+QCPDataContainer<QCPGraphData>::QCPDataContainer() :
+  mAutoSqueeze(true),
+  mHead(0),
+  mPreallocIteration(0),
+  mRevision(qcpNextDataRevision()),
+  mFrontRemoved(0),
+  mChannel(0)
+{
+}
+
+/*!
+  Constructs a container that is a view of the value channel \a channel of \a columns, together
+  with the key column of \a columns. The view doesn't copy any data: it always shows the current
+  content of \a columns, and its \ref frontRemovedCount follows that of \a columns. Its \ref
+  revision combines a revision of its own, taken at construction, with the revision of \a columns:
+  it changes whenever \a columns change, and views of different channels of the same columns never
+  report the same revision, so caches keyed on the revision (like \ref QCPGraphLod) are rebuilt
+  when a graph is switched to another channel.
+
+  Modifying the container (e.g. with \ref add, \ref removeBefore or the non-const iterators) first
+  detaches it, i.e. it copies the current data of the channel and from then on behaves like a normal
+  container. \ref clear detaches without copying.
+
+  \see QCPDataColumns, isView
+*/
+QCPDataContainer<QCPGraphData>::QCPDataContainer(const QSharedPointer<QCPDataColumns> &columns, int channel) :
+  mAutoSqueeze(true),
+  mHead(0),
+  mPreallocIteration(0),
+  mRevision(qcpNextDataRevision()),
+  mFrontRemoved(0),
+  mColumns(columns),
+  mChannel(channel)
+{
+  if (mColumns && (channel < 0 || channel >= mColumns->channelCount()))
+  {
+    qDebug() << Q_FUNC_INFO << "invalid channel" << channel;
+    mColumns.clear();
+    mChannel = 0;
+  }
+}
+
+/*!
+  \copydoc QCPDataContainer::setAutoSqueeze
+*/
+void QCPDataContainer<QCPGraphData>::setAutoSqueeze(bool enabled)
+{
+  if (mAutoSqueeze != enabled)
+  {
+    mAutoSqueeze = enabled;
+    if (mAutoSqueeze)
+      performAutoSqueeze();
+  }
+}
+
+/*! \overload
+
+  Replaces the current data in this container with the provided \a data.
+*/
+void QCPDataContainer<QCPGraphData>::set(const QCPDataContainer<QCPGraphData> &data)
+{
+  if (&data == this)
+    return;
+  clear();
+  add(data);
+}
+
+/*! \overload
+
+  Replaces the current data in this container with the provided \a data. If you can guarantee that
+  the data points in \a data are sorted by key, set \a alreadySorted to true to avoid an unnecessary
+  sorting run.
+*/
+void QCPDataContainer<QCPGraphData>::set(const QVector<QCPGraphData> &data, bool alreadySorted)
+{
+  clear();
+  add(data, alreadySorted);
+}
+
+/*! \overload
+
+  Replaces the current data in this container with the data points given by \a keys and \a values.
+  If the vectors differ in size, the shorter one determines the number of data points. If you can
+  guarantee that \a keys is sorted ascendingly, set \a alreadySorted to true to avoid an
+  unnecessary sorting run.
+*/
+void QCPDataContainer<QCPGraphData>::set(const QVector<double> &keys, const QVector<double> &values, bool alreadySorted)
+{
+  clear();
+  add(keys, values, alreadySorted);
+}
+
+/*! \overload
+
+  Adds the provided \a data to the current data in this container.
+*/
+void QCPDataContainer<QCPGraphData>::add(const QCPDataContainer<QCPGraphData> &data)
+{
+  if (data.isEmpty())
+    return;
+  if (&data == this)
+  {
+    const QCPDataContainer<QCPGraphData> copy(data);
+    add(copy);
+    return;
+  }
+  appendSorted(data.constKeyData(), data.constValueData(), data.size(), true);
+}
+
+/*! \overload
+
+  Adds the provided data points in \a data to the current data. If you can guarantee that the data
+  points in \a data are sorted by key, set \a alreadySorted to true to avoid an unnecessary sorting
+  run.
+*/
+void QCPDataContainer<QCPGraphData>::add(const QVector<QCPGraphData> &data, bool alreadySorted)
+{
+  if (data.isEmpty())
+    return;
+  const int n = int(data.size());
+  QVector<double> keys(n), values(n);
+  for (int i=0; i<n; ++i)
+  {
+    keys[i] = data.at(i).key;
+    values[i] = data.at(i).value;
+  }
+  appendSorted(keys.constData(), values.constData(), n, alreadySorted);
+}
+
+/*! \overload
+
+  Adds the data points given by \a keys and \a values to the current data. If the vectors differ in
+  size, the shorter one determines the number of data points. If you can guarantee that \a keys is
+  sorted ascendingly, set \a alreadySorted to true to avoid an unnecessary sorting run.
+
+  Since the arrays are copied as a whole, this is the fastest way to add many data points to this
+  container.
+*/
+void QCPDataContainer<QCPGraphData>::add(const QVector<double> &keys, const QVector<double> &values, bool alreadySorted)
+{
+  const int n = int(qMin(keys.size(), values.size()));
+  if (n > 0)
+    appendSorted(keys.constData(), values.constData(), n, alreadySorted);
+}
+
+/*! \overload
+
+  Adds the provided single data point to the current data.
+*/
+void QCPDataContainer<QCPGraphData>::add(const QCPGraphData &data)
+{
+  detach();
+  if (isEmpty() || !(data.key < mKeys.last())) // quickly handle appends if new data key is greater or equal to existing ones
+  {
+    mKeys.append(data.key);
+    mValues.append(data.value);
+  } else if (data.key < mKeys.at(mHead)) // quickly handle prepends using the space in front of the head
+  {
+    reserveFront(1);
+    --mHead;
+    mKeys[mHead] = data.key;
+    mValues[mHead] = data.value;
+    mRevision = qcpNextDataRevision();
+  } else // handle inserts, maintaining sorted keys
+  {
+    const int index = mHead+lowerBoundIndex(data.key);
+    mKeys.insert(index, data.key);
+    mValues.insert(index, data.value);
+    mRevision = qcpNextDataRevision();
+  }
+}
+
+/*!
+  Removes all data points with keys smaller than \a sortKey. This only advances the head offset,
+  see the class description.
+*/
+void QCPDataContainer<QCPGraphData>::removeBefore(double sortKey)
+{
+  detach();
+  const int count = lowerBoundIndex(sortKey);
+  mHead += count;
+  mFrontRemoved += count;
+  if (mAutoSqueeze)
+    performAutoSqueeze();
+}
+
+/*!
+  Removes all data points with keys greater than \a sortKey.
+*/
+void QCPDataContainer<QCPGraphData>::removeAfter(double sortKey)
+{
+  detach();
+  const int index = mHead+upperBoundIndex(sortKey);
+  if (index != mKeys.size())
+  {
+    mRevision = qcpNextDataRevision();
+    mKeys.resize(index);
+    mValues.resize(index);
+  }
+  if (mAutoSqueeze)
+    performAutoSqueeze();
+}
+
+/*!
+  Removes all data points with keys between \a sortKeyFrom and \a sortKeyTo. If \a sortKeyFrom is
+  greater or equal to \a sortKeyTo, the function does nothing.
+*/
+void QCPDataContainer<QCPGraphData>::remove(double sortKeyFrom, double sortKeyTo)
+{
+  if (sortKeyFrom >= sortKeyTo || isEmpty())
+    return;
+  
+  detach();
+  const int from = mHead+lowerBoundIndex(sortKeyFrom);
+  const int to = mHead+upperBoundIndex(sortKeyTo);
+  if (from < to)
+  {
+    mRevision = qcpNextDataRevision();
+    mKeys.remove(from, to-from);
+    mValues.remove(from, to-from);
+  }
+  if (mAutoSqueeze)
+    performAutoSqueeze();
+}
+
+/*! \overload
+
+  Removes a single data point at \a sortKey.
+*/
+void QCPDataContainer<QCPGraphData>::remove(double sortKey)
+{
+  detach();
+  const int index = mHead+lowerBoundIndex(sortKey);
+  if (index < mKeys.size() && mKeys.at(index) == sortKey)
+  {
+    if (index == mHead)
+    {
+      ++mHead;
+      ++mFrontRemoved;
+    } else
+    {
+      mKeys.remove(index);
+      mValues.remove(index);
+      mRevision = qcpNextDataRevision();
+    }
+  }
+  if (mAutoSqueeze)
+    performAutoSqueeze();
+}
+
+/*!
+  Removes all data points.
+*/
+void QCPDataContainer<QCPGraphData>::clear()
+{
+  mColumns.clear();
+  mChannel = 0;
+  mKeys.clear();
+  mValues.clear();
+  mHead = 0;
+  mPreallocIteration = 0;
+  mRevision = qcpNextDataRevision();
+  mFrontRemoved = 0;
+}
+
+/*!
+  Re-sorts all data points in the container by their key. This is only necessary after the keys
+  were modified through the non-const iterators, see \ref QCPDataContainer::sort.
+*/
+void QCPDataContainer<QCPGraphData>::sort()
+{
+  detach();
+  sortRange(mHead, int(mKeys.size()));
+  mRevision = qcpNextDataRevision();
+}
+
+/*!
+  Frees the unused memory in front of the head offset (\a preAllocation) and behind the last data
+  point (\a postAllocation).
+*/
+void QCPDataContainer<QCPGraphData>::squeeze(bool preAllocation, bool postAllocation)
+{
+  if (mColumns) // a view doesn't own any memory
+    return;
+  if (preAllocation)
+  {
+    if (mHead > 0)
+    {
+      const int n = size();
+      std::copy(mKeys.constBegin()+mHead, mKeys.constEnd(), mKeys.begin());
+      std::copy(mValues.constBegin()+mHead, mValues.constEnd(), mValues.begin());
+      mKeys.resize(n);
+      mValues.resize(n);
+      mHead = 0;
+    }
+    mPreallocIteration = 0;
+  }
+  if (postAllocation)
+  {
+    mKeys.squeeze();
+    mValues.squeeze();
+  }
+}
+
+/*!
+  \copydoc QCPDataContainer::findBegin
+*/
+QCPDataContainer<QCPGraphData>::const_iterator QCPDataContainer<QCPGraphData>::findBegin(double sortKey, bool expandedRange) const
+{
+  if (isEmpty())
+    return constEnd();
+  
+  int index = lowerBoundIndex(sortKey);
+  if (expandedRange && index > 0) // also covers index == end case, and we know end-1 is valid because the container isn't empty
+    --index;
+  return constBegin()+index;
+}
+
+/*!
+  \copydoc QCPDataContainer::findEnd
+*/
+QCPDataContainer<QCPGraphData>::const_iterator QCPDataContainer<QCPGraphData>::findEnd(double sortKey, bool expandedRange) const
+{
+  if (isEmpty())
+    return constEnd();
+  
+  int index = upperBoundIndex(sortKey);
+  if (expandedRange && index < size())
+    ++index;
+  return constBegin()+index;
+}
+
+/*!
+  \copydoc QCPDataContainer::keyRange
+*/
+QCPRange QCPDataContainer<QCPGraphData>::keyRange(bool &foundRange, QCP::SignDomain signDomain)
+{
+  QCPRange range;
+  bool haveLower = false;
+  bool haveUpper = false;
+  const double *keys = constKeyData();
+  const double *values = constValueData();
+  const int n = size();
+  if (signDomain == QCP::sdBoth) // keys are sorted, so find just first and last key with non-NaN value
+  {
+    for (int i=0; i<n; ++i)
+    {
+      if (!qIsNaN(values[i]))
+      {
+        range.lower = keys[i];
+        haveLower = true;
+        break;
+      }
+    }
+    for (int i=n-1; i>=0; --i)
+    {
+      if (!qIsNaN(values[i]))
+      {
+        range.upper = keys[i];
+        haveUpper = true;
+        break;
+      }
+    }
+  } else // range may only be in one sign domain
+  {
+    for (int i=0; i<n; ++i)
+    {
+      const double current = keys[i];
+      if (qIsNaN(values[i]) || (signDomain == QCP::sdNegative ? !(current < 0) : !(current > 0)))
+        continue;
+      if (current < range.lower || !haveLower)
+      {
+        range.lower = current;
+        haveLower = true;
+      }
+      if (current > range.upper || !haveUpper)
+      {
+        range.upper = current;
+        haveUpper = true;
+      }
+    }
+  }
+  
+  foundRange = haveLower && haveUpper;
+  return range;
+}
+
+/*!
+  \copydoc QCPDataContainer::valueRange
+
+  Only the value array is scanned, with SSE2/AVX min/max instructions where available.
+*/
+QCPRange QCPDataContainer<QCPGraphData>::valueRange(bool &foundRange, QCP::SignDomain signDomain, const QCPRange &inKeyRange)
+{
+  int from = 0;
+  int to = size();
+  if (inKeyRange != QCPRange()) // keys are sorted, so the key restriction is an index range
+  {
+    from = lowerBoundIndex(inKeyRange.lower);
+    to = qMax(from, upperBoundIndex(inKeyRange.upper));
+  }
+  double lower, upper;
+  foundRange = qcpFiniteMinMax(constValueData()+from, to-from, signDomain, &lower, &upper);
+  return foundRange ? QCPRange(lower, upper) : QCPRange();
+}
+
+/*!
+  \copydoc QCPDataContainer::limitIteratorsToDataRange
+*/
+void QCPDataContainer<QCPGraphData>::limitIteratorsToDataRange(const_iterator &begin, const_iterator &end, const QCPDataRange &dataRange) const
+{
+  QCPDataRange iteratorRange(int(begin-constBegin()), int(end-constBegin()));
+  iteratorRange = iteratorRange.bounded(dataRange.bounded(this->dataRange()));
+  begin = constBegin()+iteratorRange.begin();
+  end = constBegin()+iteratorRange.end();
+}
+
+/*! \internal
+
+  If this container is a view of a \ref QCPDataColumns channel, copies the current data of the
+  channel into the own arrays and releases the columns. Called by all methods that modify the data.
+*/
+void QCPDataContainer<QCPGraphData>::detach()
+{
+  if (!mColumns)
+    return;
+  const int n = mColumns->size();
+  const double *keys = mColumns->constKeyData();
+  const double *values = mColumns->constValueData(mChannel);
+  mKeys.resize(n);
+  mValues.resize(n);
+  std::copy(keys, keys+n, mKeys.begin());
+  std::copy(values, values+n, mValues.begin());
+  mColumns.clear();
+  mChannel = 0;
+  mHead = 0;
+  mPreallocIteration = 0;
+  mRevision = qcpNextDataRevision();
+  mFrontRemoved = 0;
+}
+
+/*! \internal
+
+  Returns the index of the first data point with a key that is not smaller than \a sortKey. Only
+  the key array is searched.
+*/
+int QCPDataContainer<QCPGraphData>::lowerBoundIndex(double sortKey) const
+{
+  const double *keys = constKeyData();
+  return int(std::lower_bound(keys, keys+size(), sortKey)-keys);
+}
+
+/*! \internal
+
+  Returns the index of the first data point with a key that is greater than \a sortKey. Only the
+  key array is searched.
+*/
+int QCPDataContainer<QCPGraphData>::upperBoundIndex(double sortKey) const
+{
+  const double *keys = constKeyData();
+  return int(std::upper_bound(keys, keys+size(), sortKey)-keys);
+}
+
+/*! \internal
+
+  Makes sure there is room for at least \a count data points in front of the head offset. Like the
+  preallocation of the generic container, the room grows by more than requested, depending on the
+  number of previous calls.
+*/
+void QCPDataContainer<QCPGraphData>::reserveFront(int count)
+{
+  if (count <= mHead)
+    return;
+  
+  int newHead = count;
+  newHead += (1u<<qBound(4, mPreallocIteration+4, 15)) - 12; // do 4 up to 32768-12 preallocation, doubling in each intermediate iteration
+  ++mPreallocIteration;
+  
+  const int sizeDifference = newHead-mHead;
+  const int oldLength = int(mKeys.size());
+  mKeys.resize(oldLength+sizeDifference);
+  mValues.resize(oldLength+sizeDifference);
+  std::copy_backward(mKeys.begin()+mHead, mKeys.begin()+oldLength, mKeys.end());
+  std::copy_backward(mValues.begin()+mHead, mValues.begin()+oldLength, mValues.end());
+  mHead = newHead;
+}
+
+/*! \internal
+
+  Adds \a count data points given by the arrays \a keys and \a values. If all keys are smaller than
+  or equal to the existing ones (and \a alreadySorted is true), they are written in front of the
+  head offset. Otherwise they are appended, sorted if \a alreadySorted is false, and merged with the
+  existing data if necessary.
+*/
+void QCPDataContainer<QCPGraphData>::appendSorted(const double *keys, const double *values, int count, bool alreadySorted)
+{
+  if (count <= 0)
+    return;
+  detach();
+  const int oldSize = size();
+  
+  if (alreadySorted && oldSize > 0 && !(mKeys.at(mHead) < keys[count-1])) // prepend if new data is sorted and keys are all smaller than or equal to existing ones
+  {
+    reserveFront(count);
+    mHead -= count;
+    std::copy(keys, keys+count, mKeys.begin()+mHead);
+    std::copy(values, values+count, mValues.begin()+mHead);
+    mRevision = qcpNextDataRevision();
+  } else // append and then sort and merge if necessary
+  {
+    const int oldLength = int(mKeys.size());
+    mKeys.resize(oldLength+count);
+    mValues.resize(oldLength+count);
+    std::copy(keys, keys+count, mKeys.begin()+oldLength);
+    std::copy(values, values+count, mValues.begin()+oldLength);
+    if (!alreadySorted) // sort appended subrange if it wasn't already sorted
+      sortRange(oldLength, oldLength+count);
+    if (oldSize > 0 && !(mKeys.at(oldLength-1) < mKeys.at(oldLength))) // if appended range keys aren't all greater than existing ones, merge the two partitions
+    {
+      mergeTail(count);
+      mRevision = qcpNextDataRevision();
+    }
+  }
+}
+
+/*! \internal
+
+  Sorts the data points with array indices \a from up to \a to (exclusive) by key. Key and value
+  arrays are permuted together through an index array.
+*/
+void QCPDataContainer<QCPGraphData>::sortRange(int from, int to)
+{
+  if (to-from < 2 || std::is_sorted(mKeys.constBegin()+from, mKeys.constBegin()+to))
+    return;
+  
+  const double *keys = mKeys.constData();
+  QVector<int> order(to-from);
+  for (int i=0; i<order.size(); ++i)
+    order[i] = from+i;
+  std::stable_sort(order.begin(), order.end(), [keys](int a, int b) { return keys[a] < keys[b]; });
+  QVector<double> sortedKeys(order.size()), sortedValues(order.size());
+  for (int i=0; i<order.size(); ++i)
+  {
+    sortedKeys[i] = mKeys.at(order.at(i));
+    sortedValues[i] = mValues.at(order.at(i));
+  }
+  std::copy(sortedKeys.constBegin(), sortedKeys.constEnd(), mKeys.begin()+from);
+  std::copy(sortedValues.constBegin(), sortedValues.constEnd(), mValues.begin()+from);
+}
+
+/*! \internal
+
+  Merges the last \a count data points, which must be sorted, into the sorted data points before
+  them. Only the part of the existing data with keys greater than the first new key takes part in
+  the merge. On equal keys, existing data points come first.
+*/
+void QCPDataContainer<QCPGraphData>::mergeTail(int count)
+{
+  const int end = int(mKeys.size());
+  const int middle = end-count;
+  const int from = int(std::upper_bound(mKeys.constBegin()+mHead, mKeys.constBegin()+middle, mKeys.at(middle))-mKeys.constBegin());
+  QVector<double> mergedKeys(end-from), mergedValues(end-from);
+  int left = from, right = middle;
+  for (int i=0; i<mergedKeys.size(); ++i)
+  {
+    if (right >= end || (left < middle && !(mKeys.at(right) < mKeys.at(left))))
+    {
+      mergedKeys[i] = mKeys.at(left);
+      mergedValues[i] = mValues.at(left);
+      ++left;
+    } else
+    {
+      mergedKeys[i] = mKeys.at(right);
+      mergedValues[i] = mValues.at(right);
+      ++right;
+    }
+  }
+  std::copy(mergedKeys.constBegin(), mergedKeys.constEnd(), mKeys.begin()+from);
+  std::copy(mergedValues.constBegin(), mergedValues.constEnd(), mValues.begin()+from);
+}
+
+/*! \internal
+
+  Compacts the arrays once the removed part in front of the head offset is at least as large as the
+  remaining data (and not tiny), so each removed data point is moved at most once on average. Also
+  releases post-allocated memory with the same thresholds as the generic container.
+*/
+void QCPDataContainer<QCPGraphData>::performAutoSqueeze()
+{
+  if (mColumns)
+    return;
+  const int totalAlloc = int(mKeys.capacity());
+  const int postAllocSize = totalAlloc-int(mKeys.size());
+  const int usedSize = size();
+  bool shrinkPostAllocation = false;
+  const bool shrinkPreAllocation = mHead > 1000 && mHead >= usedSize;
+  if (totalAlloc > 650000) // if allocation is larger, shrink earlier with respect to total used size
+    shrinkPostAllocation = postAllocSize > usedSize*1.5; // QVector grow strategy is 2^n for static data. Watch out not to oscillate!
+  else if (totalAlloc > 1000) // below 1k points don't even bother
+    shrinkPostAllocation = postAllocSize > usedSize*5;
+  
+  if (shrinkPreAllocation || shrinkPostAllocation)
+    squeeze(shrinkPreAllocation, shrinkPostAllocation);
+}
+#endif // QCP_SOA_GRAPH_DATA
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////// QCPGraphLod
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! \class QCPGraphLod
+  \brief Multi-resolution min/max index over the data of a QCPGraph
+
+  The index consists of levels of buckets. A bucket on level \a n summarizes \ref bucketSize "2^(3+n)"
+  consecutive data points by their minimum and maximum value (and the keys at which they occur).
+  Buckets are aligned to absolute data indices, so points appended at the end of the container only
+  complete new buckets at the tail of each level, and points removed from the front (e.g. by \ref
+  QCPDataContainer::removeBefore) only drop buckets at the head. \ref sync uses \ref
+  QCPDataContainer::revision and \ref QCPDataContainer::frontRemovedCount to perform exactly those
+  incremental updates, and rebuilds the index only after other kinds of modifications.
+
+  QCPGraph uses this index in \ref QCPGraph::getOptimizedLineData when adaptive sampling is enabled
+  and the visible range is dense enough. It picks the coarsest level that still yields at least two
+  buckets per pixel, so the rendering cost depends on the pixel width of the axis rect rather than
+  on the number of visible data points.
+
+  Since the buckets only contain real data points, the resulting line data has the same envelope as
+  the full data set.
+*/
+
+/*!
+  Constructs an empty index. Call \ref sync to build it.
+*/
+QCPGraphLod::QCPGraphLod() :
+  mValid(false),
+  mRevision(0),
+  mFrontRemoved(0)
+{
+}
+
+/*!
+  Releases all levels. The next call to \ref sync rebuilds the index.
+*/
+void QCPGraphLod::clear()
+{
+  mLevels.clear();
+  mValid = false;
+}
+
+/*!
+  Brings the index up to date with \a data. Points appended at the end and points removed from the
+  front since the last call are processed incrementally. Any other modification causes a full
+  rebuild.
+*/
+void QCPGraphLod::sync(const QCPGraphDataContainer &data)
+{
+  const qint64 absoluteEnd = data.frontRemovedCount()+data.size();
+  if (!mValid || data.revision() != mRevision || data.frontRemovedCount() < mFrontRemoved ||
+      (!mLevels.isEmpty() && absoluteEnd < mLevels.first().end()*bucketSize(0)))
+  {
+    mLevels.clear();
+    mRevision = data.revision();
+    mFrontRemoved = data.frontRemovedCount();
+    mValid = true;
+  } else if (data.frontRemovedCount() > mFrontRemoved)
+  {
+    mFrontRemoved = data.frontRemovedCount();
+    trimFront(mFrontRemoved);
+  }
+  appendBuckets(data);
+}
+
+/*!
+  Returns the coarsest level that still provides at least two buckets per pixel when \a dataCount
+  points span \a keyPixelSpan pixels, or -1 if even the finest level is too coarse.
+*/
+int QCPGraphLod::levelFor(int dataCount, double keyPixelSpan) const
+{
+  const double minBuckets = 2.0*qMax(1.0, keyPixelSpan);
+  int level = -1;
+  while (level+1 < mLevels.size() && dataCount/double(bucketSize(level+1)) >= minBuckets)
+    ++level;
+  return level;
+}
+
+/*!
+  Appends the line data for the data points with indices \a beginIndex up to \a endIndex
+  (exclusive) of \a data to \a lineData, using buckets up to level \a maxLevel. Each bucket yields
+  its minimum and maximum point in key order. Parts of the range not covered by complete buckets
+  (edges, and the not yet completed bucket at the tail) are filled with the finer levels and
+  finally with the raw data points.
+
+  \ref sync must have been called with the same \a data before.
+*/
+void QCPGraphLod::collect(QVector<QCPGraphData> *lineData, const QCPGraphDataContainer &data, int beginIndex, int endIndex, int maxLevel) const
+{
+  if (!lineData) return;
+  maxLevel = qMin(maxLevel, int(mLevels.size())-1);
+  const QCPGraphDataContainer::const_iterator dataBegin = data.constBegin();
+  const qint64 end = mFrontRemoved+endIndex;
+  qint64 pos = mFrontRemoved+beginIndex;
+  lineData->reserve(lineData->size()+int(2*(end-pos)/bucketSize(qMax(0, maxLevel)))+4*bucketSize(0));
+  while (pos < end)
+  {
+    bool found = false;
+    for (int level=maxLevel; level>=0; --level)
+    {
+      const qint64 size = bucketSize(level);
+      if ((pos & (size-1)) != 0 || pos+size > end)
+        continue;
+      const Level &lev = mLevels.at(level);
+      const qint64 index = pos >> (baseShift+level);
+      if (index < lev.first || index >= lev.end())
+        continue;
+      const Bucket &bucket = lev.buckets.at(lev.head+int(index-lev.first));
+      if (bucket.minKey < bucket.maxKey)
+      {
+        lineData->append(QCPGraphData(bucket.minKey, bucket.minValue));
+        lineData->append(QCPGraphData(bucket.maxKey, bucket.maxValue));
+      } else if (bucket.minKey > bucket.maxKey)
+      {
+        lineData->append(QCPGraphData(bucket.maxKey, bucket.maxValue));
+        lineData->append(QCPGraphData(bucket.minKey, bucket.minValue));
+      } else
+        lineData->append(QCPGraphData(bucket.minKey, bucket.minValue));
+      if (bucket.hasNaN) // keep gaps in the data visible as gaps in the line
+        lineData->append(QCPGraphData(qMax(bucket.minKey, bucket.maxKey), qQNaN()));
+      pos += size;
+      found = true;
+      break;
+    }
+    if (!found)
+    {
+      lineData->append(*(dataBegin+int(pos-mFrontRemoved)));
+      ++pos;
+    }
+  }
+}
+
+/*! \internal
+
+  Drops all buckets that contain data points before the absolute index \a absoluteBegin.
+*/
+void QCPGraphLod::trimFront(qint64 absoluteBegin)
+{
+  for (int level=0; level<mLevels.size(); ++level)
+  {
+    Level &lev = mLevels[level];
+    const qint64 size = bucketSize(level);
+    const qint64 newFirst = (absoluteBegin+size-1)/size;
+    if (newFirst <= lev.first)
+      continue;
+    lev.head += int(qMin(newFirst-lev.first, qint64(lev.buckets.size()-lev.head)));
+    lev.first = newFirst;
+    if (lev.head == lev.buckets.size())
+    {
+      lev.buckets.clear();
+      lev.head = 0;
+    } else if (lev.head > 1024 && lev.head*2 > lev.buckets.size()) // compact only occasionally, so trimming stays amortized O(1)
+    {
+      lev.buckets.remove(0, lev.head);
+      lev.head = 0;
+    }
+  }
+}
+
+/*! \internal
+
+  Completes all buckets that became complete since the last call, level by level, and adds new
+  levels while the topmost level has at least two buckets.
+*/
+void QCPGraphLod::appendBuckets(const QCPGraphDataContainer &data)
+{
+  const qint64 absoluteEnd = mFrontRemoved+data.size();
+  const QCPGraphDataContainer::const_iterator dataBegin = data.constBegin();
+  if (mLevels.isEmpty())
+  {
+    Level lev;
+    lev.head = 0;
+    lev.first = (mFrontRemoved+bucketSize(0)-1)/bucketSize(0);
+    mLevels.append(lev);
+  }
+  
+  // level 0 from the raw data:
+  Level &base = mLevels[0];
+  for (qint64 index=base.end(); (index+1)*bucketSize(0) <= absoluteEnd; ++index)
+  {
+    const int first = int(index*bucketSize(0)-mFrontRemoved);
+    base.buckets.append(bucketFromData(dataBegin+first, dataBegin+first+bucketSize(0)));
+  }
+  
+  // higher levels from pairs of buckets of the level below:
+  for (int level=1; mLevels.at(level-1).end()-mLevels.at(level-1).first >= 2 || level < mLevels.size(); ++level)
+  {
+    if (level == mLevels.size())
+    {
+      Level lev;
+      lev.head = 0;
+      lev.first = (mLevels.at(level-1).first+1)/2;
+      mLevels.append(lev);
+    }
+    const Level &below = mLevels.at(level-1);
+    Level &lev = mLevels[level];
+    for (qint64 index=lev.end(); 2*index+1 < below.end(); ++index)
+    {
+      const int child = below.head+int(2*index-below.first);
+      lev.buckets.append(mergeBuckets(below.buckets.at(child), below.buckets.at(child+1)));
+    }
+  }
+}
+
+/*! \internal
+
+  Returns the bucket summarizing the data points from \a begin up to \a end (exclusive).
+*/
+QCPGraphLod::Bucket QCPGraphLod::bucketFromData(QCPGraphDataContainer::const_iterator begin, QCPGraphDataContainer::const_iterator end)
+{
+  Bucket result;
+  result.minKey = result.maxKey = begin->key;
+  result.minValue = result.maxValue = qQNaN();
+  result.hasNaN = false;
+  for (QCPGraphDataContainer::const_iterator it=begin; it!=end; ++it)
+  {
+    if (qIsNaN(it->value))
+    {
+      result.hasNaN = true;
+      continue;
+    }
+    if (qIsNaN(result.minValue) || it->value < result.minValue)
+    {
+      result.minValue = it->value;
+      result.minKey = it->key;
+    }
+    if (qIsNaN(result.maxValue) || it->value > result.maxValue)
+    {
+      result.maxValue = it->value;
+      result.maxKey = it->key;
+    }
+  }
+  return result;
+}
+
+/*! \internal
+
+  Returns the bucket summarizing the two adjacent buckets \a a and \a b.
+*/
+QCPGraphLod::Bucket QCPGraphLod::mergeBuckets(const Bucket &a, const Bucket &b)
+{
+  Bucket result = a;
+  result.hasNaN = a.hasNaN || b.hasNaN;
+  if (qIsNaN(result.minValue) || b.minValue < result.minValue)
+  {
+    result.minValue = b.minValue;
+    result.minKey = b.minKey;
+  }
+  if (qIsNaN(result.maxValue) || b.maxValue > result.maxValue)
+  {
+    result.maxValue = b.maxValue;
+    result.maxKey = b.maxKey;
+  }
+  return result;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////// QCPGraph
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! \class QCPGraph
+  \brief A plottable representing a graph in a plot.
+
+  \image html QCPGraph.png
+  
+  Usually you create new graphs by calling QCustomPlot::addGraph. The resulting instance can be
+  accessed via QCustomPlot::graph.
+
+  To plot data, assign it with the \ref setData or \ref addData functions. Alternatively, you can
+  also access and modify the data via the \ref data method, which returns a pointer to the internal
+  \ref QCPGraphDataContainer.
+  
+  Graphs are used to display single-valued data. Single-valued means that there should only be one
+  data point per unique key coordinate. In other words, the graph can't have \a loops. If you do
+  want to plot non-single-valued curves, rather use the QCPCurve plottable.
+  
   Gaps in the graph line can be created by adding data points with NaN as value
   (<tt>qQNaN()</tt> or <tt>std::numeric_limits<double>::quiet_NaN()</tt>) in between the two data points that shall be
   separated.
@@ -21054,6 +22788,9 @@ void QCPGraph::addData(const QVector<double> &keys, const QVector<double> &value
 {
   if (keys.size() != values.size())
     qDebug() << Q_FUNC_INFO << "keys and values have different sizes:" << keys.size() << values.size();
+#ifdef QCP_SOA_GRAPH_DATA
+  mDataContainer->add(keys, values, alreadySorted); // struct-of-arrays container copies the arrays directly
+#else
   const int n = qMin(keys.size(), values.size());
   QVector<QCPGraphData> tempData(n);
   QVector<QCPGraphData>::iterator it = tempData.begin();
@@ -21067,6 +22804,7 @@ void QCPGraph::addData(const QVector<double> &keys, const QVector<double> &value
     ++i;
   }
   mDataContainer->add(tempData, alreadySorted); // don't modify tempData beyond this to prevent copy on write
+#endif
 }
 
 /*! \overload
@@ -21350,6 +23088,15 @@ QVector<QPointF> QCPGraph::dataToLines(const QVector<QCPGraphData> &data) const
 
   result.resize(data.size());
   
+  // both axes linear: transform all points in one pass with the batched kernel
+  double keyScale, keyOffset, valueScale, valueOffset;
+  if (keyAxis->linearPixelTransform(&keyScale, &keyOffset) && valueAxis->linearPixelTransform(&valueScale, &valueOffset))
+  {
+    qcpLinearDataToPixels(data.constData(), int(data.size()), keyScale, keyOffset, valueScale, valueOffset,
+                          keyAxis->orientation() == Qt::Vertical, result.data());
+    return result;
+  }
+  
   // transform data points to pixels:
   if (keyAxis->orientation() == Qt::Vertical)
   {
@@ -21691,6 +23438,10 @@ void QCPGraph::drawImpulsePlot(QCPPainter *painter, const QVector<QPointF> &line
 
   This method is used by \ref getLines to retrieve the basic working set of data.
 
+  For large data sets on a linear key axis, adaptive sampling uses the min/max buckets of a \ref
+  QCPGraphLod instead of visiting every visible data point, so the cost is proportional to the
+  pixel width of the key axis.
+
   \see getOptimizedScatterData
 */
 void QCPGraph::getOptimizedLineData(QVector<QCPGraphData> *lineData, const QCPGraphDataContainer::const_iterator &begin, const QCPGraphDataContainer::const_iterator &end) const
@@ -21710,6 +23461,20 @@ void QCPGraph::getOptimizedLineData(QVector<QCPGraphData> *lineData, const QCPGr
       maxCount = int(2*keyPixelSpan+2);
   }
   
+  if (mAdaptiveSampling && mDataContainer->size() >= QCPGraphLod::minimumDataCount && keyAxis->scaleType() == QCPAxis::stLinear && dataCount >= maxCount)
+  {
+    // dense data: take the min/max buckets of the level-of-detail index instead of walking every point
+    mLod.sync(*mDataContainer);
+    const int level = mLod.levelFor(dataCount, (maxCount-2)/2.0);
+    if (level >= 0)
+    {
+      const QCPGraphDataContainer::const_iterator dataBegin = mDataContainer->constBegin();
+      mLod.collect(lineData, *mDataContainer, int(begin-dataBegin), int(end-dataBegin), level);
+      return;
+    }
+  } else if (mLod.levelCount() > 0 && mDataContainer->size() < QCPGraphLod::minimumDataCount)
+    mLod.clear();
+  
   if (mAdaptiveSampling && dataCount >= maxCount) // use adaptive sampling only if there are at least two points per pixel on average
   {
     QCPGraphDataContainer::const_iterator it = begin;
@@ -25853,7 +27618,10 @@ QCPColorMapData::QCPColorMapData(int keySize, int valueSize, const QCPRange &key
   mIsEmpty(true),
   mData(nullptr),
   mAlpha(nullptr),
-  mDataModified(true)
+  mDataModified(true),
+  mModifiedKeyBegin(0),
+  mModifiedKeyEnd(0),
+  mShiftedKeyCells(0)
 {
   setSize(keySize, valueSize);
   fill(0);
@@ -25874,7 +27642,10 @@ QCPColorMapData::QCPColorMapData(const QCPColorMapData &other) :
   mIsEmpty(true),
   mData(nullptr),
   mAlpha(nullptr),
-  mDataModified(true)
+  mDataModified(true),
+  mModifiedKeyBegin(0),
+  mModifiedKeyEnd(0),
+  mShiftedKeyCells(0)
 {
   *this = other;
 }
@@ -26085,7 +27856,7 @@ void QCPColorMapData::setData(double key, double value, double z)
       mDataBounds.lower = z;
     if (z > mDataBounds.upper)
       mDataBounds.upper = z;
-     mDataModified = true;
+    markKeysModified(keyCell, keyCell+1);
   }
 }
 
@@ -26109,7 +27880,7 @@ void QCPColorMapData::setCell(int keyIndex, int valueIndex, double z)
       mDataBounds.lower = z;
     if (z > mDataBounds.upper)
       mDataBounds.upper = z;
-     mDataModified = true;
+    markKeysModified(keyIndex, keyIndex+1);
   } else
     qDebug() << Q_FUNC_INFO << "index out of bounds:" << keyIndex << valueIndex;
 }
@@ -26136,7 +27907,7 @@ void QCPColorMapData::setAlpha(int keyIndex, int valueIndex, unsigned char alpha
     if (mAlpha || createAlpha())
     {
       mAlpha[valueIndex*mKeySize + keyIndex] = alpha;
-      mDataModified = true;
+      markKeysModified(keyIndex, keyIndex+1);
     }
   } else
     qDebug() << Q_FUNC_INFO << "index out of bounds:" << keyIndex << valueIndex;
@@ -26203,7 +27974,7 @@ void QCPColorMapData::clearAlpha()
 void QCPColorMapData::fill(double z)
 {
   const int dataCount = mValueSize*mKeySize;
-  memset(mData, z, dataCount*sizeof(*mData));
+  std::fill(mData, mData+dataCount, z);
   mDataBounds = QCPRange(z, z);
   mDataModified = true;
 }
@@ -26227,6 +27998,80 @@ void QCPColorMapData::fillAlpha(unsigned char alpha)
   }
 }
 
+/*!
+  Moves the cells by \a cellCount key indices towards lower key indices and shifts the key range
+  (\ref setKeyRange) by the same number of cells, so each remaining cell keeps its key coordinate.
+  The \a cellCount cells that move out at the lower key end are discarded, and the cells that are
+  freed at the upper key end are set to zero (and full opacity, if an alpha map exists). A negative
+  \a cellCount shifts in the other direction.
+  
+  This is intended for color maps where the key axis is time and new columns of cells are appended
+  continuously, e.g. a spectrogram or a heatmap of the last hours: Instead of rebuilding the whole
+  map for each new column, shift it by one cell and set the new column with \ref setCell. The
+  color map then only has to move the already colorized pixels of its map image and colorize the
+  new column, instead of the full map (see \ref QCPColorMap::draw).
+  
+  The buffered data bounds are not reduced by the discarded cells, call \ref recalculateDataBounds
+  if necessary.
+*/
+void QCPColorMapData::shiftKeys(int cellCount)
+{
+  if (cellCount == 0 || isEmpty())
+    return;
+  
+  if (mKeySize > 1)
+    mKeyRange += cellCount*mKeyRange.size()/double(mKeySize-1);
+  else
+    mKeyRange += cellCount;
+  
+  const int keep = qMax(0, mKeySize-qAbs(cellCount));
+  const int freedBegin = cellCount > 0 ? keep : 0; // key index range of cells that become free
+  const int freedEnd = cellCount > 0 ? mKeySize : mKeySize-keep;
+  for (int valueIndex=0; valueIndex<mValueSize; ++valueIndex)
+  {
+    double *line = mData+valueIndex*mKeySize;
+    if (keep > 0)
+    {
+      if (cellCount > 0)
+        memmove(line, line+cellCount, sizeof(*line)*size_t(keep));
+      else
+        memmove(line-cellCount, line, sizeof(*line)*size_t(keep));
+    }
+    std::fill(line+freedBegin, line+freedEnd, 0.0);
+    if (mAlpha)
+    {
+      unsigned char *alphaLine = mAlpha+valueIndex*mKeySize;
+      if (keep > 0)
+      {
+        if (cellCount > 0)
+          memmove(alphaLine, alphaLine+cellCount, size_t(keep));
+        else
+          memmove(alphaLine-cellCount, alphaLine, size_t(keep));
+      }
+      memset(alphaLine+freedBegin, 255, size_t(freedEnd-freedBegin));
+    }
+  }
+  if (mDataBounds.lower > 0)
+    mDataBounds.lower = 0;
+  if (mDataBounds.upper < 0)
+    mDataBounds.upper = 0;
+  
+  if (keep == 0 || qAbs(mShiftedKeyCells+cellCount) >= mKeySize)
+  {
+    mDataModified = true;
+  } else if (!mDataModified)
+  {
+    // move the already modified key range along with the data, then add the freed cells:
+    mShiftedKeyCells += cellCount;
+    if (mModifiedKeyBegin < mModifiedKeyEnd)
+    {
+      mModifiedKeyBegin = qBound(0, mModifiedKeyBegin-cellCount, mKeySize);
+      mModifiedKeyEnd = qBound(0, mModifiedKeyEnd-cellCount, mKeySize);
+    }
+    markKeysModified(freedBegin, freedEnd);
+  }
+}
+
 /*!
   Transforms plot coordinates given by \a key and \a value to cell indices of this QCPColorMapData
   instance. The resulting cell indices are returned via the output parameters \a keyIndex and \a
@@ -26313,6 +28158,39 @@ bool QCPColorMapData::createAlpha(bool initializeOpaque)
   }
 }
 
+/*! \internal
+
+  Records that the cells with key indices from \a begin up to (excluding) \a end have changed, so
+  the next map image update only needs to colorize these columns of cells (see \ref
+  QCPColorMap::updateMapImageKeys).
+*/
+void QCPColorMapData::markKeysModified(int begin, int end)
+{
+  if (mDataModified || begin >= end)
+    return;
+  if (mModifiedKeyBegin < mModifiedKeyEnd)
+  {
+    mModifiedKeyBegin = qMin(mModifiedKeyBegin, begin);
+    mModifiedKeyEnd = qMax(mModifiedKeyEnd, end);
+  } else
+  {
+    mModifiedKeyBegin = begin;
+    mModifiedKeyEnd = end;
+  }
+}
+
+/*! \internal
+
+  Called by QCPColorMap after the map image was brought up to date with the data.
+*/
+void QCPColorMapData::resetModified()
+{
+  mDataModified = false;
+  mModifiedKeyBegin = 0;
+  mModifiedKeyEnd = 0;
+  mShiftedKeyCells = 0;
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////// QCPColorMap
@@ -26824,10 +28702,93 @@ void QCPColorMap::updateMapImage()
         mMapImage = mUndersampledMapImage.scaled(valueSize*valueOversamplingFactor, keySize*keyOversamplingFactor, Qt::IgnoreAspectRatio, Qt::FastTransformation);
     }
   }
-  mMapData->mDataModified = false;
+  mMapData->resetModified();
   mMapImageInvalidated = false;
 }
 
+/*! \internal
+  
+  Brings the map image up to date with changes of the color map data that only concern some key
+  indices: Pixels are moved by the number of cells the data was shifted by (\ref
+  QCPColorMapData::shiftKeys), and only the columns of modified cells (e.g. by \ref
+  QCPColorMapData::setCell) are colorized again. For large maps that grow by one column at a time,
+  this is much cheaper than \ref updateMapImage.
+  
+  This is only possible if the map image has one pixel per cell, i.e. isn't oversampled. Returns
+  false if the map image can't be updated partially, in which case \ref updateMapImage must be
+  called.
+*/
+bool QCPColorMap::updateMapImageKeys()
+{
+  QCPAxis *keyAxis = mKeyAxis.data();
+  if (!keyAxis) return false;
+  
+  const int keySize = mMapData->keySize();
+  const int valueSize = mMapData->valueSize();
+  const bool keyHorizontal = keyAxis->orientation() == Qt::Horizontal;
+  if (!mUndersampledMapImage.isNull() || mMapImage.isNull() || mMapImage.size() != (keyHorizontal ? QSize(keySize, valueSize) : QSize(valueSize, keySize)))
+    return false;
+  
+  // move the pixels along with the data:
+  const int shift = mMapData->mShiftedKeyCells;
+  if (shift != 0)
+  {
+    const int keep = keySize-qAbs(shift);
+    if (keyHorizontal)
+    {
+      for (int line=0; line<valueSize; ++line)
+      {
+        QRgb* pixels = reinterpret_cast<QRgb*>(mMapImage.scanLine(line));
+        if (shift > 0)
+          memmove(pixels, pixels+shift, sizeof(QRgb)*size_t(keep));
+        else
+          memmove(pixels-shift, pixels, sizeof(QRgb)*size_t(keep));
+      }
+    } else // key index i is on scanline keySize-1-i, so shifting towards lower key indices moves scanlines towards the bottom of the image
+    {
+      const size_t bytesPerLine = size_t(mMapImage.bytesPerLine());
+      uchar *bits = mMapImage.bits();
+      if (shift > 0)
+        memmove(bits+size_t(shift)*bytesPerLine, bits, size_t(keep)*bytesPerLine);
+      else
+        memmove(bits, bits+size_t(-shift)*bytesPerLine, size_t(keep)*bytesPerLine);
+    }
+  }
+  
+  // colorize the modified columns of cells:
+  const int begin = mMapData->mModifiedKeyBegin;
+  const int end = mMapData->mModifiedKeyEnd;
+  if (begin < end)
+  {
+    const double *rawData = mMapData->mData;
+    const unsigned char *rawAlpha = mMapData->mAlpha;
+    const bool logarithmic = mDataScaleType==QCPAxis::stLogarithmic;
+    if (keyHorizontal)
+    {
+      for (int line=0; line<valueSize; ++line)
+      {
+        QRgb* pixels = reinterpret_cast<QRgb*>(mMapImage.scanLine(valueSize-1-line))+begin;
+        if (rawAlpha)
+          mGradient.colorize(rawData+line*keySize+begin, rawAlpha+line*keySize+begin, mDataRange, pixels, end-begin, 1, logarithmic);
+        else
+          mGradient.colorize(rawData+line*keySize+begin, mDataRange, pixels, end-begin, 1, logarithmic);
+      }
+    } else
+    {
+      for (int line=begin; line<end; ++line)
+      {
+        QRgb* pixels = reinterpret_cast<QRgb*>(mMapImage.scanLine(keySize-1-line));
+        if (rawAlpha)
+          mGradient.colorize(rawData+line, rawAlpha+line, mDataRange, pixels, valueSize, keySize, logarithmic);
+        else
+          mGradient.colorize(rawData+line, mDataRange, pixels, valueSize, keySize, logarithmic);
+      }
+    }
+  }
+  mMapData->resetModified();
+  return true;
+}
+
 /* inherits documentation from base class */
 void QCPColorMap::draw(QCPPainter *painter)
 {
@@ -26837,6 +28798,11 @@ void QCPColorMap::draw(QCPPainter *painter)
   
   if (mMapData->mDataModified || mMapImageInvalidated)
     updateMapImage();
+  else if (mMapData->mShiftedKeyCells != 0 || mMapData->mModifiedKeyBegin < mMapData->mModifiedKeyEnd)
+  {
+    if (!updateMapImageKeys()) // map image is oversampled, can't update only the modified cells
+      updateMapImage();
+  }
   
   // use buffer if painting vectorized (PDF):
   const bool useBuffer = painter->modes().testFlag(QCPPainter::pmVectorized);
@@ -47,11 +47,24 @@
 #  endif
 #endif
 
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+#  define QCP_THREADED_RASTER_SUPPORTED
+#endif
+
+#ifdef QCUSTOMPLOT_USE_SOA_GRAPHDATA
+#  define QCP_SOA_GRAPH_DATA
+#endif
+
 #include <QtCore/QObject>
 #include <QtCore/QPointer>
 #include <QtCore/QSharedPointer>
 #include <QtCore/QTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
 #include <QtGui/QPainter>
+#include <QtGui/QPicture>
+#include <QtGui/QImage>
 #include <QtGui/QPainterPath>
 #include <QtGui/QPaintEvent>
 #include <QtGui/QMouseEvent>
@@ -69,6 +82,7 @@
 #include <qmath.h>
 #include <limits>
 #include <algorithm>
+#include <iterator>
 #ifdef QCP_OPENGL_FBO
 #  include <QtGui/QOpenGLContext>
 #  if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
@@ -626,6 +640,66 @@ protected:
 };
 
 
+#ifdef QCP_THREADED_RASTER_SUPPORTED
+class QCP_LIB_DECL QCPPaintBufferImage : public QCPAbstractPaintBuffer
+{
+public:
+  /*! \internal
+    Shared between a paint buffer and its rasterization jobs, so jobs may outlive the buffer.
+  */
+  struct Frame
+  {
+    Frame() : shownGeneration(0), submittedGeneration(0) {}
+    QMutex mutex;
+    QImage image;                   // guarded by mutex
+    QMap<quint64, QImage> staged;   // finished images by generation, waiting for their batch; guarded by mutex
+    quint64 shownGeneration;        // guarded by mutex
+    QAtomicInteger<quint64> submittedGeneration;
+    bool promote(quint64 generation);
+  };
+  
+  /*! \internal
+    Groups the rasterization jobs of one replot, so their images are shown together.
+  */
+  struct Batch
+  {
+    Batch(QWidget *target, quint64 replotCount) : pending(1), target(target), replotCount(replotCount) {}
+    QAtomicInt pending; // jobs still running, plus one until the replot has submitted all layers
+    QList<QPair<QSharedPointer<Frame>, quint64> > frames; // frame and generation submitted in this batch; only modified on the GUI thread before the batch is sealed
+    QPointer<QWidget> target;
+    quint64 replotCount; // QCustomPlot::replotCount of the replot this batch belongs to
+    void finishOne(const QSharedPointer<Batch> &self);
+    static void seal(const QSharedPointer<Batch> &batch);
+  };
+  
+  explicit QCPPaintBufferImage(const QSize &size, double devicePixelRatio, QThreadPool *threadPool, QWidget *target);
+  virtual ~QCPPaintBufferImage() Q_DECL_OVERRIDE;
+  
+  // setters:
+  void setBatch(const QSharedPointer<Batch> &batch) { mBatch = batch; }
+  
+  // reimplemented virtual methods:
+  virtual QCPPainter *startPainting() Q_DECL_OVERRIDE;
+  virtual void donePainting() Q_DECL_OVERRIDE;
+  virtual void draw(QCPPainter *painter) const Q_DECL_OVERRIDE;
+  void clear(const QColor &color) Q_DECL_OVERRIDE;
+  
+protected:
+  // non-property members:
+  QPicture mPicture;
+  QColor mClearColor;
+  quint64 mGeneration;
+  QThreadPool *mThreadPool;
+  QPointer<QWidget> mTarget;
+  QSharedPointer<Frame> mFrame;
+  QSharedPointer<Batch> mBatch;
+  
+  // reimplemented virtual methods:
+  virtual void reallocateBuffer() Q_DECL_OVERRIDE;
+};
+#endif // QCP_THREADED_RASTER_SUPPORTED
+
+
 #ifdef QCP_OPENGL_PBUFFER
 class QCP_LIB_DECL QCPPaintBufferGlPbuffer : public QCPAbstractPaintBuffer
 {
@@ -1820,6 +1894,9 @@ public:
   static double dateTimeToKey(const QDateTime &dateTime);
   static double dateTimeToKey(const QDate &date, Qt::TimeSpec timeSpec=Qt::LocalTime);
   
+  // reimplemented virtual methods:
+  virtual void generate(const QCPRange &range, const QLocale &locale, QChar formatChar, int precision, QVector<double> &ticks, QVector<double> *subTicks, QVector<QString> *tickLabels) Q_DECL_OVERRIDE;
+  
 protected:
   // property members:
   QString mDateTimeFormat;
@@ -1829,12 +1906,29 @@ protected:
 # endif
   // non-property members:
   enum DateStrategy {dsNone, dsUniformTimeInDay, dsUniformDayInMonth} mDateStrategy;
+  // caches for consecutive generate calls (see \ref generate):
+  bool mCachedResultValid, mCachedHasSubTicks, mCachedHasLabels;
+  QCPRange mCachedRange;
+  QLocale mCachedLocale;
+  int mCachedTickCount;
+  double mCachedTickOrigin;
+  TickStepStrategy mCachedTickStepStrategy;
+  QVector<double> mCachedTicks, mCachedSubTicks;
+  QVector<QString> mCachedTickLabels;
+  double mTickPositionCacheStep, mTickPositionCacheOrigin;
+  DateStrategy mTickPositionCacheStrategy;
+  QHash<double, double> mTickPositionCache;
+  QLocale mLabelCacheLocale;
+  QHash<double, QString> mLabelCache;
   
   // reimplemented virtual methods:
   virtual double getTickStep(const QCPRange &range) Q_DECL_OVERRIDE;
   virtual int getSubTickCount(double tickStep) Q_DECL_OVERRIDE;
   virtual QString getTickLabel(double tick, const QLocale &locale, QChar formatChar, int precision) Q_DECL_OVERRIDE;
   virtual QVector<double> createTickVector(double tickStep, const QCPRange &range) Q_DECL_OVERRIDE;
+  
+  // non-virtual methods:
+  void clearCaches();
 };
 
 /* end of 'src/axis/axistickerdatetime.h' */
@@ -2315,6 +2409,7 @@ public:
   void rescale(bool onlyVisiblePlottables=false);
   double pixelToCoord(double value) const;
   double coordToPixel(double value) const;
+  bool linearPixelTransform(double *scale, double *offset) const;
   SelectablePart getPartAt(const QPointF &pos) const;
   QList<QCPAbstractPlottable*> plottables() const;
   QList<QCPGraph*> graphs() const;
@@ -2431,7 +2526,9 @@ public:
   virtual void draw(QCPPainter *painter);
   virtual int size();
   void clearCache();
+  QSize maxTickLabelSize(const QVector<QString> &labels) const;
   
+  QSize tickLabelsSize() const { return mTickLabelsSize; }
   QRect axisSelectionBox() const { return mAxisSelectionBox; }
   QRect tickLabelsSelectionBox() const { return mTickLabelsSelectionBox; }
   QRect labelSelectionBox() const { return mLabelSelectionBox; }
@@ -2477,6 +2574,7 @@ protected:
   QCustomPlot *mParentPlot;
   QByteArray mLabelParameterHash; // to determine whether mLabelCache needs to be cleared due to changed parameters
   QCache<QString, CachedLabel> mLabelCache;
+  QSize mTickLabelsSize; // size of the largest tick label as determined by the last call to size()
   QRect mAxisSelectionBox, mTickLabelsSelectionBox, mLabelSelectionBox;
   
   virtual QByteArray generateLabelParameterHash() const;
@@ -2609,6 +2707,8 @@ Q_DECLARE_METATYPE(QCPScatterStyle::ScatterShape)
 template <class DataType>
 inline bool qcpLessThanSortKey(const DataType &a, const DataType &b) { return a.sortKey() < b.sortKey(); }
 
+QCP_LIB_DECL quint64 qcpNextDataRevision();
+
 template <class DataType>
 class QCPDataContainer // no QCP_LIB_DECL, template class ends up in header (cpp included below)
 {
@@ -2622,6 +2722,8 @@ public:
   int size() const { return mData.size()-mPreallocSize; }
   bool isEmpty() const { return size() == 0; }
   bool autoSqueeze() const { return mAutoSqueeze; }
+  quint64 revision() const { return mRevision; }
+  qint64 frontRemovedCount() const { return mFrontRemoved; }
   
   // setters:
   void setAutoSqueeze(bool enabled);
@@ -2660,6 +2762,8 @@ protected:
   QVector<DataType> mData;
   int mPreallocSize;
   int mPreallocIteration;
+  quint64 mRevision;
+  qint64 mFrontRemoved;
   
   // non-virtual methods:
   void preallocateGrow(int minimumPreallocSize);
@@ -2752,6 +2856,23 @@ protected:
   Returns whether this container holds no data points.
 */
 
+/*! \fn quint64 QCPDataContainer<DataType>::revision() const
+
+  Returns a value that changes whenever the data is modified in a way other than appending points
+  at the end or removing points from the front (e.g. \ref set, \ref clear, \ref sort, inserts and
+  prepends). Revisions are unique across all containers.
+
+  Together with \ref frontRemovedCount and \ref size, this allows derived indices (like \ref
+  QCPGraphLod) to be updated incrementally. Modifications made through the non-const iterators are
+  not tracked; call \ref sort afterwards, as is required anyway when sort keys are changed.
+*/
+
+/*! \fn qint64 QCPDataContainer<DataType>::frontRemovedCount() const
+
+  Returns the number of data points removed from the front of the container (e.g. by \ref
+  removeBefore) since the last change of \ref revision.
+*/
+
 /*! \fn QCPDataContainer::const_iterator QCPDataContainer<DataType>::constBegin() const
   
   Returns a const iterator to the first data point in this container.
@@ -2806,7 +2927,9 @@ template <class DataType>
 QCPDataContainer<DataType>::QCPDataContainer() :
   mAutoSqueeze(true),
   mPreallocSize(0),
-  mPreallocIteration(0)
+  mPreallocIteration(0),
+  mRevision(qcpNextDataRevision()),
+  mFrontRemoved(0)
 {
 }
 
@@ -2857,6 +2980,8 @@ void QCPDataContainer<DataType>::set(const QVector<DataType> &data, bool already
   mData = data;
   mPreallocSize = 0;
   mPreallocIteration = 0;
+  mRevision = qcpNextDataRevision();
+  mFrontRemoved = 0;
   if (!alreadySorted)
     sort();
 }
@@ -2882,12 +3007,16 @@ void QCPDataContainer<DataType>::add(const QCPDataContainer<DataType> &data)
       preallocateGrow(n);
     mPreallocSize -= n;
     std::copy(data.constBegin(), data.constEnd(), begin());
+    mRevision = qcpNextDataRevision();
   } else // don't need to prepend, so append and merge if necessary
   {
     mData.resize(mData.size()+n);
     std::copy(data.constBegin(), data.constEnd(), end()-n);
     if (oldSize > 0 && !qcpLessThanSortKey<DataType>(*(constEnd()-n-1), *(constEnd()-n))) // if appended range keys aren't all greater than existing ones, merge the two partitions
+    {
       std::inplace_merge(begin(), end()-n, end(), qcpLessThanSortKey<DataType>);
+      mRevision = qcpNextDataRevision();
+    }
   }
 }
 
@@ -2919,6 +3048,7 @@ void QCPDataContainer<DataType>::add(const QVector<DataType> &data, bool already
       preallocateGrow(n);
     mPreallocSize -= n;
     std::copy(data.constBegin(), data.constEnd(), begin());
+    mRevision = qcpNextDataRevision();
   } else // don't need to prepend, so append and then sort and merge if necessary
   {
     mData.resize(mData.size()+n);
@@ -2926,7 +3056,10 @@ void QCPDataContainer<DataType>::add(const QVector<DataType> &data, bool already
     if (!alreadySorted) // sort appended subrange if it wasn't already sorted
       std::sort(end()-n, end(), qcpLessThanSortKey<DataType>);
     if (oldSize > 0 && !qcpLessThanSortKey<DataType>(*(constEnd()-n-1), *(constEnd()-n))) // if appended range keys aren't all greater than existing ones, merge the two partitions
+    {
       std::inplace_merge(begin(), end()-n, end(), qcpLessThanSortKey<DataType>);
+      mRevision = qcpNextDataRevision();
+    }
   }
 }
 
@@ -2948,10 +3081,12 @@ void QCPDataContainer<DataType>::add(const DataType &data)
       preallocateGrow(1);
     --mPreallocSize;
     *begin() = data;
+    mRevision = qcpNextDataRevision();
   } else // handle inserts, maintaining sorted keys
   {
     QCPDataContainer<DataType>::iterator insertionPoint = std::lower_bound(begin(), end(), data, qcpLessThanSortKey<DataType>);
     mData.insert(insertionPoint, data);
+    mRevision = qcpNextDataRevision();
   }
 }
 
@@ -2966,6 +3101,7 @@ void QCPDataContainer<DataType>::removeBefore(double sortKey)
   QCPDataContainer<DataType>::iterator it = begin();
   QCPDataContainer<DataType>::iterator itEnd = std::lower_bound(begin(), end(), DataType::fromSortKey(sortKey), qcpLessThanSortKey<DataType>);
   mPreallocSize += int(itEnd-it); // don't actually delete, just add it to the preallocated block (if it gets too large, squeeze will take care of it)
+  mFrontRemoved += int(itEnd-it);
   if (mAutoSqueeze)
     performAutoSqueeze();
 }
@@ -2980,6 +3116,8 @@ void QCPDataContainer<DataType>::removeAfter(double sortKey)
 {
   QCPDataContainer<DataType>::iterator it = std::upper_bound(begin(), end(), DataType::fromSortKey(sortKey), qcpLessThanSortKey<DataType>);
   QCPDataContainer<DataType>::iterator itEnd = end();
+  if (it != itEnd)
+    mRevision = qcpNextDataRevision();
   mData.erase(it, itEnd); // typically adds it to the postallocated block
   if (mAutoSqueeze)
     performAutoSqueeze();
@@ -3000,6 +3138,8 @@ void QCPDataContainer<DataType>::remove(double sortKeyFrom, double sortKeyTo)
   
   QCPDataContainer<DataType>::iterator it = std::lower_bound(begin(), end(), DataType::fromSortKey(sortKeyFrom), qcpLessThanSortKey<DataType>);
   QCPDataContainer<DataType>::iterator itEnd = std::upper_bound(it, end(), DataType::fromSortKey(sortKeyTo), qcpLessThanSortKey<DataType>);
+  if (it != itEnd)
+    mRevision = qcpNextDataRevision();
   mData.erase(it, itEnd);
   if (mAutoSqueeze)
     performAutoSqueeze();
@@ -3021,9 +3161,14 @@ void QCPDataContainer<DataType>::remove(double sortKey)
   if (it != end() && it->sortKey() == sortKey)
   {
     if (it == begin())
+    {
       ++mPreallocSize; // don't actually delete, just add it to the preallocated block (if it gets too large, squeeze will take care of it)
-    else
+      ++mFrontRemoved;
+    } else
+    {
       mData.erase(it);
+      mRevision = qcpNextDataRevision();
+    }
   }
   if (mAutoSqueeze)
     performAutoSqueeze();
@@ -3040,6 +3185,8 @@ void QCPDataContainer<DataType>::clear()
   mData.clear();
   mPreallocIteration = 0;
   mPreallocSize = 0;
+  mRevision = qcpNextDataRevision();
+  mFrontRemoved = 0;
 }
 
 /*!
@@ -3057,6 +3204,7 @@ template <class DataType>
 void QCPDataContainer<DataType>::sort()
 {
   std::sort(begin(), end(), qcpLessThanSortKey<DataType>);
+  mRevision = qcpNextDataRevision();
 }
 
 /*!
@@ -3846,6 +3994,7 @@ public:
   QCP::SelectionRectMode selectionRectMode() const { return mSelectionRectMode; }
   QCPSelectionRect *selectionRect() const { return mSelectionRect; }
   bool openGl() const { return mOpenGl; }
+  bool threadedRendering() const { return mThreadedRendering; }
   
   // setters:
   void setViewport(const QRect &rect);
@@ -3870,6 +4019,7 @@ public:
   void setSelectionRectMode(QCP::SelectionRectMode mode);
   void setSelectionRect(QCPSelectionRect *selectionRect);
   void setOpenGl(bool enabled, int multisampling=16);
+  void setThreadedRendering(bool enabled);
   
   // non-property methods:
   // plottable interface:
@@ -3940,6 +4090,7 @@ public:
   void toPainter(QCPPainter *painter, int width=0, int height=0);
   Q_SLOT void replot(QCustomPlot::RefreshPriority refreshPriority=QCustomPlot::rpRefreshHint);
   double replotTime(bool average=false) const;
+  quint64 replotCount() const { return mReplotCount; }
   
   QCPAxis *xAxis, *yAxis, *xAxis2, *yAxis2;
   QCPLegend *legend;
@@ -3964,6 +4115,7 @@ signals:
   void beforeReplot();
   void afterLayout();
   void afterReplot();
+  void afterRasterize(quint64 replotCount);
   
 protected:
   // property members:
@@ -3990,6 +4142,7 @@ protected:
   QCP::SelectionRectMode mSelectionRectMode;
   QCPSelectionRect *mSelectionRect;
   bool mOpenGl;
+  bool mThreadedRendering;
   
   // non-property members:
   QList<QSharedPointer<QCPAbstractPaintBuffer> > mPaintBuffers;
@@ -4002,9 +4155,11 @@ protected:
   bool mReplotting;
   bool mReplotQueued;
   double mReplotTime, mReplotTimeAverage;
+  quint64 mReplotCount;
   int mOpenGlMultisamples;
   QCP::AntialiasedElements mOpenGlAntialiasedElementsBackup;
   bool mOpenGlCacheLabelsBackup;
+  QThreadPool *mRasterThreadPool;
 #ifdef QCP_OPENGL_FBO
   QSharedPointer<QOpenGLContext> mGlContext;
   QSharedPointer<QSurface> mGlSurface;
@@ -4041,6 +4196,8 @@ protected:
   void drawBackground(QCPPainter *painter);
   void setupPaintBuffers();
   QCPAbstractPaintBuffer *createPaintBuffer();
+  QCPAbstractPaintBuffer *createThreadedPaintBuffer();
+  void ensurePaintBuffer(int index, bool threaded);
   bool hasInvalidatedPaintBuffers();
   bool setupOpenGl();
   void freeOpenGl();
@@ -5479,6 +5636,231 @@ public:
 };
 Q_DECLARE_TYPEINFO(QCPGraphData, Q_PRIMITIVE_TYPE);
 
+class QCP_LIB_DECL QCPDataColumns
+{
+public:
+  explicit QCPDataColumns(int channelCount);
+  
+  // getters:
+  int channelCount() const { return int(mValues.size()); }
+  int size() const { return int(mKeys.size())-mHead; }
+  bool isEmpty() const { return size() == 0; }
+  quint64 revision() const { return mRevision; }
+  qint64 frontRemovedCount() const { return mFrontRemoved; }
+  const double *constKeyData() const { return mKeys.constData()+mHead; }
+  const double *constValueData(int channel) const { return mValues.at(channel).constData()+mHead; }
+  double keyAt(int index) const { return mKeys.at(mHead+index); }
+  double valueAt(int channel, int index) const { return mValues.at(channel).at(mHead+index); }
+  
+  // non-virtual methods:
+  void append(double key, const double *values);
+  void removeBefore(double key);
+  void removeFirst(int count);
+  void clear();
+  
+protected:
+  QVector<double> mKeys;
+  QVector<QVector<double> > mValues;
+  int mHead;
+  quint64 mRevision;
+  qint64 mFrontRemoved;
+  
+  void compact();
+};
+
+
+#ifdef QCP_SOA_GRAPH_DATA
+template <>
+class QCP_LIB_DECL QCPDataContainer<QCPGraphData>
+{
+public:
+  class ConstReference
+  {
+  public:
+    ConstReference(const double &key, const double &value) : key(key), value(value) {}
+    operator QCPGraphData() const { return QCPGraphData(key, value); }
+    inline double sortKey() const { return key; }
+    inline double mainKey() const { return key; }
+    inline double mainValue() const { return value; }
+    inline QCPRange valueRange() const { return QCPRange(value, value); }
+    const double &key;
+    const double &value;
+  };
+  class Reference
+  {
+  public:
+    Reference(double &key, double &value) : key(key), value(value) {}
+    Reference(const Reference &other) : key(other.key), value(other.value) {}
+    Reference &operator=(const QCPGraphData &data) { key = data.key; value = data.value; return *this; }
+    Reference &operator=(const Reference &other) { key = other.key; value = other.value; return *this; }
+    operator QCPGraphData() const { return QCPGraphData(key, value); }
+    inline double sortKey() const { return key; }
+    inline double mainKey() const { return key; }
+    inline double mainValue() const { return value; }
+    inline QCPRange valueRange() const { return QCPRange(value, value); }
+    double &key;
+    double &value;
+  };
+  template <class ReferenceType>
+  class ArrowProxy
+  {
+  public:
+    explicit ArrowProxy(const ReferenceType &reference) : mReference(reference) {}
+    const ReferenceType *operator->() const { return &mReference; }
+  private:
+    ReferenceType mReference;
+  };
+  
+  class const_iterator
+  {
+  public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef QCPGraphData value_type;
+    typedef qptrdiff difference_type;
+    typedef ArrowProxy<ConstReference> pointer;
+    typedef QCPGraphData reference;
+    
+    const_iterator() : mKey(nullptr), mValue(nullptr) {}
+    const_iterator(const double *key, const double *value) : mKey(key), mValue(value) {}
+    
+    QCPGraphData operator*() const { return QCPGraphData(*mKey, *mValue); }
+    pointer operator->() const { return pointer(ConstReference(*mKey, *mValue)); }
+    QCPGraphData operator[](difference_type n) const { return QCPGraphData(mKey[n], mValue[n]); }
+    const double *keyPointer() const { return mKey; }
+    const double *valuePointer() const { return mValue; }
+    
+    const_iterator &operator++() { ++mKey; ++mValue; return *this; }
+    const_iterator operator++(int) { const_iterator result(*this); ++*this; return result; }
+    const_iterator &operator--() { --mKey; --mValue; return *this; }
+    const_iterator operator--(int) { const_iterator result(*this); --*this; return result; }
+    const_iterator &operator+=(difference_type n) { mKey += n; mValue += n; return *this; }
+    const_iterator &operator-=(difference_type n) { mKey -= n; mValue -= n; return *this; }
+    const_iterator operator+(difference_type n) const { return const_iterator(mKey+n, mValue+n); }
+    const_iterator operator-(difference_type n) const { return const_iterator(mKey-n, mValue-n); }
+    difference_type operator-(const const_iterator &other) const { return mKey-other.mKey; }
+    
+    bool operator==(const const_iterator &other) const { return mKey == other.mKey; }
+    bool operator!=(const const_iterator &other) const { return mKey != other.mKey; }
+    bool operator<(const const_iterator &other) const { return mKey < other.mKey; }
+    bool operator>(const const_iterator &other) const { return mKey > other.mKey; }
+    bool operator<=(const const_iterator &other) const { return mKey <= other.mKey; }
+    bool operator>=(const const_iterator &other) const { return mKey >= other.mKey; }
+    
+  private:
+    const double *mKey;
+    const double *mValue;
+  };
+  
+  class iterator
+  {
+  public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef QCPGraphData value_type;
+    typedef qptrdiff difference_type;
+    typedef ArrowProxy<Reference> pointer;
+    typedef Reference reference;
+    
+    iterator() : mKey(nullptr), mValue(nullptr) {}
+    iterator(double *key, double *value) : mKey(key), mValue(value) {}
+    operator const_iterator() const { return const_iterator(mKey, mValue); }
+    
+    Reference operator*() const { return Reference(*mKey, *mValue); }
+    pointer operator->() const { return pointer(Reference(*mKey, *mValue)); }
+    Reference operator[](difference_type n) const { return Reference(mKey[n], mValue[n]); }
+    
+    iterator &operator++() { ++mKey; ++mValue; return *this; }
+    iterator operator++(int) { iterator result(*this); ++*this; return result; }
+    iterator &operator--() { --mKey; --mValue; return *this; }
+    iterator operator--(int) { iterator result(*this); --*this; return result; }
+    iterator &operator+=(difference_type n) { mKey += n; mValue += n; return *this; }
+    iterator &operator-=(difference_type n) { mKey -= n; mValue -= n; return *this; }
+    iterator operator+(difference_type n) const { return iterator(mKey+n, mValue+n); }
+    iterator operator-(difference_type n) const { return iterator(mKey-n, mValue-n); }
+    difference_type operator-(const iterator &other) const { return mKey-other.mKey; }
+    
+    bool operator==(const iterator &other) const { return mKey == other.mKey; }
+    bool operator!=(const iterator &other) const { return mKey != other.mKey; }
+    bool operator<(const iterator &other) const { return mKey < other.mKey; }
+    bool operator>(const iterator &other) const { return mKey > other.mKey; }
+    bool operator<=(const iterator &other) const { return mKey <= other.mKey; }
+    bool operator>=(const iterator &other) const { return mKey >= other.mKey; }
+    
+  private:
+    double *mKey;
+    double *mValue;
+  };
+  
+  QCPDataContainer();
+  QCPDataContainer(const QSharedPointer<QCPDataColumns> &columns, int channel);
+  
+  // getters:
+  int size() const { return mColumns ? mColumns->size() : int(mKeys.size())-mHead; }
+  bool isEmpty() const { return size() == 0; }
+  bool autoSqueeze() const { return mAutoSqueeze; }
+  quint64 revision() const { return mColumns ? (mRevision << 32)^mColumns->revision() : mRevision; }
+  qint64 frontRemovedCount() const { return mColumns ? mColumns->frontRemovedCount() : mFrontRemoved; }
+  const double *constKeyData() const { return mColumns ? mColumns->constKeyData() : mKeys.constData()+mHead; }
+  const double *constValueData() const { return mColumns ? mColumns->constValueData(mChannel) : mValues.constData()+mHead; }
+  bool isView() const { return !mColumns.isNull(); }
+  QSharedPointer<QCPDataColumns> columns() const { return mColumns; }
+  int channel() const { return mChannel; }
+  
+  // setters:
+  void setAutoSqueeze(bool enabled);
+  
+  // non-virtual methods:
+  void set(const QCPDataContainer<QCPGraphData> &data);
+  void set(const QVector<QCPGraphData> &data, bool alreadySorted=false);
+  void set(const QVector<double> &keys, const QVector<double> &values, bool alreadySorted=false);
+  void add(const QCPDataContainer<QCPGraphData> &data);
+  void add(const QVector<QCPGraphData> &data, bool alreadySorted=false);
+  void add(const QVector<double> &keys, const QVector<double> &values, bool alreadySorted=false);
+  void add(const QCPGraphData &data);
+  void removeBefore(double sortKey);
+  void removeAfter(double sortKey);
+  void remove(double sortKeyFrom, double sortKeyTo);
+  void remove(double sortKey);
+  void clear();
+  void sort();
+  void squeeze(bool preAllocation=true, bool postAllocation=true);
+  
+  const_iterator constBegin() const { return const_iterator(constKeyData(), constValueData()); }
+  const_iterator constEnd() const { return constBegin()+size(); }
+  iterator begin() { detach(); return iterator(mKeys.data()+mHead, mValues.data()+mHead); }
+  iterator end() { detach(); return iterator(mKeys.data()+mKeys.size(), mValues.data()+mValues.size()); }
+  const_iterator findBegin(double sortKey, bool expandedRange=true) const;
+  const_iterator findEnd(double sortKey, bool expandedRange=true) const;
+  const_iterator at(int index) const { return constBegin()+qBound(0, index, size()); }
+  QCPRange keyRange(bool &foundRange, QCP::SignDomain signDomain=QCP::sdBoth);
+  QCPRange valueRange(bool &foundRange, QCP::SignDomain signDomain=QCP::sdBoth, const QCPRange &inKeyRange=QCPRange());
+  QCPDataRange dataRange() const { return QCPDataRange(0, size()); }
+  void limitIteratorsToDataRange(const_iterator &begin, const_iterator &end, const QCPDataRange &dataRange) const;
+  
+protected:
+  // property members:
+  bool mAutoSqueeze;
+  
+  // non-property memebers:
+  QVector<double> mKeys, mValues;
+  int mHead;
+  int mPreallocIteration;
+  quint64 mRevision;
+  qint64 mFrontRemoved;
+  QSharedPointer<QCPDataColumns> mColumns;
+  int mChannel;
+  
+  // non-virtual methods:
+  void detach();
+  int lowerBoundIndex(double sortKey) const;
+  int upperBoundIndex(double sortKey) const;
+  void reserveFront(int count);
+  void appendSorted(const double *keys, const double *values, int count, bool alreadySorted);
+  void sortRange(int from, int to);
+  void mergeTail(int count);
+  void performAutoSqueeze();
+};
+#endif // QCP_SOA_GRAPH_DATA
+
 
 /*! \typedef QCPGraphDataContainer
   
@@ -5491,6 +5873,52 @@ Q_DECLARE_TYPEINFO(QCPGraphData, Q_PRIMITIVE_TYPE);
 */
 typedef QCPDataContainer<QCPGraphData> QCPGraphDataContainer;
 
+QCP_LIB_DECL void qcpLinearDataToPixels(const QCPGraphData *data, int count, double keyScale, double keyOffset, double valueScale, double valueOffset, bool keyVertical, QPointF *pixels);
+
+class QCP_LIB_DECL QCPGraphLod
+{
+public:
+  QCPGraphLod();
+  
+  // getters:
+  int levelCount() const { return int(mLevels.size()); }
+  static int bucketSize(int level) { return 1 << (baseShift+level); }
+  
+  // non-virtual methods:
+  void clear();
+  void sync(const QCPGraphDataContainer &data);
+  int levelFor(int dataCount, double keyPixelSpan) const;
+  void collect(QVector<QCPGraphData> *lineData, const QCPGraphDataContainer &data, int beginIndex, int endIndex, int maxLevel) const;
+  
+  static const int baseShift = 3;
+  static const int minimumDataCount = 16384;
+  
+protected:
+  struct Bucket
+  {
+    double minKey, minValue, maxKey, maxValue;
+    bool hasNaN;
+  };
+  struct Level
+  {
+    QVector<Bucket> buckets;
+    int head;
+    qint64 first; // absolute index of buckets[head]
+    qint64 end() const { return first+buckets.size()-head; }
+  };
+  
+  QVector<Level> mLevels;
+  bool mValid;
+  quint64 mRevision;
+  qint64 mFrontRemoved;
+  
+  // non-virtual methods:
+  void trimFront(qint64 absoluteBegin);
+  void appendBuckets(const QCPGraphDataContainer &data);
+  static Bucket bucketFromData(QCPGraphDataContainer::const_iterator begin, QCPGraphDataContainer::const_iterator end);
+  static Bucket mergeBuckets(const Bucket &a, const Bucket &b);
+};
+
 class QCP_LIB_DECL QCPGraph : public QCPAbstractPlottable1D<QCPGraphData>
 {
   Q_OBJECT
@@ -5554,6 +5982,9 @@ protected:
   QPointer<QCPGraph> mChannelFillGraph;
   bool mAdaptiveSampling;
   
+  // non-property members:
+  mutable QCPGraphLod mLod;
+  
   // reimplemented virtual methods:
   virtual void draw(QCPPainter *painter) Q_DECL_OVERRIDE;
   virtual void drawLegendIcon(QCPPainter *painter, const QRectF &rect) const Q_DECL_OVERRIDE;
@@ -6054,6 +6485,7 @@ public:
   void clearAlpha();
   void fill(double z);
   void fillAlpha(unsigned char alpha);
+  void shiftKeys(int cellCount);
   bool isEmpty() const { return mIsEmpty; }
   void coordToCell(double key, double value, int *keyIndex, int *valueIndex) const;
   void cellToCoord(int keyIndex, int valueIndex, double *key, double *value) const;
@@ -6069,8 +6501,12 @@ protected:
   unsigned char *mAlpha;
   QCPRange mDataBounds;
   bool mDataModified;
+  int mModifiedKeyBegin, mModifiedKeyEnd; // key index range [begin, end) of cells changed since the last map image update
+  int mShiftedKeyCells; // cells the data was shifted by (see shiftKeys) since the last map image update
   
   bool createAlpha(bool initializeOpaque=true);
+  void markKeysModified(int begin, int end);
+  void resetModified();
   
   friend class QCPColorMap;
 };
@@ -6145,6 +6581,9 @@ protected:
   virtual void draw(QCPPainter *painter) Q_DECL_OVERRIDE;
   virtual void drawLegendIcon(QCPPainter *painter, const QRectF &rect) const Q_DECL_OVERRIDE;
   
+  // non-virtual methods:
+  bool updateMapImageKeys();
+  
   friend class QCustomPlot;
   friend class QCPLegend;
 };
@@ -0,0 +1,184 @@
+﻿#ifndef QUANTILESKETCH_H
+#define QUANTILESKETCH_H
+
+#include <QVector>
+#include <QDataStream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// QuantileSketch - 可合并的流式分位数草图（合并式t-digest）
+// 数据被归并为若干质心（均值+权重）：中位数附近的质心大，两端的质心小，因此两端分位数也较准。
+// 质心个数不超过约kCompression个，与数据量无关（约几KB）；最小值、最大值精确记录。
+// 两个草图可以直接合并（多个节点合并为全部节点，多天合并为一周），
+// 所以一天的分布只需一个草图，不必对当天全部读数排序。
+class QuantileSketch
+{
+public:
+    static const int kCompression = 100; // 压缩参数，越大越准、草图越大
+    static const int kBufferSize = 500;  // 新数据先进缓冲区，满了再统一归并
+
+    // 加入一个数值（NaN被忽略）
+    void add(double value, double weight = 1)
+    {
+        if (std::isnan(value) || weight <= 0) {
+            return;
+        }
+        m_buffer.append(Centroid{value, weight});
+        m_count += weight;
+        m_min = std::min(m_min, value);
+        m_max = std::max(m_max, value);
+        if (m_buffer.size() >= kBufferSize) {
+            compress();
+        }
+    }
+
+    // 合并另一个草图
+    void merge(const QuantileSketch &other)
+    {
+        if (other.isEmpty()) {
+            return;
+        }
+        other.compress();
+        for (const Centroid &c : other.m_centroids) {
+            m_buffer.append(c);
+        }
+        m_count += other.m_count;
+        m_min = std::min(m_min, other.m_min);
+        m_max = std::max(m_max, other.m_max);
+        if (m_buffer.size() >= kBufferSize) {
+            compress();
+        }
+    }
+
+    bool isEmpty() const { return m_count <= 0; }
+    double count() const { return m_count; }
+    double min() const { return isEmpty() ? std::numeric_limits<double>::quiet_NaN() : m_min; }
+    double max() const { return isEmpty() ? std::numeric_limits<double>::quiet_NaN() : m_max; }
+    int centroidCount() const { compress(); return m_centroids.size(); }
+
+    // q分位数（0 <= q <= 1），相邻质心之间线性插值，两端在最小/最大值与第一个/最后一个质心之间插值
+    double quantile(double q) const
+    {
+        if (isEmpty()) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        compress();
+        if (q <= 0 || m_min == m_max) {
+            return m_min;
+        }
+        if (q >= 1) {
+            return m_max;
+        }
+
+        const double index = q * m_count;
+        const Centroid &first = m_centroids.first();
+        if (index < first.weight / 2) {
+            return m_min + (first.mean - m_min) * index / (first.weight / 2);
+        }
+        double weightSoFar = first.weight / 2;
+        for (int i = 0; i + 1 < m_centroids.size(); ++i) {
+            const Centroid &left = m_centroids.at(i);
+            const Centroid &right = m_centroids.at(i + 1);
+            const double step = (left.weight + right.weight) / 2;
+            if (weightSoFar + step > index) {
+                const double t = (index - weightSoFar) / step;
+                return left.mean + (right.mean - left.mean) * t;
+            }
+            weightSoFar += step;
+        }
+        const Centroid &last = m_centroids.last();
+        const double t = std::min(1.0, (index - weightSoFar) / (last.weight / 2));
+        return last.mean + (m_max - last.mean) * t;
+    }
+
+    // 序列化（存入数据库的BLOB），写入前先归并缓冲区
+    friend QDataStream &operator<<(QDataStream &out, const QuantileSketch &sketch)
+    {
+        sketch.compress();
+        out << quint8(1) << sketch.m_count << sketch.m_min << sketch.m_max << qint32(sketch.m_centroids.size());
+        for (const Centroid &c : sketch.m_centroids) {
+            out << c.mean << c.weight;
+        }
+        return out;
+    }
+
+    friend QDataStream &operator>>(QDataStream &in, QuantileSketch &sketch)
+    {
+        sketch = QuantileSketch();
+        quint8 version = 0;
+        qint32 size = 0;
+        in >> version;
+        if (version != 1) {
+            in.setStatus(QDataStream::ReadCorruptData);
+            return in;
+        }
+        in >> sketch.m_count >> sketch.m_min >> sketch.m_max >> size;
+        for (qint32 i = 0; i < size && in.status() == QDataStream::Ok; ++i) {
+            Centroid c;
+            in >> c.mean >> c.weight;
+            sketch.m_centroids.append(c);
+        }
+        if (in.status() != QDataStream::Ok) {
+            sketch = QuantileSketch();
+        }
+        return in;
+    }
+
+private:
+    struct Centroid {
+        double mean;
+        double weight;
+    };
+
+    // 质心和缓冲区在查询时才归并，所以是mutable
+    mutable QVector<Centroid> m_centroids; // 按均值排序
+    mutable QVector<Centroid> m_buffer;    // 尚未归并的数据
+    double m_count = 0;
+    double m_min = std::numeric_limits<double>::infinity();
+    double m_max = -std::numeric_limits<double>::infinity();
+
+    // 刻度函数k1：k(q) = δ/(2π)·asin(2q-1)，相邻质心的k之差不超过1，
+    // 因此q接近0或1处的质心权重很小
+    static constexpr double kPi = 3.14159265358979323846;
+    static double qToK(double q) { return kCompression / (2 * kPi) * std::asin(2 * q - 1); }
+    static double kToQ(double k)
+    {
+        const double x = std::min(kPi / 2, std::max(-kPi / 2, k * 2 * kPi / kCompression));
+        return (std::sin(x) + 1) / 2;
+    }
+
+    // 把缓冲区与已有质心按均值排序后重新归并
+    void compress() const
+    {
+        if (m_buffer.isEmpty()) {
+            return;
+        }
+        QVector<Centroid> all = m_centroids;
+        all += m_buffer;
+        m_buffer.clear();
+        std::sort(all.begin(), all.end(), [](const Centroid &a, const Centroid &b) { return a.mean < b.mean; });
+
+        QVector<Centroid> merged;
+        merged.reserve(qMin(int(all.size()), 2 * kCompression));
+        Centroid current = all.first();
+        double weightSoFar = 0;
+        double limit = m_count * kToQ(qToK(0) + 1);
+        for (int i = 1; i < all.size(); ++i) {
+            const Centroid &next = all.at(i);
+            if (weightSoFar + current.weight + next.weight <= limit) {
+                current.mean += (next.mean - current.mean) * next.weight / (current.weight + next.weight);
+                current.weight += next.weight;
+            } else {
+                weightSoFar += current.weight;
+                merged.append(current);
+                current = next;
+                limit = m_count * kToQ(qToK(weightSoFar / m_count) + 1);
+            }
+        }
+        merged.append(current);
+        m_centroids = merged;
+    }
+};
+
+#endif // QUANTILESKETCH_H
@@ -0,0 +1,18 @@
+﻿#ifndef QUEUESTATS_H
+#define QUEUESTATS_H
+
+#include <QString>
+
+// QueueStats - 队列统计快照（BoundedQueue和MpscRing共用）
+struct QueueStats {
+    QString name;          // 队列名
+    int depth = 0;         // 当前内存中的元素数
+    int capacity = 0;      // 容量
+    qint64 spilled = 0;    // 当前在磁盘溢出文件中的元素数
+    quint64 pushed = 0;    // 累计入队数
+    quint64 popped = 0;    // 累计出队数
+    quint64 dropped = 0;   // 累计丢弃数
+    int highWater = 0;     // 内存深度历史最大值
+};
+
+#endif // QUEUESTATS_H
@@ -1,6 +1,8 @@
 ﻿#ifndef SENSORDATA_H
 #define SENSORDATA_H
 
+#include <QDataStream>
+
 struct SensorData {
     double atemp;    // 空气温度
     double ahumi;    // 空气湿度
@@ -8,9 +10,37 @@ struct SensorData {
     double stemp;    // 土壤温度
     double shumi2;   // 土壤湿度
     double light;    // 光照强度
+    int node;        // 节点编号（报文中的node字段，未携带时为0）
+    long long seq;   // 报文序号（报文中的seq字段，未携带时为-1）
+    long long time;  // 接收时间（毫秒时间戳），入库时作为采集时间
+    long long sent;  // 发送端时间戳（微秒，报文中的ts字段，未携带时为0），用于端到端延迟统计
+    // 延迟追踪的各阶段时刻（LatencyTrace::now()，微秒，0表示未追踪）；只在本进程内有效，不序列化
+    long long readAt;     // 从套接字/串口读出
+    long long parsedAt;   // 解析完成
+    long long enqueuedAt; // 进入界面/入库队列
 
     //添加默认构造函数，初始化成员（避免未初始化的随机值）
-    SensorData() : atemp(0), ahumi(0), oxygen(0), stemp(0), shumi2(0), light(0) {}
+    SensorData() : atemp(0), ahumi(0), oxygen(0), stemp(0), shumi2(0), light(0), node(0), seq(-1), time(0), sent(0), readAt(0), parsedAt(0), enqueuedAt(0) {}
 };
 
+// 序列化，用于存储队列溢出到磁盘（读回的数据不再参与延迟统计）
+inline QDataStream &operator<<(QDataStream &out, const SensorData &d)
+{
+    out << d.atemp << d.ahumi << d.oxygen << d.stemp << d.shumi2 << d.light
+        << qint32(d.node) << qint64(d.seq) << qint64(d.time) << qint64(d.sent);
+    return out;
+}
+
+inline QDataStream &operator>>(QDataStream &in, SensorData &d)
+{
+    qint32 node;
+    qint64 seq, time, sent;
+    in >> d.atemp >> d.ahumi >> d.oxygen >> d.stemp >> d.shumi2 >> d.light >> node >> seq >> time >> sent;
+    d.node = node;
+    d.seq = seq;
+    d.time = time;
+    d.sent = sent;
+    return in;
+}
+
 #endif // SENSORDATA_H
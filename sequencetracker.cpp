@@ -0,0 +1,114 @@
+﻿#include "sequencetracker.h"
+
+void SequenceTracker::record(int node, qint64 seq, qint64 timeMs)
+{
+    if (seq < 0) {
+        return;
+    }
+
+    auto found = m_nodes.find(node);
+    if (found == m_nodes.end()) {
+        if (m_nodes.size() >= kMaxNodes && !evictIdle(timeMs)) {
+            m_total.untracked++;
+            return;
+        }
+        found = m_nodes.insert(node, NodeState());
+    }
+    NodeState &state = *found;
+    state.stats.received++;
+    m_total.received++;
+    const qint64 idleMs = (timeMs >= 0 && state.lastTimeMs >= 0) ? timeMs - state.lastTimeMs : -1;
+    if (timeMs >= 0) {
+        state.lastTimeMs = timeMs;
+    }
+
+    if (state.maxSeq < 0) {
+        // 节点的第一个报文
+        resync(state, seq);
+        return;
+    }
+
+    if (seq > state.maxSeq) {
+        qint64 gap = seq - state.maxSeq;
+        if (gap > kMaxGap) {
+            // 不合理的跳跃：不计丢失，按新序号重新同步
+            state.stats.jumps++;
+            m_total.jumps++;
+            resync(state, seq);
+            return;
+        }
+        // 正常前进；跳过的序号先计为丢失
+        quint64 missing = static_cast<quint64>(gap - 1);
+        state.stats.lost += missing;
+        m_total.lost += missing;
+        state.window = gap >= kWindow ? 0 : (state.window << gap);
+        state.window |= 1;
+        state.maxSeq = seq;
+        return;
+    }
+
+    qint64 behind = state.maxSeq - seq;
+    const bool restarted = behind > kResetGap                                // 大幅回退
+                           || (seq < kResetSeq && behind >= kWindow)         // 回到起始附近
+                           || (behind > 0 && idleMs > kResetIdleMs);         // 停发一段时间后回退
+    if (restarted) {
+        // 认为节点重启后重新计数
+        state.stats.resets++;
+        m_total.resets++;
+        resync(state, seq);
+        return;
+    }
+
+    if (behind >= kWindow) {
+        state.stats.late++;
+        m_total.late++;
+        return;
+    }
+
+    quint64 bit = quint64(1) << behind;
+    if (state.window & bit) {
+        state.stats.duplicates++;
+        m_total.duplicates++;
+        return;
+    }
+
+    // 之前计为丢失的报文迟到了
+    state.window |= bit;
+    state.stats.reordered++;
+    m_total.reordered++;
+    if (state.stats.lost > 0) {
+        state.stats.lost--;
+        m_total.lost--;
+    }
+}
+
+void SequenceTracker::resync(NodeState &state, qint64 seq)
+{
+    state.maxSeq = seq;
+    state.window = 1;
+}
+
+bool SequenceTracker::evictIdle(qint64 timeMs)
+{
+    if (timeMs < 0) {
+        return false;
+    }
+    auto oldest = m_nodes.end();
+    for (auto it = m_nodes.begin(); it != m_nodes.end(); ++it) {
+        // 从未带时刻的节点（lastTimeMs<0）无法判断是否停发，不移除
+        if (it->lastTimeMs >= 0 && (oldest == m_nodes.end() || it->lastTimeMs < oldest->lastTimeMs)) {
+            oldest = it;
+        }
+    }
+    if (oldest == m_nodes.end() || timeMs - oldest->lastTimeMs <= kEvictIdleMs) {
+        return false;
+    }
+    m_nodes.erase(oldest); // 其计数已累加在汇总中
+    return true;
+}
+
+void SequenceTracker::clear()
+{
+    m_nodes.clear();
+    m_total = SeqStats();
+}
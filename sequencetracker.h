@@ -0,0 +1,71 @@
+﻿#ifndef SEQUENCETRACKER_H
+#define SEQUENCETRACKER_H
+
+#include <QHash>
+#include <QtGlobal>
+
+// SeqStats - 丢包/乱序统计
+struct SeqStats {
+    quint64 received = 0;   // 收到的带序号报文数
+    quint64 lost = 0;       // 当前判定为丢失的报文数（迟到报文补到后会减回去）
+    quint64 reordered = 0;  // 乱序到达（比已收到的最大序号小）的报文数
+    quint64 duplicates = 0; // 重复报文数
+    quint64 late = 0;       // 超出检测窗口的过旧报文数
+    quint64 resets = 0;     // 检测到节点重启（序号回到很小的值）的次数
+    quint64 jumps = 0;      // 序号向前跳跃过大（超过kMaxGap，不计为丢失，按新序号重新同步）的次数
+    quint64 untracked = 0;  // 已跟踪的节点数达到上限、新节点的报文未参与统计的条数（只在汇总中）
+};
+
+// SequenceTracker - 按节点跟踪报文序号，统计丢包、乱序和重复
+// 每个节点记录已收到的最大序号和其后64个序号的接收位图（与IPsec防重放窗口相同的做法），
+// 序号跳跃时先把空缺计为丢失，空缺的报文迟到补上时再计为乱序并从丢失中扣除。
+// 节点重启的判断：序号大幅回退；序号回到起始附近且已在窗口之外；或停发一段时间后序号回退。
+// 前进幅度不合理（例如报文损坏或节点换了计数方式）时不计丢失，只记一次跳跃并重新同步。
+// 节点号来自报文内容，不可信：最多跟踪kMaxNodes个节点，满了以后新节点只能替换停发超过kEvictIdleMs的节点，
+// 否则其报文计入untracked，伪造节点号的报文不会让内存无限增长。
+// tools/seqcheck用脚本化的序号序列检查各项计数。
+class SequenceTracker
+{
+public:
+    // 记录一个报文，seq<0表示报文没有携带序号，不参与统计
+    // timeMs为到达时刻（毫秒，任意起点的单调时钟），<0表示不按停发时间判断重启
+    void record(int node, qint64 seq, qint64 timeMs = -1);
+
+    // 全部节点的汇总统计
+    SeqStats total() const { return m_total; }
+
+    // 单个节点的统计
+    SeqStats nodeStats(int node) const { return m_nodes.value(node).stats; }
+
+    // 已出现过的节点数
+    int nodeCount() const { return m_nodes.size(); }
+
+    void clear();
+
+private:
+    static const int kWindow = 64;        // 乱序检测窗口
+    static const qint64 kResetGap = 1024; // 序号回退超过该值视为节点重启
+    static const qint64 kResetSeq = 16;   // 序号回到该值以下且在窗口之外，视为节点重启后从头计数
+    static const qint64 kResetIdleMs = 3000; // 停发超过该时间后序号回退，视为节点重启
+    static const qint64 kMaxGap = 65536;  // 一次前进超过该值不计为丢失
+    static const int kMaxNodes = 256;     // 最多跟踪的节点数（与指标的node标签上限一致）
+    static const qint64 kEvictIdleMs = 60000; // 节点数满时，停发超过该时间的节点可被新节点替换
+
+    struct NodeState {
+        qint64 maxSeq = -1;   // 已收到的最大序号
+        quint64 window = 0;   // 第i位表示 maxSeq-i 是否已收到
+        qint64 lastTimeMs = -1; // 上一个报文的到达时刻
+        SeqStats stats;
+    };
+
+    // 从seq重新开始跟踪（重启或跳跃之后）
+    static void resync(NodeState &state, qint64 seq);
+
+    // 节点数已满时，移除停发最久且超过kEvictIdleMs的节点，返回是否腾出了位置
+    bool evictIdle(qint64 timeMs);
+
+    QHash<int, NodeState> m_nodes;
+    SeqStats m_total;
+};
+
+#endif // SEQUENCETRACKER_H
@@ -0,0 +1,200 @@
+﻿// serialworker.cpp - 串口数据接收工作对象实现
+
+#include "serialworker.h"
+#include "latencytrace.h"
+#include "logger.h"
+
+SerialWorker::SerialWorker(QObject *parent) : QObject(parent)
+{
+}
+
+SerialWorker::~SerialWorker()
+{
+    // 确保在对象销毁前关闭串口
+    closePort();
+}
+
+bool SerialWorker::parseFraming(const QString &spec, SerialConfig &config)
+{
+    QString s = spec.trimmed().toUpper();
+    if (s.size() != 3) {
+        return false;
+    }
+
+    switch (s.at(0).toLatin1()) {
+    case '5': config.dataBits = QSerialPort::Data5; break;
+    case '6': config.dataBits = QSerialPort::Data6; break;
+    case '7': config.dataBits = QSerialPort::Data7; break;
+    case '8': config.dataBits = QSerialPort::Data8; break;
+    default: return false;
+    }
+
+    switch (s.at(1).toLatin1()) {
+    case 'N': config.parity = QSerialPort::NoParity; break;
+    case 'E': config.parity = QSerialPort::EvenParity; break;
+    case 'O': config.parity = QSerialPort::OddParity; break;
+    case 'S': config.parity = QSerialPort::SpaceParity; break;
+    case 'M': config.parity = QSerialPort::MarkParity; break;
+    default: return false;
+    }
+
+    switch (s.at(2).toLatin1()) {
+    case '1': config.stopBits = QSerialPort::OneStop; break;
+    case '2': config.stopBits = QSerialPort::TwoStop; break;
+    default: return false;
+    }
+    return true;
+}
+
+// 打开串口 - 在工作线程中执行
+void SerialWorker::openPort(const SerialConfig &config)
+{
+    if (!m_port) {
+        // 串口和定时器在工作线程中创建，保证它们的事件都在本线程处理
+        m_port = new QSerialPort(this);
+        connect(m_port, &QSerialPort::readyRead, this, &SerialWorker::readSerialData);
+        connect(m_port, &QSerialPort::errorOccurred, this, &SerialWorker::handleSerialError);
+
+        m_reconnectTimer = new QTimer(this);
+        m_reconnectTimer->setSingleShot(true);
+        connect(m_reconnectTimer, &QTimer::timeout, this, &SerialWorker::tryReconnect);
+    }
+
+    if (m_port->isOpen()) {
+        m_port->close();
+    }
+    m_config = config;
+    m_wantOpen = true;
+    m_parser.clear();
+
+    if (!openConfiguredPort()) {
+        scheduleReconnect("打开串口失败: " + m_port->errorString());
+    }
+}
+
+// 关闭串口并停止重连
+void SerialWorker::closePort()
+{
+    m_wantOpen = false;
+    if (m_reconnectTimer) {
+        m_reconnectTimer->stop();
+    }
+    if (m_port && m_port->isOpen()) {
+        // 关闭前处理已读到缓冲中的数据
+        readSerialData();
+        m_port->close();
+        emit portStatusChanged(false, "串口已关闭");
+    }
+    m_parser.clear();
+}
+
+void SerialWorker::sendstrdata(QByteArray data)//发送数据给下位机
+{
+    if (!m_port || !m_port->isOpen()) {
+        LOG_WARNING("serial", "串口未打开，无法发送数据");
+        return;
+    }
+    m_port->write(data);
+}
+
+bool SerialWorker::openConfiguredPort()
+{
+    m_port->setPortName(m_config.portName);
+    m_port->setBaudRate(m_config.baudRate);
+    m_port->setDataBits(m_config.dataBits);
+    m_port->setParity(m_config.parity);
+    m_port->setStopBits(m_config.stopBits);
+    m_port->setFlowControl(m_config.flowControl);
+
+    if (!m_port->open(QIODevice::ReadWrite)) {
+        return false;
+    }
+
+    // 不限制驱动层读缓冲，由readyRead非阻塞地把数据全部取走
+    m_port->setReadBufferSize(0);
+    emit portStatusChanged(true, QString("串口 %1 已打开 (%2)").arg(m_config.portName).arg(m_config.baudRate));
+    return true;
+}
+
+// 关闭串口，并在用户仍要求打开时安排重连
+void SerialWorker::scheduleReconnect(const QString &reason)
+{
+    if (m_port->isOpen()) {
+        m_port->close();
+    }
+    // 残帧不能和重连后的数据拼在一起
+    m_parser.clear();
+    emit portStatusChanged(false, reason);
+
+    if (m_wantOpen) {
+        m_reconnectTimer->start(m_config.reconnectIntervalMs);
+    }
+}
+
+void SerialWorker::tryReconnect()
+{
+    if (!m_wantOpen) {
+        return;
+    }
+    if (!openConfiguredPort()) {
+        scheduleReconnect("重连失败: " + m_port->errorString());
+    }
+}
+
+//读取数据
+void SerialWorker::readSerialData()
+{
+    // readyRead时驱动缓冲中的数据已经到达，readAll不会阻塞
+    m_parser.append(m_port->readAll());
+    const qint64 readAt = LatencyTrace::now();
+
+    QByteArray frame;
+    while (m_parser.nextFrame(frame)) {
+        SensorData result;
+        QString rawStr = QString(frame).trimmed();
+        if (FrameParser::rawDataEnabled()) {
+            emit rawdata(rawStr);//发送原始数据到调试终端。
+        }
+        if (FrameParser::parseSensorData(rawStr, result)) {
+            result.readAt = readAt;
+            result.parsedAt = LatencyTrace::now();
+            m_traffic.recordFrame(result.node, frame.size());
+            emit showsensordata(result);
+        } else {
+            m_traffic.recordParseFailure();
+        }
+    }
+
+    //不符合报文格式的字节仍然显示在调试窗口
+    QString discarded = QString(m_parser.takeDiscarded()).trimmed();
+    if (!discarded.isEmpty() && FrameParser::rawDataEnabled()) {
+        emit rawdata(discarded);
+    }
+}
+
+void SerialWorker::handleSerialError(QSerialPort::SerialPortError error)
+{
+    switch (error) {
+    case QSerialPort::NoError:
+    case QSerialPort::TimeoutError:
+        return;
+    case QSerialPort::ResourceError:        // USB转串口被拔出、pty另一端关闭
+    case QSerialPort::DeviceNotFoundError:
+    case QSerialPort::PermissionError:
+    case QSerialPort::OpenError:
+    case QSerialPort::ReadError:
+    case QSerialPort::WriteError:
+        LOG_WARNING("serial", "串口错误", {"error", m_port->errorString()});
+        // 打开失败由openPort/tryReconnect自己处理；这里只处理运行中的断开。
+        // 不在errorOccurred回调里直接关闭串口，放到下一轮事件循环处理
+        QMetaObject::invokeMethod(this, [this]() {
+            if (m_port->isOpen()) {
+                scheduleReconnect("串口断开: " + m_port->errorString());
+            }
+        }, Qt::QueuedConnection);
+        return;
+    default:
+        LOG_WARNING("serial", "串口错误", {"error", m_port->errorString()});
+        return;
+    }
+}
@@ -0,0 +1,65 @@
+﻿#ifndef SERIALWORKER_H
+#define SERIALWORKER_H
+
+#include <QObject>
+#include <QSerialPort>
+#include <QTimer>
+#include "sensordata.h"
+#include "frameparser.h"
+#include "metrics.h"
+
+// SerialConfig - 串口参数
+struct SerialConfig {
+    QString portName;                                          // 串口名，如 COM3、/dev/ttyUSB0、/dev/pts/3
+    qint32 baudRate = 115200;                                  // 波特率
+    QSerialPort::DataBits dataBits = QSerialPort::Data8;       // 数据位
+    QSerialPort::Parity parity = QSerialPort::NoParity;        // 校验位
+    QSerialPort::StopBits stopBits = QSerialPort::OneStop;     // 停止位
+    QSerialPort::FlowControl flowControl = QSerialPort::NoFlowControl; // 流控
+    int reconnectIntervalMs = 2000;                            // 断开后重连间隔（毫秒）
+};
+
+// SerialWorker - 串口数据接收工作对象
+// 与DatabaseWorker一样通过moveToThread运行在独立线程中，
+// 收到的字节经过FrameParser分帧后走与MsgWorker相同的解析流程，
+// 串口被拔出或打开失败时按固定间隔自动重连。
+class SerialWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SerialWorker(QObject *parent = nullptr);
+    ~SerialWorker();
+
+    // 解析 "8N1"、"7E1"、"8O2" 形式的帧格式（数据位/校验/停止位），格式错误返回false
+    static bool parseFraming(const QString &spec, SerialConfig &config);
+
+public slots:
+    void openPort(const SerialConfig &config);//打开串口，失败后自动重连
+    void closePort();//关闭串口并停止重连
+    void sendstrdata(QByteArray data);//发送数据给下位机
+
+signals:
+    void rawdata(QString);//发送原始数据在调试窗口
+    void showsensordata(SensorData);//将接收到的数据，在界面上展示出来
+    void portStatusChanged(bool opened, const QString &message);//串口状态变化
+
+private slots:
+    void readSerialData();//读取数据（非阻塞，readyRead触发）
+    void handleSerialError(QSerialPort::SerialPortError error);//串口错误处理
+    void tryReconnect();//重连定时器触发
+
+private:
+    QSerialPort *m_port = nullptr;//串口对象，在工作线程中创建
+    QTimer *m_reconnectTimer = nullptr;//重连定时器
+    SerialConfig m_config;//当前串口参数
+    FrameParser m_parser;//分帧器
+    NodeTrafficMetrics m_traffic{"serial"};//各节点的报文数、字节数和解析失败数
+    bool m_wantOpen = false;//用户是否要求保持串口打开
+
+    bool openConfiguredPort();//按m_config打开串口
+    void scheduleReconnect(const QString &reason);//关闭串口并安排重连
+};
+
+Q_DECLARE_METATYPE(SerialConfig)
+
+#endif // SERIALWORKER_H
@@ -0,0 +1,37 @@
+# 热点路径基准套件：解析、曲线追加、重绘、SQLite写入、Excel导出，结果输出为JSON便于跨版本对比
+# 重绘在离屏平台上进行（未设置QT_QPA_PLATFORM时自动使用offscreen）
+QT       += core gui widgets printsupport sql
+CONFIG   += console c++17
+CONFIG   -= app_bundle
+
+INCLUDEPATH += $$PWD/../..
+# 与主程序相同的曲线数据布局
+DEFINES += QCUSTOMPLOT_USE_SOA_GRAPHDATA
+
+include($$PWD/../../QXlsx/QXlsx.pri)
+INCLUDEPATH += $$PWD/../../QXlsx
+
+HEADERS += \
+    $$PWD/../../boundedqueue.h \
+    $$PWD/../../config.h \
+    $$PWD/../../databaseworker.h \
+    $$PWD/../../excelexport.h \
+    $$PWD/../../frameparser.h \
+    $$PWD/../../latencytrace.h \
+    $$PWD/../../logger.h \
+    $$PWD/../../metrics.h \
+    $$PWD/../../qcustomplot.h \
+    $$PWD/../../quantilesketch.h \
+    $$PWD/../../queuestats.h \
+    $$PWD/../../sensordata.h
+
+SOURCES += \
+    $$PWD/../../config.cpp \
+    $$PWD/../../databaseworker.cpp \
+    $$PWD/../../excelexport.cpp \
+    $$PWD/../../frameparser.cpp \
+    $$PWD/../../latencytrace.cpp \
+    $$PWD/../../logger.cpp \
+    $$PWD/../../metrics.cpp \
+    $$PWD/../../qcustomplot.cpp \
+    main.cpp
@@ -0,0 +1,312 @@
+﻿// hotpathbench - 热点路径基准套件，结果输出为JSON（便于跨版本跟踪性能回退）
+// parse         MsgWorker::managejson的路径：按1460字节分段送入FrameParser，逐帧trimmed后parseSensorData
+// chart_append  Widget::showdata的曲线部分：QCPDataColumns追加一行，超出窗口时删除最旧的行（不含标签和报警）
+// replot        QCustomPlot三条曲线的一次完整重绘，按点数和是否多线程光栅化分组（离屏平台）
+// sqlite_insert DatabaseWorker::insertGreenhouseRows在SQLite文件数据库上的写入吞吐（每批500条一个事务）
+// export        ExcelExporter::writeGreenhouseWorkbook导出10万行（两个工作表和两个图表）
+// 每个用例重复若干次，记录每次耗时，输出最短和中位数的每操作纳秒数。
+//
+// 用法: hotpathbench [-o 结果文件.json] [-f 用例名过滤] [-r 重复次数=5]
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include <functional>
+#include "databaseworker.h"
+#include "excelexport.h"
+#include "frameparser.h"
+#include "qcustomplot.h"
+
+static QTextStream err(stderr);
+
+struct Bench {
+    QString filter;
+    int repeats = 5;
+    QJsonArray results;
+
+    bool enabled(const QString &name) const { return filter.isEmpty() || name.contains(filter); }
+
+    // 执行repeats次，每次完成ops个操作；结果追加到results
+    void measure(const QString &name, const QJsonObject &params, qint64 ops, int runs, const std::function<void()> &run)
+    {
+        QVector<qint64> times;
+        for (int r = 0; r < runs; ++r) {
+            QElapsedTimer timer;
+            timer.start();
+            run();
+            times.append(timer.nsecsElapsed());
+        }
+        std::sort(times.begin(), times.end());
+        const double best = double(times.first()) / ops;
+        const double median = double(times.at(times.size() / 2)) / ops;
+
+        QJsonObject result;
+        result["name"] = name;
+        result["params"] = params;
+        result["ops"] = ops;
+        result["repeats"] = runs;
+        result["ns_per_op_min"] = best;
+        result["ns_per_op_median"] = median;
+        result["ops_per_sec"] = median > 0 ? 1e9 / median : 0.0;
+        result["ms_per_run_median"] = times.at(times.size() / 2) / 1e6;
+        results.append(result);
+
+        err << name << " " << QJsonDocument(params).toJson(QJsonDocument::Compact) << ": "
+            << QString::number(median, 'f', 1) << " ns/op (min " << QString::number(best, 'f', 1) << ")" << Qt::endl;
+    }
+};
+
+static QByteArray makeFrame(int node, qint64 seq, QRandomGenerator &rng)
+{
+    return QString("{Params[node:%1;seq:%2;atemp:%3;ahumi:%4;oxygen:%5;stemp:%6;shumi2:%7;light:%8]}")
+        .arg(node).arg(seq)
+        .arg(15 + rng.bounded(200) / 10.0, 0, 'f', 1).arg(40 + rng.bounded(400) / 10.0, 0, 'f', 1)
+        .arg(20 + rng.bounded(20) / 10.0, 0, 'f', 1).arg(12 + rng.bounded(100) / 10.0, 0, 'f', 1)
+        .arg(20 + rng.bounded(300) / 10.0, 0, 'f', 1).arg(rng.bounded(1000) / 10.0, 0, 'f', 1)
+        .toUtf8();
+}
+
+static SensorData makeReading(qint64 i, QRandomGenerator &rng)
+{
+    SensorData data;
+    data.atemp = 15 + rng.bounded(200) / 10.0;
+    data.ahumi = 40 + rng.bounded(400) / 10.0;
+    data.oxygen = 20 + rng.bounded(20) / 10.0;
+    data.stemp = 12 + rng.bounded(100) / 10.0;
+    data.shumi2 = 20 + rng.bounded(300) / 10.0;
+    data.light = rng.bounded(1000) / 10.0;
+    data.node = int(i % 16);
+    data.seq = i;
+    data.time = QDateTime::currentMSecsSinceEpoch() - 100000 + i;
+    return data;
+}
+
+// MsgWorker::managejson：分帧 + 解析
+static void benchParse(Bench &bench)
+{
+    const int frames = 20000;
+    QRandomGenerator rng(1);
+    QByteArray stream;
+    for (int i = 0; i < frames; ++i) {
+        stream += makeFrame(i % 16, i, rng);
+    }
+    // 按一个TCP段的大小分段到达，帧会跨段
+    QVector<QByteArray> chunks;
+    for (int offset = 0; offset < stream.size(); offset += 1460) {
+        chunks.append(stream.mid(offset, 1460));
+    }
+
+    int parsed = 0;
+    bench.measure("parse", QJsonObject{{"frames", frames}, {"chunk_bytes", 1460}}, frames, bench.repeats, [&]() {
+        FrameParser parser;
+        QByteArray frame;
+        parsed = 0;
+        for (const QByteArray &chunk : chunks) {
+            parser.append(chunk);
+            while (parser.nextFrame(frame)) {
+                SensorData result;
+                if (FrameParser::parseSensorData(QString(frame).trimmed(), result)) {
+                    ++parsed;
+                }
+            }
+        }
+    });
+    if (parsed != frames) {
+        err << "parse: 只解析出" << parsed << "/" << frames << "帧" << Qt::endl;
+    }
+}
+
+// Widget::showdata：追加一行并保持窗口大小
+static void benchChartAppend(Bench &bench)
+{
+    const int appends = 100000;
+    for (int window : {300, 3000, 30000, 300000}) {
+        QCPDataColumns columns(6);
+        double key = 0;
+        double values[6] = {20, 60, 21, 18, 35, 40};
+        for (int i = 0; i < window; ++i) {
+            columns.append(key += 0.1, values);
+        }
+        bench.measure("chart_append", QJsonObject{{"window", window}}, appends, bench.repeats, [&]() {
+            for (int i = 0; i < appends; ++i) {
+                values[i % 6] += 0.01;
+                columns.append(key += 0.1, values);
+                if (columns.size() > window) {
+                    columns.removeFirst(columns.size() - window);
+                }
+            }
+        });
+    }
+}
+
+// QCustomPlot重绘：三条曲线共用一列时间，与主界面一个图表相同
+static void benchReplot(Bench &bench)
+{
+    for (int points : {1000, 10000, 100000, 1000000}) {
+        QSharedPointer<QCPDataColumns> columns(new QCPDataColumns(3));
+        QRandomGenerator rng(2);
+        double values[3] = {20, 60, 21};
+        for (int i = 0; i < points; ++i) {
+            for (double &value : values) {
+                value += (rng.generateDouble() - 0.5) * 0.2;
+            }
+            columns->append(i * 0.1, values);
+        }
+
+        for (bool threaded : {false, true}) {
+            QCustomPlot plot;
+            plot.resize(1200, 600);
+            plot.setThreadedRendering(threaded);
+            for (int channel = 0; channel < 3; ++channel) {
+                plot.addGraph()->setData(QSharedPointer<QCPGraphDataContainer>(new QCPGraphDataContainer(columns, channel)));
+                plot.graph(channel)->setPen(QPen(QColor::fromHsv(channel * 120, 200, 200)));
+            }
+            plot.rescaleAxes();
+            plot.show();
+            plot.replot(QCustomPlot::rpImmediateRefresh); // 预热：布局和缓冲区
+            bench.measure("replot", QJsonObject{{"points", points}, {"graphs", 3}, {"threaded", threaded}}, 1,
+                          qMax(bench.repeats, 10), [&]() {
+                plot.replot(QCustomPlot::rpImmediateRefresh);
+            });
+        }
+    }
+}
+
+// DatabaseWorker写入：每批500条一个事务，与drainStoreQueue相同
+static void benchSqliteInsert(Bench &bench, const QTemporaryDir &dir)
+{
+    const int rows = 100000;
+    const int batchSize = 500;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "bench");
+        db.setDatabaseName(dir.filePath("bench.sqlite"));
+        if (!db.open()) {
+            err << "sqlite_insert: 打开失败 " << db.lastError().text() << Qt::endl;
+            return;
+        }
+        QSqlQuery create(db);
+        create.exec("CREATE TABLE greenhouse_data (entry_id INTEGER PRIMARY KEY AUTOINCREMENT, collect_time TEXT NOT NULL, "
+                    "air_temp REAL, air_humidity REAL, oxygen_content REAL, soil_temp REAL, soil_humidity REAL, light_intensity REAL)");
+        create.exec("CREATE INDEX idx_collect_time ON greenhouse_data (collect_time)");
+
+        QRandomGenerator rng(3);
+        QVector<QVector<SensorData>> batches;
+        for (int i = 0; i < rows; i += batchSize) {
+            QVector<SensorData> batch;
+            for (int j = 0; j < batchSize; ++j) {
+                batch.append(makeReading(i + j, rng));
+            }
+            batches.append(batch);
+        }
+
+        bool ok = true;
+        bench.measure("sqlite_insert", QJsonObject{{"rows", rows}, {"batch", batchSize}}, rows, qMin(bench.repeats, 3), [&]() {
+            for (const QVector<SensorData> &batch : batches) {
+                ok = DatabaseWorker::insertGreenhouseRows(db, batch) && ok;
+            }
+        });
+        if (!ok) {
+            err << "sqlite_insert: 写入失败 " << db.lastError().text() << Qt::endl;
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase("bench");
+}
+
+// Excel导出：10万行
+static void benchExport(Bench &bench, const QTemporaryDir &dir)
+{
+    const int rows = 100000;
+    QRandomGenerator rng(4);
+    QList<QVariantList> results;
+    for (int i = 0; i < rows; ++i) {
+        const SensorData data = makeReading(i, rng);
+        results.append(QVariantList{i + 1, QDateTime::fromMSecsSinceEpoch(data.time), data.atemp, data.ahumi,
+                                    data.oxygen, data.stemp, data.shumi2, data.light});
+    }
+    bool ok = true;
+    const QString fileName = dir.filePath("bench.xlsx");
+    bench.measure("export", QJsonObject{{"rows", rows}}, rows, qMin(bench.repeats, 2), [&]() {
+        ok = ExcelExporter::writeGreenhouseWorkbook(results, fileName) && ok;
+    });
+    if (!ok) {
+        err << "export: 保存失败" << Qt::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // 重绘在离屏平台上进行，无需显示器
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("热点路径基准套件");
+    parser.addHelpOption();
+    parser.addOptions({
+        {{"o", "output"}, "JSON结果文件（默认输出到标准输出）", "file"},
+        {{"f", "filter"}, "只运行名称包含该字符串的用例", "name"},
+        {{"r", "repeats"}, "每个用例的重复次数", "n", "5"},
+    });
+    parser.process(app);
+
+    Bench bench;
+    bench.filter = parser.value("filter");
+    bench.repeats = qMax(1, parser.value("repeats").toInt());
+
+    QTemporaryDir dir;
+    if (bench.enabled("parse")) {
+        benchParse(bench);
+    }
+    if (bench.enabled("chart_append")) {
+        benchChartAppend(bench);
+    }
+    if (bench.enabled("replot")) {
+        benchReplot(bench);
+    }
+    if (bench.enabled("sqlite_insert")) {
+        benchSqliteInsert(bench, dir);
+    }
+    if (bench.enabled("export")) {
+        benchExport(bench, dir);
+    }
+
+    QJsonObject root;
+    root["benchmark"] = "hotpathbench";
+    root["format"] = 1;
+    root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    root["qt"] = qVersion();
+    root["abi"] = QSysInfo::buildAbi();
+    root["os"] = QSysInfo::prettyProductName();
+    root["cpu_threads"] = QThread::idealThreadCount();
+    root["results"] = bench.results;
+    const QByteArray json = QJsonDocument(root).toJson(QJsonDocument::Indented);
+
+    if (parser.isSet("output")) {
+        QFile file(parser.value("output"));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            err << "无法写入 " << file.fileName() << Qt::endl;
+            return 1;
+        }
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+    return 0;
+}
@@ -0,0 +1,32 @@
+# 传感器节点负载发生器：本机回环上N个TCP连接定速发送报文，端到端压测接收链路
+QT       += core network
+QT       -= gui
+CONFIG   += console c++17
+CONFIG   -= app_bundle
+
+INCLUDEPATH += $$PWD/../..
+
+HEADERS += \
+    $$PWD/../../boundedqueue.h \
+    $$PWD/../../frameparser.h \
+    $$PWD/../../latencytrace.h \
+    $$PWD/../../logger.h \
+    $$PWD/../../metrics.h \
+    $$PWD/../../mpscring.h \
+    $$PWD/../../msgworker.h \
+    $$PWD/../../mytcpserver.h \
+    $$PWD/../../packetcapture.h \
+    $$PWD/../../queuestats.h \
+    $$PWD/../../sensordata.h \
+    $$PWD/../../sequencetracker.h
+
+SOURCES += \
+    $$PWD/../../frameparser.cpp \
+    $$PWD/../../latencytrace.cpp \
+    $$PWD/../../logger.cpp \
+    $$PWD/../../metrics.cpp \
+    $$PWD/../../msgworker.cpp \
+    $$PWD/../../mytcpserver.cpp \
+    $$PWD/../../packetcapture.cpp \
+    $$PWD/../../sequencetracker.cpp \
+    main.cpp
@@ -0,0 +1,429 @@
+﻿// loadgen - 传感器节点负载发生器（端到端压测，全部在本机回环上进行）
+// 接收端在本进程内按主程序的方式搭建：MyTcpServer监听127.0.0.1，每个连接一个MsgWorker线程分帧解析，
+// 解析结果进入界面队列（MpscRing，每33ms取256条，与Widget::drainQueues相同）和待入库队列
+// （BoundedQueue溢出到磁盘，每200ms最多取8批×500条，与DatabaseWorker相同，但不写数据库）。
+// 发送端开N个TCP连接（每个连接是一个节点），按总速率和抖动发送 {Params[node;seq;ts;...]} 报文：
+// 可按比例把一次写入拆成几段分开写出（半包），也可把多帧合并为一次写入（粘包），用来检验分帧。
+// ts为发送时刻（微秒），两个队列的消费端据此计算端到端延迟。
+// 结束时输出实际发送/解析速率、两条路径的延迟分位数、队列丢弃数和按序号统计的丢包/乱序。
+//
+// 用法: loadgen [-c 连接数=10] [-r 总速率(条/秒)=1000] [-j 抖动=0.2] [-d 秒数=10]
+//               [-s 拆分比例=0.1] [-b 每次写入最多帧数=1] [-t 发送线程数] [-p 端口]
+// 指定-p时不在本进程内接收，直接向已运行的主程序（127.0.0.1:端口）发送，只输出发送端统计，
+// 接收端的队列深度和丢弃数看主界面连接状态的悬停提示。
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QRandomGenerator>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include "boundedqueue.h"
+#include "latencytrace.h"
+#include "metrics.h"
+#include "mpscring.h"
+#include "msgworker.h"
+#include "mytcpserver.h"
+#include "sequencetracker.h"
+
+static QTextStream out(stdout);
+
+struct Options {
+    int connections = 10;
+    double rate = 1000;     // 全部连接合计每秒帧数
+    double jitter = 0.2;    // 发送间隔在 [1-jitter, 1+jitter] 倍之间随机
+    double duration = 10;   // 发送秒数
+    double splitRatio = 0.1;// 被拆成几段写出的写入比例
+    int coalesce = 1;       // 每次写入最多合并的帧数
+    int threads = 1;        // 发送线程数
+    quint16 port = 0;       // 0表示在本进程内接收
+};
+
+// 发送端统计（各发送线程累加）
+struct SendStats {
+    std::atomic<quint64> frames{0};
+    std::atomic<quint64> writes{0};      // 写入次数（合并的多帧算一次）
+    std::atomic<quint64> splitWrites{0}; // 被拆成几段写出的写入次数
+    std::atomic<quint64> bytes{0};
+    std::atomic<int> connected{0};
+    std::atomic<int> failed{0};          // 连接或写入失败的连接数
+};
+
+// 本进程内的接收链路
+struct Pipeline {
+    QSharedPointer<MpscRing<SensorData>> ui{new MpscRing<SensorData>("ui", 1024)};
+    QSharedPointer<BoundedQueue<SensorData>> store{new BoundedQueue<SensorData>("store", 10000, OverflowPolicy::SpillToDisk)};
+    std::atomic<quint64> parsed{0};
+    std::atomic<bool> stopStore{false};
+    std::vector<qint64> uiLatencyUs;    // 只由界面定时器（主线程）写入
+    std::vector<qint64> storeLatencyUs; // 只由入库线程写入
+    SequenceTracker storeSeq;           // 入库路径不丢数据，这里的丢失说明分帧或解析出了问题
+};
+
+// 墙上时钟（微秒），与报文中的ts字段一致
+static qint64 nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static void appendFrame(QByteArray &payload, int node, qint64 seq, QRandomGenerator &rng)
+{
+    payload += "{Params[node:";
+    payload += QByteArray::number(node);
+    payload += ";seq:";
+    payload += QByteArray::number(seq);
+    payload += ";ts:";
+    payload += QByteArray::number(nowUs());
+    payload += ";atemp:";
+    payload += QByteArray::number(15 + rng.bounded(200) / 10.0, 'f', 1);
+    payload += ";ahumi:";
+    payload += QByteArray::number(40 + rng.bounded(400) / 10.0, 'f', 1);
+    payload += ";oxygen:";
+    payload += QByteArray::number(20 + rng.bounded(20) / 10.0, 'f', 1);
+    payload += ";stemp:";
+    payload += QByteArray::number(12 + rng.bounded(100) / 10.0, 'f', 1);
+    payload += ";shumi2:";
+    payload += QByteArray::number(20 + rng.bounded(300) / 10.0, 'f', 1);
+    payload += ";light:";
+    payload += QByteArray::number(rng.bounded(1000) / 10.0, 'f', 1);
+    payload += "]}";
+}
+
+static bool writeAll(QTcpSocket *socket, const char *data, qint64 size)
+{
+    if (socket->write(data, size) != size) {
+        return false;
+    }
+    while (socket->bytesToWrite() > 0) {
+        if (!socket->waitForBytesWritten(3000)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 一个发送线程：负责若干个节点，每个节点一个阻塞模式的QTcpSocket
+static void runSender(const Options &options, const QVector<int> &nodeIds, const QElapsedTimer &clock,
+                      qint64 endNs, SendStats *stats)
+{
+    struct Node {
+        QTcpSocket *socket = nullptr;
+        int id = 0;
+        qint64 seq = 0;
+        qint64 dueNs = 0; // 下一次写入的计划时刻（相对开始时刻）
+    };
+
+    QRandomGenerator rng(quint32(nodeIds.first()) * 7919u + 1u);
+    const double intervalNs = 1e9 * options.connections / options.rate; // 每个节点的平均发送间隔
+    std::vector<Node> nodes;
+    for (int id : nodeIds) {
+        Node node;
+        node.id = id;
+        node.socket = new QTcpSocket;
+        node.socket->connectToHost(QHostAddress::LocalHost, options.port);
+        if (!node.socket->waitForConnected(3000)) {
+            stats->failed++;
+            delete node.socket;
+            continue;
+        }
+        // 关闭Nagle，拆开的几段各自成为一个TCP段
+        node.socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        node.dueNs = qint64(rng.generateDouble() * intervalNs); // 各节点错开
+        nodes.push_back(node);
+        stats->connected++;
+    }
+
+    QByteArray payload;
+    while (!nodes.empty()) {
+        auto next = std::min_element(nodes.begin(), nodes.end(),
+                                     [](const Node &a, const Node &b) { return a.dueNs < b.dueNs; });
+        if (next->dueNs >= endNs) {
+            break;
+        }
+        // 等到计划时刻：还早时睡眠，最后1ms让出CPU等待
+        const qint64 waitNs = next->dueNs - clock.nsecsElapsed();
+        if (waitNs > 2000000) {
+            QThread::usleep(quint64((waitNs - 1000000) / 1000));
+        }
+        while (clock.nsecsElapsed() < next->dueNs) {
+            QThread::yieldCurrentThread();
+        }
+
+        // 粘包：一次写入1~coalesce帧
+        const int count = options.coalesce > 1 ? 1 + int(rng.bounded(options.coalesce)) : 1;
+        payload.clear();
+        for (int i = 0; i < count; ++i) {
+            appendFrame(payload, next->id, next->seq++, rng);
+            next->dueNs += qint64(intervalNs * (1 + options.jitter * (2 * rng.generateDouble() - 1)));
+        }
+
+        bool ok = true;
+        if (options.splitRatio > 0 && rng.generateDouble() < options.splitRatio) {
+            // 半包：在随机位置拆成2~4段，每段单独写出，段之间稍作停顿，接收端会分几次读到
+            std::vector<int> cuts;
+            const int pieces = 2 + int(rng.bounded(3));
+            for (int i = 1; i < pieces; ++i) {
+                cuts.push_back(1 + int(rng.bounded(payload.size() - 1)));
+            }
+            cuts.push_back(int(payload.size()));
+            std::sort(cuts.begin(), cuts.end());
+            int from = 0;
+            for (int cut : cuts) {
+                if (cut <= from) {
+                    continue;
+                }
+                ok = ok && writeAll(next->socket, payload.constData() + from, cut - from);
+                from = cut;
+                if (cut < payload.size()) {
+                    QThread::usleep(100);
+                }
+            }
+            stats->splitWrites++;
+        } else {
+            ok = writeAll(next->socket, payload.constData(), payload.size());
+        }
+        if (!ok) {
+            stats->failed++;
+            next->socket->abort();
+            delete next->socket;
+            nodes.erase(next);
+            continue;
+        }
+        stats->frames += count;
+        stats->writes++;
+        stats->bytes += payload.size();
+    }
+
+    for (Node &node : nodes) {
+        node.socket->disconnectFromHost();
+        if (node.socket->state() != QAbstractSocket::UnconnectedState) {
+            node.socket->waitForDisconnected(1000);
+        }
+        delete node.socket;
+    }
+}
+
+// 取出的一批读数：记录延迟
+static void recordLatency(const QVector<SensorData> &readings, std::vector<qint64> &latencies)
+{
+    const qint64 now = nowUs();
+    for (const SensorData &data : readings) {
+        if (data.sent > 0) {
+            latencies.push_back(now - data.sent);
+        }
+    }
+}
+
+static QString latencyLine(std::vector<qint64> &latencies)
+{
+    if (latencies.empty()) {
+        return "no samples";
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto at = [&latencies](double q) {
+        const size_t index = std::min(latencies.size() - 1, size_t(q * latencies.size()));
+        return QString::number(latencies[index] / 1000.0, 'f', 2);
+    };
+    return QString("p50 %1 ms, p90 %2 ms, p99 %3 ms, p99.9 %4 ms, max %5 ms")
+        .arg(at(0.5), at(0.9), at(0.99), at(0.999), at(1.0));
+}
+
+static QString queueLine(const QueueStats &q)
+{
+    return QString("队列[%1] 深度:%2/%3 峰值:%4 溢出到磁盘:%5 丢弃:%6")
+        .arg(q.name).arg(q.depth).arg(q.capacity).arg(q.highWater).arg(q.spilled).arg(q.dropped);
+}
+
+// 接收线程内某一阶段的中位数和p99（LatencyTrace记录的直方图，微秒）
+static QString stageLine(const char *stage)
+{
+    const MetricHistogram *histogram = Metrics::instance().histogram(
+        "sensor_latency_seconds", "读数各阶段的延迟", 1e-6, QString("stage=\"%1\"").arg(QLatin1String(stage)));
+    return QString("%1 p50 %2 us / p99 %3 us").arg(QLatin1String(stage))
+        .arg(histogram->quantile(0.5)).arg(histogram->quantile(0.99));
+}
+
+// 未启动Logger时MsgWorker等的日志经由Qt输出，压测时只保留警告以上
+static QtMessageHandler s_defaultHandler = nullptr;
+static void quietHandler(QtMsgType type, const QMessageLogContext &context, const QString &message)
+{
+    if (type != QtDebugMsg && s_defaultHandler) {
+        s_defaultHandler(type, context, message);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    s_defaultHandler = qInstallMessageHandler(quietHandler);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("传感器节点负载发生器");
+    parser.addHelpOption();
+    parser.addOptions({
+        {{"c", "connections"}, "连接（节点）数", "n", "10"},
+        {{"r", "rate"}, "全部连接合计每秒帧数", "fps", "1000"},
+        {{"j", "jitter"}, "发送间隔抖动比例（0~1）", "ratio", "0.2"},
+        {{"d", "duration"}, "发送秒数", "seconds", "10"},
+        {{"s", "split"}, "拆成几段写出的写入比例（0~1）", "ratio", "0.1"},
+        {{"b", "coalesce"}, "每次写入最多合并的帧数", "n", "1"},
+        {{"t", "threads"}, "发送线程数（默认取连接数与CPU核数的较小值）", "n"},
+        {{"p", "port"}, "向已运行的主程序的端口发送（不在本进程内接收）", "port"},
+    });
+    parser.process(app);
+
+    Options options;
+    options.connections = parser.value("connections").toInt();
+    options.rate = parser.value("rate").toDouble();
+    options.jitter = qBound(0.0, parser.value("jitter").toDouble(), 1.0);
+    options.duration = parser.value("duration").toDouble();
+    options.splitRatio = qBound(0.0, parser.value("split").toDouble(), 1.0);
+    options.coalesce = qMax(1, parser.value("coalesce").toInt());
+    options.threads = parser.isSet("threads") ? parser.value("threads").toInt()
+                                              : qMin(options.connections, QThread::idealThreadCount());
+    options.threads = qBound(1, options.threads, qMax(1, options.connections));
+    options.port = quint16(parser.value("port").toUInt());
+    if (options.connections < 1 || options.rate <= 0 || options.duration <= 0) {
+        parser.showHelp(2);
+    }
+
+    // 本进程内的接收链路（与Widget::connectIngest相同：解析线程直接写两个队列）
+    const bool hosted = options.port == 0;
+    MyTcpServer server;
+    Pipeline pipe;
+    QThread *storeThread = nullptr;
+    if (hosted) {
+        if (!server.listen(QHostAddress::LocalHost, 0)) {
+            out << "监听失败: " << server.errorString() << Qt::endl;
+            return 1;
+        }
+        options.port = server.serverPort();
+        QObject::connect(&server, &MyTcpServer::newDescriptor, &app, [&app, &pipe](qintptr socket) {
+            MsgWorker *worker = new MsgWorker(socket);
+            QObject::connect(worker, &MsgWorker::showsensordata, worker, [&pipe](SensorData data) {
+                pipe.parsed++;
+                LatencyTrace::recordEnqueued(data);
+                pipe.ui->push(data);
+                pipe.store->push(data);
+            }, Qt::DirectConnection);
+            QObject::connect(worker, &MsgWorker::deletethread, &app, [worker]() {
+                worker->wait();
+                worker->deleteLater();
+            });
+            worker->start();
+        });
+
+        // 界面路径：每帧取一次
+        QTimer *frameTimer = new QTimer(&app);
+        QObject::connect(frameTimer, &QTimer::timeout, &app, [&pipe]() {
+            QVector<SensorData> readings;
+            pipe.ui->popBatch(readings, 256);
+            recordLatency(readings, pipe.uiLatencyUs);
+        });
+        frameTimer->start(33);
+
+        // 入库路径：与DatabaseWorker相同的节奏，停止时取空为止
+        storeThread = QThread::create([&pipe]() {
+            QVector<SensorData> batch;
+            for (;;) {
+                const bool stopping = pipe.stopStore.load();
+                int taken = 0;
+                for (int i = 0; i < 8 || stopping; ++i) {
+                    batch.clear();
+                    const int n = pipe.store->popBatch(batch, 500);
+                    if (n == 0) {
+                        break;
+                    }
+                    taken += n;
+                    recordLatency(batch, pipe.storeLatencyUs);
+                    for (const SensorData &data : batch) {
+                        pipe.storeSeq.record(data.node, data.seq);
+                    }
+                }
+                if (stopping && taken == 0) {
+                    return;
+                }
+                QThread::msleep(200);
+            }
+        });
+        storeThread->start();
+    }
+
+    out << "目标 127.0.0.1:" << options.port << "，" << options.connections << "个连接，" << options.rate
+        << "帧/秒，抖动" << options.jitter << "，拆分" << options.splitRatio << "，合并最多" << options.coalesce
+        << "帧，" << options.threads << "个发送线程，" << options.duration << "秒" << Qt::endl;
+
+    // 节点按轮转分给各发送线程
+    SendStats sendStats;
+    QElapsedTimer clock;
+    clock.start();
+    const qint64 endNs = qint64(options.duration * 1e9);
+    std::vector<QThread *> senders;
+    for (int t = 0; t < options.threads; ++t) {
+        QVector<int> nodeIds;
+        for (int node = t + 1; node <= options.connections; node += options.threads) {
+            nodeIds.append(node);
+        }
+        senders.push_back(QThread::create(runSender, options, nodeIds, std::cref(clock), endNs, &sendStats));
+        senders.back()->start();
+    }
+
+    // 发送结束后等待接收端取空（最多5秒），然后输出结果
+    qint64 sendEndNs = -1;
+    quint64 lastParsed = 0;
+    QTimer *finishTimer = new QTimer(&app);
+    QObject::connect(finishTimer, &QTimer::timeout, &app, [&]() {
+        if (sendEndNs < 0) {
+            for (QThread *sender : senders) {
+                if (!sender->isFinished()) {
+                    return;
+                }
+            }
+            sendEndNs = clock.nsecsElapsed();
+        }
+        const quint64 parsed = pipe.parsed.load();
+        const bool settled = parsed == lastParsed && pipe.ui->stats().depth == 0 && pipe.store->stats().depth == 0;
+        lastParsed = parsed;
+        if (hosted && !settled && clock.nsecsElapsed() - sendEndNs < 5000000000LL) {
+            return;
+        }
+        finishTimer->stop();
+
+        const double sendSeconds = sendEndNs / 1e9;
+        const quint64 frames = sendStats.frames.load();
+        out << "发送: " << frames << "帧，" << qint64(frames / sendSeconds) << "帧/秒，写入" << sendStats.writes.load()
+            << "次（拆分" << sendStats.splitWrites.load() << "次），" << sendStats.bytes.load() / 1024 << " KB，连接成功"
+            << sendStats.connected.load() << "，失败" << sendStats.failed.load() << Qt::endl;
+        if (hosted) {
+            pipe.stopStore = true;
+            storeThread->wait();
+            const SeqStats seq = pipe.storeSeq.total();
+            out << "解析: " << parsed << "帧（" << QString::number(frames ? 100.0 * parsed / frames : 0, 'f', 2)
+                << "%），" << qint64(parsed / sendSeconds) << "帧/秒" << Qt::endl;
+            out << "界面路径延迟: " << pipe.uiLatencyUs.size() << "帧，" << latencyLine(pipe.uiLatencyUs) << Qt::endl;
+            out << "入库路径延迟: " << pipe.storeLatencyUs.size() << "帧，" << latencyLine(pipe.storeLatencyUs) << Qt::endl;
+            out << "接收线程内: " << stageLine("parse") << "，" << stageLine("enqueue") << Qt::endl;
+            out << queueLine(pipe.ui->stats()) << Qt::endl;
+            out << queueLine(pipe.store->stats()) << Qt::endl;
+            out << "序号统计: 丢包:" << seq.lost << " 乱序:" << seq.reordered << " 重复:" << seq.duplicates
+                << " 过旧:" << seq.late << " 重启:" << seq.resets << " 跳跃:" << seq.jumps << Qt::endl;
+        }
+        for (QThread *sender : senders) {
+            delete sender;
+        }
+        app.quit();
+    });
+    finishTimer->start(100);
+
+    const int result = app.exec();
+    delete storeThread;
+    return result;
+}
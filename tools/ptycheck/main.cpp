@@ -0,0 +1,238 @@
+﻿// ptycheck - SerialWorker的伪终端检查（只支持Linux）
+// 用openpty创建一对伪终端，SerialWorker按主程序的方式运行在独立线程中，打开指向从端的符号链接；
+// 本线程从主端写入报文，按1、3、7、13...这样的奇数长度切开分多次写，报文边界落在任意位置。
+// 第一段写完后先写半帧再关闭伪终端（相当于USB转串口被拔出），SerialWorker应报告断开并按间隔重连；
+// 随后新建一对伪终端并把符号链接指向新的从端，SerialWorker应自动重新打开，第二段报文照常解析，
+// 重连后先写入断开前那一帧的后半截：断开前的半帧已被丢弃时它只是无帧头的杂散字节，拼上了就会多出一条读数。
+// 最后核对打开/断开次数、收到的读数条数以及每条读数的节点和序号；全部一致时退出码为0，否则为1。
+//
+// 用法: ptycheck [每段报文条数，默认200]
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QTextStream>
+#include <QThread>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <pty.h>
+#include <termios.h>
+#include <unistd.h>
+#include <cstdio>
+#include "serialworker.h"
+
+static QTextStream out(stdout);
+static int failures = 0;
+
+static void check(const char *name, qint64 actual, qint64 expected)
+{
+    const bool ok = actual == expected;
+    if (!ok) {
+        failures++;
+    }
+    out << (ok ? "通过  " : "失败  ") << name << ": " << actual;
+    if (!ok) {
+        out << "（预期 " << expected << "）";
+    }
+    out << Qt::endl;
+}
+
+// 在timeoutMs内轮询条件，满足时返回true
+static bool waitFor(const std::function<bool()> &condition, int timeoutMs = 5000)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!condition()) {
+        if (timer.elapsed() > timeoutMs) {
+            return false;
+        }
+        QThread::msleep(10);
+    }
+    return true;
+}
+
+static QByteArray frame(int node, qint64 seq)
+{
+    return "{Params[node:" + QByteArray::number(node) + ";seq:" + QByteArray::number(seq)
+           + ";atemp:21.5;ahumi:55.0;oxygen:20.9;stemp:18.0;shumi2:30.0;light:800]}\r\n";
+}
+
+// 一对伪终端；从端设为原始模式，避免行规程改写字节或回显
+struct Pty {
+    int master = -1;
+    int slave = -1;
+    QString slaveName;
+
+    bool open()
+    {
+        char name[256] = {0};
+        if (::openpty(&master, &slave, name, nullptr, nullptr) < 0) {
+            return false;
+        }
+        termios tio;
+        ::tcgetattr(slave, &tio);
+        ::cfmakeraw(&tio);
+        ::tcsetattr(slave, TCSANOW, &tio);
+        slaveName = QString::fromLocal8Bit(name);
+        return true;
+    }
+
+    void close()
+    {
+        if (slave >= 0) {
+            ::close(slave);
+            slave = -1;
+        }
+        if (master >= 0) {
+            ::close(master);
+            master = -1;
+        }
+    }
+};
+
+// 把符号链接link原子地指向target
+static bool pointLink(const QString &link, const QString &target)
+{
+    const QByteArray tmp = (link + ".new").toLocal8Bit();
+    ::unlink(tmp.constData());
+    if (::symlink(target.toLocal8Bit().constData(), tmp.constData()) < 0) {
+        return false;
+    }
+    return ::rename(tmp.constData(), link.toLocal8Bit().constData()) == 0;
+}
+
+// 按奇数长度切开data，分多次写入主端；每次写后稍停，让读端分多次读到
+static bool writeSplit(int fd, const QByteArray &data)
+{
+    static const int kChunks[] = {1, 3, 7, 13, 29, 61, 5, 17};
+    int offset = 0;
+    int i = 0;
+    while (offset < data.size()) {
+        const int len = qMin(kChunks[i++ % 8], int(data.size()) - offset);
+        const ssize_t written = ::write(fd, data.constData() + offset, size_t(len));
+        if (written <= 0) {
+            return false;
+        }
+        offset += int(written);
+        QThread::usleep(500);
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const int count = argc > 1 ? qMax(1, QString(argv[1]).toInt()) : 200;
+    const QString link = QDir::tempPath() + QString("/ptycheck-%1").arg(QCoreApplication::applicationPid());
+
+    Pty pty;
+    if (!pty.open() || !pointLink(link, pty.slaveName)) {
+        out << "无法创建伪终端" << Qt::endl;
+        return 2;
+    }
+
+    QThread thread;
+    SerialWorker *worker = new SerialWorker;
+    worker->moveToThread(&thread);
+    QObject::connect(&thread, &QThread::finished, worker, &QObject::deleteLater);
+
+    std::atomic<int> opened{0};
+    std::atomic<int> closed{0};
+    QMutex readingsMutex;
+    QVector<SensorData> readings;
+    QObject::connect(worker, &SerialWorker::showsensordata, worker, [&](SensorData d) {
+        QMutexLocker locker(&readingsMutex);
+        readings.append(d);
+    }, Qt::DirectConnection);
+    QObject::connect(worker, &SerialWorker::portStatusChanged, worker, [&](bool isOpen, const QString &message) {
+        (isOpen ? opened : closed)++;
+        out << message << Qt::endl;
+    }, Qt::DirectConnection);
+    auto received = [&]() {
+        QMutexLocker locker(&readingsMutex);
+        return readings.size();
+    };
+    thread.start();
+
+    SerialConfig config;
+    config.portName = link;
+    config.reconnectIntervalMs = 200;
+    QMetaObject::invokeMethod(worker, [worker, config]() { worker->openPort(config); }, Qt::QueuedConnection);
+    if (!waitFor([&]() { return opened >= 1; })) {
+        out << "串口未能打开" << Qt::endl;
+        failures++;
+    }
+
+    // 第一段：节点1，序号0..count-1
+    QByteArray first;
+    for (int seq = 0; seq < count; ++seq) {
+        first += frame(1, seq);
+    }
+    if (!writeSplit(pty.master, first)) {
+        out << "写入伪终端失败" << Qt::endl;
+        failures++;
+    }
+    waitFor([&]() { return received() >= count; });
+    check("第一段读数", received(), count);
+
+    // 写半帧后关闭伪终端
+    const QByteArray cut = frame(1, count);
+    writeSplit(pty.master, cut.left(30));
+    QThread::msleep(50);
+    pty.close();
+    if (!waitFor([&]() { return closed >= 1; })) {
+        out << "关闭伪终端后没有报告断开" << Qt::endl;
+    }
+    check("报告断开", closed >= 1 ? 1 : 0, 1);
+
+    // 新建伪终端并把符号链接指向它，等待自动重连
+    Pty second;
+    if (!second.open() || !pointLink(link, second.slaveName)) {
+        out << "无法重建伪终端" << Qt::endl;
+        failures++;
+    }
+    const bool reconnected = waitFor([&]() { return opened >= 2; });
+    check("重连后打开", reconnected ? 1 : 0, 1);
+
+    // 第二段：断开前那一帧的后半截，然后是节点2的序号0..count-1
+    QByteArray rest = cut.mid(30);
+    for (int seq = 0; seq < count; ++seq) {
+        rest += frame(2, seq);
+    }
+    if (reconnected && !writeSplit(second.master, rest)) {
+        out << "写入伪终端失败" << Qt::endl;
+        failures++;
+    }
+    waitFor([&]() { return received() >= 2 * count; });
+    QThread::msleep(100); // 多出来的读数（例如半帧被拼上）也要收进来
+
+    QMetaObject::invokeMethod(worker, &SerialWorker::closePort, Qt::BlockingQueuedConnection);
+    second.close();
+    ::unlink(link.toLocal8Bit().constData());
+
+    QVector<SensorData> got;
+    {
+        QMutexLocker locker(&readingsMutex);
+        got = readings;
+    }
+    check("读数总数", got.size(), 2 * count);
+    int mismatched = 0;
+    for (int i = 0; i < got.size() && i < 2 * count; ++i) {
+        const int node = i < count ? 1 : 2;
+        const qint64 seq = i % count;
+        if (got[i].node != node || got[i].seq != seq || got[i].atemp != 21.5 || got[i].light != 800) {
+            if (mismatched++ < 5) {
+                out << "  第" << i << "条: 节点" << got[i].node << " 序号" << got[i].seq
+                    << "（预期 节点" << node << " 序号" << seq << "）" << Qt::endl;
+            }
+        }
+    }
+    check("内容不一致的读数", mismatched, 0);
+
+    thread.quit();
+    thread.wait();
+    out << (failures == 0 ? "全部通过" : "有不一致的项") << Qt::endl;
+    return failures == 0 ? 0 : 1;
+}
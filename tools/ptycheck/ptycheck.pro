@@ -0,0 +1,26 @@
+# SerialWorker伪终端检查：经openpty创建的伪终端发送拆包的报文，关闭并重建伪终端后核对解析结果和自动重连（只支持Linux）
+QT       += core serialport
+QT       -= gui
+CONFIG   += console c++17
+CONFIG   -= app_bundle
+
+!linux: error("ptycheck使用openpty，只支持Linux")
+LIBS += -lutil
+
+INCLUDEPATH += $$PWD/../..
+
+HEADERS += \
+    $$PWD/../../frameparser.h \
+    $$PWD/../../latencytrace.h \
+    $$PWD/../../logger.h \
+    $$PWD/../../metrics.h \
+    $$PWD/../../sensordata.h \
+    $$PWD/../../serialworker.h
+
+SOURCES += \
+    $$PWD/../../frameparser.cpp \
+    $$PWD/../../latencytrace.cpp \
+    $$PWD/../../logger.cpp \
+    $$PWD/../../metrics.cpp \
+    $$PWD/../../serialworker.cpp \
+    main.cpp
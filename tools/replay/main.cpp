@@ -0,0 +1,205 @@
+﻿// replay - 回放主程序用 --capture 记录的抓包文件
+// 默认不经过套接字：每个会话一个MsgWorker（不启动线程），按记录顺序把每次读到的字节交给MsgWorker::ingest，
+// 与线上完全相同的分帧、解析、指标和延迟统计代码；输出解析出的帧数、解析失败数和结果摘要。
+// 摘要是按顺序对（会话, 节点, 序号, 六个数值）求的FNV-1a哈希，同一抓包文件每次回放都相同，
+// 修改分帧/解析代码后摘要变化即说明行为有变。
+// 指定-p时改为向运行中的主程序（默认127.0.0.1）按会话开TCP连接重放，经过完整的接收、队列、入库和显示链路。
+// 速度：-x 1按原始节奏（默认），-x 2两倍速，-x 0尽快发送（用于压测）。
+//
+// 用法: replay 抓包文件 [-x 速度=1] [-p 端口] [-H 主机=127.0.0.1]
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QThread>
+#include "latencytrace.h"
+#include "metrics.h"
+#include "msgworker.h"
+#include "packetcapture.h"
+
+static QTextStream out(stdout);
+
+// 按原始节奏回放时等到记录的时刻（speed<=0时不等待）
+static void waitUntil(const QElapsedTimer &clock, qint64 timeUs, double speed)
+{
+    if (speed <= 0) {
+        return;
+    }
+    const qint64 target = qint64(timeUs / speed);
+    const qint64 now = clock.nsecsElapsed() / 1000;
+    if (target > now) {
+        QThread::usleep(quint64(target - now));
+    }
+}
+
+static void fnv1a(quint64 &hash, const void *data, size_t size)
+{
+    const uchar *bytes = static_cast<const uchar *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+}
+
+struct ReplayStats {
+    quint64 records = 0;
+    quint64 bytes = 0;
+    quint64 sessions = 0;
+    quint64 frames = 0;
+    quint64 digest = 0xCBF29CE484222325ull;
+};
+
+// 直接送入分帧和解析
+static bool replayDirect(PacketCaptureReader &reader, double speed, ReplayStats &stats)
+{
+    QHash<quint32, MsgWorker *> workers;
+    QElapsedTimer clock;
+    clock.start();
+    PacketCapture::Record record;
+    while (reader.next(record)) {
+        waitUntil(clock, record.timeUs, speed);
+        stats.records++;
+        MsgWorker *worker = workers.value(record.connection);
+        if (!worker && record.type != PacketCapture::Closed) {
+            worker = new MsgWorker(-1);
+            const quint32 session = record.connection;
+            QObject::connect(worker, &MsgWorker::showsensordata, worker, [&stats, session](SensorData data) {
+                LatencyTrace::recordEnqueued(data);
+                stats.frames++;
+                const qint64 node = data.node;
+                const double values[6] = {data.atemp, data.ahumi, data.oxygen, data.stemp, data.shumi2, data.light};
+                fnv1a(stats.digest, &session, sizeof(session));
+                fnv1a(stats.digest, &node, sizeof(node));
+                fnv1a(stats.digest, &data.seq, sizeof(data.seq));
+                fnv1a(stats.digest, values, sizeof(values));
+            }, Qt::DirectConnection);
+            workers.insert(record.connection, worker);
+            stats.sessions++;
+        }
+        switch (record.type) {
+        case PacketCapture::Opened:
+            break;
+        case PacketCapture::Data:
+            stats.bytes += quint64(record.bytes.size());
+            worker->ingest(record.bytes, LatencyTrace::now());
+            break;
+        case PacketCapture::Closed:
+            delete workers.take(record.connection);
+            break;
+        }
+    }
+    qDeleteAll(workers);
+    return reader.errorString().isEmpty();
+}
+
+// 经TCP发给运行中的主程序，每个会话一个连接
+static bool replaySockets(PacketCaptureReader &reader, double speed, const QString &host, quint16 port, ReplayStats &stats)
+{
+    QHash<quint32, QTcpSocket *> sockets;
+    auto closeSocket = [](QTcpSocket *socket) {
+        socket->disconnectFromHost();
+        if (socket->state() != QAbstractSocket::UnconnectedState) {
+            socket->waitForDisconnected(1000);
+        }
+        delete socket;
+    };
+
+    QElapsedTimer clock;
+    clock.start();
+    PacketCapture::Record record;
+    while (reader.next(record)) {
+        waitUntil(clock, record.timeUs, speed);
+        stats.records++;
+        QTcpSocket *socket = sockets.value(record.connection);
+        if (!socket && record.type != PacketCapture::Closed) {
+            socket = new QTcpSocket;
+            socket->connectToHost(host, port);
+            if (!socket->waitForConnected(3000)) {
+                out << "连接" << host << ":" << port << "失败: " << socket->errorString() << Qt::endl;
+                delete socket;
+                for (QTcpSocket *open : std::as_const(sockets)) {
+                    closeSocket(open);
+                }
+                return false;
+            }
+            socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+            sockets.insert(record.connection, socket);
+            stats.sessions++;
+        }
+        switch (record.type) {
+        case PacketCapture::Opened:
+            break;
+        case PacketCapture::Data:
+            stats.bytes += quint64(record.bytes.size());
+            socket->write(record.bytes);
+            // 每次写入单独发出，尽量保持原来的分段
+            while (socket->bytesToWrite() > 0 && socket->waitForBytesWritten(3000)) {
+            }
+            break;
+        case PacketCapture::Closed:
+            if (socket) {
+                closeSocket(sockets.take(record.connection));
+            }
+            break;
+        }
+    }
+    for (QTcpSocket *socket : std::as_const(sockets)) {
+        closeSocket(socket);
+    }
+    return reader.errorString().isEmpty();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("抓包回放");
+    parser.addHelpOption();
+    parser.addPositionalArgument("capture", "主程序 --capture 记录的抓包文件");
+    parser.addOptions({
+        {{"x", "speed"}, "回放速度：1为原始节奏，0为尽快", "factor", "1"},
+        {{"p", "port"}, "经TCP发给运行中的主程序的端口（不指定时直接送入分帧解析）", "port"},
+        {{"H", "host"}, "主程序地址", "host", "127.0.0.1"},
+    });
+    parser.process(app);
+    if (parser.positionalArguments().size() != 1) {
+        parser.showHelp(2);
+    }
+
+    PacketCaptureReader reader;
+    if (!reader.open(parser.positionalArguments().constFirst())) {
+        out << "无法读取抓包文件: " << reader.errorString() << Qt::endl;
+        return 1;
+    }
+    const double speed = parser.value("speed").toDouble();
+    const bool direct = !parser.isSet("port");
+    out << "抓包开始于 " << QDateTime::fromMSecsSinceEpoch(reader.startMs()).toString("yyyy-MM-dd HH:mm:ss")
+        << "，" << (direct ? "直接送入分帧解析" : "经TCP发送") << "，速度"
+        << (speed > 0 ? QString::number(speed) + "倍" : QString("尽快")) << Qt::endl;
+
+    ReplayStats stats;
+    QElapsedTimer elapsed;
+    elapsed.start();
+    const bool complete = direct ? replayDirect(reader, speed, stats)
+                                 : replaySockets(reader, speed, parser.value("host"), quint16(parser.value("port").toUInt()), stats);
+    const double seconds = qMax(1e-9, elapsed.nsecsElapsed() / 1e9);
+
+    out << "会话: " << stats.sessions << "，记录: " << stats.records << "，字节: " << stats.bytes << "，耗时 "
+        << QString::number(seconds, 'f', 3) << " 秒（" << QString::number(stats.bytes / seconds / 1e6, 'f', 1) << " MB/s）" << Qt::endl;
+    if (direct) {
+        const quint64 failures = Metrics::instance()
+                                     .counter("sensor_parse_failures_total", "格式错误、无法解析的报文数", "transport=\"tcp\"")
+                                     ->value();
+        out << "解析: " << stats.frames << "帧（" << qint64(stats.frames / seconds) << "帧/秒），解析失败: " << failures
+            << "，摘要: " << QString::number(stats.digest, 16).rightJustified(16, '0') << Qt::endl;
+    }
+    if (!reader.errorString().isEmpty()) {
+        out << "抓包文件不完整: " << reader.errorString() << Qt::endl;
+    }
+    return complete ? 0 : 1;
+}
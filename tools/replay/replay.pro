@@ -0,0 +1,25 @@
+# 抓包回放：把--capture记录的TCP会话重新送入接收链路（直接送入分帧解析，或经TCP发给运行中的主程序）
+QT       += core network
+QT       -= gui
+CONFIG   += console c++17
+CONFIG   -= app_bundle
+
+INCLUDEPATH += $$PWD/../..
+
+HEADERS += \
+    $$PWD/../../frameparser.h \
+    $$PWD/../../latencytrace.h \
+    $$PWD/../../logger.h \
+    $$PWD/../../metrics.h \
+    $$PWD/../../msgworker.h \
+    $$PWD/../../packetcapture.h \
+    $$PWD/../../sensordata.h
+
+SOURCES += \
+    $$PWD/../../frameparser.cpp \
+    $$PWD/../../latencytrace.cpp \
+    $$PWD/../../logger.cpp \
+    $$PWD/../../metrics.cpp \
+    $$PWD/../../msgworker.cpp \
+    $$PWD/../../packetcapture.cpp \
+    main.cpp
@@ -0,0 +1,262 @@
+﻿// ringbench - MpscRing压力测试与基准
+// 1. 压力测试：多个生产者线程各自写入递增序号，消费者检查每个生产者的序号连续且不丢不重
+// 2. 吞吐对比：N条读数分别走排队信号（改造前MsgWorker -> Widget的方式）和MpscRing
+// 3. 定速对比：以每秒100万条的速率持续写入，比较两条路径的积压和丢弃
+// 2、3中MpscRing路径还核对条数：消费者取出的条数加上丢弃的条数应等于写入的条数，否则返回1
+//
+// 用法: ringbench [生产者数=4] [读数条数=1000000]
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QTextStream>
+#include <atomic>
+#include <vector>
+#include "mpscring.h"
+#include "sensordata.h"
+
+static QTextStream out(stdout);
+
+// 排队信号路径的发送端和接收端
+class Emitter : public QObject
+{
+    Q_OBJECT
+signals:
+    void showsensordata(SensorData);
+};
+
+class Receiver : public QObject
+{
+    Q_OBJECT
+public:
+    std::atomic<qint64> count{0};
+    qint64 target = 0;
+public slots:
+    void showdata(SensorData)
+    {
+        if (++count == target) {
+            QCoreApplication::quit();
+        }
+    }
+};
+
+// 按固定速率节拍：每写1000条检查一次时间，超前则让出CPU
+static void pace(QElapsedTimer &clock, qint64 done, double perSecond)
+{
+    if (perSecond <= 0 || done % 1000 != 0) {
+        return;
+    }
+    qint64 dueNs = static_cast<qint64>(done / perSecond * 1e9);
+    while (clock.nsecsElapsed() < dueNs) {
+        QThread::yieldCurrentThread();
+    }
+}
+
+// 1. 压力测试
+static bool stressTest(int producers, qint64 perProducer)
+{
+    MpscRing<SensorData> ring("stress", 1024);
+    std::vector<QThread *> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.push_back(QThread::create([&ring, p, perProducer]() {
+            SensorData d;
+            d.node = p;
+            for (qint64 i = 0; i < perProducer; ++i) {
+                d.seq = i;
+                while (!ring.tryPush(d)) {
+                    QThread::yieldCurrentThread();
+                }
+            }
+        }));
+        threads.back()->start();
+    }
+
+    std::vector<qint64> next(producers, 0);
+    qint64 total = 0;
+    bool ok = true;
+    QVector<SensorData> batch;
+    while (total < producers * perProducer) {
+        batch.clear();
+        total += ring.popBatch(batch, 256);
+        for (const SensorData &d : batch) {
+            if (d.seq != next[d.node]) {
+                ok = false;
+            }
+            next[d.node] = d.seq + 1;
+        }
+    }
+    for (QThread *t : threads) {
+        t->wait();
+        delete t;
+    }
+
+    out << "stress: producers=" << producers << " readings=" << total
+        << (ok ? " order=ok" : " order=BROKEN") << Qt::endl;
+    return ok;
+}
+
+// 排队信号路径：perSecond<=0时不限速，返回耗时（毫秒）；backlog返回写入结束时的积压
+static double signalPath(int producers, qint64 total, double perSecond, qint64 *backlog)
+{
+    qint64 perProducer = total / producers;
+    Receiver receiver;
+    receiver.target = perProducer * producers;
+    std::vector<Emitter *> emitters;
+    std::vector<QThread *> threads;
+    std::atomic<qint64> sent{0};
+    std::atomic<int> finished{0};
+
+    for (int p = 0; p < producers; ++p) {
+        Emitter *e = new Emitter;
+        QObject::connect(e, &Emitter::showsensordata, &receiver, &Receiver::showdata, Qt::QueuedConnection);
+        emitters.push_back(e);
+        threads.push_back(QThread::create([e, perProducer, perSecond, producers, &sent, &finished, &receiver, backlog]() {
+            QElapsedTimer clock;
+            clock.start();
+            SensorData d;
+            for (qint64 i = 0; i < perProducer; ++i) {
+                pace(clock, i, perSecond / producers);
+                emit e->showsensordata(d);
+            }
+            sent += perProducer;
+            if (++finished == producers && backlog) {
+                *backlog = sent.load() - receiver.count.load();
+            }
+        }));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    for (QThread *t : threads) {
+        t->start();
+    }
+    QCoreApplication::exec();
+    double ms = timer.nsecsElapsed() / 1e6;
+
+    for (QThread *t : threads) {
+        t->wait();
+        delete t;
+    }
+    qDeleteAll(emitters);
+    return ms;
+}
+
+// MpscRing路径：消费者在本线程每毫秒批量取一次；received返回取出的条数，dropped返回因队列满被丢弃的条数
+static double ringPath(int producers, qint64 total, double perSecond, qint64 *backlog, qint64 *received, quint64 *dropped)
+{
+    MpscRing<SensorData> ring("bench", 1024);
+    qint64 perProducer = total / producers;
+    std::atomic<int> finished{0};
+    std::vector<QThread *> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.push_back(QThread::create([&ring, perProducer, perSecond, producers, &finished]() {
+            QElapsedTimer clock;
+            clock.start();
+            SensorData d;
+            for (qint64 i = 0; i < perProducer; ++i) {
+                pace(clock, i, perSecond / producers);
+                if (perSecond > 0) {
+                    ring.push(d);// 定速时与界面一致：满了丢最旧
+                } else {
+                    while (!ring.tryPush(d)) {// 吞吐测试：不丢，等待消费者
+                        QThread::yieldCurrentThread();
+                    }
+                }
+            }
+            ++finished;
+        }));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    for (QThread *t : threads) {
+        t->start();
+    }
+
+    qint64 popped = 0;
+    QVector<SensorData> batch;
+    batch.reserve(4096);
+    bool backlogTaken = false;
+    for (;;) {
+        batch.clear();
+        popped += ring.popBatch(batch, 4096);
+        if (finished.load() == producers) {
+            if (!backlogTaken && backlog) {
+                *backlog = ring.stats().depth;
+                backlogTaken = true;
+            }
+            if (ring.stats().depth == 0) {
+                break;
+            }
+        }
+        if (perSecond > 0 && batch.isEmpty()) {
+            QThread::usleep(1000);
+        }
+    }
+    double ms = timer.nsecsElapsed() / 1e6;
+
+    for (QThread *t : threads) {
+        t->wait();
+        delete t;
+    }
+    *received = popped;
+    *dropped = ring.stats().dropped;
+    return ms;
+}
+
+// 核对MpscRing路径的条数：取出 + 丢弃 = 写入
+static bool checkRingCount(const char *name, qint64 written, qint64 received, quint64 dropped)
+{
+    if (received + qint64(dropped) == written) {
+        return true;
+    }
+    out << name << ": ring count MISMATCH written=" << written << " received=" << received
+        << " dropped=" << dropped << Qt::endl;
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    int producers = argc > 1 ? QString(argv[1]).toInt() : 4;
+    qint64 total = argc > 2 ? QString(argv[2]).toLongLong() : 1000000;
+    if (producers < 1 || total < producers) {
+        out << "用法: ringbench [生产者数] [读数条数]" << Qt::endl;
+        return 2;
+    }
+
+    // 1. 压力测试
+    if (!stressTest(producers, total / producers)) {
+        return 1;
+    }
+
+    // 2. 不限速吞吐
+    const qint64 written = total / producers * producers;
+    qint64 ringReceived = 0;
+    quint64 ringDropped = 0;
+    double signalMs = signalPath(producers, total, 0, nullptr);
+    double ringMs = ringPath(producers, total, 0, nullptr, &ringReceived, &ringDropped);
+    bool ok = checkRingCount("throughput", written, ringReceived, ringDropped);
+    if (ringDropped != 0) {
+        // 不限速时生产者在队列满时等待，不应有丢弃
+        out << "throughput: ring dropped " << ringDropped << " readings without pacing" << Qt::endl;
+        ok = false;
+    }
+    out << "throughput: signal " << qint64(total / (signalMs / 1000)) << " readings/s ("
+        << signalMs << " ms), ring " << qint64(total / (ringMs / 1000)) << " readings/s ("
+        << ringMs << " ms)" << Qt::endl;
+
+    // 3. 每秒100万条定速写入
+    const double rate = 1e6;
+    qint64 signalBacklog = 0, ringBacklog = 0;
+    double signalPacedMs = signalPath(producers, total, rate, &signalBacklog);
+    double ringPacedMs = ringPath(producers, total, rate, &ringBacklog, &ringReceived, &ringDropped);
+    out << "paced 1M/s: signal drained in " << signalPacedMs << " ms, backlog at end of writes "
+        << signalBacklog << "; ring drained in " << ringPacedMs << " ms, backlog " << ringBacklog
+        << ", dropped " << ringDropped << Qt::endl;
+    ok = checkRingCount("paced", written, ringReceived, ringDropped) && ok;
+    return ok ? 0 : 1;
+}
+
+#include "main.moc"
@@ -0,0 +1,15 @@
+# MpscRing压力测试与基准：与排队信号路径对比
+QT       += core
+QT       -= gui
+CONFIG   += console c++17
+CONFIG   -= app_bundle
+
+INCLUDEPATH += $$PWD/../..
+
+HEADERS += \
+    $$PWD/../../mpscring.h \
+    $$PWD/../../queuestats.h \
+    $$PWD/../../sensordata.h
+
+SOURCES += \
+    main.cpp
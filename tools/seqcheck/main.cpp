@@ -0,0 +1,165 @@
+﻿// seqcheck - SequenceTracker的脚本化检查
+// 每个用例按顺序送入一组（节点, 序号, 到达时刻）记录，再与预期的各项计数比较；
+// 全部通过时退出码为0，否则打印不一致的用例并返回1，修改序号统计逻辑后运行即可确认行为。
+//
+// 用法: seqcheck
+
+#include <QCoreApplication>
+#include <QString>
+#include <QTextStream>
+#include <QVector>
+#include "sequencetracker.h"
+
+static QTextStream out(stdout);
+
+struct Packet {
+    int node;
+    qint64 seq;
+    qint64 timeMs; // <0表示不带到达时刻
+};
+
+struct Case {
+    const char *name;
+    QVector<Packet> packets;
+    SeqStats expected;
+};
+
+// 节点node按intervalMs的间隔依次发送[first, last]，从startMs开始；返回最后一个报文的时刻
+static qint64 appendRange(QVector<Packet> &packets, int node, qint64 first, qint64 last, qint64 startMs = -1, qint64 intervalMs = 0)
+{
+    qint64 timeMs = startMs;
+    for (qint64 seq = first; seq <= last; ++seq) {
+        packets.append({node, seq, timeMs});
+        if (startMs >= 0) {
+            timeMs += intervalMs;
+        }
+    }
+    return timeMs - intervalMs;
+}
+
+static SeqStats expect(quint64 received, quint64 lost, quint64 reordered, quint64 duplicates, quint64 late, quint64 resets, quint64 jumps,
+                       quint64 untracked = 0)
+{
+    SeqStats s;
+    s.received = received;
+    s.lost = lost;
+    s.reordered = reordered;
+    s.duplicates = duplicates;
+    s.late = late;
+    s.resets = resets;
+    s.jumps = jumps;
+    s.untracked = untracked;
+    return s;
+}
+
+static QString format(const SeqStats &s)
+{
+    return QString("收到%1 丢包%2 乱序%3 重复%4 过旧%5 重启%6 跳跃%7 未跟踪%8")
+        .arg(s.received).arg(s.lost).arg(s.reordered).arg(s.duplicates).arg(s.late).arg(s.resets).arg(s.jumps)
+        .arg(s.untracked);
+}
+
+static bool same(const SeqStats &a, const SeqStats &b)
+{
+    return a.received == b.received && a.lost == b.lost && a.reordered == b.reordered && a.duplicates == b.duplicates
+           && a.late == b.late && a.resets == b.resets && a.jumps == b.jumps && a.untracked == b.untracked;
+}
+
+static QVector<Case> cases()
+{
+    QVector<Case> list;
+
+    Case inOrder{"顺序到达", {}, expect(10, 0, 0, 0, 0, 0, 0)};
+    appendRange(inOrder.packets, 1, 0, 9);
+    list << inOrder;
+
+    list << Case{"丢包", {{1, 0, -1}, {1, 1, -1}, {1, 2, -1}, {1, 5, -1}, {1, 6, -1}}, expect(5, 2, 0, 0, 0, 0, 0)};
+    list << Case{"乱序补回丢包", {{1, 0, -1}, {1, 1, -1}, {1, 3, -1}, {1, 2, -1}, {1, 4, -1}}, expect(5, 0, 1, 0, 0, 0, 0)};
+    list << Case{"重复", {{1, 0, -1}, {1, 1, -1}, {1, 1, -1}, {1, 2, -1}}, expect(4, 0, 0, 1, 0, 0, 0)};
+
+    Case late{"超出窗口的过旧报文", {}, expect(202, 0, 0, 0, 1, 0, 0)};
+    appendRange(late.packets, 1, 0, 200);
+    late.packets.append({1, 100, -1});
+    list << late;
+
+    // 节点发了不到1024个报文就重启：序号回到0，其后的报文正常计数，不应计为过旧或重复
+    Case restartFromZero{"重启后从0计数", {}, expect(500 + 20, 0, 0, 0, 0, 1, 0)};
+    appendRange(restartFromZero.packets, 1, 0, 499);
+    appendRange(restartFromZero.packets, 1, 0, 19);
+    list << restartFromZero;
+
+    // 只发了30个报文就重启（仍在乱序窗口内）：靠停发时间判断
+    Case restartAfterIdle{"停发后序号回退", {}, expect(31 + 10, 0, 0, 0, 0, 1, 0)};
+    const qint64 lastMs = appendRange(restartAfterIdle.packets, 1, 0, 30, 0, 50);
+    appendRange(restartAfterIdle.packets, 1, 0, 9, lastMs + 5000, 50);
+    list << restartAfterIdle;
+
+    // 同样的序列但不带时刻：窗口内的回退只能按重复计
+    Case restartNoTime{"窗口内回退且无时刻", {}, expect(31 + 3, 0, 0, 3, 0, 0, 0)};
+    appendRange(restartNoTime.packets, 1, 0, 30);
+    appendRange(restartNoTime.packets, 1, 0, 2);
+    list << restartNoTime;
+
+    // 短暂停顿后正常的乱序报文不应被当作重启
+    Case pauseThenReorder{"停顿后乱序", {{1, 0, 0}, {1, 2, 100}, {1, 1, 150}, {1, 3, 200}}, expect(4, 0, 1, 0, 0, 0, 0)};
+    list << pauseThenReorder;
+
+    Case bigBackward{"大幅回退", {}, expect(2001 + 1, 0, 0, 0, 0, 1, 0)};
+    appendRange(bigBackward.packets, 1, 0, 2000);
+    bigBackward.packets.append({1, 500, -1});
+    list << bigBackward;
+
+    list << Case{"不合理的前进", {{1, 0, -1}, {1, 1, -1}, {1, 1000000, -1}, {1, 1000001, -1}, {1, 1000003, -1}},
+                 expect(5, 1, 0, 0, 0, 0, 1)};
+
+    // 两个节点交错发送，各自独立统计：节点1丢1个，节点2重复1个
+    list << Case{"多节点交错", {{1, 0, -1}, {2, 0, -1}, {1, 2, -1}, {2, 1, -1}, {2, 1, -1}, {1, 3, -1}},
+                 expect(6, 1, 0, 1, 0, 0, 0)};
+
+    list << Case{"无序号报文不计入", {{1, -1, -1}, {1, 0, -1}, {1, -1, -1}, {1, 1, -1}}, expect(2, 0, 0, 0, 0, 0, 0)};
+
+    // 节点号来自报文：超过256个节点后新节点不再跟踪
+    Case manyNodes{"节点数上限", {}, expect(256, 0, 0, 0, 0, 0, 0, 300 - 256)};
+    for (int node = 0; node < 300; ++node) {
+        manyNodes.packets.append({node, 0, -1});
+    }
+    list << manyNodes;
+
+    // 节点数满时，停发超过一分钟的节点让位给新节点；新节点之后的报文正常统计
+    Case evictIdle{"替换停发的节点", {}, expect(256 + 2, 1, 0, 0, 0, 0, 0, 2)};
+    for (int node = 0; node < 256; ++node) {
+        evictIdle.packets.append({node, 0, node == 7 ? 0 : 50000});
+    }
+    evictIdle.packets.append({1000, 0, 60000}); // 节点7刚好停发60秒，还不能替换：未跟踪
+    evictIdle.packets.append({1000, 0, 61000}); // 停发61秒，替换节点7
+    evictIdle.packets.append({1000, 2, 61100}); // 丢了1个
+    evictIdle.packets.append({1001, 0, 61200}); // 其余节点50秒时发过，不能替换：未跟踪
+    list << evictIdle;
+
+    return list;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    int failures = 0;
+    const QVector<Case> list = cases();
+    for (const Case &c : list) {
+        SequenceTracker tracker;
+        for (const Packet &p : c.packets) {
+            tracker.record(p.node, p.seq, p.timeMs);
+        }
+        const SeqStats actual = tracker.total();
+        if (same(actual, c.expected)) {
+            out << "通过  " << c.name << Qt::endl;
+        } else {
+            failures++;
+            out << "失败  " << c.name << Qt::endl
+                << "      预期: " << format(c.expected) << Qt::endl
+                << "      实际: " << format(actual) << Qt::endl;
+        }
+    }
+    out << list.size() - failures << "/" << list.size() << " 个用例通过" << Qt::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,14 @@
+# SequenceTracker检查：用脚本化的序号序列核对丢包、乱序、重复、过旧、重启和跳跃计数
+QT       += core
+QT       -= gui
+CONFIG   += console c++17
+CONFIG   -= app_bundle
+
+INCLUDEPATH += $$PWD/../..
+
+HEADERS += \
+    $$PWD/../../sequencetracker.h
+
+SOURCES += \
+    $$PWD/../../sequencetracker.cpp \
+    main.cpp
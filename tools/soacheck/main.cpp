@@ -0,0 +1,332 @@
+﻿// soacheck - 结构数组版QCPDataContainer<QCPGraphData>的随机对比检查
+// 用按键排序的std::vector作参考模型，对两边执行相同的随机add/remove*/removeBefore/removeAfter序列，
+// 每一步之后比较全部数据，并核对findBegin/findEnd、keyRange和valueRange（各符号域，带和不带键范围限制）。
+// 最后检查复制、可写迭代器、sort()，滚动窗口（尾部追加、头部删除）下的头部偏移路径，以及同一组数据列各通道视图的修订号。
+// soacheck.pro默认打开ASan/UBSan；不一致时打印前20处并返回1。
+//
+// 用法: soacheck [轮数=300] [随机种子=1]
+
+#include <QCoreApplication>
+#include <QTextStream>
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "qcustomplot.h"
+
+#ifndef QCUSTOMPLOT_USE_SOA_GRAPHDATA
+#error "soacheck需要定义QCUSTOMPLOT_USE_SOA_GRAPHDATA（见soacheck.pro）"
+#endif
+
+typedef QCPDataContainer<QCPGraphData> Container;
+typedef std::pair<double, double> Point; // (键, 值)
+
+static QTextStream out(stdout);
+static int failures = 0;
+
+#define CHECK(cond)                                                                   \
+    do {                                                                              \
+        if (!(cond)) {                                                                \
+            if (++failures <= 20) {                                                   \
+                out << "不一致 第" << __LINE__ << "行: " << #cond << Qt::endl;        \
+            }                                                                         \
+        }                                                                             \
+    } while (0)
+
+static bool keyLess(const Point &a, const Point &b) { return a.first < b.first; }
+
+// 参考模型：按键排序，键相同时保持插入顺序（与QCPDataContainer的稳定排序一致）
+struct Reference {
+    std::vector<Point> points;
+
+    int lowerBound(double key) const
+    {
+        return int(std::lower_bound(points.begin(), points.end(), Point(key, 0), keyLess) - points.begin());
+    }
+
+    int upperBound(double key) const
+    {
+        return int(std::upper_bound(points.begin(), points.end(), Point(key, 0), keyLess) - points.begin());
+    }
+
+    void add(std::vector<Point> added, bool alreadySorted)
+    {
+        if (added.empty()) {
+            return;
+        }
+        std::stable_sort(added.begin(), added.end(), keyLess);
+        // 新数据整体不晚于现有第一个点时放在前面（QCPDataContainer的前插路径）
+        if (alreadySorted && !points.empty() && !(points.front().first < added.back().first)) {
+            added.insert(added.end(), points.begin(), points.end());
+            points.swap(added);
+            return;
+        }
+        std::vector<Point> merged;
+        merged.reserve(points.size() + added.size());
+        std::merge(points.begin(), points.end(), added.begin(), added.end(), std::back_inserter(merged), keyLess);
+        points.swap(merged);
+    }
+
+    void addOne(const Point &p)
+    {
+        if (points.empty() || !(p.first < points.back().first)) {
+            points.push_back(p);
+        } else {
+            points.insert(points.begin() + lowerBound(p.first), p);
+        }
+    }
+
+    void removeBefore(double key) { points.erase(points.begin(), points.begin() + lowerBound(key)); }
+    void removeAfter(double key) { points.erase(points.begin() + upperBound(key), points.end()); }
+
+    void remove(double from, double to)
+    {
+        if (from >= to || points.empty()) {
+            return;
+        }
+        const int begin = lowerBound(from);
+        const int end = std::max(begin, upperBound(to));
+        points.erase(points.begin() + begin, points.begin() + end);
+    }
+
+    void removeOne(double key)
+    {
+        const int i = lowerBound(key);
+        if (i < int(points.size()) && points[i].first == key) {
+            points.erase(points.begin() + i);
+        }
+    }
+};
+
+static bool sameValue(double a, double b) { return a == b || (std::isnan(a) && std::isnan(b)); }
+
+static bool sameData(const Container &c, const Reference &ref)
+{
+    if (c.size() != int(ref.points.size())) {
+        return false;
+    }
+    int i = 0;
+    for (auto it = c.constBegin(); it != c.constEnd(); ++it, ++i) {
+        if (it->key != ref.points[i].first || !sameValue(it->value, ref.points[i].second)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool inDomain(double v, QCP::SignDomain domain)
+{
+    switch (domain) {
+    case QCP::sdPositive: return v > 0;
+    case QCP::sdNegative: return v < 0;
+    default: return true;
+    }
+}
+
+// 参考实现的范围：按值（valueRange）或按键（keyRange）
+static QCPRange referenceRange(const Reference &ref, bool byValue, QCP::SignDomain domain, const QCPRange &keys, bool &found)
+{
+    const bool restrictKeys = keys != QCPRange();
+    found = false;
+    QCPRange range;
+    for (const Point &p : ref.points) {
+        if (restrictKeys && (p.first < keys.lower || p.first > keys.upper)) {
+            continue;
+        }
+        if (std::isnan(p.second) || (byValue && !std::isfinite(p.second))) {
+            continue;
+        }
+        const double v = byValue ? p.second : p.first;
+        if (!inDomain(v, domain)) {
+            continue;
+        }
+        if (!found) {
+            range = QCPRange(v, v);
+            found = true;
+        }
+        range.lower = std::min(range.lower, v);
+        range.upper = std::max(range.upper, v);
+    }
+    return range;
+}
+
+static void checkQueries(Container &c, const Reference &ref, double key)
+{
+    if (!ref.points.empty()) {
+        const int lower = ref.lowerBound(key);
+        const int upper = ref.upperBound(key);
+        const int size = int(ref.points.size());
+        CHECK(c.findBegin(key, false) - c.constBegin() == lower);
+        CHECK(c.findBegin(key, true) - c.constBegin() == (lower > 0 ? lower - 1 : 0));
+        CHECK(c.findEnd(key, false) - c.constBegin() == upper);
+        CHECK(c.findEnd(key, true) - c.constBegin() == (upper < size ? upper + 1 : upper));
+        // 代理迭代器也能直接用于标准算法
+        auto it = std::lower_bound(c.constBegin(), c.constEnd(), QCPGraphData(key, 0),
+                                   [](const QCPGraphData &a, const QCPGraphData &b) { return a.key < b.key; });
+        CHECK(it - c.constBegin() == lower);
+    }
+
+    const QCP::SignDomain domains[] = {QCP::sdNegative, QCP::sdBoth, QCP::sdPositive};
+    for (QCP::SignDomain domain : domains) {
+        for (const QCPRange &keys : {QCPRange(), QCPRange(key, key + 30)}) {
+            bool found = false;
+            bool expectedFound = false;
+            const QCPRange actual = c.valueRange(found, domain, keys);
+            const QCPRange expected = referenceRange(ref, true, domain, keys, expectedFound);
+            CHECK(found == expectedFound);
+            if (found && expectedFound) {
+                CHECK(actual.lower == expected.lower && actual.upper == expected.upper);
+            }
+        }
+        bool found = false;
+        bool expectedFound = false;
+        const QCPRange actual = c.keyRange(found, domain);
+        const QCPRange expected = referenceRange(ref, false, domain, QCPRange(), expectedFound);
+        CHECK(found == expectedFound);
+        if (found && expectedFound) {
+            CHECK(actual.lower == expected.lower && actual.upper == expected.upper);
+        }
+    }
+}
+
+static void runRound(std::mt19937 &rng)
+{
+    Container c;
+    Reference ref;
+    auto randomKey = [&rng]() { return int(rng() % 1000) * 0.25 - 50; };
+    auto randomValue = [&rng]() { return rng() % 10 == 0 ? std::nan("") : (int(rng() % 200) - 100) * 0.5; };
+
+    for (int step = 0; step < 60; ++step) {
+        const int op = int(rng() % 9);
+        if (op <= 2) {
+            // 批量添加：有序或无序，分别走QVector<QCPGraphData>和键/值两个数组的接口
+            const int n = int(rng() % 50) + 1;
+            const bool sorted = rng() % 2;
+            const bool columns = rng() % 2;
+            const double base = int(rng() % 400) - 100;
+            std::vector<Point> added;
+            QVector<QCPGraphData> data;
+            QVector<double> keys, values;
+            for (int i = 0; i < n; ++i) {
+                const double key = sorted ? base + i * 0.5 : randomKey();
+                const double value = randomValue();
+                added.push_back(Point(key, value));
+                data.append(QCPGraphData(key, value));
+                keys.append(key);
+                values.append(value);
+            }
+            if (columns) {
+                c.add(keys, values, sorted);
+            } else {
+                c.add(data, sorted);
+            }
+            ref.add(added, sorted);
+        } else if (op == 3) {
+            const Point p(randomKey(), int(rng() % 7));
+            c.add(QCPGraphData(p.first, p.second));
+            ref.addOne(p);
+        } else if (op == 4) {
+            const double key = randomKey();
+            c.removeBefore(key);
+            ref.removeBefore(key);
+        } else if (op == 5) {
+            const double key = randomKey();
+            c.removeAfter(key);
+            ref.removeAfter(key);
+        } else if (op == 6) {
+            const double from = randomKey();
+            const double to = from + int(rng() % 100);
+            c.remove(from, to);
+            ref.remove(from, to);
+        } else if (op == 7 && !ref.points.empty()) {
+            const double key = ref.points[rng() % ref.points.size()].first;
+            c.remove(key);
+            ref.removeOne(key);
+        } else if (op == 8) {
+            c.squeeze(rng() % 2, rng() % 2);
+        }
+        CHECK(sameData(c, ref));
+        checkQueries(c, ref, randomKey() - 10);
+    }
+
+    // 复制、可写迭代器和sort()
+    Container copy;
+    copy.set(c);
+    CHECK(sameData(copy, ref));
+    for (auto it = copy.begin(); it != copy.end(); ++it) {
+        it->value = 1;
+    }
+    for (auto it = copy.constBegin(); it != copy.constEnd(); ++it) {
+        CHECK(it->value == 1);
+    }
+    CHECK(sameData(c, ref)); // 修改副本不影响原容器
+    for (auto it = copy.begin(); it != copy.end(); ++it) {
+        it->key = -it->key;
+    }
+    copy.sort();
+    CHECK(std::is_sorted(copy.constKeyData(), copy.constKeyData() + copy.size()));
+
+    std::vector<QCPGraphData> exported(size_t(c.size()));
+    std::copy(c.constBegin(), c.constEnd(), exported.begin());
+    for (int i = 0; i < c.size(); ++i) {
+        CHECK(exported[size_t(i)].key == ref.points[size_t(i)].first);
+    }
+}
+
+// 滚动窗口：只在尾部追加、从头部删除（曲线的常见用法），走头部偏移路径
+static void checkRollingWindow()
+{
+    const int window = 5000;
+    Container c;
+    for (int i = 0; i < 200000; ++i) {
+        c.add(QCPGraphData(i, i));
+        c.removeBefore(i - window);
+    }
+    CHECK(c.size() == window + 1);
+    CHECK(c.frontRemovedCount() == 200000 - window - 1);
+    CHECK(c.constBegin()->key == 200000 - window - 1);
+}
+
+// 同一组数据列的不同通道视图：修订号互不相同（曲线切换通道时LOD缓存会重建），数据列的修订号变化时视图的也跟着变
+static void checkChannelViews()
+{
+    QSharedPointer<QCPDataColumns> columns(new QCPDataColumns(2));
+    const double values[2] = {1, 2};
+    columns->append(0, values);
+    const Container first(columns, 0);
+    const Container second(columns, 1);
+    CHECK(first.revision() != second.revision());
+    quint64 before = first.revision();
+    columns->append(1, values); // 按键顺序追加不改变修订号
+    CHECK(first.revision() == before);
+    columns->append(0.5, values); // 插入到中间
+    CHECK(first.revision() != before);
+    CHECK(first.revision() != second.revision());
+    CHECK(first.constValueData()[1] == 1 && second.constValueData()[1] == 2);
+    before = second.revision();
+    columns->clear();
+    CHECK(second.revision() != before);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const QStringList args = app.arguments();
+    const int rounds = args.size() > 1 ? args.at(1).toInt() : 300;
+    const unsigned seed = args.size() > 2 ? args.at(2).toUInt() : 1;
+
+    std::mt19937 rng(seed);
+    for (int round = 0; round < rounds; ++round) {
+        runRound(rng);
+    }
+    checkRollingWindow();
+    checkChannelViews();
+
+    if (failures == 0) {
+        out << rounds << "轮随机操作全部一致（种子" << seed << "）" << Qt::endl;
+        return 0;
+    }
+    out << "共" << failures << "处不一致（种子" << seed << "）" << Qt::endl;
+    return 1;
+}
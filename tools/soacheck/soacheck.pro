@@ -0,0 +1,18 @@
+# 结构数组（SoA）版QCPDataContainer<QCPGraphData>与参考模型的随机对比检查
+# 默认带AddressSanitizer/UndefinedBehaviorSanitizer编译（MSVC只支持ASan，去掉sanitize_undefined）；
+# 检查SSE2以外的路径：qmake "QMAKE_CXXFLAGS+=-mavx"（MSVC为 /arch:AVX），不带向量指令：qmake "QMAKE_CXXFLAGS+=-mno-sse2"（仅32位x86）
+QT       += core gui widgets printsupport
+CONFIG   += console c++17
+CONFIG   -= app_bundle
+CONFIG   += sanitizer sanitize_address sanitize_undefined
+
+DEFINES += QCUSTOMPLOT_USE_SOA_GRAPHDATA
+
+INCLUDEPATH += $$PWD/../..
+
+HEADERS += \
+    $$PWD/../../qcustomplot.h
+
+SOURCES += \
+    $$PWD/../../qcustomplot.cpp \
+    main.cpp
@@ -0,0 +1,154 @@
+﻿// transformbench - QCPGraph::dataToLines坐标变换基准
+// 1. 逐点调用QCPAxis::coordToPixel（改造前dataToLines的做法）
+// 2. qcpLinearDataToPixels批量变换（两个轴都是线性轴时dataToLines走这条路径）
+// 3. 完整的dataToLines，水平和垂直键轴各一次
+// 每种方式重复多次取最短耗时，并检查与逐点结果的最大偏差。
+//
+// 用法: transformbench [点数=1000000] [重复次数=20]
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QtMath>
+#include <functional>
+#include "qcustomplot.h"
+
+static QTextStream out(stdout);
+
+// 公开受保护的dataToLines以便直接计时
+class BenchGraph : public QCPGraph
+{
+public:
+    BenchGraph(QCPAxis *keyAxis, QCPAxis *valueAxis) : QCPGraph(keyAxis, valueAxis) {}
+    using QCPGraph::dataToLines;
+};
+
+// 重复执行，返回最短耗时（纳秒）
+static qint64 bestOf(int repeats, const std::function<void()> &run)
+{
+    qint64 best = -1;
+    for (int r = 0; r < repeats; ++r) {
+        QElapsedTimer timer;
+        timer.start();
+        run();
+        qint64 ns = timer.nsecsElapsed();
+        if (best < 0 || ns < best) {
+            best = ns;
+        }
+    }
+    return best;
+}
+
+// 改造前的逐点变换
+static void perPoint(const QVector<QCPGraphData> &data, QCPAxis *keyAxis, QCPAxis *valueAxis, QVector<QPointF> &result)
+{
+    result.resize(data.size());
+    if (keyAxis->orientation() == Qt::Vertical) {
+        for (int i = 0; i < data.size(); ++i) {
+            result[i].setX(valueAxis->coordToPixel(data.at(i).value));
+            result[i].setY(keyAxis->coordToPixel(data.at(i).key));
+        }
+    } else {
+        for (int i = 0; i < data.size(); ++i) {
+            result[i].setX(keyAxis->coordToPixel(data.at(i).key));
+            result[i].setY(valueAxis->coordToPixel(data.at(i).value));
+        }
+    }
+}
+
+static double maxDeviation(const QVector<QPointF> &a, const QVector<QPointF> &b)
+{
+    double deviation = 0;
+    for (int i = 0; i < a.size() && i < b.size(); ++i) {
+        deviation = qMax(deviation, qMax(qAbs(a.at(i).x() - b.at(i).x()), qAbs(a.at(i).y() - b.at(i).y())));
+    }
+    return deviation;
+}
+
+static void report(const char *name, qint64 ns, int count, double deviation = -1)
+{
+    out << QString("%1 %2 ms, %3 ns/point, %4 Mpoints/s")
+               .arg(QString::fromLatin1(name), -28)
+               .arg(ns / 1e6, 0, 'f', 3)
+               .arg(double(ns) / count, 0, 'f', 3)
+               .arg(count / (ns / 1e3), 0, 'f', 1);
+    if (deviation >= 0) {
+        out << ", max deviation " << deviation << " px";
+    }
+    out << Qt::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    int count = argc > 1 ? QString(argv[1]).toInt() : 1000000;
+    int repeats = argc > 2 ? QString(argv[2]).toInt() : 20;
+    if (count < 1 || repeats < 1) {
+        out << "用法: transformbench [点数] [重复次数]" << Qt::endl;
+        return 2;
+    }
+
+#if defined(__AVX__) && !defined(QT_COORD_TYPE)
+    out << "kernel: AVX" << Qt::endl;
+#elif (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) && !defined(QT_COORD_TYPE)
+    out << "kernel: SSE2" << Qt::endl;
+#else
+    out << "kernel: scalar" << Qt::endl;
+#endif
+
+    // 与主界面相近的图表：时间为键，带噪声的温度曲线为值
+    QCustomPlot plot;
+    plot.resize(1920, 1080);
+    BenchGraph *graph = new BenchGraph(plot.xAxis, plot.yAxis);
+    QVector<QCPGraphData> data(count);
+    const double start = 1.7e9;
+    for (int i = 0; i < count; ++i) {
+        data[i].key = start + i * 0.01;
+        data[i].value = 25 + 5 * qSin(i * 0.001) + (i % 7) * 0.1;
+    }
+    plot.xAxis->setRange(start, start + count * 0.01);
+    plot.yAxis->setRange(15, 35);
+    plot.replot(); // 完成布局，确定坐标轴矩形
+
+    QVector<QPointF> reference, batched, lines;
+    for (int vertical = 0; vertical < 2; ++vertical) {
+        QCPAxis *keyAxis = vertical ? plot.yAxis : plot.xAxis;
+        QCPAxis *valueAxis = vertical ? plot.xAxis : plot.yAxis;
+        graph->setKeyAxis(keyAxis);
+        graph->setValueAxis(valueAxis);
+        keyAxis->setRange(start, start + count * 0.01);
+        valueAxis->setRange(15, 35);
+        out << (vertical ? "key axis vertical:" : "key axis horizontal:") << Qt::endl;
+
+        qint64 perPointNs = bestOf(repeats, [&] { perPoint(data, keyAxis, valueAxis, reference); });
+        report("  coordToPixel per point", perPointNs, count);
+
+        double keyScale = 0, keyOffset = 0, valueScale = 0, valueOffset = 0;
+        keyAxis->linearPixelTransform(&keyScale, &keyOffset);
+        valueAxis->linearPixelTransform(&valueScale, &valueOffset);
+        batched.resize(count);
+        qint64 batchedNs = bestOf(repeats, [&] {
+            qcpLinearDataToPixels(data.constData(), count, keyScale, keyOffset, valueScale, valueOffset,
+                                  keyAxis->orientation() == Qt::Vertical, batched.data());
+        });
+        report("  qcpLinearDataToPixels", batchedNs, count, maxDeviation(reference, batched));
+
+        qint64 linesNs = bestOf(repeats, [&] { lines = graph->dataToLines(data); });
+        report("  dataToLines", linesNs, count, maxDeviation(reference, lines));
+        out << QString("  speedup %1x (kernel), %2x (dataToLines)")
+                   .arg(double(perPointNs) / batchedNs, 0, 'f', 2)
+                   .arg(double(perPointNs) / linesNs, 0, 'f', 2) << Qt::endl;
+    }
+
+    // 对数轴不满足条件，dataToLines回到逐点变换
+    graph->setKeyAxis(plot.xAxis);
+    graph->setValueAxis(plot.yAxis);
+    plot.yAxis->setScaleType(QCPAxis::stLogarithmic);
+    perPoint(data, plot.xAxis, plot.yAxis, reference);
+    out << "logarithmic value axis: max deviation "
+        << maxDeviation(reference, graph->dataToLines(data)) << " px" << Qt::endl;
+    return 0;
+}
@@ -0,0 +1,14 @@
+# QCPGraph坐标变换基准：逐点coordToPixel与批量线性变换对比
+# 默认按编译器的基础指令集（x64为SSE2）编译，测试AVX2路径：qmake "QMAKE_CXXFLAGS+=-mavx2 -mfma"（MSVC为 /arch:AVX2）
+QT       += core gui widgets printsupport
+CONFIG   += console c++17
+CONFIG   -= app_bundle
+
+INCLUDEPATH += $$PWD/../..
+
+HEADERS += \
+    $$PWD/../../qcustomplot.h
+
+SOURCES += \
+    $$PWD/../../qcustomplot.cpp \
+    main.cpp
@@ -0,0 +1,172 @@
+﻿// udpcheck - UdpWorker的本机回环检查
+// UdpWorker按主程序的方式运行在独立线程中，监听一个空闲端口；本线程向127.0.0.1发送一组脚本化的数据报：
+//   节点1：序号0~199，缺10、11，20和21对调，30重复一次，最后补发一个超出窗口的100；每个数据报一帧
+//   节点2：序号0~59，缺5；每个数据报两帧（检查一个数据报内的多帧）
+//   另有一个格式错误的数据报
+// 发送期间接收线程被挡住，数据报全部留在内核缓冲里，随后调用stopListening：
+// 检查停止监听时先把已到达的数据报取完（Linux上一次recvmmsg最多取64个，这里会分几次取）。
+// 最后核对数据报数、帧数、解析失败数、showsensordata信号数和各项序号统计；全部一致时退出码为0，否则为1。
+//
+// 用法: udpcheck [端口，默认自动选择空闲端口]
+
+#include <QCoreApplication>
+#include <QHostAddress>
+#include <QSemaphore>
+#include <QTextStream>
+#include <QThread>
+#include <QUdpSocket>
+#include <QVector>
+#include <atomic>
+#include "udpworker.h"
+
+static QTextStream out(stdout);
+static int failures = 0;
+
+static void check(const char *name, quint64 actual, quint64 expected)
+{
+    const bool ok = actual == expected;
+    if (!ok) {
+        failures++;
+    }
+    out << (ok ? "通过  " : "失败  ") << name << ": " << actual;
+    if (!ok) {
+        out << "（预期 " << expected << "）";
+    }
+    out << Qt::endl;
+}
+
+static QByteArray frame(int node, qint64 seq)
+{
+    return "{Params[node:" + QByteArray::number(node) + ";seq:" + QByteArray::number(seq)
+           + ";atemp:21.5;ahumi:55.0;oxygen:20.9;stemp:18.0;shumi2:30.0;light:800]}";
+}
+
+// 脚本化的数据报序列
+static QVector<QByteArray> script()
+{
+    QVector<QByteArray> datagrams;
+
+    // 节点1
+    QVector<qint64> seqs;
+    for (qint64 seq = 0; seq < 200; ++seq) {
+        if (seq == 10 || seq == 11) {
+            continue; // 丢包
+        }
+        if (seq == 20) {
+            seqs << 21 << 20; // 乱序
+            continue;
+        }
+        if (seq == 21) {
+            continue;
+        }
+        seqs << seq;
+        if (seq == 30) {
+            seqs << 30; // 重复
+        }
+    }
+    seqs << 100; // 比最大序号小99，超出64的检测窗口：过旧
+    for (qint64 seq : seqs) {
+        datagrams << frame(1, seq);
+    }
+
+    // 节点2：两帧一个数据报
+    QByteArray pending;
+    for (qint64 seq = 0; seq < 60; ++seq) {
+        if (seq == 5) {
+            continue;
+        }
+        pending += frame(2, seq);
+        if (pending.count("{Params[") == 2) {
+            datagrams << pending;
+            pending.clear();
+        }
+    }
+    if (!pending.isEmpty()) {
+        datagrams << pending;
+    }
+
+    datagrams << QByteArray("not a sensor frame");
+    return datagrams;
+}
+
+// 向127.0.0.1绑定端口0取得一个当前空闲的端口
+static quint16 freePort()
+{
+    QUdpSocket probe;
+    if (!probe.bind(QHostAddress::LocalHost, 0)) {
+        return 0;
+    }
+    return probe.localPort();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const quint16 port = argc > 1 ? quint16(QString(argv[1]).toUInt()) : freePort();
+    if (port == 0) {
+        out << "无法取得空闲端口" << Qt::endl;
+        return 2;
+    }
+
+    QThread thread;
+    UdpWorker *worker = new UdpWorker;
+    worker->moveToThread(&thread);
+    QObject::connect(&thread, &QThread::finished, worker, &QObject::deleteLater);
+
+    std::atomic<int> signalled{0};
+    std::atomic<bool> listening{false};
+    QObject::connect(worker, &UdpWorker::showsensordata, worker, [&signalled](SensorData) { signalled++; },
+                     Qt::DirectConnection);
+    QObject::connect(worker, &UdpWorker::listenStatusChanged, worker,
+                     [&listening](bool ok, const QString &message) {
+                         listening = ok;
+                         out << message << Qt::endl;
+                     }, Qt::DirectConnection);
+    thread.start();
+
+    QMetaObject::invokeMethod(worker, [worker, port]() { worker->startListening(port); }, Qt::BlockingQueuedConnection);
+    if (!listening) {
+        thread.quit();
+        thread.wait();
+        return 2;
+    }
+
+    // 挡住接收线程，让全部数据报积压在内核缓冲中，由stopListening取走
+    QSemaphore gate;
+    QMetaObject::invokeMethod(worker, [&gate]() { gate.acquire(); }, Qt::QueuedConnection);
+
+    const QVector<QByteArray> datagrams = script();
+    QUdpSocket sender;
+    qint64 frames = 0;
+    for (const QByteArray &datagram : datagrams) {
+        if (sender.writeDatagram(datagram, QHostAddress::LocalHost, port) != datagram.size()) {
+            out << "发送失败: " << sender.errorString() << Qt::endl;
+            failures++;
+        }
+        frames += datagram.count("{Params[");
+    }
+
+    QMetaObject::invokeMethod(worker, &UdpWorker::stopListening, Qt::QueuedConnection);
+    gate.release();
+    QMetaObject::invokeMethod(worker, []() {}, Qt::BlockingQueuedConnection); // 等stopListening执行完
+
+    const UdpStats stats = worker->stats();
+    out << "唤醒次数: " << stats.wakeups << "，平均每次取走 "
+        << (stats.wakeups ? stats.datagrams / stats.wakeups : 0) << " 个数据报" << Qt::endl;
+    check("数据报", stats.datagrams, quint64(datagrams.size()));
+    check("解析成功的帧", stats.frames, quint64(frames));
+    check("showsensordata信号", quint64(signalled.load()), quint64(frames));
+    check("解析失败", stats.parseErrors, 1);
+    check("带序号的报文", stats.seq.received, quint64(frames));
+    check("丢包", stats.seq.lost, 2 + 1);
+    check("乱序", stats.seq.reordered, 1);
+    check("重复", stats.seq.duplicates, 1);
+    check("过旧", stats.seq.late, 1);
+    check("节点重启", stats.seq.resets, 0);
+    check("序号跳跃", stats.seq.jumps, 0);
+
+    thread.quit();
+    thread.wait();
+    out << (failures == 0 ? "全部通过" : "有不一致的项") << Qt::endl;
+    return failures == 0 ? 0 : 1;
+}
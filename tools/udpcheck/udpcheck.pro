@@ -0,0 +1,25 @@
+# UdpWorker回环检查：向127.0.0.1发送带缺号、乱序、重复和过旧报文的脚本化序列，核对接收和序号统计
+QT       += core network
+QT       -= gui
+CONFIG   += console c++17
+CONFIG   -= app_bundle
+
+INCLUDEPATH += $$PWD/../..
+
+HEADERS += \
+    $$PWD/../../frameparser.h \
+    $$PWD/../../latencytrace.h \
+    $$PWD/../../logger.h \
+    $$PWD/../../metrics.h \
+    $$PWD/../../sensordata.h \
+    $$PWD/../../sequencetracker.h \
+    $$PWD/../../udpworker.h
+
+SOURCES += \
+    $$PWD/../../frameparser.cpp \
+    $$PWD/../../latencytrace.cpp \
+    $$PWD/../../logger.cpp \
+    $$PWD/../../metrics.cpp \
+    $$PWD/../../sequencetracker.cpp \
+    $$PWD/../../udpworker.cpp \
+    main.cpp
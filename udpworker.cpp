@@ -0,0 +1,240 @@
+﻿// udpworker.cpp - UDP数据接收工作对象实现
+
+#include "udpworker.h"
+#include "latencytrace.h"
+#include "logger.h"
+#include <QUdpSocket>
+#include <QNetworkDatagram>
+#include <QSocketNotifier>
+#include <QMutexLocker>
+
+#ifdef Q_OS_LINUX
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#endif
+
+UdpWorker::UdpWorker(QObject *parent) : QObject(parent)
+{
+#ifdef Q_OS_LINUX
+    m_batchBuffer.resize(kBatchSize * kMaxDatagramSize);
+#endif
+}
+
+UdpWorker::~UdpWorker()
+{
+    stopListening();
+}
+
+UdpStats UdpWorker::stats() const
+{
+    QMutexLocker locker(&m_statsMutex);
+    return m_stats;
+}
+
+#ifdef Q_OS_LINUX
+// 创建非阻塞UDP套接字并绑定端口；优先使用双栈IPv6，与QHostAddress::Any行为一致
+static int openUdpSocket(quint16 port, QString &error)
+{
+    int fd = ::socket(AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    bool v6 = fd >= 0;
+    if (!v6) {
+        fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    }
+    if (fd < 0) {
+        error = QString::fromLocal8Bit(strerror(errno));
+        return -1;
+    }
+
+    int on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    // 突发流量时给内核留足接收缓冲，避免在两次唤醒之间被内核丢弃
+    int rcvbuf = 4 * 1024 * 1024;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    int rc;
+    if (v6) {
+        int off = 0;
+        ::setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+        sockaddr_in6 addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin6_family = AF_INET6;
+        addr.sin6_addr = in6addr_any;
+        addr.sin6_port = htons(port);
+        rc = ::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    } else {
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(port);
+        rc = ::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    }
+    if (rc < 0) {
+        error = QString::fromLocal8Bit(strerror(errno));
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+#endif
+
+//开始监听
+void UdpWorker::startListening(quint16 port)
+{
+    stopListening();
+
+#ifdef Q_OS_LINUX
+    QString error;
+    m_fd = openUdpSocket(port, error);
+    if (m_fd < 0) {
+        emit listenStatusChanged(false, QString("UDP端口 %1 绑定失败: %2").arg(port).arg(error));
+        return;
+    }
+    // 水平触发：只要内核缓冲里还有数据就会再次唤醒
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &UdpWorker::readDatagrams);
+#else
+    m_socket = new QUdpSocket(this);
+    if (!m_socket->bind(QHostAddress::Any, port)) {
+        QString error = m_socket->errorString();
+        delete m_socket;
+        m_socket = nullptr;
+        emit listenStatusChanged(false, QString("UDP端口 %1 绑定失败: %2").arg(port).arg(error));
+        return;
+    }
+    m_socket->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, 4 * 1024 * 1024);
+    connect(m_socket, &QUdpSocket::readyRead, this, &UdpWorker::readDatagrams);
+#endif
+
+    emit listenStatusChanged(true, QString("UDP端口 %1 监听中").arg(port));
+}
+
+//停止监听
+void UdpWorker::stopListening()
+{
+    // 关闭前把内核缓冲中已到达的数据报取完（退出或切换端口时不丢弃已收到的数据）
+#ifdef Q_OS_LINUX
+    if (m_fd >= 0) {
+        readDatagrams();
+    }
+#else
+    if (m_socket) {
+        readDatagrams();
+    }
+#endif
+    if (m_notifier) {
+        m_notifier->setEnabled(false);
+        delete m_notifier;
+        m_notifier = nullptr;
+    }
+#ifdef Q_OS_LINUX
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+#endif
+    if (m_socket) {
+        m_socket->close();
+        delete m_socket;
+        m_socket = nullptr;
+    }
+}
+
+//读事件：一次唤醒把内核缓冲里的数据报全部取走
+void UdpWorker::readDatagrams()
+{
+    UdpStats batch;
+    batch.wakeups = 1;
+
+#ifdef Q_OS_LINUX
+    mmsghdr msgs[kBatchSize];
+    iovec iovs[kBatchSize];
+    char *base = m_batchBuffer.data();
+    for (;;) {
+        memset(msgs, 0, sizeof(msgs));
+        for (int i = 0; i < kBatchSize; ++i) {
+            iovs[i].iov_base = base + i * kMaxDatagramSize;
+            iovs[i].iov_len = kMaxDatagramSize;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int n = ::recvmmsg(m_fd, msgs, kBatchSize, MSG_DONTWAIT, nullptr);
+        if (n <= 0) {
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                LOG_WARNING("udp", "recvmmsg失败", {"error", QString::fromLocal8Bit(strerror(errno))});
+            }
+            break;
+        }
+        const qint64 readAt = LatencyTrace::now();
+
+        for (int i = 0; i < n; ++i) {
+            if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                // 超长数据报被截断，不能按完整报文解析
+                batch.datagrams++;
+                batch.parseErrors++;
+                continue;
+            }
+            handleDatagram(base + i * kMaxDatagramSize, static_cast<int>(msgs[i].msg_len), readAt, batch);
+        }
+
+        if (n < kBatchSize) {
+            break;// 已取空
+        }
+    }
+#else
+    while (m_socket && m_socket->hasPendingDatagrams()) {
+        QNetworkDatagram datagram = m_socket->receiveDatagram(kMaxDatagramSize);
+        const QByteArray data = datagram.data();
+        handleDatagram(data.constData(), data.size(), LatencyTrace::now(), batch);
+    }
+#endif
+
+    commitStats(batch);
+}
+
+//解析一个数据报，UDP报文边界即帧边界，但一个数据报里允许放多帧
+void UdpWorker::handleDatagram(const char *data, int size, qint64 readAt, UdpStats &batch)
+{
+    batch.datagrams++;
+    m_parser.append(QByteArray(data, size));
+
+    bool parsed = false;
+    QByteArray frame;
+    while (m_parser.nextFrame(frame)) {
+        SensorData result;
+        QString rawStr = QString(frame).trimmed();
+        if (FrameParser::rawDataEnabled()) {
+            emit rawdata(rawStr);//发送原始数据到调试终端。
+        }
+        if (FrameParser::parseSensorData(rawStr, result)) {
+            parsed = true;
+            result.readAt = readAt;
+            result.parsedAt = LatencyTrace::now();
+            batch.frames++;
+            m_traffic.recordFrame(result.node, frame.size());
+            m_tracker.record(result.node, result.seq, readAt / 1000);
+            emit showsensordata(result);
+        }
+    }
+    if (!parsed) {
+        batch.parseErrors++;
+        m_traffic.recordParseFailure();
+    }
+
+    // 数据报之间互不拼接
+    m_parser.clear();
+}
+
+void UdpWorker::commitStats(const UdpStats &batch)
+{
+    QMutexLocker locker(&m_statsMutex);
+    m_stats.datagrams += batch.datagrams;
+    m_stats.wakeups += batch.wakeups;
+    m_stats.frames += batch.frames;
+    m_stats.parseErrors += batch.parseErrors;
+    m_stats.seq = m_tracker.total();
+}
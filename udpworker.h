@@ -0,0 +1,71 @@
+﻿#ifndef UDPWORKER_H
+#define UDPWORKER_H
+
+#include <QObject>
+#include <QMutex>
+#include <QByteArray>
+#include <QVector>
+#include "sensordata.h"
+#include "frameparser.h"
+#include "sequencetracker.h"
+#include "metrics.h"
+
+class QUdpSocket;
+class QSocketNotifier;
+
+// UdpStats - UDP接收统计
+struct UdpStats {
+    quint64 datagrams = 0;    // 收到的数据报数
+    quint64 wakeups = 0;      // 读事件次数（datagrams/wakeups 即每次唤醒批量取走的数据报数）
+    quint64 frames = 0;       // 解析成功的报文数
+    quint64 parseErrors = 0;  // 解析失败的数据报数
+    SeqStats seq;             // 按节点序号统计的丢包/乱序汇总
+};
+
+// UdpWorker - UDP数据接收工作对象
+// 用于10~50Hz的高频节点：没有TCP的连接开销和队头阻塞，丢包通过报文中的seq字段统计。
+// 与SerialWorker一样通过moveToThread运行在独立线程中。
+// Linux上用recvmmsg一次系统调用取走多个数据报，其他平台退回QUdpSocket逐个读取。
+class UdpWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit UdpWorker(QObject *parent = nullptr);
+    ~UdpWorker();
+
+    // 统计快照，可在任意线程调用
+    UdpStats stats() const;
+
+public slots:
+    void startListening(quint16 port);//开始监听端口
+    void stopListening();//停止监听
+
+signals:
+    void rawdata(QString);//发送原始数据在调试窗口
+    void showsensordata(SensorData);//将接收到的数据，在界面上展示出来
+    void listenStatusChanged(bool listening, const QString &message);//监听状态变化
+
+private slots:
+    void readDatagrams();//读事件：批量取走所有待处理的数据报
+
+private:
+    static const int kBatchSize = 64;        // 每次recvmmsg最多取走的数据报数
+    static const int kMaxDatagramSize = 2048; // 单个数据报的最大长度
+
+    QUdpSocket *m_socket = nullptr;        // 非Linux平台使用
+    QSocketNotifier *m_notifier = nullptr; // Linux平台使用
+    int m_fd = -1;                         // Linux平台的原生套接字
+    QByteArray m_batchBuffer;              // recvmmsg接收缓冲区（kBatchSize * kMaxDatagramSize）
+
+    FrameParser m_parser;      // 一个数据报内可能有多帧
+    SequenceTracker m_tracker; // 序号跟踪，只在工作线程中访问
+    NodeTrafficMetrics m_traffic{"udp"}; // 各节点的报文数、字节数和解析失败数
+
+    mutable QMutex m_statsMutex;
+    UdpStats m_stats;
+
+    void handleDatagram(const char *data, int size, qint64 readAt, UdpStats &batch);//解析一个数据报，readAt为读出时刻
+    void commitStats(const UdpStats &batch);//把本次唤醒的统计合并到快照
+};
+
+#endif // UDPWORKER_H
@@ -1,31 +1,56 @@
 ﻿#include "widget.h"
 #include "ui_widget.h"
 #include <QNetworkInterface>
+#include <QSerialPortInfo>
 #include <QMessageBox>
 #include <QTimer>
-#include <QDebug>
+#include <QDeadlineTimer>
 #include <QFileDialog>
 #include <QStringList>
-// 引入QXlsx库
-#include "QXlsx/header/xlsxdocument.h"
-#include "QXlsx/header/xlsxformat.h"
-#include "QXlsx/header/xlsxchart.h"
-#include "QXlsx/header/xlsxcellrange.h"
-using namespace QXlsx;
-
-Widget::Widget(QWidget *parent)
+#include "excelexport.h"
+#include "metrics.h"
+#include "logger.h"
+
+Widget::Widget(const QElapsedTimer &startupClock, QWidget *parent)
     : QWidget(parent)
     , ui(new Ui::Widget)
+    , startupClock(startupClock)
 {
     ui->setupUi(this);
     init();
 }
 
+//记录从main()开始到某个启动阶段的耗时
+void Widget::recordStartupPhase(const char *phase)
+{
+    const qint64 ms = startupClock.elapsed();
+    Metrics::instance()
+        .gauge("sensor_startup_milliseconds", "从程序启动到各阶段（listening开始监听/shown首次显示/ready初始化完成）的毫秒数",
+               QString("phase=\"%1\"").arg(phase))
+        ->set(ms);
+    LOG_INFO("startup", "启动阶段", {"phase", phase}, {"ms", ms});
+}
+
+//开始抓包，已建立的连接不受影响
+bool Widget::startCapture(const QString &fileName)
+{
+    QSharedPointer<PacketCapture> file(new PacketCapture);
+    if (!file->open(fileName)) {
+        LOG_ERROR("capture", "无法创建抓包文件", {"file", fileName}, {"error", file->errorString()});
+        return false;
+    }
+    capture = file;
+    LOG_INFO("capture", "开始抓包", {"file", fileName});
+    return true;
+}
+
 //有客户端连接到消息服务器
 void Widget::do_msgnewConnection(qintptr socket)//处理客户端msgsocket的连接
 {
     //传的是socket描述符，根据socket描述符，可以初始化TcpSocket
     MsgWorker *worker=new MsgWorker(socket);//初始化客户端线程
+    worker->setCapture(capture);
+    msgWorkers.append(worker);
     worker->start();//因为继承了QThread，这里启动线程，启动run（）函数
     
     // 连接成功，更新连接状态标签为"已连接"
@@ -33,17 +58,20 @@ void Widget::do_msgnewConnection(qintptr socket)//处理客户端msgsocket的连
     
     // 连接worker的deletethread信号到线程安全销毁的lambda
     connect(worker,&MsgWorker::deletethread,this,[this, worker](){
+        // 退出过程（shutdown）已接管并释放该线程
+        if (!msgWorkers.removeOne(worker)) {
+            return;
+        }
         worker->wait();// 主线程等待子线程安全退出
         worker->deleteLater();// 安全释放线程对象
         // 连接断开，更新连接状态标签为"未连接"
         ui->connectlab->setText("未连接");
-        qDebug()<<"成功删除通信线程"<<'\n';
+        LOG_DEBUG("tcp", "连接线程已释放", {"connections", int(msgWorkers.size())});
     });
     
-    // 连接worker的rawdata信号到调试窗口的showdata槽函数
-    connect(worker, &MsgWorker::rawdata, deb, &debugging::showdata);//发送信号，让原始数据显示在调试界面
-    connect(deb,&debugging::senddata,worker,&MsgWorker::sendstrdata);//接收到发送信号，发送数据给下位机
-    connect(worker,&MsgWorker::showsensordata,this,&Widget::showdata);//发送信号，让接收到的数据显示在界面上
+    // 原始数据和解析后的数据进入有界队列，由界面每帧批量取出
+    connectIngest(worker);
+    connect(this,&Widget::senddata,worker,&MsgWorker::sendstrdata);//接收到发送信号，发送数据给下位机
 }
 
 //初始化图表
@@ -86,12 +114,26 @@ void Widget::initCharts()
     timeTicker1->setDateTimeFormat("HH:mm:ss");
     timeTicker1->setDateTimeSpec(Qt::LocalTime);
     customPlot1->xAxis->setTicker(timeTicker1);
+
+    // 四边坐标轴只需设置一次，上/右轴的范围通过信号跟随下/左轴
+    customPlot1->axisRect()->setupFullAxesBox(true);
     
     // 启用图例
     customPlot1->legend->setVisible(true);
     
     // 设置抗锯齿
     customPlot1->setAntialiasedElements(QCP::aeAll);
+
+    // 每条曲线放在各自的缓冲层上，多条曲线在线程池中并行光栅化，界面线程只贴图
+    QCPLayer *below1 = customPlot1->layer("main");
+    for (int i = 0; i < customPlot1->graphCount(); ++i) {
+        const QString name = QString("graph%1").arg(i);
+        customPlot1->addLayer(name, below1, QCustomPlot::limAbove);
+        below1 = customPlot1->layer(name);
+        below1->setMode(QCPLayer::lmBuffered);
+        customPlot1->graph(i)->setLayer(below1);
+    }
+    customPlot1->setThreadedRendering(true);
     
     // 将图表添加到frame1
     QVBoxLayout *layout1 = new QVBoxLayout(ui->charFrame1);
@@ -124,35 +166,177 @@ void Widget::initCharts()
     timeTicker2->setDateTimeFormat("HH:mm:ss");
     timeTicker2->setDateTimeSpec(Qt::LocalTime);
     customPlot2->xAxis->setTicker(timeTicker2);
+
+    // 四边坐标轴只需设置一次，上/右轴的范围通过信号跟随下/左轴
+    customPlot2->axisRect()->setupFullAxesBox(true);
     
     // 启用图例
     customPlot2->legend->setVisible(true);
     
     // 设置抗锯齿
     customPlot2->setAntialiasedElements(QCP::aeAll);
+
+    // 每条曲线放在各自的缓冲层上，多条曲线在线程池中并行光栅化，界面线程只贴图
+    QCPLayer *below2 = customPlot2->layer("main");
+    for (int i = 0; i < customPlot2->graphCount(); ++i) {
+        const QString name = QString("graph%1").arg(i);
+        customPlot2->addLayer(name, below2, QCustomPlot::limAbove);
+        below2 = customPlot2->layer(name);
+        below2->setMode(QCPLayer::lmBuffered);
+        customPlot2->graph(i)->setLayer(below2);
+    }
+    customPlot2->setThreadedRendering(true);
     
     // 将图表添加到frame2
     QVBoxLayout *layout2 = new QVBoxLayout(ui->charFrame2);
     layout2->setContentsMargins(0, 0, 0, 0);
     layout2->addWidget(customPlot2);
+
+    // 每次重绘的耗时（afterReplot发出时replotTime()已是本次的值）
+    const QList<QCustomPlot *> plots = {customPlot1, customPlot2};
+    for (int i = 0; i < plots.size(); ++i) {
+        QCustomPlot *plot = plots.at(i);
+        MetricHistogram *replotSeconds = Metrics::instance().histogram(
+            "sensor_replot_seconds", "实时曲线一次重绘的耗时", 1e-6, QString("plot=\"%1\"").arg(i + 1));
+        connect(plot, &QCustomPlot::afterReplot, this, [plot, replotSeconds]() {
+            replotSeconds->record(qint64(plot->replotTime() * 1000));
+        });
+    }
+    // 两个图表排在同一次事件中重绘：第一个开始时记下开始时刻，第二个结束时读数已画进两个图表。
+    // 曲线在线程池中光栅化，afterReplot时还没有显示，等两个图表的光栅化结果都显示后再记录显示延迟
+    connect(customPlot1, &QCustomPlot::beforeReplot, this, [this]() {
+        replotStart = LatencyTrace::now();
+    });
+    connect(customPlot2, &QCustomPlot::afterReplot, this, [this]() {
+        if (unpainted.isEmpty()) {
+            return;
+        }
+        drawn.append({unpainted, replotStart, {customPlot1->replotCount(), customPlot2->replotCount()}});
+        unpainted.clear();
+    });
+    for (int i = 0; i < plots.size(); ++i) {
+        connect(plots.at(i), &QCustomPlot::afterRasterize, this, [this, i](quint64 replotCount) {
+            recordShown(i, replotCount);
+        });
+    }
+
+    // 历史模式：瓦片在数据库线程中查询，结果排队回到界面线程
+    history = new HistoryChart({customPlot1, customPlot2}, this);
+    connect(history, &HistoryChart::requestTile, dbWorker, &DatabaseWorker::queryHistoryTile);
+    connect(dbWorker, &DatabaseWorker::historyTileReady, history, &HistoryChart::onTileReady);
+
+    liveData.reset(new QCPDataColumns(6));
+    bindLiveGraphs();
+
+    // 节点热力图先隐藏创建，从启动起就按分钟累加
+    heatmap = new NodeHeatmap();
+}
+
+//图表plot已显示到第replotCount次重绘（afterRasterize）；两个图表都已显示的读数记录显示延迟
+void Widget::recordShown(int plot, quint64 replotCount)
+{
+    shownReplot[plot] = qMax(shownReplot[plot], replotCount);
+    const qint64 shownAt = LatencyTrace::now();
+    while (!drawn.isEmpty() && drawn.first().replots[0] <= shownReplot[0] && drawn.first().replots[1] <= shownReplot[1]) {
+        LatencyTrace::recordPainted(drawn.first().readings, drawn.first().replotStart, shownAt);
+        drawn.removeFirst();
+    }
+}
+
+//让六条曲线直接显示liveData中对应的通道（历史模式会替换曲线数据，退出时需重新绑定）
+void Widget::bindLiveGraphs()
+{
+    const QList<QCustomPlot *> plots = {customPlot1, customPlot2};
+    for (int i = 0; i < plots.size(); ++i) {
+        for (int j = 0; j < 3; ++j) {
+            plots.at(i)->graph(j)->setData(QSharedPointer<QCPGraphDataContainer>(new QCPGraphDataContainer(liveData, i * 3 + j)));
+        }
+    }
+}
+
+//切换历史曲线/实时曲线
+void Widget::on_historybtn_clicked()
+{
+    if (!history) {
+        return; // 图表尚未创建（initDeferred）
+    }
+    if (history->isActive()) {
+        history->stop();
+        ui->historybtn->setText("历史曲线");
+        bindLiveGraphs();
+        updateLiveCharts();
+        return;
+    }
+    ui->historybtn->setText("实时曲线");
+    // 默认显示最近一小时，之后可拖动、滚轮缩放
+    history->start(QDateTime::currentDateTime().toMSecsSinceEpoch() / 1000.0, 3600);
 }
 
+//启动时只做开始接收所必需的初始化，尽快开始监听；调试窗口和MySQL窗口在第一次打开时才创建，
+//图表、热力图、串口等在窗口第一次显示之后（initDeferred）再初始化。
+//数据库在数据库线程中连接，连不上时按退避重试，不阻塞监听；期间的数据留在待入库队列中。
 void Widget::init()
 {
-    // 创建调试窗口但默认隐藏
-    deb = new debugging();
-    deb->setAttribute(Qt::WA_DeleteOnClose, false); // 关闭时不自动删除
-    
-    // 创建MySQL窗口并显示以确保数据库连接建立
-    mysqldb = new Mysql();
-    mysqldb->setAttribute(Qt::WA_DeleteOnClose, false); // 关闭时不自动删除
+    // 端口、报警阈值等取自配置文件，之后配置文件修改时由applyConfig处理
+    const AppConfig &config = Config::current();
+    port = config.port;
+    ui->portlineEdit->setText(QString::number(port));
+    applyAlarmThresholds(config);
+    connect(&Config::instance(), &Config::changed, this, &Widget::applyConfig);
+
+    // 数据库工作线程（其待入库队列需要在各接收源连接之前创建）
+    initDatabase();
     
+    // 创建有界队列（需要在各接收源连接之前）
+    initQueues();
+
     msgserver=new MyTcpServer(this);//创建Tcp服务器对象
     //QHostAddress::Any //双栈任意地址。以这种地址绑定的套接字将同时监听两个端口。 一。
     msgserver->listen(QHostAddress::Any,port);//监听端口
     // 连接服务器的newDescriptor信号到Widget的do_msgnewConnection槽函数
     connect(msgserver, &MyTcpServer::newDescriptor, this, &Widget::do_msgnewConnection);
+    // 初始化UDP监听
+    initUdp();
+    recordStartupPhase("listening");
 
+    // 设置raySlider的范围和初始值
+    // 滑动条范围设为0-1950，用于映射到50-2000 μmol/m²
+    ui->raySlider->setRange(0, 1950);
+    ui->raySlider->setValue(0); // 默认在最小值位置
+
+    // 初始化raylabel显示
+    ui->raylabel->setText("50 μmol/m²");
+
+    //当端口行编辑完成之后，更改服务器监听的端口
+    connect(ui->portlineEdit,&QLineEdit::editingFinished,this,&Widget::portchange);
+    // 连接滑动条值变化信号到lambda函数，更新raylabel显示
+    connect(ui->raySlider, &QSlider::valueChanged, [this](int value) {
+        // 将0-1950映射到50-2000 μmol/m²
+        int mappedValue = 50 + value;
+        QString rayText = QString::number(mappedValue) + " μmol/m²";
+        ui->raylabel->setText(rayText);
+        
+        // 如果灯是开着的，同步更新lightbtn的文本
+        if (light) {
+            ui->lightbtn->setText(rayText);
+        }
+    });
+}
+
+//窗口第一次显示：其余初始化排到事件队列中，先完成第一次绘制
+void Widget::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    if (!deferredInitDone) {
+        deferredInitDone = true;
+        recordStartupPhase("shown");
+        QMetaObject::invokeMethod(this, [this]() { initDeferred(); }, Qt::QueuedConnection);
+    }
+}
+
+//第一次显示之后的初始化
+void Widget::initDeferred()
+{
     // 获取并显示本地IPv4地址，便于复制连接
     QString ipAddress = "";
     QList<QHostAddress> ipAddressesList = QNetworkInterface::allAddresses();
@@ -173,29 +357,197 @@ void Widget::init()
     ui->iplineEdit->setReadOnly(true);
     // 初始化图表
     initCharts();
+    // 初始化串口
+    initSerial();
 
-    // 设置raySlider的范围和初始值
-    // 滑动条范围设为0-1950，用于映射到50-2000 μmol/m²
-    ui->raySlider->setRange(0, 1950);
-    ui->raySlider->setValue(0); // 默认在最小值位置
+    // 图表就绪后开始每帧取出界面队列（此前的数据在队列中等待，满时丢弃最旧的）
+    frameTimer->start(1000 / Config::current().fps);
+    recordStartupPhase("ready");
+}
 
-    // 初始化raylabel显示
-    ui->raylabel->setText("50 μmol/m²");
+//创建数据库工作线程
+void Widget::initDatabase()
+{
+    dbThread = new QThread(this);
+    dbWorker = new DatabaseWorker(OverflowPolicy::SpillToDisk, Config::current().storeQueueCapacity);
+    dbWorker->moveToThread(dbThread);
+    // 配置修改在数据库线程中处理（写入间隔、连接参数）
+    connect(&Config::instance(), &Config::changed, dbWorker, &DatabaseWorker::applyConfig);
 
-    //当端口行编辑完成之后，更改服务器监听的端口
-    connect(ui->portlineEdit,&QLineEdit::editingFinished,this,&Widget::portchange);
-    // 连接滑动条值变化信号到lambda函数，更新raylabel显示
-    connect(ui->raySlider, &QSlider::valueChanged, [this](int value) {
-        // 将0-1950映射到50-2000 μmol/m²
-        int mappedValue = 50 + value;
-        QString rayText = QString::number(mappedValue) + " μmol/m²";
-        ui->raylabel->setText(rayText);
-        
-        // 如果灯是开着的，同步更新lightbtn的文本
-        if (light) {
-            ui->lightbtn->setText(rayText);
-        }
+    // 线程结束时释放工作对象
+    connect(dbThread, &QThread::finished, dbWorker, &QObject::deleteLater);
+    // 线程启动后开始批量写入待入库队列，并在后台连接数据库
+    connect(dbThread, &QThread::started, dbWorker, &DatabaseWorker::startStoreDrain);
+    connect(dbThread, &QThread::started, dbWorker, &DatabaseWorker::connectToDatabase);
+
+    dbThread->start();
+}
+
+//初始化串口
+void Widget::initSerial()
+{
+    // 列出本机可用串口；下拉框可编辑，也可以手动输入 /dev/pts/N 等路径
+    const QList<QSerialPortInfo> ports = QSerialPortInfo::availablePorts();
+    for (const QSerialPortInfo &info : ports) {
+        ui->serialcombo->addItem(info.portName());
+    }
+
+    ui->baudcombo->addItems({"9600", "19200", "38400", "57600", "115200"});
+    ui->baudcombo->setCurrentText("115200");
+    ui->framecombo->addItems({"8N1", "8E1", "8O1", "7E1", "7O1", "8N2"});
+
+    // 串口工作对象运行在独立线程中，与数据库工作线程的方式相同
+    serialThread = new QThread(this);
+    serialworker = new SerialWorker();
+    serialworker->moveToThread(serialThread);
+    connect(serialThread, &QThread::finished, serialworker, &QObject::deleteLater);
+
+    connect(this, &Widget::openSerialSignal, serialworker, &SerialWorker::openPort);
+    connect(this, &Widget::closeSerialSignal, serialworker, &SerialWorker::closePort);
+    connect(serialworker, &SerialWorker::portStatusChanged, this, &Widget::onSerialStatusChanged);
+    connectIngest(serialworker);
+    connect(this, &Widget::senddata, serialworker, &SerialWorker::sendstrdata);//接收到发送信号，发送数据给下位机
+
+    serialThread->start();
+}
+
+//打开/关闭串口按钮按下
+void Widget::on_serialbtn_clicked()
+{
+    if (serialOpen) {
+        serialOpen = false;
+        ui->serialbtn->setText("打开串口");
+        emit closeSerialSignal();
+        return;
+    }
+
+    SerialConfig config;
+    config.portName = ui->serialcombo->currentText().trimmed();
+    bool ok = false;
+    config.baudRate = ui->baudcombo->currentText().toInt(&ok);
+    if (config.portName.isEmpty() || !ok || config.baudRate <= 0
+        || !SerialWorker::parseFraming(ui->framecombo->currentText(), config)) {
+        QMessageBox::warning(this, "串口", "串口参数有误");
+        return;
+    }
+
+    serialOpen = true;
+    ui->serialbtn->setText("关闭串口");
+    emit openSerialSignal(config);
+}
+
+//串口状态变化
+void Widget::onSerialStatusChanged(bool opened, const QString &message)
+{
+    LOG_INFO("serial", "串口状态变化", {"opened", opened}, {"message", message});
+    if (serialOpen) {
+        ui->connectlab->setText(opened ? "串口已连接" : "串口重连中");
+    }
+}
+
+//初始化UDP监听
+void Widget::initUdp()
+{
+    udpThread = new QThread(this);
+    udpworker = new UdpWorker();
+    udpworker->moveToThread(udpThread);
+    connect(udpThread, &QThread::finished, udpworker, &QObject::deleteLater);
+
+    connect(this, &Widget::startUdpSignal, udpworker, &UdpWorker::startListening);
+    connect(this, &Widget::stopUdpSignal, udpworker, &UdpWorker::stopListening);
+    connect(udpworker, &UdpWorker::listenStatusChanged, this, [](bool listening, const QString &message) {
+        LOG_INFO("udp", "UDP监听状态变化", {"listening", listening}, {"message", message});
     });
+    connectIngest(udpworker);
+
+    udpThread->start();
+    emit startUdpSignal(static_cast<quint16>(port));
+}
+
+//创建有界队列
+void Widget::initQueues()
+{
+    // 界面只关心最新数据，落后时丢弃最旧的快照
+    uiQueue.reset(new MpscRing<SensorData>("ui", Config::current().uiQueueCapacity));
+    rawQueue.reset(new BoundedQueue<QString>("raw", Config::current().rawQueueCapacity, OverflowPolicy::DropOldest));
+    // 待入库队列由数据库工作对象持有（溢出写磁盘，不丢数据）
+    storeQueue = dbWorker->storeQueue();
+
+    // 队列深度等在抓取/metrics时才读取
+    QList<std::function<QueueStats()>> sources;
+    QSharedPointer<MpscRing<SensorData>> ui = uiQueue;
+    QSharedPointer<BoundedQueue<QString>> raw = rawQueue;
+    QSharedPointer<BoundedQueue<SensorData>> store = storeQueue;
+    sources << [ui]() { return ui->stats(); } << [raw]() { return raw->stats(); };
+    if (store) {
+        sources << [store]() { return store->stats(); };
+    }
+    Metrics &metrics = Metrics::instance();
+    for (const std::function<QueueStats()> &source : sources) {
+        const QString labels = QString("queue=\"%1\"").arg(source().name);
+        metrics.gaugeCallback("sensor_queue_depth", "队列中等待的条数", labels,
+                              [source]() { return double(source().depth); });
+        metrics.gaugeCallback("sensor_queue_spilled", "溢出到磁盘的条数", labels,
+                              [source]() { return double(source().spilled); });
+        metrics.counterCallback("sensor_queue_dropped_total", "队列满时丢弃的条数", labels,
+                                [source]() { return double(source().dropped); });
+    }
+
+    // 每帧（默认30fps，见配置[ui] fps）批量取出一次，代替每条数据一个排队事件；图表创建后（initDeferred）才启动
+    frameTimer = new QTimer(this);
+    connect(frameTimer, &QTimer::timeout, this, &Widget::drainQueues);
+
+    // 每秒刷新一次统计
+    QTimer *statsTimer = new QTimer(this);
+    connect(statsTimer, &QTimer::timeout, this, &Widget::updateStats);
+    statsTimer->start(1000);
+}
+
+//每帧批量取出界面队列和调试队列中的数据
+void Widget::drainQueues()
+{
+    QVector<SensorData> readings;
+    uiQueue->popBatch(readings, 256);
+    for (const SensorData &data : readings) {
+        showdata(data);
+    }
+    heatmap->addReadings(readings);
+    // 历史模式下实时数据不重绘，不计显示延迟
+    if (!history->isActive()) {
+        unpainted += readings;
+    }
+
+    QVector<QString> lines;
+    rawQueue->popBatch(lines, 256);
+    if (deb && !lines.isEmpty()) {
+        deb->showlines(lines);
+    }
+}
+
+//刷新UDP丢包/乱序和队列统计显示（鼠标悬停在连接状态上查看）
+void Widget::updateStats()
+{
+    QStringList lines;
+    if (udpworker) {
+        UdpStats stats = udpworker->stats();
+        lines << QString("UDP 数据报:%1 报文:%2 解析失败:%3")
+                     .arg(stats.datagrams).arg(stats.frames).arg(stats.parseErrors);
+        lines << QString("丢包:%1 乱序:%2 重复:%3 过旧:%4 节点重启:%5 序号跳跃:%6 超出节点上限:%7")
+                     .arg(stats.seq.lost).arg(stats.seq.reordered).arg(stats.seq.duplicates)
+                     .arg(stats.seq.late).arg(stats.seq.resets).arg(stats.seq.jumps).arg(stats.seq.untracked);
+    }
+
+    QList<QueueStats> queues;
+    queues << uiQueue->stats() << rawQueue->stats();
+    if (storeQueue) {
+        queues << storeQueue->stats();
+    }
+    for (const QueueStats &q : queues) {
+        lines << QString("队列[%1] 深度:%2/%3 峰值:%4 溢出到磁盘:%5 丢弃:%6")
+                     .arg(q.name).arg(q.depth).arg(q.capacity).arg(q.highWater)
+                     .arg(q.spilled).arg(q.dropped);
+    }
+    ui->connectlab->setToolTip(lines.join('\n'));
 }
 
 // 简单的输入验证函数，检查报警阈值是否为有效数字
@@ -233,15 +585,27 @@ bool Widget::isValidNumber(const QString &input)
     return true;
 }
 
+//各通道的报警次数计数器
+static MetricCounter *alarmTriggered(const char *channel)
+{
+    return Metrics::instance().counter("sensor_alarms_triggered_total", "超过报警阈值的次数",
+                                       QString("channel=\"%1\"").arg(QLatin1String(channel)));
+}
+
 // 检查所有报警阈值
 void Widget::checkAlarmThresholds(const SensorData &data)
 {
+    static MetricCounter *const evaluations = Metrics::instance().counter(
+        "sensor_alarm_evaluations_total", "检查过报警阈值的读数条数");
+    evaluations->inc();
+
     // 空气温度阈值检查
     if (ui->airtemcb->isChecked()) {
         QString input = ui->airtemLE->text();
         if (isValidNumber(input)) {
             double threshold = input.toDouble();
             if (data.atemp > threshold) {
+                alarmTriggered("atemp")->inc();
                 QMessageBox::warning(this, "警报", "空气温度超过设定阈值！");
             }
         }
@@ -253,6 +617,7 @@ void Widget::checkAlarmThresholds(const SensorData &data)
         if (isValidNumber(input)) {
             double threshold = input.toDouble();
             if (data.ahumi > threshold) {
+                alarmTriggered("ahumi")->inc();
                 QMessageBox::warning(this, "警报", "空气相对湿度超过设定阈值！");
             }
         }
@@ -264,6 +629,7 @@ void Widget::checkAlarmThresholds(const SensorData &data)
         if (isValidNumber(input)) {
             double threshold = input.toDouble();
             if (data.oxygen > threshold) {
+                alarmTriggered("oxygen")->inc();
                 QMessageBox::warning(this, "警报", "氧气浓度超过设定阈值！");
             }
         }
@@ -275,6 +641,7 @@ void Widget::checkAlarmThresholds(const SensorData &data)
         if (isValidNumber(input)) {
             double threshold = input.toDouble();
             if (data.stemp > threshold) {
+                alarmTriggered("stemp")->inc();
                 QMessageBox::warning(this, "警报", "土壤温度超过设定阈值！");
             }
         }
@@ -286,6 +653,7 @@ void Widget::checkAlarmThresholds(const SensorData &data)
         if (isValidNumber(input)) {
             double threshold = input.toDouble();
             if (data.shumi2 > threshold) {
+                alarmTriggered("shumi2")->inc();
                 QMessageBox::warning(this, "警报", "土壤含水量超过设定阈值！");
             }
         }
@@ -297,6 +665,7 @@ void Widget::checkAlarmThresholds(const SensorData &data)
         if (isValidNumber(input)) {
             double threshold = input.toDouble();
             if (data.light > threshold) {
+                alarmTriggered("light")->inc();
                 QMessageBox::warning(this, "警报", "光照强度超过设定阈值！");
             }
         }
@@ -317,72 +686,71 @@ void Widget::showdata(SensorData data)
     // 调用报警阈值检查函数
     checkAlarmThresholds(data);
     
-    // 存储数据到数据库
-    qDebug() << "[Widget] 准备存储数据到数据库";
-    if (mysqldb) {
-        qDebug() << "[Widget] mysqldb对象存在，调用storeDataToDatabase方法";
-        mysqldb->storeDataToDatabase(data.atemp, data.ahumi, data.oxygen, data.stemp, data.shumi2, data.light);
-        qDebug() << "[Widget] storeDataToDatabase方法调用完成";
-    } else {
-        qDebug() << "[Widget] mysqldb对象不存在，无法存储数据";
-    }
+    // 入库已由接收线程直接写入待入库队列，这里不再等待数据库
     
     // 获取当前时间
     double currentTime = QDateTime::currentDateTime().toMSecsSinceEpoch() / 1000.0;
     
-    // 添加数据到第一个图表
-    timeData1.append(currentTime);
-    tempData.append(data.atemp);
-    humidityData.append(data.ahumi);
-    oxygenData.append(data.oxygen);
-    
-    // 添加数据到第二个图表
-    timeData2.append(currentTime);
-    soilTempData.append(data.stemp);
-    soilHumidityData.append(data.shumi2);
-    lightData.append(data.light);
-    
-    // 限制数据点数量
-    if (timeData1.size() > maxDataPoints) {
-        timeData1.removeFirst();
-        tempData.removeFirst();
-        humidityData.removeFirst();
-        oxygenData.removeFirst();
-    }
-    
-    if (timeData2.size() > maxDataPoints) {
-        timeData2.removeFirst();
-        soilTempData.removeFirst();
-        soilHumidityData.removeFirst();
-        lightData.removeFirst();
-    }
-    
-    // 更新曲线数据
-    customPlot1->graph(0)->setData(timeData1, tempData);
-    customPlot1->graph(1)->setData(timeData1, humidityData);
-    customPlot1->graph(2)->setData(timeData1, oxygenData);
-    
-    customPlot2->graph(0)->setData(timeData2, soilTempData);
-    customPlot2->graph(1)->setData(timeData2, soilHumidityData);
-    customPlot2->graph(2)->setData(timeData2, lightData);
-    
-    // 更新X轴范围
-    if (!timeData1.isEmpty()) {
-        double minTime = timeData1.first() - 1;
-        double maxTime = timeData1.last() + 1;
-        customPlot1->xAxis->setRange(minTime, maxTime);
+    // 一行：一个时间加六个通道的数值，曲线直接引用这些列
+    const double values[6] = {data.atemp, data.ahumi, data.oxygen, data.stemp, data.shumi2, data.light};
+    liveData->append(currentTime, values);
+    
+    // 限制数据点数量（只移动头部偏移）；点数可由配置文件热加载修改
+    const int maxDataPoints = Config::current().maxDataPoints;
+    if (liveData->size() > maxDataPoints) {
+        liveData->removeFirst(liveData->size() - maxDataPoints);
     }
     
-    if (!timeData2.isEmpty()) {
-        double minTime = timeData2.first() - 1;
-        double maxTime = timeData2.last() + 1;
+    // 历史模式下只更新数据，不改动正在查看的图表
+    if (!history->isActive()) {
+        updateLiveCharts();
+    }
+}
+
+//配置文件修改：端口、帧率、报警阈值立即生效（曲线点数、批大小等各处直接读取当前配置）
+void Widget::applyConfig(const AppConfig *previous, const AppConfig *current)
+{
+    if (previous->port != current->port) {
+        ui->portlineEdit->setText(QString::number(current->port));
+        listenOn(current->port);
+    }
+    if (previous->fps != current->fps) {
+        frameTimer->setInterval(1000 / current->fps);
+    }
+    applyAlarmThresholds(*current, previous);
+}
+
+//配置了阈值的通道启用报警并填入阈值，未配置的通道保持界面上的设置
+//配置文件重新加载时只处理阈值有改动的通道，不覆盖用户在界面上改过的其他通道
+void Widget::applyAlarmThresholds(const AppConfig &config, const AppConfig *previous)
+{
+    const QList<QPair<QCheckBox *, QLineEdit *>> inputs = {
+        {ui->airtemcb, ui->airtemLE},   {ui->airwatercb, ui->airwaterLE},   {ui->oxygencb, ui->oxygenLE},
+        {ui->soiltemcb, ui->soiltemLE}, {ui->soilwatercb, ui->soilwaterLE}, {ui->raycb, ui->rayLE}};
+    for (int i = 0; i < AppConfig::kAlarmChannels; ++i) {
+        const double threshold = config.alarmThresholds[i];
+        if (qIsNaN(threshold)) {
+            continue;
+        }
+        if (previous && previous->alarmThresholds[i] == threshold) {
+            continue; // 未改动（NaN与任何值都不相等，从未配置变为配置时照常填入）
+        }
+        inputs.at(i).first->setChecked(true);
+        inputs.at(i).second->setText(QString::number(threshold));
+    }
+}
+
+//用最近maxDataPoints条数据刷新实时图表
+void Widget::updateLiveCharts()
+{
+    // 曲线数据是liveData的视图，无需重新设置，只更新X轴范围
+    if (!liveData->isEmpty()) {
+        double minTime = liveData->keyAt(0) - 1;
+        double maxTime = liveData->keyAt(liveData->size() - 1) + 1;
+        customPlot1->xAxis->setRange(minTime, maxTime);
         customPlot2->xAxis->setRange(minTime, maxTime);
     }
     
-    // 确保坐标轴标签可见
-    customPlot1->axisRect()->setupFullAxesBox();
-    customPlot2->axisRect()->setupFullAxesBox();
-    
     // 重绘图表
     customPlot1->replot(QCustomPlot::rpQueuedReplot);
     customPlot2->replot(QCustomPlot::rpQueuedReplot);
@@ -414,6 +782,12 @@ void Widget::portchange()
     // 端口有效，恢复正常样式
     ui->portlineEdit->setStyleSheet("");
     
+    listenOn(newPort);
+}
+
+//切换TCP/UDP监听端口（界面修改或配置文件修改）
+void Widget::listenOn(unsigned int newPort)
+{
     // 如果端口号没有变化，不需要重新监听
     if (newPort == port) {
         return;
@@ -431,6 +805,8 @@ void Widget::portchange()
     if (msgserver) {
         msgserver->listen(QHostAddress::Any, port);
     }
+    // UDP同步切换到新端口
+    emit startUdpSignal(static_cast<quint16>(port));
 }
 
 // 发送命令到下位机并在调试界面显示
@@ -514,6 +890,9 @@ void Widget::closeEvent(QCloseEvent *event)
         sendCommand("waterOFF");
     }
     
+    // 停止接收，写完待入库数据
+    shutdown();
+    
     // 关闭debugging界面（如果存在）
     if (deb) {
         deb->close();
@@ -527,6 +906,13 @@ void Widget::closeEvent(QCloseEvent *event)
         delete mysqldb;
         mysqldb = nullptr;
     }
+
+    // 关闭节点热力图
+    if (heatmap) {
+        heatmap->close();
+        delete heatmap;
+        heatmap = nullptr;
+    }
     
     // 退出整个系统
     QApplication::quit();
@@ -535,12 +921,88 @@ void Widget::closeEvent(QCloseEvent *event)
     event->accept();
 }
 
+//有序关闭
+void Widget::shutdown()
+{
+    if (shutdownDone) {
+        return;
+    }
+    shutdownDone = true;
+    QElapsedTimer clock;
+    clock.start();
+    const int deadlineMs = Config::current().shutdownDeadlineMs;
+    if (frameTimer) {
+        frameTimer->stop();
+    }
+
+    // 1. 停止接受新的TCP连接
+    if (msgserver) {
+        msgserver->close();
+    }
+
+    // 2. UDP和串口在各自线程中读完已到达的数据后关闭；各TCP连接读完套接字中的数据后结束线程
+    if (udpworker) {
+        QMetaObject::invokeMethod(udpworker, &UdpWorker::stopListening, Qt::BlockingQueuedConnection);
+    }
+    if (serialworker) {
+        serialOpen = false;
+        QMetaObject::invokeMethod(serialworker, &SerialWorker::closePort, Qt::BlockingQueuedConnection);
+    }
+    const QList<MsgWorker *> workers = msgWorkers;
+    msgWorkers.clear();
+    for (MsgWorker *worker : workers) {
+        worker->stopAndDrain(deadlineMs / 4);
+    }
+    int unfinished = 0;
+    for (MsgWorker *worker : workers) {
+        if (worker->wait(QDeadlineTimer(qMax<qint64>(0, deadlineMs / 2 - clock.elapsed())))) {
+            delete worker;
+        } else {
+            unfinished++; // 仍在运行的线程不释放，随程序退出
+        }
+    }
+
+    // 3-4. 接收线程已结束，在剩余期限内把待入库数据写完并提交最后一批，写回每日草图后断开
+    // 阻塞调用要等数据库线程上正在执行的查询结束才开始，期限不包括这段时间，也不能打断已开始写入的一批
+    DatabaseWorker::FlushResult flush;
+    if (dbThread && dbThread->isRunning()) {
+        const int remainingMs = int(qMax<qint64>(0, deadlineMs - clock.elapsed()));
+        DatabaseWorker *worker = dbWorker;
+        QMetaObject::invokeMethod(worker, [worker, remainingMs, &flush]() {
+            flush = worker->flushForShutdown(remainingMs);
+            worker->disconnectFromDatabase();
+        }, Qt::BlockingQueuedConnection);
+    }
+
+    // 5. 报告
+    if (flush.unwritten > 0 || unfinished > 0) {
+        LOG_WARNING("shutdown", "退出时有数据未能入库", {"flushed", flush.flushed}, {"dropped", flush.unwritten},
+                    {"unfinishedConnections", unfinished}, {"elapsedMs", clock.elapsed()});
+    } else {
+        LOG_INFO("shutdown", "已写完全部数据", {"flushed", flush.flushed}, {"connections", int(workers.size())},
+                 {"elapsedMs", clock.elapsed()});
+    }
+}
+
 void Widget::on_exitbtn_clicked()
 {
     // 调用窗口关闭事件处理函数
     close();
 }
 
+//打开节点热力图窗口
+void Widget::on_heatmapbtn_clicked()
+{
+    if (!heatmap) {
+        return;
+    }
+    if (heatmap->isMinimized() || !heatmap->isVisible()) {
+        heatmap->showNormal();
+    }
+    heatmap->raise();
+    heatmap->activateWindow();
+}
+
 //调试按钮按下
 void Widget::on_debugbtn_clicked()
 {
@@ -548,6 +1010,7 @@ void Widget::on_debugbtn_clicked()
         // 如果窗口不存在，创建新窗口
         deb = new debugging();
         deb->setAttribute(Qt::WA_DeleteOnClose, false); // 关闭时不自动删除
+        connect(deb, &debugging::senddata, this, &Widget::senddata);//调试窗口发送的数据经主窗口转发给下位机
         deb->show();
     } else if (deb->isMinimized()) {
         // 如果窗口最小化，恢复正常窗口
@@ -571,7 +1034,7 @@ void Widget::on_mysqlbtn_clicked()
 {
     if (!mysqldb) {
         // 如果窗口不存在，创建新窗口
-        mysqldb = new Mysql();
+        mysqldb = new Mysql(dbWorker);
         mysqldb->setAttribute(Qt::WA_DeleteOnClose, false); // 关闭时不自动删除
         mysqldb->show();
     } else if (mysqldb->isMinimized()) {
@@ -593,31 +1056,28 @@ void Widget::on_mysqlbtn_clicked()
 
 void Widget::on_exportbtn_clicked() // 导出按钮点击事件处理函数
 {
-    qDebug() << "[导出数据] 开始从数据库导出图表数据到Excel文件"; // 输出调试信息，指示导出开始
-    
-    
+    LOG_DEBUG("export", "开始从数据库导出图表数据到Excel文件");
+
     // 确保数据库工作线程正在运行
-    if (mysqldb->chackconnect()) {
+    if (dbThread && dbThread->isRunning()) {
         // 连接数据库查询结果信号到当前类的槽函数
-        connect(mysqldb->getdataworker(), &DatabaseWorker::queryResultsReady, this, &Widget::onQueryResultsReady);
-        
-        qDebug() << "[导出数据] 请求查询所有数据库数据"; // 输出调试信息
-        
+        connect(dbWorker, &DatabaseWorker::queryResultsReady, this, &Widget::onQueryResultsReady);
+
         // 使用信号槽机制调用数据库工作线程的查询所有数据方法
-        QMetaObject::invokeMethod(mysqldb->getdataworker(), "queryAllGreenhouseData", Qt::QueuedConnection);
+        QMetaObject::invokeMethod(dbWorker, "queryAllGreenhouseData", Qt::QueuedConnection);
         
     } else {
-        qDebug() << "[导出数据] 数据库工作线程不可用"; // 输出调试信息
+        LOG_WARNING("export", "数据库工作线程不可用，无法导出");
         QMessageBox::warning(this, "导出失败", "数据库工作线程不可用，请先连接数据库");
     }
 }
 
 void Widget::onQueryResultsReady(bool success, const QList<QVariantList> &results, const QString &message)
 {
-    qDebug() << "[导出数据] 收到数据库查询结果: 成功=" << success << ", 记录数=" << results.size(); // 输出调试信息
+    LOG_DEBUG("export", "收到数据库查询结果", {"success", success}, {"rows", int(results.size())}, {"message", message});
 
     // 断开信号连接，避免重复处理
-    disconnect(mysqldb->getdataworker(), &DatabaseWorker::queryResultsReady, this, &Widget::onQueryResultsReady);
+    disconnect(dbWorker, &DatabaseWorker::queryResultsReady, this, &Widget::onQueryResultsReady);
     
     
     if (!success || results.isEmpty()) {
@@ -625,141 +1085,7 @@ void Widget::onQueryResultsReady(bool success, const QList<QVariantList> &result
         return;
     }
     
-    // 创建一个新的Excel文档对象
-    Document xlsx;
-    
-    // 创建表头格式对象
-    Format headerFormat;
-    headerFormat.setFontBold(true); // 设置表头字体为粗体
-    headerFormat.setHorizontalAlignment(Format::AlignHCenter); // 设置表头水平居中对齐
-    headerFormat.setVerticalAlignment(Format::AlignVCenter); // 设置表头垂直居中对齐
-    headerFormat.setBorderStyle(Format::BorderThin); // 设置表头边框为细边框
-    
-    // 创建数据单元格格式对象
-    Format dataFormat;
-    dataFormat.setBorderStyle(Format::BorderThin); // 设置数据单元格边框为细边框
-    
-    // 首先添加空气参数工作表
-    xlsx.addSheet("空气参数");
-    xlsx.selectSheet("空气参数");
-    
-    // 写入表头
-    xlsx.write("A1", "时间", headerFormat);
-    xlsx.write("B1", "空气温度(°C)", headerFormat);
-    xlsx.write("C1", "空气湿度(%)", headerFormat);
-    xlsx.write("D1", "氧气浓度(%)", headerFormat);
-    
-    int airDataRowCount = 0; // 计数器，用于记录实际写入的空气参数数据行数
-    
-    // 遍历查询结果，写入空气参数数据
-    for (int i = 0; i < results.size(); ++i) {
-        const QVariantList &row = results.at(i);
-        if (row.size() >= 5) { // 确保有足够的数据列
-            int excelRow = i + 2; // Excel行号从2开始
-            
-            // 从数据库结果中提取数据
-            QString timeString = row.at(1).toDateTime().toString("yyyy-MM-dd HH:mm:ss"); // 时间
-            double airTemp = row.at(2).toDouble(); // 空气温度
-            double airHumidity = row.at(3).toDouble(); // 空气湿度
-            double oxygenContent = row.at(4).toDouble(); // 氧气浓度
-            
-            // 写入Excel
-            xlsx.write(excelRow, 1, timeString, dataFormat);
-            xlsx.write(excelRow, 2, airTemp, dataFormat);
-            xlsx.write(excelRow, 3, airHumidity, dataFormat);
-            xlsx.write(excelRow, 4, oxygenContent, dataFormat);
-            
-            airDataRowCount++;
-        }
-    }
-    
-    // 如果有数据，创建空气参数图表
-    if (airDataRowCount > 0) {
-        int chartRow = airDataRowCount + 3; // 图表位置在数据下方3行
-        Chart *airChart = xlsx.insertChart(chartRow, 1, QSize(800, 400)); // 插入图表
-        
-        airChart->setChartType(Chart::CT_LineChart); // 设置为折线图
-        airChart->setChartTitle("空气参数变化趋势"); // 设置图表标题
-        
-        // 添加温度数据系列（使用时间作为X轴）
-        CellRange tempRange("A2:B" + QString::number(airDataRowCount + 1));
-        airChart->addSeries(tempRange, nullptr, false, true);
-        
-        // 添加湿度数据系列
-        CellRange humidityRange("A2:A" + QString::number(airDataRowCount + 1) + ",C2:C" + QString::number(airDataRowCount + 1));
-        airChart->addSeries(humidityRange, nullptr, false, true);
-        
-        // 添加氧气浓度数据系列
-        CellRange oxygenRange("A2:A" + QString::number(airDataRowCount + 1) + ",D2:D" + QString::number(airDataRowCount + 1));
-        airChart->addSeries(oxygenRange, nullptr, false, true);
-        
-        // 设置图表属性
-        airChart->setChartLegend(Chart::Top, false); // 图例在顶部
-        airChart->setAxisTitle(Chart::Bottom, "时间"); // X轴标题
-        airChart->setAxisTitle(Chart::Left, "数值"); // Y轴标题
-    }
-    
-    // 接下来添加土壤参数工作表
-    xlsx.addSheet("土壤参数");
-    xlsx.selectSheet("土壤参数");
-    
-    // 写入表头
-    xlsx.write("A1", "时间", headerFormat);
-    xlsx.write("B1", "土壤温度(°C)", headerFormat);
-    xlsx.write("C1", "土壤湿度(%)", headerFormat);
-    xlsx.write("D1", "光照强度(%)", headerFormat);
-    
-    int soilDataRowCount = 0; // 计数器，用于记录实际写入的土壤参数数据行数
-    
-    // 遍历查询结果，写入土壤参数数据
-    for (int i = 0; i < results.size(); ++i) {
-        const QVariantList &row = results.at(i);
-        if (row.size() >= 8) { // 确保有足够的数据列
-            int excelRow = i + 2; // Excel行号从2开始
-            
-            // 从数据库结果中提取数据
-            QString timeString = row.at(1).toDateTime().toString("yyyy-MM-dd HH:mm:ss"); // 时间
-            double soilTemp = row.at(5).toDouble(); // 土壤温度
-            double soilHumidity = row.at(6).toDouble(); // 土壤湿度
-            double lightIntensity = row.at(7).toDouble(); // 光照强度
-            
-            // 写入Excel
-            xlsx.write(excelRow, 1, timeString, dataFormat);
-            xlsx.write(excelRow, 2, soilTemp, dataFormat);
-            xlsx.write(excelRow, 3, soilHumidity, dataFormat);
-            xlsx.write(excelRow, 4, lightIntensity, dataFormat);
-            
-            soilDataRowCount++;
-        }
-    }
-    
-    // 如果有数据，创建土壤参数图表
-    if (soilDataRowCount > 0) {
-        int chartRow = soilDataRowCount + 3; // 图表位置在数据下方3行
-        Chart *soilChart = xlsx.insertChart(chartRow, 1, QSize(800, 400)); // 插入图表
-        
-        soilChart->setChartType(Chart::CT_LineChart); // 设置为折线图
-        soilChart->setChartTitle("土壤参数变化趋势"); // 设置图表标题
-        
-        // 添加土壤温度数据系列
-        CellRange soilTempRange("A2:B" + QString::number(soilDataRowCount + 1));
-        soilChart->addSeries(soilTempRange, nullptr, false, true);
-        
-        // 添加土壤湿度数据系列
-        CellRange soilHumidityRange("A2:A" + QString::number(soilDataRowCount + 1) + ",C2:C" + QString::number(soilDataRowCount + 1));
-        soilChart->addSeries(soilHumidityRange, nullptr, false, true);
-        
-        // 添加光照强度数据系列
-        CellRange lightRange("A2:A" + QString::number(soilDataRowCount + 1) + ",D2:D" + QString::number(soilDataRowCount + 1));
-        soilChart->addSeries(lightRange, nullptr, false, true);
-        
-        // 设置图表属性
-        soilChart->setChartLegend(Chart::Top, false); // 图例在顶部
-        soilChart->setAxisTitle(Chart::Bottom, "时间"); // X轴标题
-        soilChart->setAxisTitle(Chart::Left, "数值"); // Y轴标题
-    }
-    
-    // 打开文件保存对话框，让用户选择保存位置
+    // 先让用户选择保存位置，取消时不必生成工作簿
     QString fileName = QFileDialog::getSaveFileName(
         this, 
         "导出Excel文件", 
@@ -767,22 +1093,23 @@ void Widget::onQueryResultsReady(bool success, const QList<QVariantList> &result
         "Excel Files (*.xlsx);;All Files (*)"
     );
     
-    if (!fileName.isEmpty()) {
-        // 确保文件扩展名为.xlsx
-        if (!fileName.endsWith(".xlsx", Qt::CaseInsensitive)) {
-            fileName += ".xlsx";
-        }
-        
-        // 保存Excel文件
-        if (xlsx.saveAs(fileName)) {
-            qDebug() << "[导出数据] 成功保存Excel文件: " << fileName;
-            QMessageBox::information(this, "导出成功", QString("数据已成功导出到\n%1").arg(fileName));
-        } else {
-            qDebug() << "[导出数据] 保存Excel文件失败";
-            QMessageBox::warning(this, "导出失败", "无法保存Excel文件，请检查文件路径和权限");
-        }
+    if (fileName.isEmpty()) {
+        LOG_DEBUG("export", "用户取消了导出");
+        return;
+    }
+    
+    // 确保文件扩展名为.xlsx
+    if (!fileName.endsWith(".xlsx", Qt::CaseInsensitive)) {
+        fileName += ".xlsx";
+    }
+    
+    // 生成并保存Excel文件（空气参数、土壤参数两个工作表，各带一个折线图）
+    if (ExcelExporter::writeGreenhouseWorkbook(results, fileName)) {
+        LOG_INFO("export", "已导出Excel文件", {"file", fileName}, {"rows", int(results.size())});
+        QMessageBox::information(this, "导出成功", QString("数据已成功导出到\n%1").arg(fileName));
     } else {
-        qDebug() << "[导出数据] 用户取消了导出操作";
+        LOG_ERROR("export", "保存Excel文件失败", {"file", fileName});
+        QMessageBox::warning(this, "导出失败", "无法保存Excel文件，请检查文件路径和权限");
     }
 }
 
@@ -801,39 +1128,45 @@ Widget::~Widget()
         customPlot2 = nullptr;
     }
     
-    // 清除数据向量
-    timeData1.clear();
-    tempData.clear();
-    humidityData.clear();
-    oxygenData.clear();
-    timeData2.clear();
-    soilTempData.clear();
-    soilHumidityData.clear();
-    lightData.clear();
+    // 清除数据
+    liveData.clear();
     
+    // 停止UDP线程
+    if (udpThread) {
+        emit stopUdpSignal();
+        udpThread->quit();
+        udpThread->wait(3000);
+        udpworker = nullptr;
+    }
+
+    // 停止串口线程，串口工作对象在线程结束时自行释放
+    if (serialThread) {
+        emit closeSerialSignal();
+        serialThread->quit();
+        serialThread->wait(3000);
+        serialworker = nullptr;
+    }
+
     // 安全删除调试窗口
     if (deb) {
         delete deb;
         deb = nullptr;
     }
     
-    // 安全删除MySQL窗口 - 在主窗口关闭时正确断开数据库连接
+    // 安全删除MySQL窗口
     if (mysqldb) {
-        try {
-            // 调用Mysql类提供的公共方法断开数据库连接
-            mysqldb->disconnectDatabase();
-            
-            // 给一点额外时间确保所有事件都已处理
-            QCoreApplication::processEvents(QEventLoop::AllEvents, 100);
-            
-            // 安全删除MySQL窗口对象
-            delete mysqldb;
-            mysqldb = nullptr;
-        } catch (...) {
-            // 捕获异常，避免程序崩溃
-            delete mysqldb;
-            mysqldb = nullptr;
+        delete mysqldb;
+        mysqldb = nullptr;
+    }
+
+    // 断开数据库连接并停止数据库线程，数据库工作对象在线程结束时自行释放
+    if (dbThread) {
+        if (dbThread->isRunning()) {
+            QMetaObject::invokeMethod(dbWorker, "disconnectFromDatabase", Qt::BlockingQueuedConnection);
         }
+        dbThread->quit();
+        dbThread->wait(3000);
+        dbWorker = nullptr;
     }
     
     // 释放UI对象
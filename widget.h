@@ -3,14 +3,24 @@
 
 #include <QWidget>
 #include <QDateTime>
+#include <QElapsedTimer>
+#include <QPointer>
 #include <QVBoxLayout>
 #include <QFileDialog>
 #include "qcustomplot.h"
 #include "mytcpserver.h"
 #include "msgworker.h"
+#include "serialworker.h"
+#include "udpworker.h"
 #include "debugging.h"
 #include "mysql.h"
 #include "sensordata.h"
+#include "boundedqueue.h"
+#include "mpscring.h"
+#include "latencytrace.h"
+#include "historychart.h"
+#include "nodeheatmap.h"
+#include "config.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -25,43 +35,113 @@ class Widget : public QWidget
     Q_OBJECT
 
 public:
-    explicit Widget(QWidget *parent = nullptr);
+    // startupClock在main()开始时启动，用于统计启动到开始监听/显示/初始化完成的耗时
+    explicit Widget(const QElapsedTimer &startupClock, QWidget *parent = nullptr);
     ~Widget();
 
+    // 之后建立的TCP连接把收到的原始字节记录到抓包文件（tools/replay可回放）
+    bool startCapture(const QString &fileName);
+
 private:
     Ui::Widget *ui;
-    unsigned int port=1210;//端口号
+    unsigned int port=1210;//端口号（启动时取自配置文件）
     MyTcpServer *msgserver=NULL;//tcp服务
-    debugging *deb=NULL;//调试窗口
-    Mysql *mysqldb=NULL;//MySQL窗口
+    QList<MsgWorker *> msgWorkers;//各TCP连接的接收线程（退出时读完剩余数据并等待结束）
+    QPointer<debugging> deb;//调试窗口（第一次打开时创建，窗口被释放后自动置空）
+    Mysql *mysqldb=NULL;//MySQL窗口（第一次打开时创建）
+    QThread *dbThread=NULL;//数据库工作线程
+    DatabaseWorker *dbWorker=NULL;//数据库工作对象：批量入库、查询，启动时在后台连接数据库
+    SerialWorker *serialworker=NULL;//串口接收工作对象
+    QThread *serialThread=NULL;//串口工作线程
+    bool serialOpen = false;//串口是否处于打开（含自动重连）状态
+    UdpWorker *udpworker=NULL;//UDP接收工作对象
+    QThread *udpThread=NULL;//UDP工作线程
+
+    // 接收线程与界面/数据库之间的有界队列，代替逐条的跨线程信号
+    QSharedPointer<MpscRing<SensorData>> uiQueue;//界面快照队列（无锁，多个接收线程写入），满时丢弃最旧数据
+    QSharedPointer<BoundedQueue<QString>> rawQueue;//调试窗口原始数据队列，满时丢弃最旧数据
+    QSharedPointer<BoundedQueue<SensorData>> storeQueue;//待入库队列，由数据库线程批量写入
+    QTimer *frameTimer=NULL;//界面刷新定时器，每帧批量取出界面队列中的数据
+    QSharedPointer<PacketCapture> capture;//抓包文件（--capture启用）
+    QVector<SensorData> unpainted;//已加入曲线、尚未重绘的读数
+    // 已重绘、等待光栅化结果显示的读数：两个图表都显示到对应的重绘后才记录显示延迟
+    struct DrawnReadings {
+        QVector<SensorData> readings;
+        qint64 replotStart;  // 本轮重绘开始时刻（LatencyTrace::now()）
+        quint64 replots[2];  // 两个图表本轮重绘的序号（QCustomPlot::replotCount）
+    };
+    QList<DrawnReadings> drawn;
+    quint64 shownReplot[2] = {0, 0};//两个图表已显示到的重绘序号
+    qint64 replotStart = 0;//本轮重绘开始时刻
     bool light = false;//开关灯
     bool water = false;//浇水
 
     // 图表相关成员变量
-    QCustomPlot *customPlot1; // 第一个图表（空气温度、湿度、氧气）
-    QCustomPlot *customPlot2; // 第二个图表（土壤温度、湿度、光照）
-
-    // 数据存储
-    QVector<double> timeData1; // 第一个图表的时间数据
-    QVector<double> tempData;  // 空气温度数据
-    QVector<double> humidityData; // 空气湿度数据
-    QVector<double> oxygenData; // 氧气浓度数据
+    QCustomPlot *customPlot1=NULL; // 第一个图表（空气温度、湿度、氧气）
+    QCustomPlot *customPlot2=NULL; // 第二个图表（土壤温度、湿度、光照）
+    HistoryChart *history=NULL; // 图表的历史模式（拖动/缩放时从数据库按需查询）
+    NodeHeatmap *heatmap=NULL; // 全部节点 × 时间的热力图窗口（隐藏时也持续累加）
 
-    QVector<double> timeData2; // 第二个图表的时间数据
-    QVector<double> soilTempData; // 土壤温度数据
-    QVector<double> soilHumidityData; // 土壤湿度数据
-    QVector<double> lightData; // 光照强度数据
+    // 数据存储：六个通道共用一列时间，每条读数只写一次时间
+    // 通道i*3+j对应图表i的第j条曲线：空气温度、空气湿度、氧气、土壤温度、土壤湿度、光照
+    QSharedPointer<QCPDataColumns> liveData;
 
-    const int maxDataPoints = 300; // 最大数据点数量
+    // 实时曲线的最大数据点数量见配置[ui] max_data_points（Config::current().maxDataPoints）
 
     // 初始化图表函数
     void initCharts();
-    //界面初始化函数
+    // 用最近maxDataPoints条数据刷新实时图表
+    void updateLiveCharts();
+    // 让六条曲线直接显示liveData中对应的通道（不复制数据）
+    void bindLiveGraphs();
+    // 初始化串口工作线程和串口参数下拉框
+    void initSerial();
+    // 初始化UDP工作线程，与TCP监听同一端口号
+    void initUdp();
+    // 创建接收线程到界面/数据库的有界队列
+    void initQueues();
+    // 把接收源（MsgWorker/SerialWorker/UdpWorker）的数据信号接到有界队列上
+    // 使用直接连接，在接收线程中入队，不再向界面线程投递逐条的排队事件
+    template <typename Source>
+    void connectIngest(Source *source)
+    {
+        QSharedPointer<MpscRing<SensorData>> ui = uiQueue;
+        QSharedPointer<BoundedQueue<SensorData>> store = storeQueue;
+        QSharedPointer<BoundedQueue<QString>> raw = rawQueue;
+        connect(source, &Source::showsensordata, source, [ui, store](SensorData data) {
+            LatencyTrace::recordEnqueued(data);
+            ui->push(data);
+            if (store) {
+                store->push(data);
+            }
+        }, Qt::DirectConnection);
+        connect(source, &Source::rawdata, source, [raw](QString data) {
+            raw->push(data);
+        }, Qt::DirectConnection);
+    }
+    //界面初始化函数：只做开始接收所必需的部分（数据库线程、队列、TCP/UDP监听）
     void init();
+    //第一次显示之后再做的初始化：图表、热力图、串口、本机地址
+    void initDeferred();
+    //创建数据库工作线程，在后台连接数据库（失败时自动退避重试）
+    void initDatabase();
+    //记录启动阶段耗时（日志和sensor_startup_milliseconds指标）
+    void recordStartupPhase(const char *phase);
+    QElapsedTimer startupClock;
+    bool deferredInitDone = false;
+    //有序关闭：停止接受连接 → 读完已到达的数据并结束接收线程 → 在期限内写完待入库数据 → 记录写入/丢弃条数
+    void shutdown();
+    bool shutdownDone = false;
     // 简单的输入验证函数，检查是否为有效数字
     bool isValidNumber(const QString &input);
     // 检查所有报警阈值
     void checkAlarmThresholds(const SensorData &data);
+    // 把配置文件中的报警阈值填入界面；给出previous时只填入与之相比有改动的通道
+    void applyAlarmThresholds(const AppConfig &config, const AppConfig *previous = nullptr);
+    // 切换TCP/UDP监听端口
+    void listenOn(unsigned int newPort);
+    // 图表plot已显示到第replotCount次重绘：记录两个图表都已显示的读数的显示延迟
+    void recordShown(int plot, quint64 replotCount);
 
 private slots:
     void do_msgnewConnection(qintptr socket);//有客户端连接到消息服务器
@@ -72,8 +152,15 @@ private slots:
     void on_exitbtn_clicked();//系统关闭按钮点击事件
     void on_debugbtn_clicked();//调试按钮点击事件
     void on_mysqlbtn_clicked();//数据库按钮点击事件
+    void on_serialbtn_clicked();//打开/关闭串口按钮点击事件
+    void onSerialStatusChanged(bool opened, const QString &message);//串口状态变化
+    void updateStats();//刷新UDP丢包/乱序和队列统计显示
+    void drainQueues();//每帧批量取出界面队列和调试队列中的数据
     void on_exportbtn_clicked();//把数据导出为xlsx格式
+    void on_historybtn_clicked();//切换历史曲线/实时曲线
+    void on_heatmapbtn_clicked();//打开节点热力图窗口
     void onQueryResultsReady(bool success, const QList<QVariantList> &results, const QString &message); // 处理数据库查询结果的槽函数
+    void applyConfig(const AppConfig *previous, const AppConfig *current); // 配置文件修改后应用端口、帧率、报警阈值
     
 private:
     // 发送命令到下位机并在调试界面显示
@@ -82,8 +169,14 @@ private:
 protected:
     // 重写窗口关闭事件处理函数
     void closeEvent(QCloseEvent *event);
+    // 第一次显示时安排其余的初始化
+    void showEvent(QShowEvent *event) override;
     
 signals:
     void senddata(QByteArray data);
+    void openSerialSignal(const SerialConfig &config);//在串口线程中打开串口
+    void closeSerialSignal();//在串口线程中关闭串口
+    void startUdpSignal(quint16 port);//在UDP线程中开始监听
+    void stopUdpSignal();//在UDP线程中停止监听
 };
 #endif // WIDGET_H